@@ -0,0 +1,204 @@
+/*
+ * Acquisition Scheduler - Chooses between full-rate and sparse clamp
+ * sampling from the sensor readings, plus a CPU load meter.
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * ACTIVE: full DMA rate, the default after boot and after every change.
+ * IDLE:   entered once power, voltage and state have been stable for
+ *         idleAfterMs. Any power step, voltage sag, state transition or
+ *         mains event goes back to ACTIVE on the same reading.
+ * In IDLE the references are frozen at the readings that entered it, so a
+ * slow drift also ends up as a trigger instead of going unnoticed.
+ */
+
+#ifndef ACQ_SCHEDULER_H
+#define ACQ_SCHEDULER_H
+
+#include <stdint.h>
+
+enum AcqMode {
+  ACQ_MODE_ACTIVE = 0,
+  ACQ_MODE_IDLE = 1
+};
+
+// What ended the last stable period
+enum AcqTrigger {
+  ACQ_TRIGGER_NONE = 0,
+  ACQ_TRIGGER_POWER = 1,      // IN or OUT power moved by powerDeltaW
+  ACQ_TRIGGER_VOLTAGE = 2,    // Battery voltage dropped by voltageSagV
+  ACQ_TRIGGER_STATE = 3,      // detectState() transition
+  ACQ_TRIGGER_MAINS = 4       // Fast mains-loss/restore event
+};
+
+struct AcqSchedulerConfig {
+  uint32_t idleAfterMs;       // Stable time before switching to IDLE
+  float powerDeltaW;
+  float voltageSagV;
+};
+
+inline const char* acqModeName(int mode) {
+  return (mode == ACQ_MODE_IDLE) ? "idle" : "active";
+}
+
+inline const char* acqTriggerName(int trigger) {
+  switch (trigger) {
+    case ACQ_TRIGGER_POWER:   return "power";
+    case ACQ_TRIGGER_VOLTAGE: return "voltage";
+    case ACQ_TRIGGER_STATE:   return "state";
+    case ACQ_TRIGGER_MAINS:   return "mains";
+    default:                  return "none";
+  }
+}
+
+class AcquisitionScheduler {
+private:
+  AcqSchedulerConfig config;
+  AcqMode mode;
+  AcqTrigger lastTrigger;
+  bool initialized;
+  bool statsStarted;
+
+  // Readings the next one is compared with
+  float refPowerIn;
+  float refPowerOut;
+  float refVoltage;
+  int refState;
+  unsigned long stableSinceMs;
+
+  // Statistics
+  uint32_t switches;
+  unsigned long startMs;
+  unsigned long lastUpdateMs;
+  uint64_t idleMs;
+
+  void setReference(float powerIn, float powerOut, float voltage, int state) {
+    refPowerIn = powerIn;
+    refPowerOut = powerOut;
+    refVoltage = voltage;
+    refState = state;
+  }
+
+  AcqTrigger detectTrigger(float powerIn, float powerOut, float voltage, int state, bool mainsEvent) const {
+    if (mainsEvent) return ACQ_TRIGGER_MAINS;
+    if (state != refState) return ACQ_TRIGGER_STATE;
+    float deltaIn = powerIn - refPowerIn;
+    float deltaOut = powerOut - refPowerOut;
+    if (deltaIn < 0) deltaIn = -deltaIn;
+    if (deltaOut < 0) deltaOut = -deltaOut;
+    if (deltaIn >= config.powerDeltaW || deltaOut >= config.powerDeltaW) return ACQ_TRIGGER_POWER;
+    if (refVoltage - voltage >= config.voltageSagV) return ACQ_TRIGGER_VOLTAGE;
+    return ACQ_TRIGGER_NONE;
+  }
+
+public:
+  AcquisitionScheduler()
+    : mode(ACQ_MODE_ACTIVE), lastTrigger(ACQ_TRIGGER_NONE), initialized(false),
+      statsStarted(false), refPowerIn(0), refPowerOut(0), refVoltage(0), refState(0), stableSinceMs(0),
+      switches(0), startMs(0), lastUpdateMs(0), idleMs(0) {
+    config.idleAfterMs = 30000;
+    config.powerDeltaW = 20;
+    config.voltageSagV = 0.3f;
+  }
+
+  void configure(const AcqSchedulerConfig& newConfig) {
+    config = newConfig;
+  }
+
+  // Back to ACTIVE, the next reading starts a new stable period
+  void reset() {
+    mode = ACQ_MODE_ACTIVE;
+    lastTrigger = ACQ_TRIGGER_NONE;
+    initialized = false;
+  }
+
+  // One sensor reading. mainsEvent: the sampler flagged a mains loss or
+  // restore since the previous reading. Returns true when the mode changed.
+  bool update(unsigned long nowMs, float powerIn, float powerOut, float voltage, int state, bool mainsEvent) {
+    if (!initialized) {
+      setReference(powerIn, powerOut, voltage, state);
+      stableSinceMs = nowMs;
+      if (!statsStarted) {
+        startMs = nowMs;
+        statsStarted = true;
+      }
+      lastUpdateMs = nowMs;
+      initialized = true;
+      return false;
+    }
+
+    if (mode == ACQ_MODE_IDLE) idleMs += nowMs - lastUpdateMs;
+    lastUpdateMs = nowMs;
+
+    AcqTrigger trigger = detectTrigger(powerIn, powerOut, voltage, state, mainsEvent);
+    if (trigger != ACQ_TRIGGER_NONE) {
+      lastTrigger = trigger;
+      stableSinceMs = nowMs;
+      setReference(powerIn, powerOut, voltage, state);
+      if (mode == ACQ_MODE_ACTIVE) return false;
+      mode = ACQ_MODE_ACTIVE;
+      switches++;
+      return true;
+    }
+
+    if (mode == ACQ_MODE_IDLE) return false;
+
+    // ACTIVE: compare reading to reading, so only steps count as changes
+    setReference(powerIn, powerOut, voltage, state);
+    if (nowMs - stableSinceMs < config.idleAfterMs) return false;
+    mode = ACQ_MODE_IDLE;
+    switches++;
+    return true;
+  }
+
+  AcqMode getMode() const {
+    return mode;
+  }
+
+  AcqTrigger getLastTrigger() const {
+    return lastTrigger;
+  }
+
+  uint32_t getSwitches() const {
+    return switches;
+  }
+
+  // Share of the time since the first reading spent in IDLE (%)
+  float getIdlePercent() const {
+    unsigned long total = lastUpdateMs - startMs;
+    if (total == 0) return 0;
+    return (float)(idleMs * 100.0 / total);
+  }
+};
+
+// Busy time per second of wall time, measured over ~1 s windows
+class CpuLoadMeter {
+private:
+  int64_t windowStartUs;
+  int64_t busyUs;
+  volatile float usPerSecond;   // Last full window, read from other tasks
+  bool started;
+
+public:
+  CpuLoadMeter() : windowStartUs(0), busyUs(0), usPerSecond(0), started(false) {}
+
+  // busy: time spent in the measured code, nowUs: when it ended
+  void add(int64_t busy, int64_t nowUs) {
+    if (!started) {
+      windowStartUs = nowUs - busy;
+      started = true;
+    }
+    busyUs += busy;
+    int64_t elapsedUs = nowUs - windowStartUs;
+    if (elapsedUs >= 1000000) {
+      usPerSecond = (float)(busyUs * 1000000.0 / elapsedUs);
+      busyUs = 0;
+      windowStartUs = nowUs;
+    }
+  }
+
+  float getUsPerSecond() const {
+    return usPerSecond;
+  }
+};
+
+#endif // ACQ_SCHEDULER_H
@@ -0,0 +1,534 @@
+/*
+ * ADC Sampler Implementation
+ * ESP-IDF continuous ADC driver drained by a dedicated FreeRTOS task
+ */
+
+#include "adc_sampler.h"
+#include "logger.h"
+#include <esp_timer.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+
+#define ADC_SAMPLER_FRAME_BYTES (ADC_SAMPLER_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+
+// Window engine tuning from config.h
+static AdcWindowConfig samplerWindowConfig(int windowCycles, float channelRateHz) {
+  AdcWindowConfig config;
+  config.adcMidpoint = ADC_RESOLUTION / 2;
+  config.zeroCrossHysteresis = ZERO_CROSS_HYSTERESIS;
+  config.nominalHz = MAINS_FREQUENCY_DEFAULT;
+  config.windowCycles = windowCycles;
+  config.windowCyclesMin = RMS_WINDOW_CYCLES_MIN;
+  config.windowCyclesMax = RMS_WINDOW_CYCLES_MAX;
+  config.channelRateHz = channelRateHz;
+  config.mainsLossThreshold = MAINS_LOSS_THRESHOLD_COUNTS;
+  config.mainsLossHalfCycles = MAINS_LOSS_HALF_CYCLES;
+  config.mainsRestoreHalfCycles = MAINS_RESTORE_HALF_CYCLES;
+  return config;
+}
+
+// Per-channel rate the window engine sees (battery: decimation 1)
+static float samplerChannelRate(uint32_t totalHz, int decimation) {
+  return (float)totalHz / ADC_SAMPLER_PATTERN_LEN / decimation;
+}
+
+AdcSampler::AdcSampler() {
+  adcHandle = nullptr;
+  taskHandle = nullptr;
+  lock = portMUX_INITIALIZER_UNLOCKED;
+  running = false;
+
+  pins[ADC_SAMPLER_CH_IN] = PIN_SCT013_MAIN;
+  pins[ADC_SAMPLER_CH_OUT] = PIN_SCT013_OUTPUT;
+  batteryAdcChannel = 0;
+
+  sampleRateHz = ADC_SAMPLER_RATE_HZ;
+  decimation = 1;
+  requestedRateHz = ADC_SAMPLER_RATE_HZ;
+  requestedDecimation = 1;
+  mainsClearRequested = false;
+  rateSwitches = 0;
+
+  engine.begin(samplerWindowConfig(RMS_WINDOW_CYCLES_DEFAULT, samplerChannelRate(sampleRateHz, decimation)), 0);
+
+  batterySum = 0;
+  batteryCount = 0;
+  batteryWindowSamples = (uint32_t)(samplerChannelRate(sampleRateHz, 1) * BATTERY_SAMPLER_WINDOW_MS / 1000);
+  batteryFilteredRaw = 0;
+  batterySequence = 0;
+  caliFactory = false;
+  for (int i = 0; i < ADC_CALI_LUT_SIZE; i++) {
+    caliLut[i] = 0;
+  }
+  framesRead = 0;
+  samplesDropped = 0;
+  mainsEvent.sequence = 0;
+  mainsEvent.lost = false;
+  mainsEvent.onsetUs = 0;
+  mainsEvent.detectedUs = 0;
+
+  for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    adcChannels[i] = 0;
+    decimationCount[i] = 0;
+    ringHead[i] = 0;
+    for (int j = 0; j < ADC_SAMPLER_RING_SAMPLES; j++) {
+      ring[i][j] = 0;
+    }
+    published[i].meanSquare = 0;
+    published[i].samples = 0;
+    published[i].sequence = 0;
+    published[i].completedAt = 0;
+    published[i].durationUs = 0;
+    published[i].sampleRateHz = 0;
+    published[i].frequencyHz = 0;
+    published[i].cycles = 0;
+    published[i].synced = false;
+  }
+}
+
+bool AdcSampler::begin() {
+  if (running) return true;
+
+  LogSerial.println("[ADC] Starting continuous ADC sampler...");
+
+  buildCalibrationCurve();
+
+  for (int i = 0; i < ADC_SAMPLER_PATTERN_LEN; i++) {
+    int pin = (i < ADC_SAMPLER_CH_COUNT) ? pins[i] : PIN_BATTERY_VOLTAGE;
+    adc_unit_t unit;
+    adc_channel_t channel;
+    if (adc_continuous_io_to_channel(pin, &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) {
+      LOG_ERROR("ADC sampler: GPIO%d is not an ADC1 pin", pin);
+      return false;
+    }
+    if (i < ADC_SAMPLER_CH_COUNT) {
+      adcChannels[i] = (uint8_t)channel;
+    } else {
+      batteryAdcChannel = (uint8_t)channel;
+    }
+
+    pattern[i].atten = ADC_ATTEN_DB_12;
+    pattern[i].channel = (uint8_t)channel;
+    pattern[i].unit = ADC_UNIT_1;
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_continuous_handle_cfg_t handleConfig = {};
+  handleConfig.max_store_buf_size = ADC_SAMPLER_FRAME_BYTES * 4;
+  handleConfig.conv_frame_size = ADC_SAMPLER_FRAME_BYTES;
+  if (adc_continuous_new_handle(&handleConfig, &adcHandle) != ESP_OK) {
+    LOG_ERROR("ADC sampler: Failed to allocate continuous ADC handle");
+    adcHandle = nullptr;
+    return false;
+  }
+
+  if (!configureConversion(sampleRateHz)) {
+    LOG_ERROR("ADC sampler: Failed to configure continuous ADC");
+    adc_continuous_deinit(adcHandle);
+    adcHandle = nullptr;
+    return false;
+  }
+
+  adc_continuous_evt_cbs_t callbacks = {};
+  callbacks.on_conv_done = onConvDone;
+  adc_continuous_register_event_callbacks(adcHandle, &callbacks, this);
+
+  engine.begin(samplerWindowConfig(engine.getWindowCycles(), samplerChannelRate(sampleRateHz, decimation)), esp_timer_get_time());
+  batterySum = 0;
+  batteryCount = 0;
+  for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    decimationCount[i] = 0;
+  }
+
+  running = true;
+  if (xTaskCreatePinnedToCore(taskEntry, "adcSampler", ADC_SAMPLER_TASK_STACK, this,
+                              ADC_SAMPLER_TASK_PRIORITY, &taskHandle, ADC_SAMPLER_TASK_CORE) != pdPASS) {
+    LOG_ERROR("ADC sampler: Failed to create sampler task");
+    running = false;
+    adc_continuous_deinit(adcHandle);
+    adcHandle = nullptr;
+    return false;
+  }
+
+  if (adc_continuous_start(adcHandle) != ESP_OK) {
+    LOG_ERROR("ADC sampler: Failed to start continuous ADC");
+    stop();
+    return false;
+  }
+
+  LOG_INFO("ADC sampler: running %lu Hz total, %d interleaved channels + battery, window %d mains cycles",
+           (unsigned long)sampleRateHz, (int)ADC_SAMPLER_CH_COUNT, engine.getWindowCycles());
+  return true;
+}
+
+void AdcSampler::stop() {
+  if (!running && !adcHandle) return;
+
+  running = false;
+  if (taskHandle) {
+    xTaskNotifyGive(taskHandle);
+    // The task deletes itself, wait for it so the handle is not used afterwards
+    for (int i = 0; i < 20 && taskHandle; i++) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  }
+
+  if (adcHandle) {
+    adc_continuous_stop(adcHandle);
+    adc_continuous_deinit(adcHandle);
+    adcHandle = nullptr;
+  }
+  LOG_INFO("ADC sampler: stopped");
+}
+
+bool AdcSampler::isRunning() {
+  return running;
+}
+
+void AdcSampler::setWindowCycles(int cycles) {
+  engine.setWindowCycles(cycles);
+}
+
+int AdcSampler::getWindowCycles() {
+  return engine.getWindowCycles();
+}
+
+AdcWindowConfig AdcSampler::getWindowConfig() {
+  return samplerWindowConfig(engine.getWindowCycles(), samplerChannelRate(sampleRateHz, decimation));
+}
+
+bool AdcSampler::configureConversion(uint32_t rateHz) {
+  adc_continuous_config_t digConfig = {};
+  digConfig.sample_freq_hz = rateHz;
+  digConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  digConfig.pattern_num = ADC_SAMPLER_PATTERN_LEN;
+  digConfig.adc_pattern = pattern;
+  return adc_continuous_config(adcHandle, &digConfig) == ESP_OK;
+}
+
+void AdcSampler::setAcquisitionRate(uint32_t totalHz, int channelDecimation) {
+  requestedRateHz = constrain(totalHz, (uint32_t)ADC_SAMPLER_RATE_MIN_HZ, (uint32_t)ADC_SAMPLER_RATE_HZ);
+  requestedDecimation = (uint8_t)constrain(channelDecimation, 1, ADC_SAMPLER_DECIMATION_MAX);
+  if (taskHandle) {
+    xTaskNotifyGive(taskHandle);
+  }
+}
+
+// Sampler task: the driver has to be stopped to change the conversion rate
+void AdcSampler::applyRequestedRate() {
+  uint32_t rate = requestedRateHz;
+  uint8_t newDecimation = requestedDecimation;
+  if (rate == sampleRateHz && newDecimation == decimation) return;
+
+  if (rate != sampleRateHz) {
+    adc_continuous_stop(adcHandle);
+    if (!configureConversion(rate)) {
+      rate = sampleRateHz;
+      requestedRateHz = rate;
+      configureConversion(rate);
+    }
+    adc_continuous_start(adcHandle);
+  }
+
+  sampleRateHz = rate;
+  decimation = newDecimation;
+  for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    decimationCount[i] = 0;
+  }
+  engine.setChannelRate(samplerChannelRate(sampleRateHz, decimation), esp_timer_get_time());
+
+  batterySum = 0;
+  batteryCount = 0;
+  batteryWindowSamples = (uint32_t)(samplerChannelRate(sampleRateHz, 1) * BATTERY_SAMPLER_WINDOW_MS / 1000);
+  rateSwitches++;
+}
+
+uint32_t AdcSampler::getSampleRate() {
+  return sampleRateHz;
+}
+
+int AdcSampler::getDecimation() {
+  return decimation;
+}
+
+uint32_t AdcSampler::getRateSwitches() {
+  return rateSwitches;
+}
+
+float AdcSampler::getCpuUsPerSecond() {
+  return cpuLoad.getUsPerSecond();
+}
+
+int AdcSampler::getNominalFrequency() {
+  return engine.getNominalFrequency();
+}
+
+bool IRAM_ATTR AdcSampler::onConvDone(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* userData) {
+  AdcSampler* self = (AdcSampler*)userData;
+  BaseType_t mustYield = pdFALSE;
+  if (self->taskHandle) {
+    vTaskNotifyGiveFromISR(self->taskHandle, &mustYield);
+  }
+  return (mustYield == pdTRUE);
+}
+
+void AdcSampler::taskEntry(void* arg) {
+  ((AdcSampler*)arg)->taskLoop();
+}
+
+void AdcSampler::taskLoop() {
+  static uint8_t frame[ADC_SAMPLER_FRAME_BYTES];
+
+  while (running) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    if (!running) break;
+
+    int64_t startUs = esp_timer_get_time();
+    applyRequestedRate();
+
+    if (mainsClearRequested) {
+      mainsClearRequested = false;
+      if (engine.clearMainsLoss()) {
+        publishMainsEvent(MAINS_EVENT_RESTORED, startUs);
+      }
+    }
+
+    uint32_t length = 0;
+    while (running && adc_continuous_read(adcHandle, frame, sizeof(frame), &length, 0) == ESP_OK) {
+      processFrame(frame, length);
+      framesRead++;
+    }
+
+    int64_t endUs = esp_timer_get_time();
+    cpuLoad.add(endUs - startUs, endUs);
+  }
+
+  taskHandle = nullptr;
+  vTaskDelete(NULL);
+}
+
+int AdcSampler::channelIndexFor(uint8_t adcChannel) {
+  for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    if (adcChannels[i] == adcChannel) return i;
+  }
+  return -1;
+}
+
+void AdcSampler::processFrame(const uint8_t* data, uint32_t length) {
+  // The frame has just been read, its last conversion is (about) now
+  int64_t frameEndUs = esp_timer_get_time();
+
+  for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+    const adc_digi_output_data_t* result = (const adc_digi_output_data_t*)&data[i];
+    uint16_t sample = result->type1.data;
+
+    if (result->type1.channel == batteryAdcChannel) {
+      processBatterySample(sample);
+      continue;
+    }
+
+    int idx = channelIndexFor(result->type1.channel);
+    if (idx < 0) {
+      samplesDropped++;
+      continue;
+    }
+
+    if (decimation > 1) {
+      if (++decimationCount[idx] < decimation) continue;
+      decimationCount[idx] = 0;
+    }
+
+    ring[idx][ringHead[idx] % ADC_SAMPLER_RING_SAMPLES] = sample;
+    ringHead[idx]++;
+
+    uint32_t remaining = (length - i) / SOC_ADC_DIGI_RESULT_BYTES - 1;
+    int64_t sampleUs = frameEndUs - (int64_t)remaining * 1000000 / sampleRateHz;
+
+    MainsLossEvent event;
+    if (engine.addSample(idx, sample, sampleUs, event)) {
+      publishWindows();
+    }
+    if (event != MAINS_EVENT_NONE) {
+      publishMainsEvent(event, sampleUs);
+    }
+  }
+}
+
+void AdcSampler::publishWindows() {
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    published[i] = engine.result(i);
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+bool AdcSampler::getLatestWindow(AdcSamplerChannel channel, AdcRmsWindow& window) {
+  if (channel < 0 || channel >= ADC_SAMPLER_CH_COUNT) return false;
+
+  portENTER_CRITICAL(&lock);
+  window = published[channel];
+  portEXIT_CRITICAL(&lock);
+
+  return window.sequence > 0;
+}
+
+void AdcSampler::publishMainsEvent(MainsLossEvent event, int64_t sampleUs) {
+  bool lost = (event == MAINS_EVENT_LOST);
+  int64_t onsetUs = sampleUs;
+  if (lost) {
+    onsetUs -= (int64_t)(engine.mainsSilentSamples() * 1000000.0 / engine.getChannelRate());
+  }
+
+  // Full rate from the first cycles of an outage, without waiting for the
+  // sensor task to see it
+  if (lost) {
+    requestedRateHz = ADC_SAMPLER_RATE_HZ;
+    requestedDecimation = 1;
+  }
+
+  portENTER_CRITICAL(&lock);
+  mainsEvent.lost = lost;
+  mainsEvent.onsetUs = onsetUs;
+  mainsEvent.detectedUs = esp_timer_get_time();
+  mainsEvent.sequence++;
+  portEXIT_CRITICAL(&lock);
+}
+
+bool AdcSampler::isMainsLost() {
+  return engine.isMainsLost();
+}
+
+void AdcSampler::requestMainsClear() {
+  mainsClearRequested = true;
+}
+
+bool AdcSampler::getMainsEvent(AdcMainsEvent& event) {
+  portENTER_CRITICAL(&lock);
+  event = mainsEvent;
+  portEXIT_CRITICAL(&lock);
+  return event.sequence > 0;
+}
+
+void AdcSampler::processBatterySample(uint16_t sample) {
+  batterySum += sample;
+  batteryCount++;
+  if (batteryCount < batteryWindowSamples) return;
+
+  float mean = (float)batterySum / batteryCount;
+  batterySum = 0;
+  batteryCount = 0;
+
+  portENTER_CRITICAL(&lock);
+  if (batterySequence == 0) {
+    batteryFilteredRaw = mean;
+  } else {
+    batteryFilteredRaw += BATTERY_FILTER_ALPHA * (mean - batteryFilteredRaw);
+  }
+  batterySequence++;
+  portEXIT_CRITICAL(&lock);
+}
+
+void AdcSampler::buildCalibrationCurve() {
+  if (caliLut[ADC_CALI_LUT_SIZE - 1] != 0) return;  // Already built
+
+  adc_cali_handle_t caliHandle = nullptr;
+  adc_cali_line_fitting_config_t caliConfig = {};
+  caliConfig.unit_id = ADC_UNIT_1;
+  caliConfig.atten = ADC_ATTEN_DB_12;
+  caliConfig.bitwidth = ADC_BITWIDTH_12;
+#if CONFIG_IDF_TARGET_ESP32
+  caliConfig.default_vref = 1100;
+#endif
+  caliFactory = (adc_cali_create_scheme_line_fitting(&caliConfig, &caliHandle) == ESP_OK);
+
+  for (int i = 0; i < ADC_CALI_LUT_SIZE; i++) {
+    int raw = i * ADC_CALI_LUT_STEP;
+    if (raw > ADC_RESOLUTION - 1) raw = ADC_RESOLUTION - 1;
+    int mv = 0;
+    if (!caliFactory || adc_cali_raw_to_voltage(caliHandle, raw, &mv) != ESP_OK) {
+      mv = (int)(raw * ADC_VREF * 1000.0 / (ADC_RESOLUTION - 1));
+    }
+    caliLut[i] = (uint16_t)mv;
+  }
+
+  if (caliFactory) {
+    adc_cali_delete_scheme_line_fitting(caliHandle);
+    LOG_INFO("ADC sampler: Factory calibration cached (%d points, full scale %u mV)",
+             ADC_CALI_LUT_SIZE, (unsigned)caliLut[ADC_CALI_LUT_SIZE - 1]);
+  } else {
+    LOG_WARNING("ADC sampler: No factory calibration, using linear 0-3.3V scale");
+  }
+}
+
+float AdcSampler::rawToMillivolts(float raw) {
+  if (raw <= 0) return caliLut[0];
+  float pos = raw / ADC_CALI_LUT_STEP;
+  int idx = (int)pos;
+  if (idx >= ADC_CALI_LUT_SIZE - 1) return caliLut[ADC_CALI_LUT_SIZE - 1];
+  float frac = pos - idx;
+  return caliLut[idx] + frac * (caliLut[idx + 1] - caliLut[idx]);
+}
+
+bool AdcSampler::hasFactoryCalibration() {
+  return caliFactory;
+}
+
+bool AdcSampler::getBatteryMillivolts(float& millivolts) {
+  portENTER_CRITICAL(&lock);
+  float raw = batteryFilteredRaw;
+  uint32_t sequence = batterySequence;
+  portEXIT_CRITICAL(&lock);
+
+  if (sequence == 0) return false;
+  millivolts = rawToMillivolts(raw);
+  return true;
+}
+
+float AdcSampler::getBatteryRaw() {
+  portENTER_CRITICAL(&lock);
+  float raw = batteryFilteredRaw;
+  portEXIT_CRITICAL(&lock);
+  return raw;
+}
+
+bool AdcSampler::getLatestWindows(AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT]) {
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    windows[i] = published[i];
+  }
+  portEXIT_CRITICAL(&lock);
+
+  return windows[0].sequence > 0;
+}
+
+float AdcSampler::getChannelSampleRate() {
+  portENTER_CRITICAL(&lock);
+  float rate = published[ADC_SAMPLER_CH_IN].sampleRateHz;
+  portEXIT_CRITICAL(&lock);
+  return rate;
+}
+
+uint32_t AdcSampler::copyRecentSamples(AdcSamplerChannel channel, uint16_t* dest, uint32_t maxSamples) {
+  if (channel < 0 || channel >= ADC_SAMPLER_CH_COUNT || dest == nullptr) return 0;
+
+  // Samples may straddle a frame boundary while the task is writing,
+  // which is fine for diagnostics and benchmarking
+  uint32_t head = ringHead[channel];
+  uint32_t available = head < ADC_SAMPLER_RING_SAMPLES ? head : ADC_SAMPLER_RING_SAMPLES;
+  uint32_t count = maxSamples < available ? maxSamples : available;
+
+  uint32_t start = head - count;
+  for (uint32_t i = 0; i < count; i++) {
+    dest[i] = ring[channel][(start + i) % ADC_SAMPLER_RING_SAMPLES];
+  }
+  return count;
+}
+
+uint32_t AdcSampler::getFramesRead() {
+  return framesRead;
+}
+
+uint32_t AdcSampler::getSamplesDropped() {
+  return samplesDropped;
+}
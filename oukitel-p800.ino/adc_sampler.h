@@ -0,0 +1,151 @@
+/*
+ * ADC Sampler - Background continuous (DMA) acquisition of the SCT013 clamps
+ * and of the battery voltage divider. Fills per-channel ring buffers and
+ * publishes finished RMS windows and an oversampled battery reading so the
+ * main loop never runs a blocking sample loop.
+ */
+
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include "config.h"
+#include "adc_window.h"
+#include "acq_scheduler.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_adc/adc_continuous.h>
+
+// The battery divider (GPIO36) is converted in the same DMA pattern,
+// after the current channels, but is averaged instead of RMS-integrated
+#define ADC_SAMPLER_PATTERN_LEN   (ADC_SAMPLER_CH_COUNT + 1)
+
+// Cached raw -> mV calibration curve (built once at boot)
+#define ADC_CALI_LUT_SIZE         (ADC_RESOLUTION / ADC_CALI_LUT_STEP + 1)
+
+// Last fast-path mains event (loss or restore), timestamps in esp_timer us
+struct AdcMainsEvent {
+  uint32_t sequence;          // Incremented on every event, 0 = none yet
+  bool lost;                  // true = supply lost, false = restored
+  int64_t onsetUs;            // Last IN half-cycle seen before the loss (restore: detection time)
+  int64_t detectedUs;         // When the sampler flagged it
+};
+
+class AdcSampler {
+private:
+  adc_continuous_handle_t adcHandle;
+  adc_digi_pattern_config_t pattern[ADC_SAMPLER_PATTERN_LEN];
+  TaskHandle_t taskHandle;
+  portMUX_TYPE lock;
+  bool running;
+
+  int pins[ADC_SAMPLER_CH_COUNT];
+  uint8_t adcChannels[ADC_SAMPLER_CH_COUNT];
+  uint8_t batteryAdcChannel;
+
+  // Ring buffers with the most recent raw samples of each channel
+  uint16_t ring[ADC_SAMPLER_CH_COUNT][ADC_SAMPLER_RING_SAMPLES];
+  volatile uint32_t ringHead[ADC_SAMPLER_CH_COUNT];
+
+  // Window accumulation, cycle sync and mains-loss detection (sampler task
+  // only), last published windows and mains event (under lock)
+  AdcWindowEngine engine;
+  AdcRmsWindow published[ADC_SAMPLER_CH_COUNT];
+  AdcMainsEvent mainsEvent;
+
+  // Battery oversampling (sampler task) and filtered result (under lock)
+  uint32_t batterySum;
+  uint32_t batteryCount;
+  uint32_t batteryWindowSamples;
+  float batteryFilteredRaw;
+  uint32_t batterySequence;
+
+  // Factory (eFuse) calibration, sampled into a LUT at boot
+  uint16_t caliLut[ADC_CALI_LUT_SIZE];
+  bool caliFactory;
+
+  // Acquisition rate: DMA conversions/s and per-channel decimation in use
+  // (sampler task), requested by setAcquisitionRate() from other tasks
+  uint32_t sampleRateHz;
+  uint8_t decimation;
+  uint8_t decimationCount[ADC_SAMPLER_CH_COUNT];
+  volatile uint32_t requestedRateHz;
+  volatile uint8_t requestedDecimation;
+  volatile bool mainsClearRequested;      // requestMainsClear(), applied by the sampler task
+  uint32_t rateSwitches;
+
+  // Statistics
+  uint32_t framesRead;
+  uint32_t samplesDropped;
+  CpuLoadMeter cpuLoad;       // Frame reads + processing
+
+  static void taskEntry(void* arg);
+  static bool IRAM_ATTR onConvDone(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* userData);
+  void taskLoop();
+  bool configureConversion(uint32_t rateHz);
+  void applyRequestedRate();
+  void processFrame(const uint8_t* data, uint32_t length);
+  int channelIndexFor(uint8_t adcChannel);
+  void publishWindows();
+  void processBatterySample(uint16_t sample);
+  void publishMainsEvent(MainsLossEvent event, int64_t sampleUs);
+  void buildCalibrationCurve();
+
+public:
+  AdcSampler();
+  bool begin();
+  void stop();
+  bool isRunning();
+
+  // Mains cycles per RMS window (RMS_WINDOW_CYCLES_MIN..MAX)
+  void setWindowCycles(int cycles);
+  int getWindowCycles();
+
+  // Window engine tuning in use (e.g. to replay a trace with the same settings)
+  AdcWindowConfig getWindowConfig();
+
+  // Total DMA conversions/s (ADC_SAMPLER_RATE_MIN_HZ..ADC_SAMPLER_RATE_HZ) and
+  // per-channel decimation, applied by the sampler task between two frames
+  void setAcquisitionRate(uint32_t totalHz, int channelDecimation);
+  uint32_t getSampleRate();
+  int getDecimation();
+  uint32_t getRateSwitches();
+
+  // Sampler task CPU time per second of wall time (us), last full second
+  float getCpuUsPerSecond();
+
+  // Detected mains standard (50/60), MAINS_FREQUENCY_DEFAULT until detected
+  int getNominalFrequency();
+
+  // Latest finished window, returns false until the first one is available
+  bool getLatestWindow(AdcSamplerChannel channel, AdcRmsWindow& window);
+
+  // Latest finished window of every channel, copied atomically (same sequence)
+  bool getLatestWindows(AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT]);
+
+  // Fast mains-loss state and last event, false until the first event
+  bool isMainsLost();
+  bool getMainsEvent(AdcMainsEvent& event);
+
+  // Drops a reported loss from another task; the sampler task clears it
+  // between two frames and publishes a RESTORED event
+  void requestMainsClear();
+
+  // Per-channel sample rate reached in the last window (Hz)
+  float getChannelSampleRate();
+
+  // Latest filtered battery divider reading, false until the first window
+  bool getBatteryMillivolts(float& millivolts);
+  float getBatteryRaw();
+
+  // Raw ADC counts (fractional) -> calibrated mV at the ADC pin
+  float rawToMillivolts(float raw);
+  bool hasFactoryCalibration();
+
+  // Copy the most recent raw samples (oldest first), returns samples copied
+  uint32_t copyRecentSamples(AdcSamplerChannel channel, uint16_t* dest, uint32_t maxSamples);
+
+  uint32_t getFramesRead();
+  uint32_t getSamplesDropped();
+};
+
+#endif // ADC_SAMPLER_H
@@ -0,0 +1,270 @@
+/*
+ * ADC Window Engine - Turns interleaved raw clamp samples into finished,
+ * mains-cycle-aligned RMS windows and fast mains-loss events.
+ * Plain C++ (no Arduino dependencies): the continuous ADC sampler feeds it
+ * from DMA frames, the replay HAL feeds it from a recorded trace file.
+ */
+
+#ifndef ADC_WINDOW_H
+#define ADC_WINDOW_H
+
+#include <stdint.h>
+#include "rms_kernel.h"
+#include "mains_loss.h"
+
+enum AdcSamplerChannel {
+  ADC_SAMPLER_CH_IN = 0,      // GPIO34 - SCT013 Main (IN)
+  ADC_SAMPLER_CH_OUT = 1,     // GPIO35 - SCT013 Output (OUT)
+  ADC_SAMPLER_CH_COUNT = 2
+};
+
+// One finished RMS window for a channel. The pattern alternates IN/OUT
+// conversions, and all channels close their window together, so windows
+// with the same sequence cover the same mains cycles. When the reference
+// clamp carries enough current, windows start and end on its rising zero
+// crossings and span exactly the configured number of mains cycles.
+struct AdcRmsWindow {
+  double meanSquare;          // Mean of squared offset-free samples (ADC counts^2)
+  uint32_t samples;           // Samples integrated in the window
+  uint32_t sequence;          // Incremented on every published window
+  unsigned long completedAt;  // Time (ms) when the window was closed
+  uint32_t durationUs;        // Wall time covered by the window
+  float sampleRateHz;         // Effective per-channel sample rate in the window
+  float frequencyHz;          // Measured mains frequency, 0 if not cycle-synced
+  uint8_t cycles;             // Mains cycles covered (0 if not cycle-synced)
+  bool synced;                // Window aligned on zero crossings
+};
+
+// Tuning, filled from config.h on the device
+struct AdcWindowConfig {
+  int adcMidpoint;            // Initial DC offset (ADC counts)
+  int zeroCrossHysteresis;    // ADC counts around the DC offset
+  int nominalHz;              // Used until 50/60 Hz has been detected
+  int windowCycles;           // Mains cycles per window
+  int windowCyclesMin;
+  int windowCyclesMax;
+  float channelRateHz;        // Per-channel rate estimate until measured
+  int mainsLossThreshold;     // |sample - offset| counted as a half-cycle peak
+  int mainsLossHalfCycles;
+  int mainsRestoreHalfCycles;
+};
+
+class AdcWindowEngine {
+private:
+  AdcWindowConfig config;
+  RmsAccumulatorQ accumulators[ADC_SAMPLER_CH_COUNT];
+  ZeroCrossDetector detectors[ADC_SAMPLER_CH_COUNT];
+  MainsLossDetector mainsLoss;
+  AdcRmsWindow results[ADC_SAMPLER_CH_COUNT];
+
+  volatile uint8_t windowCycles;
+  uint8_t cyclesInWindow;
+  bool windowAligned;
+  int referenceChannel;
+  volatile int nominalHz;
+  int64_t windowStartUs;
+
+  // Long-term per-channel sample rate, used to turn periods into Hz
+  int64_t rateStartUs;
+  uint64_t referenceSamplesTotal;
+  float channelRateHz;
+
+  uint32_t expectedWindowSamples() const {
+    return (uint32_t)(channelRateHz * windowCycles / nominalHz);
+  }
+
+  void configureMainsLoss() {
+    uint32_t halfCycle = (uint32_t)(channelRateHz / (2 * nominalHz));
+    mainsLoss.configure(config.mainsLossThreshold << RMS_Q_SAMPLE_BITS, halfCycle,
+                        config.mainsLossHalfCycles, config.mainsRestoreHalfCycles);
+  }
+
+  void startWindow(int64_t nowUs) {
+    for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+      accumulators[i].clearWindow();
+    }
+    cyclesInWindow = 0;
+    windowStartUs = nowUs;
+  }
+
+  void closeWindows(bool synced, int64_t nowUs) {
+    uint32_t durationUs = (uint32_t)(nowUs - windowStartUs);
+
+    // Per-window durations jitter by one DMA frame, the long-term rate does not
+    int64_t elapsedUs = nowUs - rateStartUs;
+    if (elapsedUs > 1000000) {
+      channelRateHz = (float)(referenceSamplesTotal * 1000000.0 / elapsedUs);
+    }
+
+    float frequency = 0;
+    uint32_t refCount = accumulators[referenceChannel].count;
+    if (synced && refCount > 0) {
+      frequency = cyclesInWindow * channelRateHz / refCount;
+      int nominal = nominalMainsFrequency(frequency);
+      if (nominal > 0) {
+        nominalHz = nominal;
+      } else {
+        synced = false;  // Crossings from noise or harmonics, not a mains period
+        frequency = 0;
+      }
+    }
+
+    for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+      RmsAccumulatorQ& acc = accumulators[i];
+      results[i].meanSquare = acc.meanSquare();
+      results[i].samples = acc.count;
+      results[i].sequence++;
+      results[i].completedAt = (unsigned long)(nowUs / 1000);
+      results[i].durationUs = durationUs;
+      results[i].sampleRateHz = durationUs > 0 ? acc.count * 1000000.0f / durationUs : 0;
+      results[i].frequencyHz = frequency;
+      results[i].cycles = synced ? cyclesInWindow : 0;
+      results[i].synced = synced;
+    }
+
+    // Follow the clamp with the strongest signal (cleanest crossings), with
+    // a 2x RMS margin so the reference does not flap between similar channels
+    int strongest = referenceChannel;
+    for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+      if (accumulators[i].meanSquare() > 4.0 * accumulators[strongest].meanSquare()) {
+        strongest = i;
+      }
+    }
+
+    configureMainsLoss();
+    startWindow(nowUs);
+    if (strongest != referenceChannel) {
+      referenceChannel = strongest;
+      windowAligned = false;
+    }
+  }
+
+public:
+  AdcWindowEngine() {
+    AdcWindowConfig defaults = {2048, 20, 50, 10, 1, 50, 10000.0f, 40, 2, 20};
+    begin(defaults, 0);
+  }
+
+  void begin(const AdcWindowConfig& newConfig, int64_t nowUs) {
+    config = newConfig;
+    windowCycles = (uint8_t)config.windowCycles;
+    cyclesInWindow = 0;
+    windowAligned = false;
+    referenceChannel = ADC_SAMPLER_CH_IN;
+    nominalHz = config.nominalHz;
+    rateStartUs = nowUs;
+    referenceSamplesTotal = 0;
+    channelRateHz = config.channelRateHz;
+
+    for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+      accumulators[i].reset(config.adcMidpoint);
+      detectors[i].reset(config.zeroCrossHysteresis << RMS_Q_SAMPLE_BITS);
+      results[i].meanSquare = 0;
+      results[i].samples = 0;
+      results[i].sequence = 0;
+      results[i].completedAt = 0;
+      results[i].durationUs = 0;
+      results[i].sampleRateHz = 0;
+      results[i].frequencyHz = 0;
+      results[i].cycles = 0;
+      results[i].synced = false;
+    }
+    configureMainsLoss();
+    mainsLoss.reset();
+    startWindow(nowUs);
+  }
+
+  // Feed one raw sample taken at sampleUs. Returns true when the windows of
+  // all channels were closed on this sample (read them with result()).
+  // mainsEvent reports the fast mains-loss detector.
+  bool addSample(int channel, uint16_t sample, int64_t sampleUs, MainsLossEvent& mainsEvent) {
+    mainsEvent = MAINS_EVENT_NONE;
+    int32_t filtered = accumulators[channel].add(sample);
+    bool rising = detectors[channel].update(filtered);
+
+    if (channel == ADC_SAMPLER_CH_IN) {
+      mainsEvent = mainsLoss.updateIn(filtered);
+    } else {
+      mainsLoss.updateOut(filtered);
+    }
+
+    // Window boundaries follow the reference channel only
+    if (channel != referenceChannel) return false;
+    referenceSamplesTotal++;
+
+    if (rising) {
+      if (!windowAligned) {
+        // First crossing: drop the partial data, start on this edge
+        startWindow(sampleUs);
+        windowAligned = true;
+        return false;
+      }
+      cyclesInWindow++;
+      if (cyclesInWindow >= windowCycles) {
+        closeWindows(true, sampleUs);
+        return true;
+      }
+    }
+
+    // No (or lost) zero crossings, e.g. no load on the reference clamp:
+    // fall back to a fixed count equal to the expected window length
+    uint32_t limit = expectedWindowSamples();
+    if (windowAligned) limit += limit / 2;
+    if (accumulators[referenceChannel].count >= limit) {
+      closeWindows(false, sampleUs);
+      windowAligned = false;
+      return true;
+    }
+    return false;
+  }
+
+  const AdcRmsWindow& result(int channel) const {
+    return results[channel];
+  }
+
+  void setWindowCycles(int cycles) {
+    if (cycles < config.windowCyclesMin) cycles = config.windowCyclesMin;
+    if (cycles > config.windowCyclesMax) cycles = config.windowCyclesMax;
+    windowCycles = (uint8_t)cycles;
+  }
+
+  int getWindowCycles() const {
+    return windowCycles;
+  }
+
+  int getNominalFrequency() const {
+    return nominalHz;
+  }
+
+  float getChannelRate() const {
+    return channelRateHz;
+  }
+
+  // Acquisition rate changed: restart the rate estimate and the current
+  // window. The mains-loss detector keeps its state, only its sample counts
+  // are rescaled.
+  void setChannelRate(float rateHz, int64_t nowUs) {
+    channelRateHz = rateHz;
+    rateStartUs = nowUs;
+    referenceSamplesTotal = 0;
+    configureMainsLoss();
+    startWindow(nowUs);
+    windowAligned = false;
+  }
+
+  bool isMainsLost() const {
+    return mainsLoss.isLost();
+  }
+
+  // Drops a reported loss, true if there was one
+  bool clearMainsLoss() {
+    return mainsLoss.clear();
+  }
+
+  // IN samples since the last half-cycle peak (outage onset on a LOST event)
+  uint32_t mainsSilentSamples() const {
+    return mainsLoss.silentSamples();
+  }
+};
+
+#endif // ADC_WINDOW_H
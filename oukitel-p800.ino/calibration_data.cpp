@@ -37,6 +37,15 @@ int g_socChangeThreshold = SOC_CHANGE_THRESHOLD_DEFAULT;
 float g_powerStationOffVoltage = POWER_STATION_OFF_VOLTAGE_DEFAULT;
 uint32_t g_warmupDelay = WARMUP_DELAY_DEFAULT;
 float g_maxPowerReading = MAX_POWER_READING_DEFAULT;
+int g_rmsWindowCycles = RMS_WINDOW_CYCLES_DEFAULT;
+bool g_socFusionEnabled = SOC_FUSION_ENABLED_DEFAULT;
+float g_socCapacityAh = SOC_CAPACITY_AH_DEFAULT;
+bool g_harmonicAnalysisEnabled = HARMONIC_ANALYSIS_ENABLED_DEFAULT;
+bool g_lowPowerEnabled = LOW_POWER_ENABLED_DEFAULT;
+PowerFilterParams g_powerFilterIn = {POWER_FILTER_TYPE_DEFAULT, POWER_FILTER_MEDIAN3_DEFAULT,
+                                     POWER_FILTER_ALPHA_MAX_DEFAULT, POWER_FILTER_STEP_WATTS_DEFAULT};
+PowerFilterParams g_powerFilterOut = {POWER_FILTER_TYPE_DEFAULT, POWER_FILTER_MEDIAN3_DEFAULT,
+                                      POWER_FILTER_ALPHA_MAX_DEFAULT, POWER_FILTER_STEP_WATTS_DEFAULT};
 
 // ===================================================================
 // API PASSWORD VARIABLE (loaded from SPIFFS at boot)
@@ -67,32 +76,32 @@ bool g_httpShutdownSent = false;
 // ===================================================================
 
 void loadCalibrationFromSPIFFS() {
-  Serial.println("[CAL] Loading calibration from SPIFFS...");
+  LogSerial.println("[CAL] Loading calibration from SPIFFS...");
   
   if (!SPIFFS.exists(CALIBRATION_FILE)) {
-    Serial.println("[CAL] No calibration file found, using defaults");
-    Serial.println("[CAL] Default values:");
-    Serial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
-    Serial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
-    Serial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
-    Serial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
+    LogSerial.println("[CAL] No calibration file found, using defaults");
+    LogSerial.println("[CAL] Default values:");
+    LogSerial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
+    LogSerial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
+    LogSerial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
+    LogSerial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
     return;
   }
 
   File configFile = SPIFFS.open(CALIBRATION_FILE, "r");
   if (!configFile) {
     LOG_ERROR("Calibration: Failed to open file for reading");
-    Serial.println("[CAL] SPIFFS may be corrupted or file system error");
-    Serial.println("[CAL] Using default values - calibration may need to be reconfigured");
+    LogSerial.println("[CAL] SPIFFS may be corrupted or file system error");
+    LogSerial.println("[CAL] Using default values - calibration may need to be reconfigured");
     return;
   }
   
   // Check file size to prevent reading corrupted files
   size_t fileSize = configFile.size();
   if (fileSize == 0 || fileSize > 2048) {
-    LOG_ERROR("Calibration: File size invalid (" + String(fileSize) + " bytes)");
+    LOG_ERROR("Calibration: File size invalid (%u bytes)", (unsigned)fileSize);
     configFile.close();
-    Serial.println("[CAL] Using default values");
+    LogSerial.println("[CAL] Using default values");
     return;
   }
 
@@ -101,9 +110,9 @@ void loadCalibrationFromSPIFFS() {
   configFile.close();
 
   if (error) {
-    LOG_ERROR("Calibration: Failed to parse JSON: " + String(error.c_str()));
-    Serial.println("[CAL] File may be corrupted - using default values");
-    Serial.println("[CAL] Calibration may need to be reconfigured");
+    LOG_ERROR("Calibration: Failed to parse JSON: %s", error.c_str());
+    LogSerial.println("[CAL] File may be corrupted - using default values");
+    LogSerial.println("[CAL] Calibration may need to be reconfigured");
     return;
   }
 
@@ -120,17 +129,17 @@ void loadCalibrationFromSPIFFS() {
   g_fixedVoltage = doc["fixedVoltage"] | 0.0;
   g_mainsVoltage = doc["mainsVoltage"] | MAINS_VOLTAGE;
 
-  Serial.println("[CAL] Calibration loaded from SPIFFS:");
-  Serial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
-  Serial.println("     SCT013 Cal Out: " + String(g_sct013CalOut, 2));
-  Serial.println("     Battery Divider Ratio: " + String(g_batteryDividerRatio, 3));
-  Serial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
-  Serial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
-  Serial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
+  LogSerial.println("[CAL] Calibration loaded from SPIFFS:");
+  LogSerial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
+  LogSerial.println("     SCT013 Cal Out: " + String(g_sct013CalOut, 2));
+  LogSerial.println("     Battery Divider Ratio: " + String(g_batteryDividerRatio, 3));
+  LogSerial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
+  LogSerial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
+  LogSerial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
 }
 
 void saveCalibrationToSPIFFS(const CalibrationData& cal) {
-  Serial.println("[CAL] Saving calibration to SPIFFS...");
+  LogSerial.println("[CAL] Saving calibration to SPIFFS...");
   
   DynamicJsonDocument doc(896);
   doc["sct013CalIn"] = cal.sct013CalIn;
@@ -151,15 +160,15 @@ void saveCalibrationToSPIFFS(const CalibrationData& cal) {
   size_t freeBytes = totalBytes - usedBytes;
   
   if (freeBytes < 512) {
-    LOG_ERROR("Calibration: Insufficient SPIFFS space (" + String(freeBytes) + " bytes free)");
-    Serial.println("[CAL] Calibration not saved - please free up space");
+    LOG_ERROR("Calibration: Insufficient SPIFFS space (%u bytes free)", (unsigned)freeBytes);
+    LogSerial.println("[CAL] Calibration not saved - please free up space");
     return;
   }
   
   File configFile = SPIFFS.open(CALIBRATION_FILE, "w");
   if (!configFile) {
     LOG_ERROR("Calibration: Failed to open file for writing");
-    Serial.println("[CAL] SPIFFS may be full or corrupted");
+    LogSerial.println("[CAL] SPIFFS may be full or corrupted");
     return;
   }
 
@@ -183,11 +192,11 @@ void saveCalibrationToSPIFFS(const CalibrationData& cal) {
   g_mainsVoltage = cal.mainsVoltage;
   interrupts();
 
-  Serial.println("[CAL] Calibration saved successfully:");
-  Serial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
-  Serial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
-  Serial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
-  Serial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
+  LogSerial.println("[CAL] Calibration saved successfully:");
+  LogSerial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
+  LogSerial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
+  LogSerial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
+  LogSerial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
 }
 
 // ===================================================================
@@ -195,17 +204,19 @@ void saveCalibrationToSPIFFS(const CalibrationData& cal) {
 // ===================================================================
 
 void loadAdvancedSettingsFromSPIFFS() {
-  Serial.println("[ADV] Loading advanced settings from SPIFFS...");
+  LogSerial.println("[ADV] Loading advanced settings from SPIFFS...");
   
   if (!SPIFFS.exists(ADVANCED_SETTINGS_FILE)) {
-    Serial.println("[ADV] No advanced settings file found, using defaults");
-    Serial.println("[ADV] Default values:");
-    Serial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
-    Serial.println("     Power Filter Alpha: " + String(g_powerFilterAlpha, 2));
-    Serial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 2) + "V");
-    Serial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
-    Serial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
-    Serial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+    LogSerial.println("[ADV] No advanced settings file found, using defaults");
+    LogSerial.println("[ADV] Default values:");
+    LogSerial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
+    LogSerial.println("     Power Filter Alpha: " + String(g_powerFilterAlpha, 2));
+    LogSerial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 2) + "V");
+    LogSerial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
+    LogSerial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
+    LogSerial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+    LogSerial.println("     RMS Window: " + String(g_rmsWindowCycles) + " cycles");
+    LogSerial.println("     SOC Fusion: " + String(g_socFusionEnabled ? "ON" : "OFF") + " (" + String(g_socCapacityAh, 1) + "Ah)");
     return;
   }
 
@@ -215,12 +226,12 @@ void loadAdvancedSettingsFromSPIFFS() {
     return;
   }
 
-  DynamicJsonDocument doc(512);
+  DynamicJsonDocument doc(1024);
   DeserializationError error = deserializeJson(doc, configFile);
   configFile.close();
 
   if (error) {
-    LOG_ERROR("Advanced settings: Failed to parse JSON: " + String(error.c_str()));
+    LOG_ERROR("Advanced settings: Failed to parse JSON: %s", error.c_str());
     return;
   }
 
@@ -236,25 +247,44 @@ void loadAdvancedSettingsFromSPIFFS() {
   g_powerStationOffVoltage = doc["powerStationOffVoltage"] | POWER_STATION_OFF_VOLTAGE_DEFAULT;
   g_warmupDelay = doc["warmupDelay"] | WARMUP_DELAY_DEFAULT;
   g_maxPowerReading = doc["maxPowerReading"] | MAX_POWER_READING_DEFAULT;
-
-  Serial.println("[ADV] Advanced settings loaded from SPIFFS:");
-  Serial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
-  Serial.println("     Power Filter Alpha: " + String(g_powerFilterAlpha, 2));
-  Serial.println("     Voltage Min Safe: " + String(g_voltageMinSafe, 2) + "V");
-  Serial.println("     Battery Low Warning: " + String(g_batteryLowWarning, 1) + "%");
-  Serial.println("     Battery Critical: " + String(g_batteryCritical, 1) + "%");
-  Serial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 2) + "V");
-  Serial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
-  Serial.println("     SOC Buffer Size: " + String(g_socBufferSize));
-  Serial.println("     SOC Change Threshold: " + String(g_socChangeThreshold));
-  Serial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
-  Serial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+  g_rmsWindowCycles = doc["rmsWindowCycles"] | RMS_WINDOW_CYCLES_DEFAULT;
+  g_socFusionEnabled = doc["socFusionEnabled"] | SOC_FUSION_ENABLED_DEFAULT;
+  g_socCapacityAh = doc["socCapacityAh"] | SOC_CAPACITY_AH_DEFAULT;
+  g_powerFilterIn.type = doc["powerFilterInType"] | POWER_FILTER_TYPE_DEFAULT;
+  g_powerFilterIn.median3 = doc["powerFilterInMedian3"] | POWER_FILTER_MEDIAN3_DEFAULT;
+  g_powerFilterIn.alphaMax = doc["powerFilterInAlphaMax"] | POWER_FILTER_ALPHA_MAX_DEFAULT;
+  g_powerFilterIn.stepWatts = doc["powerFilterInStepWatts"] | POWER_FILTER_STEP_WATTS_DEFAULT;
+  g_powerFilterOut.type = doc["powerFilterOutType"] | POWER_FILTER_TYPE_DEFAULT;
+  g_powerFilterOut.median3 = doc["powerFilterOutMedian3"] | POWER_FILTER_MEDIAN3_DEFAULT;
+  g_powerFilterOut.alphaMax = doc["powerFilterOutAlphaMax"] | POWER_FILTER_ALPHA_MAX_DEFAULT;
+  g_powerFilterOut.stepWatts = doc["powerFilterOutStepWatts"] | POWER_FILTER_STEP_WATTS_DEFAULT;
+  g_harmonicAnalysisEnabled = doc["harmonicAnalysisEnabled"] | HARMONIC_ANALYSIS_ENABLED_DEFAULT;
+  g_lowPowerEnabled = doc["lowPowerEnabled"] | LOW_POWER_ENABLED_DEFAULT;
+
+  LogSerial.println("[ADV] Advanced settings loaded from SPIFFS:");
+  LogSerial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
+  LogSerial.println("     Power Filter Alpha: " + String(g_powerFilterAlpha, 2));
+  LogSerial.println("     Power Filter IN/OUT: type " + String(g_powerFilterIn.type) + "/" + String(g_powerFilterOut.type) +
+                 ", median3 " + String(g_powerFilterIn.median3 ? "ON" : "OFF") + "/" + String(g_powerFilterOut.median3 ? "ON" : "OFF"));
+  LogSerial.println("     Voltage Min Safe: " + String(g_voltageMinSafe, 2) + "V");
+  LogSerial.println("     Battery Low Warning: " + String(g_batteryLowWarning, 1) + "%");
+  LogSerial.println("     Battery Critical: " + String(g_batteryCritical, 1) + "%");
+  LogSerial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 2) + "V");
+  LogSerial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
+  LogSerial.println("     SOC Buffer Size: " + String(g_socBufferSize));
+  LogSerial.println("     SOC Change Threshold: " + String(g_socChangeThreshold));
+  LogSerial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
+  LogSerial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+  LogSerial.println("     RMS Window: " + String(g_rmsWindowCycles) + " cycles");
+  LogSerial.println("     SOC Fusion: " + String(g_socFusionEnabled ? "ON" : "OFF") + " (" + String(g_socCapacityAh, 1) + "Ah)");
+  LogSerial.println("     Harmonic Analysis: " + String(g_harmonicAnalysisEnabled ? "ON" : "OFF"));
+  LogSerial.println("     Low Power on Battery: " + String(g_lowPowerEnabled ? "ON" : "OFF"));
 }
 
 void saveAdvancedSettingsToSPIFFS(const AdvancedSettings& settings) {
-  Serial.println("[ADV] Saving advanced settings to SPIFFS...");
+  LogSerial.println("[ADV] Saving advanced settings to SPIFFS...");
   
-  DynamicJsonDocument doc(512);
+  DynamicJsonDocument doc(1024);
   doc["powerThreshold"] = settings.powerThreshold;
   doc["powerFilterAlpha"] = settings.powerFilterAlpha;
   doc["voltageMinSafe"] = settings.voltageMinSafe;
@@ -266,6 +296,19 @@ void saveAdvancedSettingsToSPIFFS(const AdvancedSettings& settings) {
   doc["powerStationOffVoltage"] = settings.powerStationOffVoltage;
   doc["warmupDelay"] = settings.warmupDelay;
   doc["maxPowerReading"] = settings.maxPowerReading;
+  doc["rmsWindowCycles"] = settings.rmsWindowCycles;
+  doc["socFusionEnabled"] = settings.socFusionEnabled;
+  doc["socCapacityAh"] = settings.socCapacityAh;
+  doc["powerFilterInType"] = settings.powerFilterIn.type;
+  doc["powerFilterInMedian3"] = settings.powerFilterIn.median3;
+  doc["powerFilterInAlphaMax"] = settings.powerFilterIn.alphaMax;
+  doc["powerFilterInStepWatts"] = settings.powerFilterIn.stepWatts;
+  doc["powerFilterOutType"] = settings.powerFilterOut.type;
+  doc["powerFilterOutMedian3"] = settings.powerFilterOut.median3;
+  doc["powerFilterOutAlphaMax"] = settings.powerFilterOut.alphaMax;
+  doc["powerFilterOutStepWatts"] = settings.powerFilterOut.stepWatts;
+  doc["harmonicAnalysisEnabled"] = settings.harmonicAnalysisEnabled;
+  doc["lowPowerEnabled"] = settings.lowPowerEnabled;
 
   File configFile = SPIFFS.open(ADVANCED_SETTINGS_FILE, "w");
   if (!configFile) {
@@ -290,14 +333,23 @@ void saveAdvancedSettingsToSPIFFS(const AdvancedSettings& settings) {
   g_powerStationOffVoltage = settings.powerStationOffVoltage;
   g_warmupDelay = settings.warmupDelay;
   g_maxPowerReading = settings.maxPowerReading;
+  g_rmsWindowCycles = settings.rmsWindowCycles;
+  g_socFusionEnabled = settings.socFusionEnabled;
+  g_socCapacityAh = settings.socCapacityAh;
+  g_powerFilterIn = settings.powerFilterIn;
+  g_powerFilterOut = settings.powerFilterOut;
+  g_harmonicAnalysisEnabled = settings.harmonicAnalysisEnabled;
+  g_lowPowerEnabled = settings.lowPowerEnabled;
   interrupts();
 
-  Serial.println("[ADV] Advanced settings saved successfully:");
-  Serial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
-  Serial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 2) + "V");
-  Serial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
-  Serial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
-  Serial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+  LogSerial.println("[ADV] Advanced settings saved successfully:");
+  LogSerial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
+  LogSerial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 2) + "V");
+  LogSerial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
+  LogSerial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
+  LogSerial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+  LogSerial.println("     RMS Window: " + String(g_rmsWindowCycles) + " cycles");
+  LogSerial.println("     SOC Fusion: " + String(g_socFusionEnabled ? "ON" : "OFF") + " (" + String(g_socCapacityAh, 1) + "Ah)");
 }
 
 // ===================================================================
@@ -305,10 +357,10 @@ void saveAdvancedSettingsToSPIFFS(const AdvancedSettings& settings) {
 // ===================================================================
 
 void loadAPIPasswordFromSPIFFS() {
-  Serial.println("[API] Loading API password from SPIFFS...");
+  LogSerial.println("[API] Loading API password from SPIFFS...");
   
   if (!SPIFFS.exists(API_PASSWORD_FILE)) {
-    Serial.println("[API] No API password file found, using default");
+    LogSerial.println("[API] No API password file found, using default");
     g_apiPassword = API_PASSWORD_DEFAULT;
     return;
   }
@@ -329,11 +381,11 @@ void loadAPIPasswordFromSPIFFS() {
     g_apiPassword = API_PASSWORD_DEFAULT;
   }
 
-  Serial.println("[API] API password loaded from SPIFFS");
+  LogSerial.println("[API] API password loaded from SPIFFS");
 }
 
 void saveAPIPasswordToSPIFFS(const String& password) {
-  Serial.println("[API] Saving API password to SPIFFS...");
+  LogSerial.println("[API] Saving API password to SPIFFS...");
   
   File file = SPIFFS.open(API_PASSWORD_FILE, "w");
   if (!file) {
@@ -346,7 +398,7 @@ void saveAPIPasswordToSPIFFS(const String& password) {
   
   g_apiPassword = password;
 
-  Serial.println("[API] API password saved successfully");
+  LogSerial.println("[API] API password saved successfully");
 }
 
 // ===================================================================
@@ -354,16 +406,16 @@ void saveAPIPasswordToSPIFFS(const String& password) {
 // ===================================================================
 
 void loadSystemSettingsFromSPIFFS() {
-  Serial.println("[SYS] Loading system settings from SPIFFS...");
+  LogSerial.println("[SYS] Loading system settings from SPIFFS...");
   
   if (!SPIFFS.exists(SYSTEM_SETTINGS_FILE)) {
-    Serial.println("[SYS] No system settings file found, using defaults");
-    Serial.println("[SYS] Default values:");
-    Serial.println("     NTP Server: " + g_ntpServer);
-    Serial.println("     GMT Offset: " + String(g_gmtOffset) + "s");
-    Serial.println("     Daylight Offset: " + String(g_daylightOffset) + "s");
-    Serial.println("     Beeps Enabled: YES");
-    Serial.println("     Log Level: INFO");
+    LogSerial.println("[SYS] No system settings file found, using defaults");
+    LogSerial.println("[SYS] Default values:");
+    LogSerial.println("     NTP Server: " + g_ntpServer);
+    LogSerial.println("     GMT Offset: " + String(g_gmtOffset) + "s");
+    LogSerial.println("     Daylight Offset: " + String(g_daylightOffset) + "s");
+    LogSerial.println("     Beeps Enabled: YES");
+    LogSerial.println("     Log Level: INFO");
     return;
   }
 
@@ -378,7 +430,7 @@ void loadSystemSettingsFromSPIFFS() {
   configFile.close();
 
   if (error) {
-    LOG_ERROR("System settings: Failed to parse JSON: " + String(error.c_str()));
+    LOG_ERROR("System settings: Failed to parse JSON: %s", error.c_str());
     return;
   }
 
@@ -388,22 +440,22 @@ void loadSystemSettingsFromSPIFFS() {
   g_beepsEnabled = doc["beepsEnabled"] | true;
   g_logLevel = doc["logLevel"] | LOG_LEVEL_DEFAULT;
 
-  Serial.println("[SYS] System settings loaded from SPIFFS:");
-  Serial.println("     NTP Server: " + g_ntpServer);
-  Serial.println("     GMT Offset: " + String(g_gmtOffset) + "s");
-  Serial.println("     Daylight Offset: " + String(g_daylightOffset) + "s");
-  Serial.println("     Beeps Enabled: " + String(g_beepsEnabled ? "YES" : "NO"));
+  LogSerial.println("[SYS] System settings loaded from SPIFFS:");
+  LogSerial.println("     NTP Server: " + g_ntpServer);
+  LogSerial.println("     GMT Offset: " + String(g_gmtOffset) + "s");
+  LogSerial.println("     Daylight Offset: " + String(g_daylightOffset) + "s");
+  LogSerial.println("     Beeps Enabled: " + String(g_beepsEnabled ? "YES" : "NO"));
   
   String logLevelStr = "INFO";
   if (g_logLevel == LOG_LEVEL_DEBUG) logLevelStr = "DEBUG";
   else if (g_logLevel == LOG_LEVEL_WARNING) logLevelStr = "WARNING";
   else if (g_logLevel == LOG_LEVEL_ERROR) logLevelStr = "ERROR";
   else if (g_logLevel == LOG_LEVEL_NONE) logLevelStr = "NONE";
-  Serial.println("     Log Level: " + logLevelStr);
+  LogSerial.println("     Log Level: " + logLevelStr);
 }
 
 void saveSystemSettingsToSPIFFS(const SystemSettings& settings) {
-  Serial.println("[SYS] Saving system settings to SPIFFS...");
+  LogSerial.println("[SYS] Saving system settings to SPIFFS...");
   
   DynamicJsonDocument doc(512);
   doc["ntpServer"] = settings.ntpServer;
@@ -427,18 +479,18 @@ void saveSystemSettingsToSPIFFS(const SystemSettings& settings) {
   g_beepsEnabled = settings.beepsEnabled;
   g_logLevel = settings.logLevel;
 
-  Serial.println("[SYS] System settings saved successfully:");
-  Serial.println("     NTP Server: " + g_ntpServer);
-  Serial.println("     GMT Offset: " + String(g_gmtOffset) + "s");
-  Serial.println("     Daylight Offset: " + String(g_daylightOffset) + "s");
-  Serial.println("     Beeps Enabled: " + String(g_beepsEnabled ? "YES" : "NO"));
+  LogSerial.println("[SYS] System settings saved successfully:");
+  LogSerial.println("     NTP Server: " + g_ntpServer);
+  LogSerial.println("     GMT Offset: " + String(g_gmtOffset) + "s");
+  LogSerial.println("     Daylight Offset: " + String(g_daylightOffset) + "s");
+  LogSerial.println("     Beeps Enabled: " + String(g_beepsEnabled ? "YES" : "NO"));
   
   String logLevelStr = "INFO";
   if (g_logLevel == LOG_LEVEL_DEBUG) logLevelStr = "DEBUG";
   else if (g_logLevel == LOG_LEVEL_WARNING) logLevelStr = "WARNING";
   else if (g_logLevel == LOG_LEVEL_ERROR) logLevelStr = "ERROR";
   else if (g_logLevel == LOG_LEVEL_NONE) logLevelStr = "NONE";
-  Serial.println("     Log Level: " + logLevelStr);
+  LogSerial.println("     Log Level: " + logLevelStr);
 }
 
 // ===================================================================
@@ -446,15 +498,15 @@ void saveSystemSettingsToSPIFFS(const SystemSettings& settings) {
 // ===================================================================
 
 void loadHttpShutdownConfigFromSPIFFS() {
-  Serial.println("[SHUTDOWN] Loading HTTP shutdown config from SPIFFS...");
+  LogSerial.println("[SHUTDOWN] Loading HTTP shutdown config from SPIFFS...");
   
   if (!SPIFFS.exists(HTTP_SHUTDOWN_CONFIG_FILE)) {
-    Serial.println("[SHUTDOWN] No HTTP shutdown config file found, using defaults");
-    Serial.println("[SHUTDOWN] Default values:");
-    Serial.println("     Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
-    Serial.println("     Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
-    Serial.println("     Server: " + g_httpShutdownServer);
-    Serial.println("     Port: " + String(g_httpShutdownPort));
+    LogSerial.println("[SHUTDOWN] No HTTP shutdown config file found, using defaults");
+    LogSerial.println("[SHUTDOWN] Default values:");
+    LogSerial.println("     Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
+    LogSerial.println("     Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
+    LogSerial.println("     Server: " + g_httpShutdownServer);
+    LogSerial.println("     Port: " + String(g_httpShutdownPort));
     return;
   }
 
@@ -469,7 +521,7 @@ void loadHttpShutdownConfigFromSPIFFS() {
   configFile.close();
 
   if (error) {
-    LOG_ERROR("HTTP Shutdown: Failed to parse config JSON: " + String(error.c_str()));
+    LOG_ERROR("HTTP Shutdown: Failed to parse config JSON: %s", error.c_str());
     return;
   }
 
@@ -480,15 +532,15 @@ void loadHttpShutdownConfigFromSPIFFS() {
   g_httpShutdownPassword = doc["password"] | HTTP_SHUTDOWN_PASSWORD_DEFAULT;
   g_httpShutdownSent = false;  // Always reset on boot
 
-  Serial.println("[SHUTDOWN] HTTP shutdown config loaded from SPIFFS:");
-  Serial.println("     Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
-  Serial.println("     Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
-  Serial.println("     Server: " + g_httpShutdownServer);
-  Serial.println("     Port: " + String(g_httpShutdownPort));
+  LogSerial.println("[SHUTDOWN] HTTP shutdown config loaded from SPIFFS:");
+  LogSerial.println("     Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
+  LogSerial.println("     Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
+  LogSerial.println("     Server: " + g_httpShutdownServer);
+  LogSerial.println("     Port: " + String(g_httpShutdownPort));
 }
 
 void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config) {
-  Serial.println("[SHUTDOWN] Saving HTTP shutdown config to SPIFFS...");
+  LogSerial.println("[SHUTDOWN] Saving HTTP shutdown config to SPIFFS...");
   
   DynamicJsonDocument doc(512);
   doc["enabled"] = config.enabled;
@@ -513,9 +565,383 @@ void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config) {
   g_httpShutdownPassword = config.password;
   g_httpShutdownSent = false;  // Reset when config changes
 
-  Serial.println("[SHUTDOWN] HTTP shutdown config saved successfully:");
-  Serial.println("     Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
-  Serial.println("     Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
-  Serial.println("     Server: " + g_httpShutdownServer);
-  Serial.println("     Port: " + String(g_httpShutdownPort));
+  LogSerial.println("[SHUTDOWN] HTTP shutdown config saved successfully:");
+  LogSerial.println("     Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
+  LogSerial.println("     Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
+  LogSerial.println("     Server: " + g_httpShutdownServer);
+  LogSerial.println("     Port: " + String(g_httpShutdownPort));
+}
+
+// ===================================================================
+// VOLTAGE COMPENSATION TABLES (built-in defaults, optional SPIFFS override)
+// ===================================================================
+CompensationTable g_compDischarge;
+CompensationTable g_compCharge;
+portMUX_TYPE g_compLock = portMUX_INITIALIZER_UNLOCKED;
+static bool g_compFromSPIFFS = false;
+
+// Parse [[voltage, offset], ...] into a table, false if malformed
+static bool parseCompensationTable(JsonVariantConst json, CompensationTable& table) {
+  if (!json.is<JsonArrayConst>()) return false;
+  JsonArrayConst arr = json.as<JsonArrayConst>();
+  
+  float points[COMP_TABLE_MAX_POINTS][2];
+  int n = arr.size();
+  if (n < 1 || n > COMP_TABLE_MAX_POINTS) return false;
+  
+  for (int i = 0; i < n; i++) {
+    JsonArrayConst point = arr[i].as<JsonArrayConst>();
+    if (point.size() != 2) return false;
+    points[i][0] = point[0].as<float>();
+    points[i][1] = point[1].as<float>();
+    if (points[i][0] < BATTERY_VMIN - 5.0 || points[i][0] > BATTERY_VMAX + 5.0) return false;
+    if (points[i][1] < -5.0 || points[i][1] > 5.0) return false;
+  }
+  return table.load(points, n);
+}
+
+static void compensationTableToJson(const CompensationTable& table, JsonArray arr) {
+  for (int i = 0; i < table.size(); i++) {
+    CompensationPoint p = table.point(i);
+    JsonArray point = arr.createNestedArray();
+    point.add(p.voltage);
+    point.add(p.offset);
+  }
+}
+
+static void setCompensationTables(const CompensationTable& discharge, const CompensationTable& charge) {
+  portENTER_CRITICAL(&g_compLock);
+  g_compDischarge = discharge;
+  g_compCharge = charge;
+  portEXIT_CRITICAL(&g_compLock);
+}
+
+void loadCompensationFromSPIFFS() {
+  LogSerial.println("[COMP] Loading voltage compensation tables...");
+  
+  CompensationTable discharge;
+  CompensationTable charge;
+  discharge.load(VOLTAGE_COMP_DISCHARGE, VOLTAGE_COMP_DISCHARGE_POINTS);
+  charge.load(VOLTAGE_COMP_CHARGE, VOLTAGE_COMP_CHARGE_POINTS);
+  g_compFromSPIFFS = false;
+  
+  if (!SPIFFS.exists(COMPENSATION_FILE)) {
+    LogSerial.println("[COMP] No compensation file found, using built-in tables");
+  } else {
+    File configFile = SPIFFS.open(COMPENSATION_FILE, "r");
+    if (!configFile) {
+      LOG_ERROR("Compensation: Failed to open file for reading");
+    } else {
+      DynamicJsonDocument doc(4096);
+      DeserializationError error = deserializeJson(doc, configFile);
+      configFile.close();
+      
+      if (error) {
+        LOG_ERROR("Compensation: Failed to parse JSON: %s", error.c_str());
+      } else {
+        // A table that fails validation falls back to the built-in one
+        if (doc.containsKey("discharge") && !parseCompensationTable(doc["discharge"], discharge)) {
+          LOG_ERROR("Compensation: Invalid discharge table in SPIFFS, using built-in");
+        }
+        if (doc.containsKey("charge") && !parseCompensationTable(doc["charge"], charge)) {
+          LOG_ERROR("Compensation: Invalid charge table in SPIFFS, using built-in");
+        }
+        g_compFromSPIFFS = true;
+      }
+    }
+  }
+  
+  setCompensationTables(discharge, charge);
+  LogSerial.println("[COMP] Compensation tables active (" + String(g_compFromSPIFFS ? "SPIFFS" : "built-in") + "):");
+  LogSerial.println("     Discharge: " + String(discharge.size()) + " points");
+  LogSerial.println("     Charge: " + String(charge.size()) + " points");
+}
+
+bool saveCompensationJson(const String& json, String& error) {
+  DynamicJsonDocument doc(4096);
+  if (deserializeJson(doc, json)) {
+    error = "Invalid JSON";
+    return false;
+  }
+  
+  if (!doc.containsKey("discharge") && !doc.containsKey("charge")) {
+    error = "Missing 'discharge' or 'charge' table";
+    return false;
+  }
+  
+  // Start from the active tables so either one can be replaced alone
+  portENTER_CRITICAL(&g_compLock);
+  CompensationTable discharge = g_compDischarge;
+  CompensationTable charge = g_compCharge;
+  portEXIT_CRITICAL(&g_compLock);
+  
+  if (doc.containsKey("discharge") && !parseCompensationTable(doc["discharge"], discharge)) {
+    error = "Invalid discharge table: 1-" + String(COMP_TABLE_MAX_POINTS) + " [voltage, offset] pairs, ascending voltage";
+    return false;
+  }
+  if (doc.containsKey("charge") && !parseCompensationTable(doc["charge"], charge)) {
+    error = "Invalid charge table: 1-" + String(COMP_TABLE_MAX_POINTS) + " [voltage, offset] pairs, ascending voltage";
+    return false;
+  }
+  
+  DynamicJsonDocument out(4096);
+  compensationTableToJson(discharge, out.createNestedArray("discharge"));
+  compensationTableToJson(charge, out.createNestedArray("charge"));
+  
+  File configFile = SPIFFS.open(COMPENSATION_FILE, "w");
+  if (!configFile) {
+    LOG_ERROR("Compensation: Failed to open file for writing");
+    error = "Failed to write SPIFFS";
+    return false;
+  }
+  serializeJson(out, configFile);
+  configFile.close();
+  
+  setCompensationTables(discharge, charge);
+  g_compFromSPIFFS = true;
+  
+  LogSerial.println("[COMP] Compensation tables saved to SPIFFS:");
+  LogSerial.println("     Discharge: " + String(discharge.size()) + " points");
+  LogSerial.println("     Charge: " + String(charge.size()) + " points");
+  return true;
+}
+
+String getCompensationJson() {
+  portENTER_CRITICAL(&g_compLock);
+  CompensationTable discharge = g_compDischarge;
+  CompensationTable charge = g_compCharge;
+  portEXIT_CRITICAL(&g_compLock);
+  
+  DynamicJsonDocument doc(4096);
+  doc["source"] = g_compFromSPIFFS ? "spiffs" : "default";
+  compensationTableToJson(discharge, doc.createNestedArray("discharge"));
+  compensationTableToJson(charge, doc.createNestedArray("charge"));
+  
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+void resetCompensationToDefaults() {
+  if (SPIFFS.exists(COMPENSATION_FILE)) {
+    SPIFFS.remove(COMPENSATION_FILE);
+  }
+  
+  CompensationTable discharge;
+  CompensationTable charge;
+  discharge.load(VOLTAGE_COMP_DISCHARGE, VOLTAGE_COMP_DISCHARGE_POINTS);
+  charge.load(VOLTAGE_COMP_CHARGE, VOLTAGE_COMP_CHARGE_POINTS);
+  setCompensationTables(discharge, charge);
+  g_compFromSPIFFS = false;
+  
+  LogSerial.println("[COMP] Compensation tables reset to built-in defaults");
+}
+
+// ===================================================================
+// SOC CURVES (built-in defaults, optional SPIFFS curves)
+// ===================================================================
+// A curve set is ~5.6 KB, too large to copy under a spinlock (the sampler
+// shares the core) or to build on a task stack. Two static buffers: the
+// new set is built in the inactive one and published by swapping the
+// pointer. Only one task builds sets, setup() and then the web handlers on
+// the network task, so it can read the active set without the lock; the
+// sensor task holds the lock for each lookup, so a swapped-out buffer is
+// no longer in use when it is built again.
+static SocCurveSet socCurveBuffers[2];
+SocCurveSet* g_socCurves = &socCurveBuffers[0];
+portMUX_TYPE g_socCurveLock = portMUX_INITIALIZER_UNLOCKED;
+static bool g_socCurvesFromSPIFFS = false;
+
+static SocCurveSet& socCurveStaging() {
+  return g_socCurves == &socCurveBuffers[0] ? socCurveBuffers[1] : socCurveBuffers[0];
+}
+
+static void loadBuiltinSocCurves(SocCurveSet& set) {
+  set.clear();
+  set.add("normal", BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS);
+  set.add("charge", BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS);
+  set.select("normal", "charge");
+}
+
+// Parse {"curves": {"name": [[percent, voltage], ...]}, "discharge": "name",
+// "charge": "name"} on top of the given set, false if anything is malformed
+static bool parseSocCurves(JsonVariantConst json, SocCurveSet& set, String& error) {
+  if (json.containsKey("curves")) {
+    if (!json["curves"].is<JsonObjectConst>()) {
+      error = "'curves' must be an object of name: [[percent, voltage], ...]";
+      return false;
+    }
+    for (JsonPairConst kv : json["curves"].as<JsonObjectConst>()) {
+      String name = kv.key().c_str();
+      if (!kv.value().is<JsonArrayConst>()) {
+        error = "Curve '" + name + "' must be an array";
+        return false;
+      }
+      JsonArrayConst arr = kv.value().as<JsonArrayConst>();
+      
+      float points[SOC_CURVE_MAX_POINTS][2];
+      int n = arr.size();
+      if (n < 2 || n > SOC_CURVE_MAX_POINTS) {
+        error = "Curve '" + name + "' needs 2-" + String(SOC_CURVE_MAX_POINTS) + " points";
+        return false;
+      }
+      for (int i = 0; i < n; i++) {
+        JsonArrayConst point = arr[i].as<JsonArrayConst>();
+        if (point.size() != 2) {
+          error = "Curve '" + name + "' points must be [percent, voltage]";
+          return false;
+        }
+        points[i][0] = point[0].as<float>();
+        points[i][1] = point[1].as<float>();
+        if (points[i][1] < BATTERY_VMIN - 5.0 || points[i][1] > BATTERY_VMAX + 5.0) {
+          error = "Curve '" + name + "' voltage out of range";
+          return false;
+        }
+      }
+      if (set.add(name.c_str(), points, n) < 0) {
+        error = "Invalid curve '" + name + "' (percent 0-100, name < " + String(SOC_CURVE_NAME_LEN) +
+                " chars, max " + String(SOC_CURVE_MAX_CURVES) + " curves)";
+        return false;
+      }
+    }
+  }
+  
+  const char* dischargeName = json["discharge"] | (const char*)set.names[set.dischargeIndex];
+  const char* chargeName = json["charge"] | (const char*)set.names[set.chargeIndex];
+  if (!set.select(dischargeName, chargeName)) {
+    error = "Unknown curve selected for 'discharge' or 'charge'";
+    return false;
+  }
+  return true;
+}
+
+static void socCurvesToJson(const SocCurveSet& set, JsonDocument& doc) {
+  doc["discharge"] = set.names[set.dischargeIndex];
+  doc["charge"] = set.names[set.chargeIndex];
+  JsonObject curves = doc.createNestedObject("curves");
+  for (int c = 0; c < set.count; c++) {
+    JsonArray arr = curves.createNestedArray(set.names[c]);
+    // Stored ascending, reported from 100% down like config.h
+    for (int i = set.curves[c].size() - 1; i >= 0; i--) {
+      float percent, voltage;
+      set.curves[c].point(i, percent, voltage);
+      JsonArray point = arr.createNestedArray();
+      point.add(percent);
+      point.add(voltage);
+    }
+  }
+}
+
+// set: the staging buffer
+static void setSocCurves(SocCurveSet& set) {
+  portENTER_CRITICAL(&g_socCurveLock);
+  g_socCurves = &set;
+  portEXIT_CRITICAL(&g_socCurveLock);
+}
+
+static void printSocCurves(const SocCurveSet& set) {
+  for (int c = 0; c < set.count; c++) {
+    String role = "";
+    if (c == set.dischargeIndex) role += " [discharge]";
+    if (c == set.chargeIndex) role += " [charge]";
+    LogSerial.println("     " + String(set.names[c]) + ": " + String(set.curves[c].size()) + " points" + role);
+  }
+}
+
+void loadSocCurvesFromSPIFFS() {
+  LogSerial.println("[SOC] Loading SOC curves...");
+  
+  SocCurveSet& staging = socCurveStaging();
+  loadBuiltinSocCurves(staging);
+  g_socCurvesFromSPIFFS = false;
+  
+  if (!SPIFFS.exists(SOC_CURVES_FILE)) {
+    LogSerial.println("[SOC] No SOC curve file found, using built-in curves");
+  } else {
+    File configFile = SPIFFS.open(SOC_CURVES_FILE, "r");
+    if (!configFile) {
+      LOG_ERROR("SOC curves: Failed to open file for reading");
+    } else {
+      DynamicJsonDocument doc(8192);
+      DeserializationError error = deserializeJson(doc, configFile);
+      configFile.close();
+      
+      String parseError;
+      if (error) {
+        LOG_ERROR("SOC curves: Failed to parse JSON: %s", error.c_str());
+      } else if (!parseSocCurves(doc.as<JsonVariantConst>(), staging, parseError)) {
+        LOG_ERROR("SOC curves: %s, using built-in", parseError.c_str());
+        loadBuiltinSocCurves(staging);
+      } else {
+        g_socCurvesFromSPIFFS = true;
+      }
+    }
+  }
+  
+  setSocCurves(staging);
+  LogSerial.println("[SOC] SOC curves active (" + String(g_socCurvesFromSPIFFS ? "SPIFFS" : "built-in") + "):");
+  printSocCurves(staging);
+}
+
+bool saveSocCurvesJson(const String& json, String& error) {
+  DynamicJsonDocument doc(8192);
+  if (deserializeJson(doc, json)) {
+    error = "Invalid JSON";
+    return false;
+  }
+  
+  if (!doc.containsKey("curves") && !doc.containsKey("discharge") && !doc.containsKey("charge")) {
+    error = "Missing 'curves', 'discharge' or 'charge'";
+    return false;
+  }
+  
+  // Start from the active set so curves can be added or selected alone
+  SocCurveSet& staging = socCurveStaging();
+  staging = *g_socCurves;
+  
+  if (!parseSocCurves(doc.as<JsonVariantConst>(), staging, error)) {
+    return false;
+  }
+  
+  DynamicJsonDocument out(8192);
+  socCurvesToJson(staging, out);
+  
+  File configFile = SPIFFS.open(SOC_CURVES_FILE, "w");
+  if (!configFile) {
+    LOG_ERROR("SOC curves: Failed to open file for writing");
+    error = "Failed to write SPIFFS";
+    return false;
+  }
+  serializeJson(out, configFile);
+  configFile.close();
+  
+  setSocCurves(staging);
+  g_socCurvesFromSPIFFS = true;
+  
+  LogSerial.println("[SOC] SOC curves saved to SPIFFS:");
+  printSocCurves(staging);
+  return true;
+}
+
+String getSocCurvesJson() {
+  DynamicJsonDocument doc(8192);
+  doc["source"] = g_socCurvesFromSPIFFS ? "spiffs" : "default";
+  socCurvesToJson(*g_socCurves, doc);
+  
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+void resetSocCurvesToDefaults() {
+  if (SPIFFS.exists(SOC_CURVES_FILE)) {
+    SPIFFS.remove(SOC_CURVES_FILE);
+  }
+  
+  SocCurveSet& staging = socCurveStaging();
+  loadBuiltinSocCurves(staging);
+  setSocCurves(staging);
+  g_socCurvesFromSPIFFS = false;
+  
+  LogSerial.println("[SOC] SOC curves reset to built-in defaults");
 }
\ No newline at end of file
@@ -7,6 +7,9 @@
 #define CONFIG_H
 
 #include <Arduino.h>
+#include "voltage_compensation.h"
+#include "soc_curve.h"
+#include "power_filter.h"
 
 // System version
 #define FIRMWARE_VERSION "1.2.1"
@@ -23,6 +26,26 @@
 
 #define LOG_LEVEL_DEFAULT LOG_LEVEL_INFO  // Default log level (INFO)
 
+// Lowest level compiled in: calls below it are removed with their arguments
+// (build with -DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO to drop DEBUG). The runtime
+// level (g_logLevel) filters the levels that are compiled in.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+#define LOG_LINE_MAX      256    // Formatted on the stack, longer lines are cut
+#define LOG_TX_BUFFER     4096   // Serial TX ring, filled by the log drain task (absorbs dumps)
+
+// Log ring: log calls copy their text into it, a low-priority task sends it
+// to the serial port. It lives in RTC memory (8 KB on the ESP32) and keeps
+// the text across a watchdog or panic reset; a power-on clears it.
+#define LOG_RING_SIZE     4096   // Power of two
+#define LOG_TASK_STACK    3072
+#define LOG_TASK_PRIORITY 1      // Lowest above idle
+#define LOG_TASK_CORE     0
+#define LOG_TAIL_INTERVAL 500    // WebSocket log tail push (ms)
+#define LOG_TAIL_CHUNK    1024   // Most text per client and push
+#define LOG_TAIL_BACKLOG  1024   // Text sent when a client subscribes
+
 // Hardware pin definitions - MAPPED BUTTONS
 #define PIN_BUTTON_POWER      18    // GPIO18 - POWER button (3 seconds)
 #define PIN_BUTTON_USB        16    // GPIO16 - USB output
@@ -53,19 +76,99 @@
 #define SCT013_WARMUP_CYCLES    7
 #define SCT013_AVG_SAMPLES      5
 
+// ===================================================================
+// BACKGROUND ADC SAMPLER (continuous DMA acquisition of the clamps)
+// ===================================================================
+#define ADC_SAMPLER_RATE_HZ         30000  // Total conversions/s, shared by all channels
+#define ADC_SAMPLER_FRAME_SAMPLES   256    // Conversions per DMA frame
+#define ADC_SAMPLER_RING_SAMPLES    2048   // Raw samples kept per channel (power of 2)
+#define ADC_SAMPLER_TASK_STACK      4096
+#define ADC_SAMPLER_TASK_PRIORITY   5
+#define ADC_SAMPLER_TASK_CORE       0      // Arduino loop() runs on core 1
+
+// Adaptive acquisition: sparse sampling while the readings are stable.
+// The continuous driver cannot go below 20 kHz on the ESP32, so IDLE also
+// keeps only every Nth IN/OUT conversion (the battery keeps all of them).
+#define ADC_SAMPLER_RATE_MIN_HZ     20000
+#define ADC_SAMPLER_RATE_IDLE_HZ    20000  // IDLE: 6.7 kHz per channel before decimation
+#define ADC_SAMPLER_IDLE_DECIMATION 4      // IDLE: ~1.67 kHz per clamp (33 samples per 50 Hz cycle)
+#define ADC_SAMPLER_DECIMATION_MAX  16
+#define ACQ_IDLE_AFTER_MS           30000  // Stable readings before going IDLE
+
+// LOW POWER (power saving enabled and the station DISCHARGING, see power_manager.h)
+#define ADC_SAMPLER_LOW_POWER_DECIMATION 6   // IDLE: ~1.1 kHz per clamp, 9th harmonic of 60 Hz below Nyquist
+#define ACQ_IDLE_AFTER_LOW_POWER_MS 10000  // Stable readings before going IDLE
+#define LOW_POWER_CPU_MHZ           80
+#define NORMAL_CPU_MHZ              240
+#define LOW_POWER_LISTEN_INTERVAL   3      // Beacons between WiFi wake-ups (~300 ms at 102.4 ms)
+#define LOW_POWER_MAX_IDLE_MS       50     // Longest main loop sleep between tasks
+#define LOW_POWER_NET_DELAY_MS      10     // Network task pause per iteration
+#define POWER_MODE_INTERVAL         1000
+#define ACQ_POWER_DELTA_W           20.0   // IN/OUT change that restarts full-rate sampling
+#define ACQ_VOLTAGE_SAG_V           0.3    // Battery voltage drop that restarts full-rate sampling
+
+// Waveform analysis of the sampler ring (main loop, a slice per iteration)
+#define HARMONIC_INTERVAL_MS        2000   // Start of one channel analysis (IN and OUT alternate)
+#define HARMONIC_STEP_SAMPLES       256    // Samples processed per loop() iteration
+#define HARMONIC_MIN_RMS_COUNTS     20.0   // Below this the clamp is idle, ratios are not reported
+
+// Mains-cycle synchronised RMS windows (zero crossings of the strongest clamp)
+#define MAINS_FREQUENCY_DEFAULT     50     // Used until 50/60 Hz has been detected
+#define ZERO_CROSS_HYSTERESIS       20     // ADC counts around the DC offset
+#define RMS_WINDOW_CYCLES_MIN       1
+#define RMS_WINDOW_CYCLES_MAX       50
+
+// Fast mains-loss path (IN clamp silent while OUT still carries current)
+#define MAINS_LOSS_THRESHOLD_COUNTS 40     // |sample - offset| counted as a half-cycle peak
+#define MAINS_LOSS_HALF_CYCLES      2      // Missing half-cycles that mean an outage
+#define MAINS_RESTORE_HALF_CYCLES   20     // Active half-cycles to arm / report a restore
+#define MAINS_CLEAR_READINGS        3      // Sensor readings not discharging that clear a fast loss
+
+// ===================================================================
+// SENSOR TASK (acquisition + filtering, publishes SensorData snapshots)
+// ===================================================================
+#define SENSOR_TASK_STACK           6144
+#define SENSOR_TASK_PRIORITY        3
+#define SENSOR_TASK_CORE            0
+
+// ===================================================================
+// NETWORK TASK (web, WebSocket, NUT, MQTT, HTTP; off the main loop)
+// ===================================================================
+#define NET_TASK_STACK              8192   // Same as the Arduino loop task that ran it before
+#define NET_TASK_PRIORITY           1      // Below the sampler and sensor tasks on the same core
+#define NET_TASK_CORE               0      // loop() keeps core 1 for the safety checks
+#define NET_TICK_BUDGET_US          20000  // Publishing work per iteration before due tasks are deferred
+#define HW_COMMAND_QUEUE_LENGTH     8      // Button/settings requests waiting for the main loop
+
 // ===================================================================
 // BATTERY VOLTAGE DIVIDER CONFIGURATION - DEFAULT VALUES
 // ===================================================================
 #define BATTERY_R1              220000.0
 #define BATTERY_R2              27000.0
-#define BATTERY_ADC_SAMPLES     100
+#define BATTERY_SAMPLER_WINDOW_MS  100    // Oversampling window (whole cycles at 50 and 60 Hz)
+#define BATTERY_FILTER_ALPHA       0.25   // EMA across oversampling windows
+#define ADC_CALI_LUT_STEP          16     // Raw counts between cached calibration points
 #define BATTERY_ADC_CALIBRATION_DEFAULT 1.0125
 #define BATTERY_DIVIDER_RATIO_DEFAULT   8.925
 
 // Battery voltage range
 #define BATTERY_VMAX            29.0
 #define BATTERY_VMIN            20.0
-#define BATTERY_CAPACITY_AH     100.0
+
+// ===================================================================
+// SOC ESTIMATOR (coulomb counting fused with the voltage curve)
+// ===================================================================
+#define SOC_CHARGE_EFFICIENCY      0.90    // AC in -> battery while charging
+#define SOC_DISCHARGE_EFFICIENCY   0.88    // Battery -> AC out (inverter)
+#define SOC_INITIAL_VARIANCE       100.0   // %^2 of the first voltage-curve reading (10% sigma)
+#define SOC_PROCESS_NOISE          0.002   // %^2 added per second of current integration
+#define SOC_VOLTAGE_NOISE          25.0    // %^2 of one voltage-curve reading at REST
+#define SOC_REST_SETTLE_MS         60000   // REST time before the voltage is trusted (relaxation)
+#define SOC_BYPASS_FLOOR           90.0    // BYPASS: battery charged, lower readings are noise
+#define SOC_FLOAT_SETTLE_MS        60000   // BYPASS without IN surplus before SOC is anchored to full
+#define SOC_MAX_STEP_MS            5000    // Longer gaps between readings are integrated as this
+#define SOC_CAPACITY_AH_MIN        1.0
+#define SOC_CAPACITY_AH_MAX        500.0
 
 // ===================================================================
 // VOLTAGE COMPENSATION OFFSETS - DEFAULT VALUES
@@ -93,6 +196,15 @@
 #define POWER_STATION_OFF_VOLTAGE_DEFAULT 20.0
 #define WARMUP_DELAY_DEFAULT              30000  // 30 seconds warmup delay
 #define MAX_POWER_READING_DEFAULT         1700.0 // Maximum valid power reading in Watts
+#define RMS_WINDOW_CYCLES_DEFAULT         10     // Mains cycles per RMS window (2 = fast response)
+#define SOC_FUSION_ENABLED_DEFAULT        true   // Coulomb counting + voltage curve (false = voltage + median only)
+#define SOC_CAPACITY_AH_DEFAULT           20.0   // Usable capacity in Ah (P800: 512Wh / 25.6V)
+#define POWER_FILTER_TYPE_DEFAULT         ((int)POWER_FILTER_ADAPTIVE)  // Per channel (IN/OUT)
+#define POWER_FILTER_MEDIAN3_DEFAULT      false
+#define POWER_FILTER_ALPHA_MAX_DEFAULT    0.9    // Adaptive: alpha on a full load step
+#define POWER_FILTER_STEP_WATTS_DEFAULT   80.0   // Adaptive: deviation treated as a load step
+#define HARMONIC_ANALYSIS_ENABLED_DEFAULT true   // THD / crest factor / distortion PF of the clamps
+#define LOW_POWER_ENABLED_DEFAULT         true   // ESP32 power saving while the station is DISCHARGING
 
 // ===================================================================
 // HTTP API SECURITY - DEFAULT VALUES
@@ -169,7 +281,9 @@ struct CalibrationData {
 
 struct AdvancedSettings {
   float powerThreshold;
-  float powerFilterAlpha;
+  float powerFilterAlpha;             // EMA alpha, base alpha of the adaptive filter
+  PowerFilterParams powerFilterIn;
+  PowerFilterParams powerFilterOut;
   float voltageMinSafe;
   float batteryLowWarning;
   float batteryCritical;
@@ -179,6 +293,11 @@ struct AdvancedSettings {
   float powerStationOffVoltage;
   uint32_t warmupDelay;
   float maxPowerReading;
+  int rmsWindowCycles;
+  bool socFusionEnabled;
+  float socCapacityAh;
+  bool harmonicAnalysisEnabled;
+  bool lowPowerEnabled;
   bool valid;
 };
 
@@ -205,11 +324,17 @@ struct SensorData {
   float mainCurrent;
   float outputCurrent;
   float batteryVoltage;
-  float batteryPercentage;
+  float batteryPercentage;  // Fused SOC, or voltage SOC when fusion is disabled
+  float socVoltage;         // Voltage-curve SOC (median filtered)
+  float socFused;           // Coulomb counting corrected by the voltage curve at REST
+  float batteryCurrent;     // Battery-side current (A), positive = charging
   float mainPower;
   float outputPower;
   bool onBattery;
   BatteryState batteryState;
+  float mainsFrequency;     // Measured mains frequency (Hz), 0 if no cycle-synced window
+  float mainsPowerFactor;   // Distortion power factor of the IN current, 1 without a valid analysis
+  bool mainsLost;           // Fast path: IN half-cycles missing while OUT is loaded
   unsigned long timestamp;
 };
 
@@ -221,6 +346,14 @@ struct EnergyData {
   unsigned long operatingTime;
 };
 
+// One sensor tick as every consumer sees it (built once by the main loop)
+struct TelemetryFrame {
+  uint32_t sequence;
+  SensorData sensor;
+  EnergyData energy;        // As accumulated (MQTT, HTTP, data log)
+  EnergyData stableEnergy;  // Daily/monthly held across reset anomalies (web UI)
+};
+
 struct MonthlyEnergyRecord {
   int year;
   int month;
@@ -291,6 +424,8 @@ extern float g_mainsVoltage;             // Configurable mains voltage
 // ===================================================================
 extern float g_powerThreshold;
 extern float g_powerFilterAlpha;
+extern PowerFilterParams g_powerFilterIn;
+extern PowerFilterParams g_powerFilterOut;
 extern float g_voltageMinSafe;
 extern float g_batteryLowWarning;
 extern float g_batteryCritical;
@@ -300,6 +435,11 @@ extern int g_socChangeThreshold;
 extern float g_powerStationOffVoltage;
 extern uint32_t g_warmupDelay;
 extern float g_maxPowerReading;
+extern int g_rmsWindowCycles;
+extern bool g_socFusionEnabled;
+extern float g_socCapacityAh;
+extern bool g_harmonicAnalysisEnabled;
+extern bool g_lowPowerEnabled;
 
 // ===================================================================
 // EXTERNAL API PASSWORD VARIABLE
@@ -336,11 +476,32 @@ extern void loadSystemSettingsFromSPIFFS();
 extern void saveSystemSettingsToSPIFFS(const SystemSettings& settings);
 extern void loadHttpShutdownConfigFromSPIFFS();
 extern void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config);
+extern void loadCompensationFromSPIFFS();
+extern bool saveCompensationJson(const String& json, String& error);
+extern String getCompensationJson();
+extern void resetCompensationToDefaults();
+extern void loadSocCurvesFromSPIFFS();
+extern bool saveSocCurvesJson(const String& json, String& error);
+extern String getSocCurvesJson();
+extern void resetSocCurvesToDefaults();
+
+// ===================================================================
+// VOLTAGE COMPENSATION TABLES (defaults below, optional SPIFFS override)
+// ===================================================================
+extern CompensationTable g_compDischarge;
+extern CompensationTable g_compCharge;
+extern portMUX_TYPE g_compLock;          // Tables are swapped by the web server
+
+// ===================================================================
+// SOC CURVES (built-in "normal"/"charge", optional SPIFFS curves)
+// ===================================================================
+extern SocCurveSet* g_socCurves;        // Active set, read under g_socCurveLock
+extern portMUX_TYPE g_socCurveLock;      // Held for the pointer swap and each lookup
 
 // ===================================================================
 // FILTERING CONFIGURATION (These will be overridden by dynamic values)
 // ===================================================================
-#define SOC_BUFFER_SIZE           10
+#define SOC_BUFFER_SIZE_MAX       300   // Largest SOC median window (samples)
 #define SOC_CHANGE_THRESHOLD      3
 #define POWER_FILTER_ALPHA        0.3
 
@@ -394,6 +555,8 @@ extern void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config);
 // UPS protocol configuration
 #define UPS_PORT                  3493
 #define UPS_MAX_CLIENTS           5
+#define UPS_COMMAND_MAX           128    // NUT command line (longer ones are cut)
+#define UPS_RESPONSE_MAX          1024   // NUT response, built on the network task stack
 #define UPS_TIMEOUT               30000
 #define UPS_SHUTDOWN_THRESHOLD    20
 
@@ -403,6 +566,7 @@ extern void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config);
 #define MQTT_QOS                  1
 #define MQTT_RETAIN               true
 #define MQTT_TOPIC_PREFIX         "oukitel_p800e"
+#define MQTT_TOPIC_MAX            128    // Topics built on the stack
 
 // Data logging configuration
 #define LOG_INTERVAL              60000
@@ -413,6 +577,25 @@ extern void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config);
 #define SENSOR_READ_INTERVAL      1000
 #define SERIAL_LOG_INTERVAL       30000
 #define SERIAL_LOG_HEADER_INTERVAL 300000
+#define MQTT_PUBLISH_INTERVAL     30000
+#define HTTP_PUBLISH_INTERVAL     30000
+#define HEALTH_CHECK_INTERVAL     30000
+#define PERF_PUBLISH_INTERVAL     60000  // Profiler summary on MQTT (<state topic>/perf)
+#define MEMORY_SAMPLE_INTERVAL    1000   // Heap walk (largest block, fragmentation, allocation rates)
+#define MEMORY_PUBLISH_INTERVAL   60000  // Memory telemetry on MQTT (<state topic>/memory)
+#define WEB_PAGE_RESERVE          20000  // generateHTML() buffer, needed in one block
+#define JSON_ARENA_COUNT          3      // Pre-allocated ArduinoJson buffers (json_arena.h)
+#define JSON_ARENA_SIZE           6144   // Bytes per buffer, document and its JSON text
+#define WS_BROADCAST_INTERVAL     5000   // WebSocket heartbeat while the readings are unchanged
+#define WS_BROADCAST_MIN_INTERVAL 1000
+#define MQTT_PUBLISH_MIN_INTERVAL 5000   // Earliest MQTT publish after a change
+#define HTTP_PUBLISH_MIN_INTERVAL 10000  // Earliest HTTP publish after a change
+
+// Telemetry change filter (a sink publishes early when one of these is exceeded)
+#define TELEMETRY_POWER_DELTA_W   5.0
+#define TELEMETRY_VOLTAGE_DELTA_V 0.05
+#define TELEMETRY_SOC_DELTA       0.5
+#define SCHED_TICK_BUDGET_US      5000   // loop() work per iteration before due tasks are deferred
 
 // EEPROM/SPIFFS configuration
 #define EEPROM_SIZE               4096
@@ -420,6 +603,8 @@ extern void saveHttpShutdownConfigToSPIFFS(const HttpShutdownConfig& config);
 #define WIFI_CREDS_FILE           "/wifi.json"
 #define ENERGY_LOG_FILE           "/energy.log"
 #define CALIBRATION_FILE          "/calibration.json"
+#define COMPENSATION_FILE         "/compensation.json"
+#define SOC_CURVES_FILE           "/soc_curves.json"
 #define ENERGY_HISTORY_FILE       "/energy_history.json"
 
 // ===================================================================
@@ -445,4 +630,32 @@ const float BATTERY_CURVE_CHARGE[][2] = {
 };
 const int CURVE_CHARGE_POINTS = 18;
 
+// ===================================================================
+// VOLTAGE COMPENSATION DEFAULTS {measured V, offset V}, ascending
+// The original discharge/charge ladders, step for step: every band edge
+// is listed twice, {edge, offset below} then {edge, offset from it up}.
+// ===================================================================
+const float VOLTAGE_COMP_DISCHARGE[][2] = {
+  {21.5, 0.00}, {21.5, 1.50}, {22.0, 1.50}, {22.0, 0.00},
+  {24.0, 0.00}, {24.0, 0.50}, {24.8, 0.50}, {24.8, 0.40},
+  {25.0, 0.40}, {25.0, 0.30}, {25.2, 0.30}, {25.2, 0.20},
+  {25.5, 0.20}, {25.5, 0.10}, {26.0, 0.10}, {26.0, 0.00},
+  {28.5, 0.00}, {28.5, -1.00}
+};
+const int VOLTAGE_COMP_DISCHARGE_POINTS = 18;
+
+const float VOLTAGE_COMP_CHARGE[][2] = {
+  {21.0, 0.00}, {21.0, 1.00}, {23.5, 1.00}, {23.5, 0.80},
+  {24.0, 0.80}, {24.0, 0.70}, {24.5, 0.70}, {24.5, 0.60},
+  {25.0, 0.60}, {25.0, 0.50}, {25.5, 0.50}, {25.5, 0.40},
+  {26.0, 0.40}, {26.0, 0.00}, {26.5, 0.00}, {26.5, -0.25},
+  {27.0, -0.25}, {27.0, -0.30}, {27.2, -0.30}, {27.2, -0.40},
+  {27.4, -0.40}, {27.4, -0.50}, {27.6, -0.50}, {27.6, -0.60},
+  {27.8, -0.60}, {27.8, -0.70}, {28.0, -0.70}, {28.0, -0.75},
+  {28.1, -0.75}, {28.1, -0.80}, {28.2, -0.80}, {28.2, -0.85},
+  {28.3, -0.85}, {28.3, -0.90}, {28.4, -0.90}, {28.4, -0.95},
+  {28.5, -0.95}, {28.5, -1.00}
+};
+const int VOLTAGE_COMP_CHARGE_POINTS = 38;
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -4,8 +4,13 @@
 
 #include "data_logger.h"
 #include "logger.h"
+#include "memory_telemetry.h"
+#include "json_arena.h"
 #include <time.h>
 
+extern MemoryTelemetry memTelemetry;
+extern JsonPool jsonPool;
+
 DataLogger::DataLogger() {
   initialized = false;
   lastLogTime = 0;
@@ -17,11 +22,11 @@ DataLogger::DataLogger() {
 }
 
 bool DataLogger::begin() {
-  Serial.println("[LOG] Initializing data logger...");
+  LogSerial.println("[LOG] Initializing data logger...");
   
   // Initialize SPIFFS
   if (!SPIFFS.begin(true)) {
-    Serial.println("[LOG] SPIFFS initialization failed");
+    LogSerial.println("[LOG] SPIFFS initialization failed");
     return false;
   }
   
@@ -29,10 +34,10 @@ bool DataLogger::begin() {
   size_t totalBytes = SPIFFS.totalBytes();
   size_t usedBytes = SPIFFS.usedBytes();
   
-  Serial.println("[LOG] SPIFFS initialized:");
-  Serial.println("  Total: " + String(totalBytes) + " bytes");
-  Serial.println("  Used: " + String(usedBytes) + " bytes");
-  Serial.println("  Free: " + String(totalBytes - usedBytes) + " bytes");
+  LogSerial.println("[LOG] SPIFFS initialized:");
+  LogSerial.println("  Total: " + String(totalBytes) + " bytes");
+  LogSerial.println("  Used: " + String(usedBytes) + " bytes");
+  LogSerial.println("  Free: " + String(totalBytes - usedBytes) + " bytes");
   
   // Clean old logs if needed
   cleanOldLogs();
@@ -42,7 +47,7 @@ bool DataLogger::begin() {
   updateMonthlyTotals();
   
   initialized = true;
-  Serial.println("[LOG] Data logger initialized");
+  LogSerial.println("[LOG] Data logger initialized");
   return true;
 }
 
@@ -58,7 +63,8 @@ bool DataLogger::logData(const SensorData& sensorData, const EnergyData& energyD
   calculateEnergyConsumption(sensorData);
   
   // Create log entry
-  DynamicJsonDocument doc(512);
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["timestamp"] = sensorData.timestamp;
   doc["main_current"] = sensorData.mainCurrent;
   doc["output_current"] = sensorData.outputCurrent;
@@ -88,12 +94,13 @@ bool DataLogger::logData(const SensorData& sensorData, const EnergyData& energyD
   // Append to log file
   File file = SPIFFS.open(logFile, "a");
   if (!file) {
-    LOG_ERROR("Data logger: Failed to open log file: " + logFile);
+    LOG_ERROR("Data logger: Failed to open log file: %s", logFile.c_str());
     return false;
   }
   
-  String logEntry;
-  serializeJson(doc, logEntry);
+  size_t length;
+  const char* logEntry = lease.serialize(length);
+  memTelemetry.noteUse(MEM_USE_DATA_LOG, length + 1);
   file.println(logEntry);
   file.close();
   
@@ -102,9 +109,9 @@ bool DataLogger::logData(const SensorData& sensorData, const EnergyData& energyD
   // Debug output every 10 logs
   static int logCount = 0;
   if (++logCount >= 10) {
-    LOG_DEBUG("Data logger: Logged 10 entries to: " + logFile);
-    LOG_DEBUG("  Daily consumption: " + String(totalDailyConsumption, 3) + " kWh");
-    LOG_DEBUG("  Monthly consumption: " + String(totalMonthlyConsumption, 3) + " kWh");
+    LOG_DEBUG("Data logger: Logged 10 entries to: %s", logFile.c_str());
+    LOG_DEBUG("  Daily consumption: %.3f kWh", totalDailyConsumption);
+    LOG_DEBUG("  Monthly consumption: %.3f kWh", totalMonthlyConsumption);
     logCount = 0;
   }
   
@@ -131,7 +138,7 @@ bool DataLogger::logEvent(const String& event, const String& details) {
   file.println(logEntry);
   file.close();
   
-  Serial.println("[LOG] Event logged: " + event + " - " + details);
+  LOG_INFO("Data logger: Event logged: %s - %s", event.c_str(), details.c_str());
   return true;
 }
 
@@ -174,7 +181,7 @@ void DataLogger::calculateEnergyConsumption(const SensorData& data) {
   if (currentDay != today) {
     if (currentDay != 0) {
       // Day changed, reset daily total
-      Serial.println("[LOG] Day changed, daily consumption was: " + String(totalDailyConsumption, 3) + " kWh");
+      LOG_INFO("Data logger: Day changed, daily consumption was: %.3f kWh", totalDailyConsumption);
       totalDailyConsumption = 0.0;
     }
     currentDay = today;
@@ -183,7 +190,7 @@ void DataLogger::calculateEnergyConsumption(const SensorData& data) {
   if (currentMonth != thisMonth) {
     if (currentMonth != 0) {
       // Month changed, reset monthly total
-      Serial.println("[LOG] Month changed, monthly consumption was: " + String(totalMonthlyConsumption, 3) + " kWh");
+      LOG_INFO("Data logger: Month changed, monthly consumption was: %.3f kWh", totalMonthlyConsumption);
       totalMonthlyConsumption = 0.0;
     }
     currentMonth = thisMonth;
@@ -372,7 +379,7 @@ EnergyData DataLogger::getEnergyData() {
 }
 
 void DataLogger::cleanOldLogs() {
-  Serial.println("[LOG] Cleaning old log files...");
+  LOG_DEBUG("Data logger: Cleaning old log files...");
   
   File root = SPIFFS.open("/");
   File file = root.openNextFile();
@@ -380,7 +387,7 @@ void DataLogger::cleanOldLogs() {
   time_t now = time(nullptr);
   if (now < 1000000000) {
     // NTP not synchronized, skip cleanup
-    Serial.println("[LOG] NTP not synchronized, skipping log cleanup");
+    LOG_WARNING("Data logger: NTP not synchronized, skipping log cleanup");
     return;
   }
   time_t cutoffTime = now - (LOG_RETENTION_DAYS * 24 * 60 * 60);
@@ -407,7 +414,7 @@ void DataLogger::cleanOldLogs() {
         file.close();
         SPIFFS.remove(fileName);
         deletedFiles++;
-        Serial.println("[LOG] Deleted old log file: " + fileName);
+        LOG_DEBUG("Data logger: Deleted old log file: %s", fileName.c_str());
       }
     }
     
@@ -415,7 +422,7 @@ void DataLogger::cleanOldLogs() {
   }
   
   if (deletedFiles > 0) {
-    Serial.println("[LOG] Cleaned " + String(deletedFiles) + " old log files");
+    LOG_INFO("Data logger: Cleaned %d old log files", deletedFiles);
   }
 }
 
@@ -455,7 +462,7 @@ String DataLogger::getStorageInfo() {
 }
 
 void DataLogger::clearLogs() {
-  Serial.println("[LOG] Clearing all log files...");
+  LOG_DEBUG("Data logger: Clearing all log files...");
   
   File root = SPIFFS.open("/");
   File file = root.openNextFile();
@@ -476,5 +483,5 @@ void DataLogger::clearLogs() {
   totalDailyConsumption = 0.0;
   totalMonthlyConsumption = 0.0;
   
-  Serial.println("[LOG] Cleared " + String(deletedFiles) + " log files");
+  LOG_INFO("Data logger: Cleared %d log files", deletedFiles);
 }
\ No newline at end of file
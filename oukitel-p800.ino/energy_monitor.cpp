@@ -13,6 +13,8 @@
 
 PowerStationMonitor::PowerStationMonitor() {
   initialized = false;
+  monthlyResetRequested = false;
+  historyMutex = nullptr;
   peakPower = 0.0;
   averagePower = 0.0;
   startTime = 0;
@@ -48,6 +50,7 @@ PowerStationMonitor::PowerStationMonitor() {
   currentData.instantPower = 0.0;
   currentData.peakPower = 0.0;
   currentData.operatingTime = 0;
+  publishedData.write(currentData);
 }
 
 
@@ -59,12 +62,15 @@ bool PowerStationMonitor::begin() {
   lastDailyCheck = startTime;
   lastMonthCheck = startTime;
   
+  historyMutex = xSemaphoreCreateMutex();
+  
   // Load state from SPIFFS
   loadEnergyState();
   
   // Load monthly history from SPIFFS
   loadMonthlyHistory();
   
+  publish();
   initialized = true;
   LOG_DEBUG("Energy monitor initialized");
   return true;
@@ -79,6 +85,11 @@ void PowerStationMonitor::update(const SensorData& sensorData) {
   
   if (timeDelta < 0.1) return; // Minimum 100ms between updates
   
+  if (monthlyResetRequested) {
+    monthlyResetRequested = false;
+    resetMonthlyStats();
+  }
+  
   // Check for daily rollover (every 60 seconds)
   if (currentTime - lastDailyCheck >= 60000) {
     checkDailyRollover();
@@ -121,6 +132,7 @@ void PowerStationMonitor::update(const SensorData& sensorData) {
   currentData.operatingTime = (currentTime - startTime) / 1000;
   
   lastUpdate = currentTime;
+  publish();
   
   // Save state periodically (every 5 minutes)
   static unsigned long lastSave = 0;
@@ -133,13 +145,12 @@ void PowerStationMonitor::update(const SensorData& sensorData) {
   static unsigned long lastDebug = 0;
   if (currentTime - lastDebug > 60000) {
     LOG_DEBUG("Energy Statistics:");
-    LOG_DEBUG("  Instant: " + String(currentData.instantPower, 1) + "W | Avg: " + 
-              String(averagePower, 1) + "W | Peak: " + String(peakPower, 1) + "W");
-    LOG_DEBUG("  Daily: " + String(currentData.dailyConsumption, 3) + "kWh | " +
-              "Monthly: " + String(currentData.monthlyConsumption, 3) + "kWh");
-    LOG_DEBUG("  Total: " + String(totalEnergyConsumed, 3) + "kWh | " +
-              "Eff: " + String(efficiency, 1) + "% | " +
-              "PF: " + String(powerFactor, 2));
+    LOG_DEBUG("  Instant: %.1fW | Avg: %.1fW | Peak: %.1fW",
+              currentData.instantPower, averagePower, peakPower);
+    LOG_DEBUG("  Daily: %.3fkWh | Monthly: %.3fkWh",
+              currentData.dailyConsumption, currentData.monthlyConsumption);
+    LOG_DEBUG("  Total: %.3fkWh | Eff: %.1f%% | PF: %.2f",
+              totalEnergyConsumed, efficiency, powerFactor);
     lastDebug = currentTime;
   }
 }
@@ -153,7 +164,7 @@ void PowerStationMonitor::checkDailyRollover() {
   int newDay = timeinfo->tm_mday;
   
   if (newDay != lastDay) {
-    LOG_INFO("Energy monitor: Daily rollover detected: " + String(lastDay) + " -> " + String(newDay));
+    LOG_INFO("Energy monitor: Daily rollover detected: %d -> %d", lastDay, newDay);
     
     // Reset daily consumption at midnight
     resetDailyStats();
@@ -173,8 +184,8 @@ void PowerStationMonitor::checkMonthRollover() {
   int newYear = timeinfo->tm_year + 1900;
   
   if (newMonth != currentMonth || newYear != currentYear) {
-    LOG_INFO("Energy monitor: Month rollover detected: " + String(currentYear) + "-" + 
-             String(currentMonth) + " -> " + String(newYear) + "-" + String(newMonth));
+    LOG_INFO("Energy monitor: Month rollover detected: %d-%d -> %d-%d",
+             currentYear, currentMonth, newYear, newMonth);
     
     // Save current month's data to history
     MonthlyEnergyRecord record;
@@ -183,10 +194,12 @@ void PowerStationMonitor::checkMonthRollover() {
     record.consumption = currentData.monthlyConsumption;
     
     // Add to history (keep only last 12 months)
+    xSemaphoreTake(historyMutex, portMAX_DELAY);
     monthlyHistory.push_back(record);
     if (monthlyHistory.size() > 12) {
       monthlyHistory.erase(monthlyHistory.begin());
     }
+    xSemaphoreGive(historyMutex);
     
     // Save to SPIFFS
     saveMonthlyHistory();
@@ -223,7 +236,7 @@ void PowerStationMonitor::loadEnergyState() {
   file.close();
   
   if (error) {
-    LOG_ERROR("Energy monitor: Failed to parse energy state: " + String(error.c_str()));
+    LOG_ERROR("Energy monitor: Failed to parse energy state: %s", error.c_str());
     return;
   }
   
@@ -240,9 +253,9 @@ void PowerStationMonitor::loadEnergyState() {
   currentData.peakPower = peakPower;
   
   LOG_DEBUG("Energy monitor: Loaded energy state:");
-  Serial.println("  Total: " + String(totalEnergyConsumed, 3) + " kWh");
-  Serial.println("  Daily: " + String(currentData.dailyConsumption, 3) + " kWh");
-  Serial.println("  Monthly: " + String(currentData.monthlyConsumption, 3) + " kWh");
+  LOG_DEBUG("  Total: %.3f kWh", totalEnergyConsumed);
+  LOG_DEBUG("  Daily: %.3f kWh", currentData.dailyConsumption);
+  LOG_DEBUG("  Monthly: %.3f kWh", currentData.monthlyConsumption);
 }
 
 
@@ -285,7 +298,7 @@ void PowerStationMonitor::loadMonthlyHistory() {
   file.close();
   
   if (error) {
-    LOG_ERROR("Energy monitor: Failed to parse history JSON: " + String(error.c_str()));
+    LOG_ERROR("Energy monitor: Failed to parse history JSON: %s", error.c_str());
     return;
   }
   
@@ -303,7 +316,7 @@ void PowerStationMonitor::loadMonthlyHistory() {
     // Filter out invalid dates (1970 = NTP not synced when saved)
     if (r.year == 1970 || r.year < 2020 || r.year > 2100 || r.month < 1 || r.month > 12) {
       invalidRecords++;
-      LOG_DEBUG("Energy monitor: Skipping invalid history record: " + String(r.year) + "-" + String(r.month));
+      LOG_DEBUG("Energy monitor: Skipping invalid history record: %d-%d", r.year, r.month);
       continue;  // Skip invalid records
     }
     
@@ -312,12 +325,12 @@ void PowerStationMonitor::loadMonthlyHistory() {
   }
   
   if (invalidRecords > 0) {
-    LOG_INFO("Energy monitor: Filtered out " + String(invalidRecords) + " invalid history records (1970 dates)");
+    LOG_INFO("Energy monitor: Filtered out %d invalid history records (1970 dates)", invalidRecords);
     // Save cleaned history back to SPIFFS
     saveMonthlyHistory();
   }
   
-  LOG_DEBUG("Energy monitor: Loaded " + String(validRecords) + " valid monthly records");
+  LOG_DEBUG("Energy monitor: Loaded %d valid monthly records", validRecords);
 }
 
 
@@ -363,9 +376,8 @@ void PowerStationMonitor::syncTimeAfterNTP() {
   // If month/year was 0 (not initialized) or 1970 (not synchronized), update it
   if (currentYear == 0 || currentYear == 1970 || currentMonth == 0) {
     if (currentYear == 1970 || currentYear == 0) {
-      LOG_INFO("Energy monitor: Time correction: Month/Year updated from " + 
-                     String(currentYear) + "-" + String(currentMonth) + " to " + 
-                     String(newYear) + "-" + String(newMonth));
+      LOG_INFO("Energy monitor: Time correction: Month/Year updated from %d-%d to %d-%d",
+               currentYear, currentMonth, newYear, newMonth);
     }
     
     currentMonth = newMonth;
@@ -382,14 +394,24 @@ void PowerStationMonitor::syncTimeAfterNTP() {
     LOG_INFO("Energy monitor: Time synchronized after NTP");
   } else {
     // Already synchronized, nothing to do
-    LOG_DEBUG("Energy monitor: syncTimeAfterNTP() called - Already synchronized (" + 
-                   String(currentYear) + "-" + String(currentMonth) + ")");
+    LOG_DEBUG("Energy monitor: syncTimeAfterNTP() called - Already synchronized (%d-%d)",
+              currentYear, currentMonth);
   }
 }
 
 
+// Held only for a copy of at most 12 records on either side
 std::vector<MonthlyEnergyRecord> PowerStationMonitor::getMonthlyHistory() {
-  return monthlyHistory;
+  if (historyMutex == nullptr) return monthlyHistory;
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+  std::vector<MonthlyEnergyRecord> history = monthlyHistory;
+  xSemaphoreGive(historyMutex);
+  return history;
+}
+
+
+void PowerStationMonitor::publish() {
+  publishedData.write(currentData);
 }
 
 
@@ -428,12 +450,11 @@ void PowerStationMonitor::calculateEfficiency(const SensorData& data) {
     efficiency = 0.0;
   }
   
+  // mainPower is mainCurrent * g_mainsVoltage, so their ratio is always 1.
+  // The distortion power factor of the IN waveform is the part the clamp
+  // can actually measure (no voltage waveform for the displacement part).
   if (data.mainCurrent > 0.1) {
-    float apparentPower = data.mainCurrent * g_mainsVoltage; // Use configurable mains voltage
-    powerFactor = data.mainPower / apparentPower;
-    
-    if (powerFactor > 1.0) powerFactor = 1.0;
-    if (powerFactor < 0.0) powerFactor = 0.0;
+    powerFactor = data.mainsPowerFactor;
   } else {
     powerFactor = 1.0;
   }
@@ -441,20 +462,20 @@ void PowerStationMonitor::calculateEfficiency(const SensorData& data) {
 
 
 EnergyData PowerStationMonitor::getEnergyData() {
-  return currentData;
+  return publishedData.read();
 }
 
 
 EnergyData PowerStationMonitor::getStableEnergyData() {
   unsigned long currentTime = millis();
-  EnergyData stable = currentData;
+  EnergyData stable = publishedData.read();
   
   if (lastStableMonthly > 0.001) {
     if (stable.monthlyConsumption < lastStableMonthly * 0.7) {
       LOG_WARNING("Energy monitor: Anomaly detected!");
-      Serial.println("  Monthly: " + String(stable.monthlyConsumption, 3) + "kWh");
-      Serial.println("  Expected min: " + String(lastStableMonthly * 0.7, 3) + "kWh");
-      Serial.println("  Keeping last stable value: " + String(lastStableMonthly, 3) + "kWh");
+      LOG_WARNING("  Monthly: %.3fkWh", stable.monthlyConsumption);
+      LOG_WARNING("  Expected min: %.3fkWh", lastStableMonthly * 0.7);
+      LOG_WARNING("  Keeping last stable value: %.3fkWh", lastStableMonthly);
       
       stable.monthlyConsumption = lastStableMonthly;
       stable.dailyConsumption = lastStableDaily;
@@ -493,7 +514,7 @@ float PowerStationMonitor::getPowerFactor() {
 
 
 unsigned long PowerStationMonitor::getOperatingTime() {
-  return currentData.operatingTime;
+  return publishedData.read().operatingTime;
 }
 
 
@@ -502,9 +523,10 @@ void PowerStationMonitor::resetDailyStats() {
   currentData.dailyConsumption = 0.0;
   lastStableDaily = 0.0;
   
+  publish();
   saveEnergyState();
   
-    LOG_INFO("Energy monitor: Daily statistics reset. Total: " + String(totalEnergyConsumed, 3) + "kWh");
+    LOG_INFO("Energy monitor: Daily statistics reset. Total: %.3fkWh", totalEnergyConsumed);
 }
 
 
@@ -513,9 +535,15 @@ void PowerStationMonitor::resetMonthlyStats() {
   currentData.monthlyConsumption = 0.0;
   lastStableMonthly = 0.0;
   
+  publish();
   saveEnergyState();
   
-    LOG_INFO("Energy monitor: Monthly statistics reset. Total: " + String(totalEnergyConsumed, 3) + "kWh");
+    LOG_INFO("Energy monitor: Monthly statistics reset. Total: %.3fkWh", totalEnergyConsumed);
+}
+
+
+void PowerStationMonitor::requestMonthlyReset() {
+  monthlyResetRequested = true;
 }
 
 
@@ -547,6 +575,7 @@ void PowerStationMonitor::resetAllStats() {
   startTime = millis();
   lastUpdate = startTime;
   
+  publish();
   saveEnergyState();
   
     LOG_INFO("Energy monitor: All statistics reset");
@@ -8,13 +8,16 @@
 
 
 #include "config.h"
+#include "seqlock.h"
 #include <vector>
 
 
 class PowerStationMonitor {
 private:
-  EnergyData currentData;
+  EnergyData currentData;                       // Main loop only
+  SeqLockSnapshot<EnergyData> publishedData;    // Copy for the network task
   bool initialized;
+  volatile bool monthlyResetRequested;          // Set by the network task, done in update()
   
   // Power tracking
   float peakPower;
@@ -47,8 +50,9 @@ private:
   unsigned long lastMonthCheck;
   int lastDay;
   
-  // Monthly history tracking
+  // Monthly history tracking (historyMutex: copied by the network task)
   std::vector<MonthlyEnergyRecord> monthlyHistory;
+  SemaphoreHandle_t historyMutex;
   int currentMonth;
   int currentYear;
   
@@ -62,6 +66,7 @@ private:
   void saveMonthlyHistory();
   void loadEnergyState();
   void saveEnergyState();
+  void publish();
 
 
 public:
@@ -70,7 +75,7 @@ public:
   void update(const SensorData& sensorData);
   EnergyData getEnergyData();
   
-  // Stable data without fluctuations
+  // Stable data without fluctuations (main loop, once per telemetry frame)
   EnergyData getStableEnergyData();
   
   // ===================================================================
@@ -92,6 +97,7 @@ public:
   void resetDailyStats();
   void resetMonthlyStats();
   void resetAllStats();
+  void requestMonthlyReset();    // From other tasks: reset on the next update()
 };
 
 
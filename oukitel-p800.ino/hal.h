@@ -0,0 +1,46 @@
+/*
+ * Hardware Abstraction Layer - Clock, GPIO and ADC results used by the
+ * sensor-to-state pipeline of HardwareManager.
+ * Plain C++ (no Arduino dependencies): EspHal talks to the real hardware,
+ * ReplayHal (hal_replay.h) plays back a recorded ADC trace on a virtual
+ * clock so the pipeline can run faster than real time.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include "adc_window.h"
+
+#define HAL_PIN_LOW     0
+#define HAL_PIN_HIGH    1
+#define HAL_PIN_OUTPUT  0x03   // Same value as the Arduino OUTPUT mode
+
+class Hal {
+public:
+  virtual ~Hal() {}
+
+  // Clock
+  virtual unsigned long nowMs() = 0;
+  virtual int64_t nowUs() = 0;
+
+  // GPIO (button outputs)
+  virtual void setPinMode(int pin, int mode) = 0;
+  virtual void writePin(int pin, int level) = 0;
+  virtual int readPin(int pin) = 0;
+
+  // ADC: latest finished IN/OUT windows (same sequence), false until the first one
+  virtual bool getLatestWindows(AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT]) = 0;
+
+  // ADC: filtered battery divider reading (calibrated mV at the pin), false until the first one
+  virtual bool getBatteryMillivolts(float& millivolts) = 0;
+
+  // Fast mains-loss flag of the window engine
+  virtual bool isMainsLost() = 0;
+
+  // Drops the fast loss when the slow path does not confirm it (a RESTORED
+  // event follows, possibly a little later)
+  virtual void clearMainsLoss() = 0;
+};
+
+#endif // HAL_H
@@ -0,0 +1,58 @@
+/*
+ * ESP32 HAL backend - Arduino clock and GPIO, ADC results from the
+ * background DMA sampler
+ */
+
+#ifndef HAL_ESP32_H
+#define HAL_ESP32_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "hal.h"
+#include "adc_sampler.h"
+
+class EspHal : public Hal {
+private:
+  AdcSampler& sampler;
+
+public:
+  explicit EspHal(AdcSampler& adcSampler) : sampler(adcSampler) {}
+
+  unsigned long nowMs() {
+    return millis();
+  }
+
+  int64_t nowUs() {
+    return esp_timer_get_time();
+  }
+
+  void setPinMode(int pin, int mode) {
+    pinMode(pin, mode);
+  }
+
+  void writePin(int pin, int level) {
+    digitalWrite(pin, level);
+  }
+
+  int readPin(int pin) {
+    return digitalRead(pin);
+  }
+
+  bool getLatestWindows(AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT]) {
+    return sampler.getLatestWindows(windows);
+  }
+
+  bool getBatteryMillivolts(float& millivolts) {
+    return sampler.getBatteryMillivolts(millivolts);
+  }
+
+  bool isMainsLost() {
+    return sampler.isMainsLost();
+  }
+
+  void clearMainsLoss() {
+    sampler.requestMainsClear();
+  }
+};
+
+#endif // HAL_ESP32_H
@@ -0,0 +1,244 @@
+/*
+ * Replay HAL backend - Plays a recorded ADC trace through the window
+ * engine on a virtual clock, so the sensor-to-state pipeline can run
+ * faster than real time (on the device from SPIFFS, or the engine stages
+ * on a PC). Plain C++ (stdio only, no Arduino dependencies).
+ *
+ * Trace format, one sample per line (CSV):
+ *   # rate=10000          optional, per-channel sample rate in Hz
+ *   in,out,battery_mv     IN/OUT raw 12-bit counts, battery divider in mV at the pin
+ * Lines that do not start with a number are skipped (headers, comments).
+ */
+
+#ifndef HAL_REPLAY_H
+#define HAL_REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "hal.h"
+
+#define HAL_REPLAY_DEFAULT_RATE  10000.0f   // Per-channel Hz when the trace has no header
+#define HAL_REPLAY_PINS          40
+
+class ReplayHal : public Hal {
+private:
+  FILE* file;
+  AdcWindowEngine engine;
+  float rateHz;
+  int64_t clockUs;            // Virtual clock
+  int64_t nextSampleUs;       // Timestamp of the next trace sample
+  uint64_t samplesRead;
+  bool finished;
+
+  // Last windows closed by the engine
+  AdcRmsWindow published[ADC_SAMPLER_CH_COUNT];
+  bool hasWindows;
+
+  // Battery oversampling + EMA, same scheme as the DMA sampler
+  double batterySum;
+  uint32_t batteryCount;
+  uint32_t batteryWindowSamples;
+  float batteryAlpha;
+  float batteryFilteredMv;
+  bool hasBattery;
+
+  // GPIO writes are recorded instead of driving pins
+  uint8_t pinLevels[HAL_REPLAY_PINS];
+  uint32_t pinWrites;
+  uint32_t pinRises;
+
+  // Next "in,out,battery_mv" line, false at end of file
+  bool readSample(int& in, int& out, float& batteryMv) {
+    char line[96];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      float headerRate = 0;
+      if (sscanf(line, "# rate=%f", &headerRate) == 1 && headerRate > 0) {
+        if (samplesRead == 0) rateHz = headerRate;
+        continue;
+      }
+      if (sscanf(line, "%d,%d,%f", &in, &out, &batteryMv) == 3) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void addBattery(float batteryMv) {
+    batterySum += batteryMv;
+    batteryCount++;
+    if (batteryCount < batteryWindowSamples) return;
+
+    float mean = (float)(batterySum / batteryCount);
+    batterySum = 0;
+    batteryCount = 0;
+    if (!hasBattery) {
+      batteryFilteredMv = mean;
+      hasBattery = true;
+    } else {
+      batteryFilteredMv += batteryAlpha * (mean - batteryFilteredMv);
+    }
+  }
+
+  static uint16_t clampSample(int sample) {
+    if (sample < 0) return 0;
+    if (sample > 4095) return 4095;
+    return (uint16_t)sample;
+  }
+
+public:
+  ReplayHal()
+    : file(nullptr), rateHz(HAL_REPLAY_DEFAULT_RATE), clockUs(0), nextSampleUs(0),
+      samplesRead(0), finished(true), hasWindows(false), batterySum(0), batteryCount(0),
+      batteryWindowSamples(1), batteryAlpha(1), batteryFilteredMv(0), hasBattery(false),
+      pinWrites(0), pinRises(0) {
+    for (int i = 0; i < HAL_REPLAY_PINS; i++) pinLevels[i] = 0;
+  }
+
+  ~ReplayHal() {
+    close();
+  }
+
+  // batteryWindowMs/batteryFilterAlpha: BATTERY_SAMPLER_WINDOW_MS/BATTERY_FILTER_ALPHA
+  // on the device. The window engine rate estimate is taken from the trace.
+  bool open(const char* path, const AdcWindowConfig& config, uint32_t batteryWindowMs, float batteryFilterAlpha) {
+    close();
+    file = fopen(path, "r");
+    if (file == nullptr) return false;
+
+    rateHz = HAL_REPLAY_DEFAULT_RATE;
+    clockUs = 0;
+    nextSampleUs = 0;
+    samplesRead = 0;
+    finished = false;
+    hasWindows = false;
+    batterySum = 0;
+    batteryCount = 0;
+    batteryAlpha = batteryFilterAlpha;
+    hasBattery = false;
+    pinWrites = 0;
+    pinRises = 0;
+    for (int i = 0; i < HAL_REPLAY_PINS; i++) pinLevels[i] = 0;
+
+    // Peek the header so the engine starts with the right rate
+    long start = ftell(file);
+    char line[96];
+    if (fgets(line, sizeof(line), file) != nullptr) {
+      float headerRate = 0;
+      if (sscanf(line, "# rate=%f", &headerRate) == 1 && headerRate > 0) rateHz = headerRate;
+    }
+    fseek(file, start, SEEK_SET);
+
+    AdcWindowConfig replayConfig = config;
+    replayConfig.channelRateHz = rateHz;
+    engine.begin(replayConfig, 0);
+
+    batteryWindowSamples = (uint32_t)(rateHz * batteryWindowMs / 1000);
+    if (batteryWindowSamples < 1) batteryWindowSamples = 1;
+    return true;
+  }
+
+  void close() {
+    if (file != nullptr) {
+      fclose(file);
+      file = nullptr;
+    }
+    finished = true;
+  }
+
+  // Move the virtual clock forward and feed every trace sample up to it.
+  // Returns false once the trace is exhausted.
+  bool advance(uint32_t ms) {
+    clockUs += (int64_t)ms * 1000;
+    while (!finished && nextSampleUs <= clockUs) {
+      int in, out;
+      float batteryMv;
+      if (!readSample(in, out, batteryMv)) {
+        finished = true;
+        break;
+      }
+
+      MainsLossEvent event;
+      bool closed = engine.addSample(ADC_SAMPLER_CH_IN, clampSample(in), nextSampleUs, event);
+      closed |= engine.addSample(ADC_SAMPLER_CH_OUT, clampSample(out), nextSampleUs, event);
+      if (closed) {
+        for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) published[i] = engine.result(i);
+        hasWindows = true;
+      }
+      addBattery(batteryMv);
+
+      samplesRead++;
+      nextSampleUs = (int64_t)(samplesRead * 1000000.0 / rateHz);
+    }
+    return !finished;
+  }
+
+  bool isFinished() const {
+    return finished;
+  }
+
+  uint64_t getSamplesRead() const {
+    return samplesRead;
+  }
+
+  float getSampleRate() const {
+    return rateHz;
+  }
+
+  uint32_t getPinWrites() const {
+    return pinWrites;
+  }
+
+  // LOW -> HIGH writes, i.e. button presses started by the pipeline
+  uint32_t getPinRises() const {
+    return pinRises;
+  }
+
+  // Hal
+  unsigned long nowMs() {
+    return (unsigned long)(clockUs / 1000);
+  }
+
+  int64_t nowUs() {
+    return clockUs;
+  }
+
+  void setPinMode(int pin, int mode) {
+    (void)pin;
+    (void)mode;
+  }
+
+  void writePin(int pin, int level) {
+    if (pin < 0 || pin >= HAL_REPLAY_PINS) return;
+    uint8_t newLevel = level ? HAL_PIN_HIGH : HAL_PIN_LOW;
+    if (newLevel == HAL_PIN_HIGH && pinLevels[pin] == HAL_PIN_LOW) pinRises++;
+    pinLevels[pin] = newLevel;
+    pinWrites++;
+  }
+
+  int readPin(int pin) {
+    if (pin < 0 || pin >= HAL_REPLAY_PINS) return HAL_PIN_LOW;
+    return pinLevels[pin];
+  }
+
+  bool getLatestWindows(AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT]) {
+    if (!hasWindows) return false;
+    for (int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) windows[i] = published[i];
+    return true;
+  }
+
+  bool getBatteryMillivolts(float& millivolts) {
+    if (!hasBattery) return false;
+    millivolts = batteryFilteredMv;
+    return true;
+  }
+
+  bool isMainsLost() {
+    return engine.isMainsLost();
+  }
+
+  void clearMainsLoss() {
+    engine.clearMainsLoss();
+  }
+};
+
+#endif // HAL_REPLAY_H
@@ -7,9 +7,15 @@
 #include "web_server.h"
 #include "logger.h"
 #include <SPIFFS.h>
+#include <esp_timer.h>
+#include "loop_profiler.h"
 
+extern LoopProfiler profiler;
 
-HardwareManager::HardwareManager() {
+
+HardwareManager::HardwareManager() : espHal(adcSampler) {
+  hal = &espHal;
+  
   buttonPins[BTN_POWER] = PIN_BUTTON_POWER;
   buttonPins[BTN_USB] = PIN_BUTTON_USB;
   buttonPins[BTN_DC] = PIN_BUTTON_DC;
@@ -20,26 +26,82 @@ HardwareManager::HardwareManager() {
   currentData.outputCurrent = 0;
   currentData.batteryVoltage = 0;
   currentData.batteryPercentage = 0;
+  currentData.socVoltage = 0;
+  currentData.socFused = 0;
+  currentData.batteryCurrent = 0;
   currentData.mainPower = 0;
   currentData.outputPower = 0;
   currentData.onBattery = false;
   currentData.batteryState = STATE_REST;
+  currentData.mainsFrequency = 0;
+  currentData.mainsPowerFactor = 1.0;
+  currentData.mainsLost = false;
   currentData.timestamp = 0;
+  sensorTaskHandle = nullptr;
+  sensorTaskPaused = false;
+  sensorTaskBusy = false;
+  warmupRestartRequested = false;
+  
+  lastMainsEventSequence = 0;
+  powerFilterConfigSequence = 0;
+  mainsUnconfirmedReadings = 0;
+  mainsLossStats.events = 0;
+  mainsLossStats.lastDetectMs = 0;
+  mainsLossStats.lastNotifyMs = 0;
+  mainsLossStats.maxNotifyMs = 0;
+  mainsLossStats.lastEventAt = 0;
+  
+  AcqSchedulerConfig acqConfig;
+  acqConfig.idleAfterMs = ACQ_IDLE_AFTER_MS;
+  acqConfig.powerDeltaW = ACQ_POWER_DELTA_W;
+  acqConfig.voltageSagV = ACQ_VOLTAGE_SAG_V;
+  acqScheduler.configure(acqConfig);
+  acqMainsSequence = 0;
+  lowPowerAcquisition = false;
+  acqLowPowerApplied = false;
+  
+  harmonicChannel = ADC_SAMPLER_CH_IN;
+  lastHarmonicStart = 0;
+  for(int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+    harmonicSnapshots[i].write(harmonicAnalyzer.result());  // Not valid yet
+  }
+  
+  autoPowerOnEnabled = false;
+  powerStationWasOff = true;
+  powerOnTime = 0;
+  acAlreadyActivated = false;
+  
+  webServerRef = nullptr;
+  
+  commandQueue = nullptr;
+  commandLock = portMUX_INITIALIZER_UNLOCKED;
+  commandStats.posted = 0;
+  commandStats.dropped = 0;
+  commandStats.executed = 0;
+  commandStats.maxWaitUs = 0;
+  acActivatedCount = 0;
+  acActivatedSeen = 0;
   
+  resetPipelineState();
+}
+
+
+void HardwareManager::resetPipelineState() {
   isWarmedUp = false;
   warmupCounter = 0;
   warmupStartTime = 0;
+  warmupRestartRequested = false;
   
-  socBufferIndex = 0;
-  socBufferFull = false;
+  socWindow.reset(SOC_BUFFER_SIZE_DEFAULT);
   displayedSOC = 0;
-  for(int i = 0; i < SOC_BUFFER_SIZE; i++) {
-    socBuffer[i] = 0;
-  }
   
-  filteredPowerIN = 0;
-  filteredPowerOUT = 0;
-  powerFilterInitialized = false;
+  socEstimator.reset();
+  lastSocUpdateTime = 0;
+  restStartTime = 0;
+  floatStartTime = 0;
+  
+  powerFilterIn.reset();
+  powerFilterOut.reset();
   
   lastValidPowerIN = 0;
   lastValidPowerOUT = 0;
@@ -49,13 +111,6 @@ HardwareManager::HardwareManager() {
   previousState = STATE_REST;
   lastValidSOC = 0;
   
-  autoPowerOnEnabled = false;
-  powerStationWasOff = true;
-  powerOnTime = 0;
-  acAlreadyActivated = false;
-  
-  webServerRef = nullptr;
-  
   // Initialize emergency counters
   voltageMinSafeCounter = 0;
   batteryLowWarningCounter = 0;
@@ -88,74 +143,296 @@ HardwareManager::HardwareManager() {
 
 
 bool HardwareManager::begin() {
-  Serial.println("[HW] Initializing hardware manager...");
-  
-  analogSetPinAttenuation(PIN_BATTERY_VOLTAGE, ADC_11db);
-  analogSetPinAttenuation(PIN_SCT013_MAIN, ADC_11db);
-  analogSetPinAttenuation(PIN_SCT013_OUTPUT, ADC_11db);
+  LogSerial.println("[HW] Initializing hardware manager...");
   
   sctMain.current(PIN_SCT013_MAIN, g_sct013CalIn);
   sctOutput.current(PIN_SCT013_OUTPUT, g_sct013CalOut);
   
+  // SCT013 clamps and battery divider are sampled continuously in the background (DMA)
+  adcSampler.setWindowCycles(g_rmsWindowCycles);
+  if (!adcSampler.begin()) {
+    LOG_ERROR("Hardware: Failed to start ADC sampler");
+    return false;
+  }
+  
   for(int i = 0; i < 5; i++) {
-    pinMode(buttonPins[i], OUTPUT);
-    digitalWrite(buttonPins[i], LOW);
+    hal->setPinMode(buttonPins[i], OUTPUT);
+    hal->writePin(buttonPins[i], LOW);
   }
   
-  Serial.println("[HW] Button mapping:");
-  Serial.println("  POWER (3s):     GPIO" + String(PIN_BUTTON_POWER));
-  Serial.println("  USB Output:     GPIO" + String(PIN_BUTTON_USB));
-  Serial.println("  DC Output:      GPIO" + String(PIN_BUTTON_DC));
-  Serial.println("  Flashlight:     GPIO" + String(PIN_BUTTON_FLASHLIGHT));
-  Serial.println("  AC Output:      GPIO" + String(PIN_BUTTON_AC));
+  LogSerial.println("[HW] Button mapping:");
+  LogSerial.println("  POWER (3s):     GPIO" + String(PIN_BUTTON_POWER));
+  LogSerial.println("  USB Output:     GPIO" + String(PIN_BUTTON_USB));
+  LogSerial.println("  DC Output:      GPIO" + String(PIN_BUTTON_DC));
+  LogSerial.println("  Flashlight:     GPIO" + String(PIN_BUTTON_FLASHLIGHT));
+  LogSerial.println("  AC Output:      GPIO" + String(PIN_BUTTON_AC));
   
-  Serial.println("[HW] Current sensors initialized:");
-  Serial.println("  SCT013 Main   (PIN " + String(PIN_SCT013_MAIN) + "): " + String(g_sct013CalIn, 2));
-  Serial.println("  SCT013 Output (PIN " + String(PIN_SCT013_OUTPUT) + "): " + String(g_sct013CalOut, 2));
-  Serial.println("[HW] Battery voltage divider configured (PIN " + String(PIN_BATTERY_VOLTAGE) + ")");
-  Serial.println("[HW] Starting sensor warm-up phase (" + String(g_warmupDelay) + "ms)...");
+  LogSerial.println("[HW] Current sensors initialized:");
+  LogSerial.println("  SCT013 Main   (PIN " + String(PIN_SCT013_MAIN) + "): " + String(g_sct013CalIn, 2));
+  LogSerial.println("  SCT013 Output (PIN " + String(PIN_SCT013_OUTPUT) + "): " + String(g_sct013CalOut, 2));
+  LogSerial.println("[HW] Battery voltage divider configured (PIN " + String(PIN_BATTERY_VOLTAGE) + ")");
+  LogSerial.println("[HW] Starting sensor warm-up phase (" + String(g_warmupDelay) + "ms)...");
   
-  warmupStartTime = millis();
+  warmupStartTime = hal->nowMs();
   
+  publishPowerFilterConfig();
   loadAutoPowerOnState();
   
+  commandQueue = xQueueCreate(HW_COMMAND_QUEUE_LENGTH, sizeof(HardwareCommand));
+  if(commandQueue == nullptr) {
+    LOG_ERROR("Hardware: Failed to create command queue");
+    return false;
+  }
+  
+  return startSensorTask();
+}
+
+
+bool HardwareManager::startSensorTask() {
+  if(sensorTaskHandle != nullptr) return true;
+  
+  if(xTaskCreatePinnedToCore(sensorTaskEntry, "sensors", SENSOR_TASK_STACK, this,
+                             SENSOR_TASK_PRIORITY, &sensorTaskHandle, SENSOR_TASK_CORE) != pdPASS) {
+    LOG_ERROR("Hardware: Failed to create sensor task");
+    sensorTaskHandle = nullptr;
+    return false;
+  }
+  
+  LogSerial.println("[HW] Sensor task started on core " + String(SENSOR_TASK_CORE) + " (every " + String(SENSOR_READ_INTERVAL) + "ms)");
   return true;
 }
 
 
+void HardwareManager::sensorTaskEntry(void* arg) {
+  ((HardwareManager*)arg)->sensorTaskLoop();
+}
+
+
+void HardwareManager::sensorTaskLoop() {
+  TickType_t lastWake = xTaskGetTickCount();
+  
+  for(;;) {
+    // Busy is raised before the pause check, so runReplay() never misses a reading in flight
+    sensorTaskBusy = true;
+    if(!sensorTaskPaused) {
+      int64_t startUs = esp_timer_get_time();
+      {
+        PerfScope scope(profiler, PERF_STAGE_READ_SENSORS);
+        readSensors();
+      }
+      updateAcquisition();
+      int64_t endUs = esp_timer_get_time();
+      sensorCpuLoad.add(endUs - startUs, endUs);
+    }
+    sensorTaskBusy = false;
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_READ_INTERVAL));
+  }
+}
+
+
 void HardwareManager::setWebServerReference(WebServerManager* webServer) {
   webServerRef = webServer;
-  Serial.println("[HW] WebServer reference set");
+  LogSerial.println("[HW] WebServer reference set");
+}
+
+
+// ===================================================================
+// NETWORK TASK REQUESTS
+// ===================================================================
+// The network task never touches the buttons or the settings globals
+// directly: it queues a request and returns. A full queue refuses the
+// request instead of waiting, so a burst of MQTT or WebSocket commands
+// cannot stall either side.
+
+bool HardwareManager::postCommand(HardwareCommand& cmd) {
+  if(commandQueue == nullptr) return false;
+  cmd.postedUs = esp_timer_get_time();
+  bool queued = (xQueueSend(commandQueue, &cmd, 0) == pdTRUE);
+  portENTER_CRITICAL(&commandLock);
+  if(queued) {
+    commandStats.posted++;
+  } else {
+    commandStats.dropped++;
+  }
+  portEXIT_CRITICAL(&commandLock);
+  if(!queued) {
+    LOG_WARNING("Hardware: Command queue full, request %d refused", cmd.type);
+  }
+  return queued;
+}
+
+
+bool HardwareManager::requestButtonPress(int buttonIndex, int duration) {
+  if(buttonIndex < 0 || buttonIndex >= 5) {
+    LOG_WARNING("Hardware: Invalid button index: %d", buttonIndex);
+    return false;
+  }
+  HardwareCommand cmd;
+  cmd.type = HW_CMD_PRESS_BUTTON;
+  cmd.arg = buttonIndex;
+  cmd.duration = duration;
+  return postCommand(cmd);
+}
+
+
+bool HardwareManager::requestAutoPowerOn(bool enabled) {
+  HardwareCommand cmd;
+  cmd.type = HW_CMD_SET_AUTO_POWER_ON;
+  cmd.arg = enabled ? 1 : 0;
+  cmd.duration = 0;
+  return postCommand(cmd);
+}
+
+
+bool HardwareManager::requestCalibration(const CalibrationData& calData) {
+  portENTER_CRITICAL(&commandLock);
+  pendingCalibration = calData;
+  portEXIT_CRITICAL(&commandLock);
+  HardwareCommand cmd;
+  cmd.type = HW_CMD_APPLY_CALIBRATION;
+  cmd.arg = 0;
+  cmd.duration = 0;
+  return postCommand(cmd);
+}
+
+
+bool HardwareManager::requestAdvancedSettings(const AdvancedSettings& settings) {
+  portENTER_CRITICAL(&commandLock);
+  pendingAdvancedSettings = settings;
+  portEXIT_CRITICAL(&commandLock);
+  HardwareCommand cmd;
+  cmd.type = HW_CMD_APPLY_ADVANCED;
+  cmd.arg = 0;
+  cmd.duration = 0;
+  return postCommand(cmd);
+}
+
+
+void HardwareManager::processCommands() {
+  if(commandQueue == nullptr) return;
+  
+  // At most one queue length per call, new requests wait for the next iteration
+  HardwareCommand cmd;
+  for(int i = 0; i < HW_COMMAND_QUEUE_LENGTH && xQueueReceive(commandQueue, &cmd, 0) == pdTRUE; i++) {
+    uint32_t waitUs = (uint32_t)(esp_timer_get_time() - cmd.postedUs);
+    
+    switch(cmd.type) {
+      case HW_CMD_PRESS_BUTTON:
+        pressButton(cmd.arg, cmd.duration);
+        break;
+      case HW_CMD_SET_AUTO_POWER_ON:
+        setAutoPowerOn(cmd.arg != 0);
+        break;
+      case HW_CMD_APPLY_CALIBRATION: {
+        portENTER_CRITICAL(&commandLock);
+        CalibrationData cal = pendingCalibration;
+        portEXIT_CRITICAL(&commandLock);
+        applyCalibration(cal);
+        saveCalibration();
+        break;
+      }
+      case HW_CMD_APPLY_ADVANCED: {
+        portENTER_CRITICAL(&commandLock);
+        AdvancedSettings settings = pendingAdvancedSettings;
+        portEXIT_CRITICAL(&commandLock);
+        applyAdvancedSettings(settings);
+        saveAdvancedSettings();
+        break;
+      }
+      default:
+        break;
+    }
+    
+    portENTER_CRITICAL(&commandLock);
+    commandStats.executed++;
+    if(waitUs > commandStats.maxWaitUs) commandStats.maxWaitUs = waitUs;
+    portEXIT_CRITICAL(&commandLock);
+  }
+}
+
+
+void HardwareManager::waitForCommand(uint32_t timeoutMs) {
+  if(commandQueue == nullptr) {
+    delay(timeoutMs);
+    return;
+  }
+  // Peek only: processCommands() takes it on the next iteration
+  HardwareCommand cmd;
+  xQueuePeek(commandQueue, &cmd, pdMS_TO_TICKS(timeoutMs) > 0 ? pdMS_TO_TICKS(timeoutMs) : 1);
+}
+
+
+bool HardwareManager::needsFastLoop() {
+  // Button releases, beep pulses and analysis slices are timed by loop()
+  return buttonActive || flashlightAlertActive || isBeeping || harmonicAnalyzer.isBusy();
+}
+
+
+bool HardwareManager::pollACActivated() {
+  uint32_t count = acActivatedCount;
+  if(count == acActivatedSeen) return false;
+  acActivatedSeen = count;
+  return true;
+}
+
+
+CommandQueueStats HardwareManager::getCommandQueueStats() {
+  portENTER_CRITICAL(&commandLock);
+  CommandQueueStats stats = commandStats;
+  portEXIT_CRITICAL(&commandLock);
+  return stats;
 }
 
 
 SensorData HardwareManager::getSensorData() {
-  return currentData;
+  SensorData data = sensorSnapshot.read();
+  refreshMainsState(data);
+  return data;
+}
+
+
+void HardwareManager::refreshMainsState(SensorData& data) {
+  // The fast path flags an outage (or its end) up to a second before the
+  // next reading, onBattery is derived the same way readSensors() does
+  data.mainsLost = hal->isMainsLost();
+  data.onBattery = (data.batteryState == STATE_DISCHARGING) || data.mainsLost;
+}
+
+
+uint32_t HardwareManager::getSensorSequence() {
+  return sensorSnapshot.getSequence();
 }
 
 
 void HardwareManager::readSensors() {
+  // Restart asked for by the main loop, cleared last so getIsWarmedUp() never sees a gap
+  if(warmupRestartRequested) {
+    isWarmedUp = false;
+    warmupStartTime = hal->nowMs();
+    warmupRestartRequested = false;
+  }
+  
   // Check if warmup period has elapsed
   if(!isWarmedUp) {
-    unsigned long elapsedTime = millis() - warmupStartTime;
+    unsigned long elapsedTime = hal->nowMs() - warmupStartTime;
     if(elapsedTime >= g_warmupDelay) {
       isWarmedUp = true;
-      Serial.println("[HW] Sensor warm-up complete (" + String(elapsedTime) + "ms) - readings now valid");
+      LOG_INFO("Hardware: Sensor warm-up complete (%lums) - readings now valid", elapsedTime);
     } else {
-      // During warmup, read sensors but don't use the data
-      double dummyIN = sctMain.calcIrms(500);
-      yield();
-      double dummyOUT = sctOutput.calcIrms(500);
-      yield();
+      // During warmup the sampler keeps running (DC offset settles), ignore the data
       return;
     }
   }
   
-  yield();
-  double IrmsIN = sctMain.calcIrms(SCT013_SAMPLES) - g_sct013OffsetIn;
-  yield();
-  double IrmsOUT = sctOutput.calcIrms(SCT013_SAMPLES) - g_sct013OffsetOut;
-  yield();
+  // Pick up the latest phase-aligned IN/OUT windows from the background sampler
+  AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT];
+  if(!hal->getLatestWindows(windows)) {
+    return;  // No complete window yet
+  }
+  
+  // ADC_COUNTS comes from EmonLib so existing calibration factors stay valid
+  double IrmsIN = rmsToIrms(windows[ADC_SAMPLER_CH_IN].meanSquare, g_sct013CalIn, ADC_COUNTS) - g_sct013OffsetIn;
+  double IrmsOUT = rmsToIrms(windows[ADC_SAMPLER_CH_OUT].meanSquare, g_sct013CalOut, ADC_COUNTS) - g_sct013OffsetOut;
   
   if(IrmsIN < 0.05) IrmsIN = 0;
   if(IrmsOUT < 0.05) IrmsOUT = 0;
@@ -164,6 +441,7 @@ void HardwareManager::readSensors() {
   float rawPowerIN = IrmsIN * g_mainsVoltage;
   float rawPowerOUT = IrmsOUT * g_mainsVoltage;
   
+  updatePowerFilterConfig();
   initializePowerFilters(rawPowerIN, rawPowerOUT);
   
   float powerIN = filterPowerIN(rawPowerIN) + POWER_IN_OFFSET;
@@ -175,7 +453,7 @@ void HardwareManager::readSensors() {
     invalidReadingsCount++;
     
     if(invalidReadingsCount % 10 == 0) {
-      Serial.println("[HW] Warning: Invalid power readings detected");
+      LOG_WARNING("Hardware: Invalid power readings detected");
     }
   } else {
     lastValidPowerIN = powerIN;
@@ -186,12 +464,23 @@ void HardwareManager::readSensors() {
   
   float voltage = readBatteryVoltageRaw();
   float rawSOC = voltageToBatteryPercent(voltage);
-  float soc = getStableSOC(rawSOC);
+  float voltageSOC = getStableSOC(rawSOC);
   
   // In stato BYPASS, forza SOC a minimo 90% (batteria carica, variazioni sono solo rumore)
-  if(currentState == STATE_BYPASS && soc < 90.0) {
-    soc = 90.0;
+  if(currentState == STATE_BYPASS && voltageSOC < SOC_BYPASS_FLOOR) {
+    voltageSOC = SOC_BYPASS_FLOOR;
+  }
+  
+  // The estimator sees every raw reading, its own variance does the smoothing.
+  // In BYPASS a surplus on IN is a recharge under load (detectState calls it
+  // BYPASS up to a 30% difference), a deficit is clamp mismatch.
+  float batteryCurrent = socBatteryCurrent(powerIN, powerOUT, voltage, SOC_CHARGE_EFFICIENCY,
+                                           SOC_DISCHARGE_EFFICIENCY, g_powerThreshold, BATTERY_VMIN);
+  if(currentState == STATE_BYPASS && batteryCurrent < 0) {
+    batteryCurrent = 0;
   }
+  float fusedSOC = updateFusedSOC(rawSOC, batteryCurrent, voltage);
+  float soc = g_socFusionEnabled ? fusedSOC : voltageSOC;
 
   lastValidSOC = soc;
   
@@ -199,22 +488,47 @@ void HardwareManager::readSensors() {
   currentData.outputCurrent = IrmsOUT;
   currentData.batteryVoltage = voltage;
   currentData.batteryPercentage = soc;
+  currentData.socVoltage = voltageSOC;
+  currentData.socFused = fusedSOC;
+  currentData.batteryCurrent = batteryCurrent;
   currentData.mainPower = powerIN;
   currentData.outputPower = powerOUT;
-  currentData.onBattery = (currentState == STATE_DISCHARGING);
+  currentData.mainsLost = hal->isMainsLost();
+  
+  // A fast loss the slow path keeps contradicting was a false one (a glitch
+  // on the IN clamp): drop it so NUT/MQTT go back to OL
+  if(currentData.mainsLost && currentState != STATE_DISCHARGING) {
+    if(++mainsUnconfirmedReadings >= MAINS_CLEAR_READINGS) {
+      LOG_WARNING("Hardware: Fast mains loss not confirmed after %d readings, cleared", mainsUnconfirmedReadings);
+      hal->clearMainsLoss();
+      mainsUnconfirmedReadings = 0;
+      currentData.mainsLost = false;
+    }
+  } else {
+    mainsUnconfirmedReadings = 0;
+  }
+  currentData.onBattery = (currentState == STATE_DISCHARGING) || currentData.mainsLost;
   currentData.batteryState = currentState;
-  currentData.timestamp = millis();
+  currentData.mainsFrequency = windows[ADC_SAMPLER_CH_IN].frequencyHz;
+  HarmonicResult harmonicsIN = harmonicSnapshots[ADC_SAMPLER_CH_IN].read();
+  currentData.mainsPowerFactor = harmonicsIN.valid ? harmonicsIN.powerFactor : 1.0;
+  currentData.timestamp = hal->nowMs();
+  
+  sensorSnapshot.write(currentData);
 }
 
 
 void HardwareManager::checkStateTransition() {
   // Don't process state transitions during warmup
-  if(!isWarmedUp) {
+  if(!getIsWarmedUp()) {
     return;
   }
   
+  // currentState belongs to the sensor task, work on the published snapshot
+  BatteryState currentState = getSensorData().batteryState;
+  
   if(currentState != previousState) {
-    Serial.println("[HW] State transition: " + getStateString(previousState) + " -> " + getStateString(currentState));
+    LOG_INFO("Hardware: State transition: %s -> %s", stateName(previousState), stateName(currentState));
     
     // ===================================================================
     // STATE TRANSITION BEEP ALERTS
@@ -222,13 +536,13 @@ void HardwareManager::checkStateTransition() {
     
     // 2 beeps: When switching to battery power (charge/rest/bypass → discharge)
     if((previousState == STATE_CHARGING || previousState == STATE_REST || previousState == STATE_BYPASS) && currentState == STATE_DISCHARGING) {
-      Serial.println("[HW] Power lost - switching to battery power (2 beeps)");
+      LOG_INFO("Hardware: Power lost - switching to battery power (2 beeps)");
       triggerBeepAlert(2);
     }
     
     // 1 beep: When returning to electric power (discharge → charge/bypass)
     if(previousState == STATE_DISCHARGING && (currentState == STATE_CHARGING || currentState == STATE_BYPASS)) {
-      Serial.println("[HW] Power restored - returning to electric power (2 beep)");
+      LOG_INFO("Hardware: Power restored - returning to electric power (2 beep)");
       triggerBeepAlert(2);
     }
     
@@ -237,7 +551,150 @@ void HardwareManager::checkStateTransition() {
 }
 
 
+bool HardwareManager::pollMainsEvent(AdcMainsEvent& event) {
+  if(!adcSampler.getMainsEvent(event) || event.sequence == lastMainsEventSequence) {
+    return false;
+  }
+  lastMainsEventSequence = event.sequence;
+  
+  if(event.lost) {
+    mainsLossStats.events++;
+    mainsLossStats.lastDetectMs = (event.detectedUs - event.onsetUs) / 1000.0;
+    mainsLossStats.lastEventAt = millis();
+    LOG_INFO("Hardware: Mains lost (fast path): %.1fms after the last half-cycle", mainsLossStats.lastDetectMs);
+  } else {
+    LOG_INFO("Hardware: Mains restored (fast path)");
+  }
+  return true;
+}
+
+
+void HardwareManager::recordMainsNotified(const AdcMainsEvent& event) {
+  if(!event.lost) return;
+  mainsLossStats.lastNotifyMs = (esp_timer_get_time() - event.onsetUs) / 1000.0;
+  if(mainsLossStats.lastNotifyMs > mainsLossStats.maxNotifyMs) {
+    mainsLossStats.maxNotifyMs = mainsLossStats.lastNotifyMs;
+  }
+}
+
+
+MainsLossStats HardwareManager::getMainsLossStats() {
+  return mainsLossStats;
+}
+
+
+void HardwareManager::updateAcquisition() {
+  // On battery: IDLE after a shorter stable period, with sparser sampling
+  bool lowPower = lowPowerAcquisition;
+  if(lowPower != acqLowPowerApplied) {
+    acqLowPowerApplied = lowPower;
+    AcqSchedulerConfig acqConfig;
+    acqConfig.idleAfterMs = lowPower ? ACQ_IDLE_AFTER_LOW_POWER_MS : ACQ_IDLE_AFTER_MS;
+    acqConfig.powerDeltaW = ACQ_POWER_DELTA_W;
+    acqConfig.voltageSagV = ACQ_VOLTAGE_SAG_V;
+    acqScheduler.configure(acqConfig);
+    if(acqScheduler.getMode() == ACQ_MODE_IDLE) {
+      adcSampler.setAcquisitionRate(ADC_SAMPLER_RATE_IDLE_HZ, lowPower ? ADC_SAMPLER_LOW_POWER_DECIMATION : ADC_SAMPLER_IDLE_DECIMATION);
+    }
+  }
+  int idleDecimation = acqLowPowerApplied ? ADC_SAMPLER_LOW_POWER_DECIMATION : ADC_SAMPLER_IDLE_DECIMATION;
+  
+  // Full rate until the readings are warmed up
+  if(!isWarmedUp) {
+    if(acqScheduler.getMode() != ACQ_MODE_ACTIVE) {
+      adcSampler.setAcquisitionRate(ADC_SAMPLER_RATE_HZ, 1);
+    }
+    acqScheduler.reset();
+    return;
+  }
+  
+  AdcMainsEvent event;
+  bool mainsEvent = false;
+  if(adcSampler.getMainsEvent(event) && event.sequence != acqMainsSequence) {
+    acqMainsSequence = event.sequence;
+    mainsEvent = true;
+  }
+  
+  if(!acqScheduler.update(hal->nowMs(), currentData.mainPower, currentData.outputPower,
+                          currentData.batteryVoltage, (int)currentData.batteryState, mainsEvent)) {
+    return;
+  }
+  
+  if(acqScheduler.getMode() == ACQ_MODE_IDLE) {
+    adcSampler.setAcquisitionRate(ADC_SAMPLER_RATE_IDLE_HZ, idleDecimation);
+    LOG_DEBUG("Hardware: Acquisition: idle (%d Hz, 1/%d per clamp)", ADC_SAMPLER_RATE_IDLE_HZ, idleDecimation);
+  } else {
+    adcSampler.setAcquisitionRate(ADC_SAMPLER_RATE_HZ, 1);
+    LOG_DEBUG("Hardware: Acquisition: active (%s change)", acqTriggerName(acqScheduler.getLastTrigger()));
+  }
+}
+
+
+void HardwareManager::updateHarmonics() {
+  if(harmonicAnalyzer.isBusy()) {
+    if(harmonicAnalyzer.step(HARMONIC_STEP_SAMPLES)) {
+      harmonicSnapshots[harmonicChannel].write(harmonicAnalyzer.result());
+      harmonicChannel = (harmonicChannel + 1) % ADC_SAMPLER_CH_COUNT;
+    }
+    return;
+  }
+  
+  if(!g_harmonicAnalysisEnabled) {
+    for(int i = 0; i < ADC_SAMPLER_CH_COUNT; i++) {
+      HarmonicResult result = harmonicSnapshots[i].read();
+      if(result.valid) {
+        result.valid = false;
+        harmonicSnapshots[i].write(result);
+      }
+    }
+    return;
+  }
+  if(millis() - lastHarmonicStart < HARMONIC_INTERVAL_MS) return;
+  lastHarmonicStart = millis();
+  
+  // Tune the bins to the measured mains frequency when the windows are synced
+  AdcRmsWindow window;
+  if(!adcSampler.getLatestWindow((AdcSamplerChannel)harmonicChannel, window) || window.sampleRateHz <= 0) return;
+  float mainsHz = window.synced ? window.frequencyHz : adcSampler.getNominalFrequency();
+  
+  static uint16_t samples[ADC_SAMPLER_RING_SAMPLES];
+  uint32_t count = adcSampler.copyRecentSamples((AdcSamplerChannel)harmonicChannel, samples, ADC_SAMPLER_RING_SAMPLES);
+  if(!harmonicAnalyzer.start(samples, count, window.sampleRateHz, mainsHz, HARMONIC_MIN_RMS_COUNTS)) {
+    harmonicChannel = (harmonicChannel + 1) % ADC_SAMPLER_CH_COUNT;
+  }
+}
+
+
+HarmonicResult HardwareManager::getHarmonics(AdcSamplerChannel channel) {
+  return harmonicSnapshots[channel].read();
+}
+
+
+void HardwareManager::setLowPowerAcquisition(bool enabled) {
+  lowPowerAcquisition = enabled;   // Applied by the sensor task on its next reading
+}
+
+
+AcquisitionStats HardwareManager::getAcquisitionStats() {
+  AcquisitionStats stats;
+  stats.mode = acqScheduler.getMode();
+  stats.lastTrigger = acqScheduler.getLastTrigger();
+  stats.switches = acqScheduler.getSwitches();
+  stats.idlePercent = acqScheduler.getIdlePercent();
+  stats.sampleRateHz = adcSampler.getSampleRate();
+  stats.decimation = adcSampler.getDecimation();
+  stats.samplerCpuUsPerSecond = adcSampler.getCpuUsPerSecond();
+  stats.sensorCpuUsPerSecond = sensorCpuLoad.getUsPerSecond();
+  return stats;
+}
+
+
 String HardwareManager::getStateString(BatteryState state) {
+  return String(stateName(state));
+}
+
+
+const char* HardwareManager::stateName(BatteryState state) {
   switch(state) {
     case STATE_CHARGING: return "CHARGE";
     case STATE_DISCHARGING: return "DISCHARGE";
@@ -249,7 +706,7 @@ String HardwareManager::getStateString(BatteryState state) {
 
 
 float HardwareManager::getEstimatedAh(float percent) {
-  return (percent / 100.0) * BATTERY_CAPACITY_AH;
+  return (percent / 100.0) * g_socCapacityAh;
 }
 
 
@@ -257,5 +714,11 @@ float HardwareManager::getEstimatedAh(float percent) {
 // Getter pubblico per stato warm-up
 // ===================================================================
 bool HardwareManager::getIsWarmedUp() {
-  return isWarmedUp;
+  // A pending restart counts as warming up until the sensor task applies it
+  return !warmupRestartRequested && isWarmedUp;
+}
+
+
+void HardwareManager::requestWarmupRestart() {
+  warmupRestartRequested = true;
 }
\ No newline at end of file
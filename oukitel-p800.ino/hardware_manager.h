@@ -9,41 +9,146 @@
 
 #include "config.h"
 #include "EmonLib.h"
+#include "adc_sampler.h"
+#include "hal_esp32.h"
+#include "seqlock.h"
+#include "sliding_median.h"
+#include "soc_estimator.h"
+#include "acq_scheduler.h"
+#include "harmonic_analyzer.h"
+#include "str_buf.h"
 
 
 // Forward declaration
 class WebServerManager;
 
 
+// Fast mains-loss path latency (onset = last IN half-cycle seen)
+struct MainsLossStats {
+  uint32_t events;              // Outages flagged by the fast path since boot
+  float lastDetectMs;           // Onset -> sampler flag
+  float lastNotifyMs;           // Onset -> NUT/WebSocket/MQTT pushed
+  float maxNotifyMs;
+  unsigned long lastEventAt;    // millis() of the last outage
+};
+
+
+// Adaptive acquisition state and what it costs
+struct AcquisitionStats {
+  int mode;                     // AcqMode
+  int lastTrigger;              // AcqTrigger that ended the last stable period
+  uint32_t switches;            // ACTIVE <-> IDLE changes since boot
+  float idlePercent;
+  uint32_t sampleRateHz;        // DMA conversions/s in use
+  int decimation;               // IN/OUT conversions per kept sample
+  float samplerCpuUsPerSecond;  // Sampler task (DMA reads + windows)
+  float sensorCpuUsPerSecond;   // Sensor task (readSensors + scheduler)
+};
+
+
+// Power filter settings as the sensor task applies them
+struct PowerFilterConfig {
+  PowerFilterParams in;
+  PowerFilterParams out;
+  float alpha;                  // Base alpha shared by both channels
+};
+
+
+// Request from the network task, executed by the main loop
+enum HardwareCommandType {
+  HW_CMD_PRESS_BUTTON = 0,      // arg = button index, duration = ms
+  HW_CMD_SET_AUTO_POWER_ON = 1, // arg = enabled
+  HW_CMD_APPLY_CALIBRATION = 2, // Values in the pending calibration slot
+  HW_CMD_APPLY_ADVANCED = 3     // Values in the pending advanced settings slot
+};
+
+struct HardwareCommand {
+  uint8_t type;                 // HardwareCommandType
+  int32_t arg;
+  int32_t duration;
+  int64_t postedUs;             // For the queue wait statistics
+};
+
+struct CommandQueueStats {
+  uint32_t posted;
+  uint32_t dropped;             // Queue full, the request was refused
+  uint32_t executed;
+  uint32_t maxWaitUs;           // Posted -> executed by the main loop
+};
+
+
+// CPU cost of one pipeline stage during a trace replay
+struct ReplayStageCost {
+  uint32_t calls;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+
+
 class HardwareManager {
 private:
   EnergyMonitor sctMain;
   EnergyMonitor sctOutput;
+  AdcSampler adcSampler;              // Background DMA sampling of both clamps
+  EspHal espHal;                      // Real clock, GPIO and sampler results
+  Hal* hal;                           // espHal, or a replay backend during runReplay()
 
 
   int buttonPins[5];
 
 
-  SensorData currentData;
+  SensorData currentData;                     // Owned by the sensor task
+  SeqLockSnapshot<SensorData> sensorSnapshot; // Published copy for other tasks
+  TaskHandle_t sensorTaskHandle;
+  volatile bool sensorTaskPaused;     // Set by runReplay(), the task skips readSensors()
+  volatile bool sensorTaskBusy;       // readSensors() in progress on the sensor task
 
 
-  // Warm-up state
-  bool isWarmedUp;
+  // Warm-up state (sensor task only, the main loop asks for a restart)
+  volatile bool isWarmedUp;
   int warmupCounter;
-  unsigned long warmupStartTime;
+  volatile unsigned long warmupStartTime;
+  volatile bool warmupRestartRequested;   // requestWarmupRestart(), applied by readSensors()
+
+
+  // Fast mains-loss path (network task only, it pushes the notifications)
+  uint32_t lastMainsEventSequence;
+  MainsLossStats mainsLossStats;
+  int mainsUnconfirmedReadings;     // Sensor task: fast loss while not discharging
 
 
   // SOC filtering
-  float socBuffer[SOC_BUFFER_SIZE];
-  int socBufferIndex;
-  bool socBufferFull;
+  SlidingMedian<SOC_BUFFER_SIZE_MAX> socWindow;   // Sensor task only
   float displayedSOC;
 
 
-  // Power filtering
-  float filteredPowerIN;
-  float filteredPowerOUT;
-  bool powerFilterInitialized;
+  // Coulomb counting fused with the voltage curve (sensor task only)
+  SocEstimator socEstimator;
+  unsigned long lastSocUpdateTime;
+  unsigned long restStartTime;
+  unsigned long floatStartTime;     // BYPASS without IN surplus since
+
+
+  // Power filtering (type and parameters per channel from the advanced settings)
+  PowerFilter powerFilterIn;
+  PowerFilter powerFilterOut;
+  SeqLockSnapshot<PowerFilterConfig> powerFilterConfig;  // Published by applyAdvancedSettings()
+  uint32_t powerFilterConfigSequence;                    // Sensor task: last one applied
+
+
+  // Adaptive acquisition (sensor task only)
+  AcquisitionScheduler acqScheduler;
+  uint32_t acqMainsSequence;
+  CpuLoadMeter sensorCpuLoad;
+  volatile bool lowPowerAcquisition;  // Set by the main loop
+  bool acqLowPowerApplied;
+
+
+  // Waveform analysis of the sampler ring (main loop only, results published as snapshots)
+  HarmonicAnalyzer<ADC_SAMPLER_RING_SAMPLES> harmonicAnalyzer;
+  SeqLockSnapshot<HarmonicResult> harmonicSnapshots[ADC_SAMPLER_CH_COUNT];
+  int harmonicChannel;                // Channel being analysed / next one
+  unsigned long lastHarmonicStart;
 
 
   // Validation
@@ -99,6 +204,17 @@ private:
   WebServerManager* webServerRef;
 
 
+  // Network task -> main loop. Settings are too big for a queue item, so
+  // they wait in a slot and the command only says which slot to apply.
+  QueueHandle_t commandQueue;
+  portMUX_TYPE commandLock;
+  CalibrationData pendingCalibration;
+  AdvancedSettings pendingAdvancedSettings;
+  CommandQueueStats commandStats;
+  volatile uint32_t acActivatedCount; // Main loop -> network task (WebSocket notice)
+  uint32_t acActivatedSeen;           // Network task only
+
+
   // Private calibration storage
   CalibrationData calibration;
   AdvancedSettings advancedSettings;
@@ -114,13 +230,13 @@ private:
   BatteryState detectState(float powerIN, float powerOUT);
 
 
-  void updateSOCBuffer(float newSOC);
-  float getMedianSOC();
   float getStableSOC(float currentSOC);
-  void sortArray(float arr[], int n);
+  float updateFusedSOC(float voltageSOC, float batteryAmps, float batteryVoltage);
 
 
   void initializePowerFilters(float powerIN, float powerOUT);
+  void publishPowerFilterConfig();
+  void updatePowerFilterConfig();
   float filterPowerIN(float rawPowerIN);
   float filterPowerOUT(float rawPowerOUT);
 
@@ -142,12 +258,25 @@ private:
   // Beep button control
   bool pressBeepButton();             // Preme il pulsante POWER per 0.5s (per beep)
 
+  // Sensor task
+  static void sensorTaskEntry(void* arg);
+  void sensorTaskLoop();
+  void updateAcquisition();           // Sampler rate from the latest reading
+
+  bool postCommand(HardwareCommand& cmd);  // Non-blocking, counts refusals
+
+  // Filters, counters, alerts and button state back to their boot values
+  void resetPipelineState();
+  void requestWarmupRestart();        // Power station ON/OFF, from the main loop
+
 
 public:
   HardwareManager();
   bool begin();
+  bool startSensorTask();             // Runs readSensors() periodically on SENSOR_TASK_CORE
   void readSensors();
-  SensorData getSensorData();
+  SensorData getSensorData();         // Lock-free snapshot, safe from any task
+  uint32_t getSensorSequence();       // Increments on every published reading
 
 
   // Button control
@@ -170,11 +299,30 @@ public:
   void setWebServerReference(WebServerManager* webServer);
 
 
+  // ===================================================================
+  // NETWORK TASK REQUESTS (never block, false if refused or queue full)
+  // ===================================================================
+  bool requestButtonPress(int buttonIndex, int duration);
+  bool requestAutoPowerOn(bool enabled);
+  bool requestCalibration(const CalibrationData& calData);       // Apply + save
+  bool requestAdvancedSettings(const AdvancedSettings& settings); // Apply + save
+  void processCommands();             // Main loop: runs the queued requests
+  bool pollACActivated();             // Network task: true once per auto AC activation
+  CommandQueueStats getCommandQueueStats();
+
+
   void checkStateTransition();
 
 
   bool runSelfTest();
   void printDiagnostics();
+  void benchmarkCurrentSampling(int iterations = 5);  // Sequential calcIrms vs interleaved sampler
+  void benchmarkRmsKernels(int repeats = 20);         // Double (calcIrms math) vs fixed-point kernel
+  void benchmarkSocCurves(int repeats = 20);          // Linear walk vs binary search vs uniform grid
+  void benchmarkSocMedian(int windowSize = SOC_BUFFER_SIZE_MAX);  // Copy+sort vs sliding median
+  void benchmarkPowerFilters();                       // EMA vs adaptive/median-3: step latency and idle noise
+  void benchmarkHeapSoak(int days = 7);               // Largest free block over simulated days, String vs StrBuf
+  bool runReplay(const char* path);                   // Recorded ADC trace through the pipeline, per-stage cost
 
 
   void printStatusHeader();
@@ -182,6 +330,7 @@ public:
 
 
   String getStateString(BatteryState state);
+  static const char* stateName(BatteryState state);   // Same text, no allocation
   float getEstimatedAh(float percent);
 
 
@@ -203,6 +352,26 @@ public:
   void checkEmergencyConditions();    // Controlla le soglie critiche con timer
   void updateBeepState();             // Aggiorna stato beep
   void updateButtonState();           // Aggiorna stato pulsanti (non-blocking)
+  bool needsFastLoop();               // Button press, beep or analysis in progress
+  void waitForCommand(uint32_t timeoutMs);  // Main loop idle, wakes on a queued request
+
+
+  // ===================================================================
+  // FAST MAINS-LOSS PATH (Called from the network task)
+  // ===================================================================
+  bool pollMainsEvent(AdcMainsEvent& event);           // True once per new sampler event
+  void recordMainsNotified(const AdcMainsEvent& event); // Latency once NUT/WS/MQTT were pushed
+  MainsLossStats getMainsLossStats();
+  void refreshMainsState(SensorData& data);            // Live fast-path state into an older reading
+  AcquisitionStats getAcquisitionStats();
+  void setLowPowerAcquisition(bool enabled);          // Earlier and sparser IDLE on battery
+
+
+  // ===================================================================
+  // WAVEFORM ANALYSIS (Called from main loop)
+  // ===================================================================
+  void updateHarmonics();             // One slice per call, never a whole block
+  HarmonicResult getHarmonics(AdcSamplerChannel channel);
 
 
   // ===================================================================
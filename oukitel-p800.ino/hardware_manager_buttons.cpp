@@ -9,32 +9,32 @@
 
 bool HardwareManager::pressButton(int buttonIndex, int duration) {
   if(buttonIndex < 0 || buttonIndex >= 5) {
-    Serial.println("[HW] Invalid button index: " + String(buttonIndex));
+    LOG_WARNING("Hardware: Invalid button index: %d", buttonIndex);
     return false;
   }
   
   // If a button is already active, reject new request
   if(buttonActive) {
-    Serial.println("[HW] Button press already in progress, ignoring request");
+    LOG_WARNING("Hardware: Button press already in progress, ignoring request");
     return false;
   }
   
-  Serial.println("[HW] Starting non-blocking button press: " + String(buttonIndex) + " for " + String(duration) + "ms");
+  LOG_DEBUG("Hardware: Starting non-blocking button press: %d for %dms", buttonIndex, duration);
   
   // Start non-blocking button press
   buttonActive = true;
   activeButtonIndex = buttonIndex;
-  buttonPressStartTime = millis();
+  buttonPressStartTime = hal->nowMs();
   buttonPressDuration = duration;
   
   // Set button HIGH immediately
-  digitalWrite(buttonPins[buttonIndex], HIGH);
+  hal->writePin(buttonPins[buttonIndex], HIGH);
   
   return true;
 }
 
 bool HardwareManager::pressPowerButton() {
-  Serial.println("[HW] Pressing POWER button (3 seconds)");
+  LOG_INFO("Hardware: Pressing POWER button (3 seconds)");
   return pressButton(BTN_POWER, BUTTON_POWER_DURATION);
 }
 
@@ -45,12 +45,12 @@ bool HardwareManager::pressBeepButton() {
 }
 
 bool HardwareManager::pressUSBButton() {
-  Serial.println("[HW] Pressing USB button");
+  LOG_INFO("Hardware: Pressing USB button");
   return pressButton(BTN_USB, BUTTON_STANDARD_DURATION);
 }
 
 bool HardwareManager::pressDCButton() {
-  Serial.println("[HW] Pressing DC button");
+  LOG_INFO("Hardware: Pressing DC button");
   return pressButton(BTN_DC, BUTTON_STANDARD_DURATION);
 }
 
@@ -59,26 +59,26 @@ bool HardwareManager::pressFlashlightButton() {
 }
 
 bool HardwareManager::pressACButton() {
-  Serial.println("[HW] Pressing AC button");
+  LOG_INFO("Hardware: Pressing AC button");
   return pressButton(BTN_AC, BUTTON_STANDARD_DURATION);
 }
 
 void HardwareManager::flashlightAlert() {
-  Serial.println("[HW] Starting non-blocking flashlight alert: " + String(FLASHLIGHT_ALERT_PULSES) + " pulses");
+  LOG_INFO("Hardware: Starting non-blocking flashlight alert: %d pulses", FLASHLIGHT_ALERT_PULSES);
   
   // Start non-blocking flashlight alert
   flashlightAlertActive = true;
   flashlightPulseCount = 0;
-  lastFlashlightToggle = millis();
+  lastFlashlightToggle = hal->nowMs();
   
   // Start first pulse
-  digitalWrite(buttonPins[BTN_FLASHLIGHT], HIGH);
+  hal->writePin(buttonPins[BTN_FLASHLIGHT], HIGH);
 }
 
 void HardwareManager::loadAutoPowerOnState() {
   if(!SPIFFS.exists(AUTO_POWER_ON_FILE)) {
     autoPowerOnEnabled = false;
-    Serial.println("[HW] Auto Power On: DISABLED (default)");
+    LOG_DEBUG("Hardware: Auto Power On: DISABLED (default)");
     return;
   }
   
@@ -94,7 +94,7 @@ void HardwareManager::loadAutoPowerOnState() {
   file.close();
   state.trim();
   autoPowerOnEnabled = (state == "1");
-  LOG_DEBUG("Hardware: Auto Power On loaded: " + String(autoPowerOnEnabled ? "ENABLED" : "DISABLED"));
+  LOG_DEBUG("Hardware: Auto Power On loaded: %s", autoPowerOnEnabled ? "ENABLED" : "DISABLED");
 }
 
 void HardwareManager::saveAutoPowerOnState() {
@@ -113,7 +113,7 @@ void HardwareManager::saveAutoPowerOnState() {
   
   file.println(autoPowerOnEnabled ? "1" : "0");
   file.close();
-  Serial.println("[HW] Auto Power On saved: " + String(autoPowerOnEnabled ? "ENABLED" : "DISABLED"));
+  LOG_INFO("Hardware: Auto Power On saved: %s", autoPowerOnEnabled ? "ENABLED" : "DISABLED");
 }
 
 void HardwareManager::setAutoPowerOn(bool enabled) {
@@ -126,32 +126,32 @@ bool HardwareManager::getAutoPowerOn() {
 }
 
 // Helper function to safely check if time has elapsed (handles millis() overflow)
-static bool timeElapsed(unsigned long startTime, unsigned long interval) {
-  return (millis() - startTime) >= interval;
+static bool timeElapsed(unsigned long now, unsigned long startTime, unsigned long interval) {
+  return (now - startTime) >= interval;
 }
 
 void HardwareManager::updateButtonState() {
-  unsigned long now = millis();
+  unsigned long now = hal->nowMs();
   
   // Handle active button press
   if(buttonActive) {
-    if(timeElapsed(buttonPressStartTime, buttonPressDuration)) {
+    if(timeElapsed(now, buttonPressStartTime, buttonPressDuration)) {
       // Button press duration completed, release button
-      digitalWrite(buttonPins[activeButtonIndex], LOW);
+      hal->writePin(buttonPins[activeButtonIndex], LOW);
       buttonActive = false;
       activeButtonIndex = -1;
       buttonPressStartTime = 0;
       buttonPressDuration = 0;
-      Serial.println("[HW] Button press completed");
+      LOG_DEBUG("Hardware: Button press completed");
     }
   }
   
   // Handle flashlight alert
   if(flashlightAlertActive) {
-    if(timeElapsed(lastFlashlightToggle, FLASHLIGHT_ALERT_INTERVAL)) {
+    if(timeElapsed(now, lastFlashlightToggle, FLASHLIGHT_ALERT_INTERVAL)) {
       // Toggle flashlight
-      bool currentState = digitalRead(buttonPins[BTN_FLASHLIGHT]);
-      digitalWrite(buttonPins[BTN_FLASHLIGHT], !currentState);
+      bool currentState = hal->readPin(buttonPins[BTN_FLASHLIGHT]);
+      hal->writePin(buttonPins[BTN_FLASHLIGHT], !currentState);
       lastFlashlightToggle = now;
       
       if(!currentState) {
@@ -163,8 +163,8 @@ void HardwareManager::updateButtonState() {
           flashlightAlertActive = false;
           flashlightPulseCount = 0;
           lastFlashlightToggle = 0;
-          digitalWrite(buttonPins[BTN_FLASHLIGHT], LOW);
-          Serial.println("[HW] Flashlight alert completed");
+          hal->writePin(buttonPins[BTN_FLASHLIGHT], LOW);
+          LOG_DEBUG("Hardware: Flashlight alert completed");
         }
       }
     }
@@ -176,14 +176,16 @@ void HardwareManager::checkAutoPowerOn() {
     return;
   }
   
-  bool isPowerOn = currentData.batteryVoltage >= 20.0;
+  SensorData data = getSensorData();
+  
+  bool isPowerOn = data.batteryVoltage >= 20.0;
   
   // Detect power station turning ON
   if(isPowerOn && powerStationWasOff) {
     powerStationWasOff = false;
     acAlreadyActivated = false;
     powerOnTime = 0;  // Reset timer - will start after warmup
-    Serial.println("[HW] Power station turned ON - waiting for sensor warm-up to complete");
+    LOG_INFO("Hardware: Power station turned ON - waiting for sensor warm-up to complete");
   }
   
   // Detect power station turning OFF
@@ -191,41 +193,37 @@ void HardwareManager::checkAutoPowerOn() {
     powerStationWasOff = true;
     powerOnTime = 0;
     acAlreadyActivated = false;
-    Serial.println("[HW] Power station turned OFF");
+    LOG_INFO("Hardware: Power station turned OFF");
   }
   
   // Start countdown only after warmup is complete and power station is ON
-  if(isPowerOn && !powerStationWasOff && isWarmedUp && powerOnTime == 0 && !acAlreadyActivated) {
-    powerOnTime = millis();
-    Serial.println("[HW] Sensor warm-up complete - AC auto-activation will trigger in " + String(g_autoPowerOnDelay) + "ms");
+  if(isPowerOn && !powerStationWasOff && getIsWarmedUp() && powerOnTime == 0 && !acAlreadyActivated) {
+    powerOnTime = hal->nowMs();
+    LOG_INFO("Hardware: Sensor warm-up complete - AC auto-activation will trigger in %lums", (unsigned long)g_autoPowerOnDelay);
   }
   
   // Auto-activate AC if conditions are met (warmup complete, countdown elapsed)
-  if(isPowerOn && !acAlreadyActivated && !powerStationWasOff && isWarmedUp && powerOnTime > 0) {
-    if(timeElapsed(powerOnTime, g_autoPowerOnDelay)) {
+  if(isPowerOn && !acAlreadyActivated && !powerStationWasOff && getIsWarmedUp() && powerOnTime > 0) {
+    if(timeElapsed(hal->nowMs(), powerOnTime, g_autoPowerOnDelay)) {
       // Check if AC output is already active by detecting load on output
       // If there's significant output power (>5W), AC OUT is already active
-      bool acAlreadyActive = (currentData.outputPower > 5.0) || (currentData.outputCurrent > 0.05);
+      bool acAlreadyActive = (data.outputPower > 5.0) || (data.outputCurrent > 0.05);
       
       if(acAlreadyActive) {
         // AC OUT is already active, just update UI without pressing button
-        Serial.println("[HW] Auto Power On: AC output already active (detected load: " + String(currentData.outputPower, 1) + "W) - updating UI only");
+        LOG_INFO("Hardware: Auto Power On: AC output already active (detected load: %.1fW) - updating UI only", data.outputPower);
         acAlreadyActivated = true;
         
-        // Notify WebServer to update UI
-        if(webServerRef != nullptr) {
-          webServerRef->notifyACActivated();
-        }
+        // Notify WebServer to update UI (sent by the network task)
+        acActivatedCount = acActivatedCount + 1;
       } else {
         // AC OUT is not active, press button to activate it
-        Serial.println("[HW] Auto Power On: No load detected - activating AC output now!");
+        LOG_INFO("Hardware: Auto Power On: No load detected - activating AC output now!");
         pressACButton();
         acAlreadyActivated = true;
         
-        // Notify WebServer to update UI
-        if(webServerRef != nullptr) {
-          webServerRef->notifyACActivated();
-        }
+        // Notify WebServer to update UI (sent by the network task)
+        acActivatedCount = acActivatedCount + 1;
       }
     }
   }
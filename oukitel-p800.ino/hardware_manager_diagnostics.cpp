@@ -3,97 +3,172 @@
  */
 
 #include "hardware_manager.h"
+#include "hal_replay.h"
 #include "logger.h"
+#include "str_buf.h"
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
 
 // Helper function to safely check if time has elapsed (handles millis() overflow)
-static bool timeElapsed(unsigned long startTime, unsigned long interval) {
-  return (millis() - startTime) >= interval;
+static bool timeElapsed(unsigned long now, unsigned long startTime, unsigned long interval) {
+  return (now - startTime) >= interval;
+}
+
+// Time both RMS kernels on one trace and check they agree
+static void benchmarkKernelsOnTrace(const char* name, const uint16_t* trace, uint32_t count, int repeats) {
+  volatile double sink = 0;
+  
+  unsigned long t0 = micros();
+  for(int i = 0; i < repeats; i++) {
+    sink = referenceTraceRms(trace, count, ADC_RESOLUTION / 2);
+  }
+  unsigned long refUs = micros() - t0;
+  double rmsRef = sink;
+  
+  t0 = micros();
+  for(int i = 0; i < repeats; i++) {
+    sink = fixedTraceRms(trace, count, ADC_RESOLUTION / 2);
+  }
+  unsigned long fixedUs = micros() - t0;
+  double rmsFixed = sink;
+  
+  float refNs = refUs * 1000.0 / ((float)count * repeats);
+  float fixedNs = fixedUs * 1000.0 / ((float)count * repeats);
+  
+  LogSerial.println(String(name) + " (" + String(count) + " samples):");
+  LogSerial.println("  Double (calcIrms math): " + String(refNs, 0) + " ns/sample, RMS " + String(rmsRef, 3) + " counts");
+  LogSerial.println("  Fixed-point Q16/Q4:     " + String(fixedNs, 0) + " ns/sample, RMS " + String(rmsFixed, 3) + " counts");
+  LogSerial.println("  Speedup: " + String(fixedNs > 0 ? refNs / fixedNs : 0, 1) + "x, deviation " +
+                 String(fabs(rmsFixed - rmsRef), 4) + " counts -> " + (rmsWithinTolerance(rmsFixed, rmsRef) ? "PASS" : "FAIL"));
+}
+
+// Time the linear walk, binary search and grid lookup on one built-in curve
+// over a 22-28V sweep and check the results agree
+static void benchmarkSocCurve(const char* name, const float (*table)[2], int points, int repeats) {
+  static SocCurve curve;
+  curve.load(table, points);
+  const int steps = 600;
+  volatile float sink = 0;
+  
+  unsigned long t0 = micros();
+  for(int r = 0; r < repeats; r++) {
+    for(int i = 0; i < steps; i++) sink = socCurveLinearReference(table, points, 22.0f + i * 0.01f);
+  }
+  unsigned long linearUs = micros() - t0;
+  
+  t0 = micros();
+  for(int r = 0; r < repeats; r++) {
+    for(int i = 0; i < steps; i++) sink = curve.percentAtBinary(22.0f + i * 0.01f);
+  }
+  unsigned long binaryUs = micros() - t0;
+  
+  t0 = micros();
+  for(int r = 0; r < repeats; r++) {
+    for(int i = 0; i < steps; i++) sink = curve.percentAt(22.0f + i * 0.01f);
+  }
+  unsigned long gridUs = micros() - t0;
+  (void)sink;
+  
+  float worst = 0;
+  for(int i = 0; i < steps * 10; i++) {
+    float v = 22.0f + i * 0.001f;
+    worst = max(worst, fabsf(curve.percentAt(v) - socCurveLinearReference(table, points, v)));
+  }
+  
+  float lookups = (float)steps * repeats;
+  LogSerial.println(String(name) + " (" + String(points) + " points):");
+  LogSerial.println("  Linear walk:   " + String(linearUs * 1000.0 / lookups, 0) + " ns/lookup");
+  LogSerial.println("  Binary search: " + String(binaryUs * 1000.0 / lookups, 0) + " ns/lookup");
+  LogSerial.println("  Uniform grid:  " + String(gridUs * 1000.0 / lookups, 0) + " ns/lookup");
+  LogSerial.println("  Max deviation: " + String(worst, 4) + "% -> " + (worst < 0.001 ? "PASS" : "FAIL"));
 }
 
 void HardwareManager::printStatusHeader() {
-  Serial.println("\n╔═══════════════════════════════════════════════════════════════════════════════╗");
-  Serial.println("║ Tensione │  SOC   │ Ah rem │ Stato    │ P-IN │ P-OUT │ Diff │ Grafico       ║");
-  Serial.println("╠═══════════════════════════════════════════════════════════════════════════════╣");
+  LogSerial.println("\n╔═══════════════════════════════════════════════════════════════════════════════╗");
+  LogSerial.println("║ Tensione │  SOC   │ Ah rem │ Stato    │ P-IN │ P-OUT │ Diff │ Grafico       ║");
+  LogSerial.println("╠═══════════════════════════════════════════════════════════════════════════════╣");
 }
 
 void HardwareManager::printBatteryBar(float percent) {
-  Serial.print("[");
+  LogSerial.print("[");
   int bars = (int)(percent / 5);
   for(int i = 0; i < 20; i++) {
     if(i < bars) {
-      if(percent >= 60) Serial.print("█");
-      else if(percent >= 20) Serial.print("▓");
-      else Serial.print("░");
+      if(percent >= 60) LogSerial.print("█");
+      else if(percent >= 20) LogSerial.print("▓");
+      else LogSerial.print("░");
     } else {
-      Serial.print("░");
+      LogSerial.print("░");
     }
   }
-  Serial.print("]");
+  LogSerial.print("]");
 }
 
 void HardwareManager::printStatusLine() {
-  Serial.print("║  ");
-  Serial.print(currentData.batteryVoltage, 2);
-  Serial.print("V │ ");
-  
-  if(currentState == STATE_CHARGING) {
-    Serial.print("~");
-    if(lastValidSOC < 100) Serial.print(" ");
-    if(lastValidSOC < 10) Serial.print(" ");
-    Serial.print(lastValidSOC, 1);
+  SensorData data = getSensorData();
+  
+  LogSerial.print("║  ");
+  LogSerial.print(data.batteryVoltage, 2);
+  LogSerial.print("V │ ");
+  
+  if(data.batteryState == STATE_CHARGING) {
+    LogSerial.print("~");
+    if(lastValidSOC < 100) LogSerial.print(" ");
+    if(lastValidSOC < 10) LogSerial.print(" ");
+    LogSerial.print(lastValidSOC, 1);
   } else {
-    Serial.print(" ");
-    if(currentData.batteryPercentage < 100) Serial.print(" ");
-    if(currentData.batteryPercentage < 10) Serial.print(" ");
-    Serial.print(currentData.batteryPercentage, 1);
-  }
-  Serial.print("% │ ");
-  
-  float ahRemaining = getEstimatedAh(currentData.batteryPercentage);
-  if(ahRemaining < 100) Serial.print(" ");
-  if(ahRemaining < 10) Serial.print(" ");
-  Serial.print(ahRemaining, 1);
-  Serial.print("Ah │ ");
-  
-  String stateStr = getStateString(currentState);
-  Serial.print(stateStr);
-  for(int i = stateStr.length(); i < 9; i++) Serial.print(" ");
-  Serial.print("│ ");
-  
-  if(currentData.mainPower < 1000) Serial.print(" ");
-  if(currentData.mainPower < 100) Serial.print(" ");
-  Serial.print(currentData.mainPower, 0);
-  Serial.print("W │ ");
-  
-  if(currentData.outputPower < 1000) Serial.print(" ");
-  if(currentData.outputPower < 100) Serial.print(" ");
-  Serial.print(currentData.outputPower, 0);
-  Serial.print("W │ ");
-  
-  float powerDiff = currentData.mainPower - currentData.outputPower;
-  if(powerDiff >= 0) Serial.print("+");
-  else Serial.print("-");
-  if(abs(powerDiff) < 100) Serial.print(" ");
-  if(abs(powerDiff) < 10) Serial.print(" ");
-  Serial.print(abs(powerDiff), 0);
-  Serial.print("W │ ");
-  
-  printBatteryBar(currentData.batteryPercentage);
-  Serial.println(" ║");
+    LogSerial.print(" ");
+    if(data.batteryPercentage < 100) LogSerial.print(" ");
+    if(data.batteryPercentage < 10) LogSerial.print(" ");
+    LogSerial.print(data.batteryPercentage, 1);
+  }
+  LogSerial.print("% │ ");
+  
+  float ahRemaining = getEstimatedAh(data.batteryPercentage);
+  if(ahRemaining < 100) LogSerial.print(" ");
+  if(ahRemaining < 10) LogSerial.print(" ");
+  LogSerial.print(ahRemaining, 1);
+  LogSerial.print("Ah │ ");
+  
+  String stateStr = getStateString(data.batteryState);
+  LogSerial.print(stateStr);
+  for(int i = stateStr.length(); i < 9; i++) LogSerial.print(" ");
+  LogSerial.print("│ ");
+  
+  if(data.mainPower < 1000) LogSerial.print(" ");
+  if(data.mainPower < 100) LogSerial.print(" ");
+  LogSerial.print(data.mainPower, 0);
+  LogSerial.print("W │ ");
+  
+  if(data.outputPower < 1000) LogSerial.print(" ");
+  if(data.outputPower < 100) LogSerial.print(" ");
+  LogSerial.print(data.outputPower, 0);
+  LogSerial.print("W │ ");
+  
+  float powerDiff = data.mainPower - data.outputPower;
+  if(powerDiff >= 0) LogSerial.print("+");
+  else LogSerial.print("-");
+  if(abs(powerDiff) < 100) LogSerial.print(" ");
+  if(abs(powerDiff) < 10) LogSerial.print(" ");
+  LogSerial.print(abs(powerDiff), 0);
+  LogSerial.print("W │ ");
+  
+  printBatteryBar(data.batteryPercentage);
+  LogSerial.println(" ║");
   
   // ===================================================================
   // EMERGENCY CONDITIONS ALERTS
   // ===================================================================
   if(isPowerStationOn) {
-    if(currentData.batteryVoltage <= g_voltageMinSafe && currentState != STATE_CHARGING) {
-      Serial.println("║  [!] CRITICAL VOLTAGE! BMS intervention imminent                             ║");
-    } else if(currentData.batteryPercentage <= g_batteryCritical && currentState != STATE_CHARGING) {
-      Serial.println("║  [!] CRITICAL BATTERY! Shutdown non-essential loads                          ║");
-    } else if(currentData.batteryPercentage <= g_batteryLowWarning && currentState != STATE_CHARGING) {
-      Serial.println("║  [!] Low battery - recharge soon                                             ║");
+    if(data.batteryVoltage <= g_voltageMinSafe && data.batteryState != STATE_CHARGING) {
+      LogSerial.println("║  [!] CRITICAL VOLTAGE! BMS intervention imminent                             ║");
+    } else if(data.batteryPercentage <= g_batteryCritical && data.batteryState != STATE_CHARGING) {
+      LogSerial.println("║  [!] CRITICAL BATTERY! Shutdown non-essential loads                          ║");
+    } else if(data.batteryPercentage <= g_batteryLowWarning && data.batteryState != STATE_CHARGING) {
+      LogSerial.println("║  [!] Low battery - recharge soon                                             ║");
     }
   } else {
-    Serial.println("║  [!] Power Station OFF - V < " + String(g_powerStationOffVoltage, 1) + "V                              ║");
+    LogSerial.println("║  [!] Power Station OFF - V < " + String(g_powerStationOffVoltage, 1) + "V                              ║");
   }
 }
 
@@ -107,22 +182,23 @@ bool HardwareManager::getPowerStationOn() {
 
 void HardwareManager::checkEmergencyConditions() {
   // Don't check emergency conditions during warmup
-  if(!isWarmedUp) {
+  if(!getIsWarmedUp()) {
     return;
   }
   
+  SensorData data = getSensorData();
+  
   // Track power station state changes and trigger warmup
   bool wasPowerStationOn = isPowerStationOn;
   
   // Se Power Station è spenta (V < 20V), NON fare niente
-  if(currentData.batteryVoltage < g_powerStationOffVoltage) {
+  if(data.batteryVoltage < g_powerStationOffVoltage) {
     isPowerStationOn = false;
     
     // If power station just turned OFF, trigger warmup
     if(wasPowerStationOn && !isPowerStationOn) {
-      Serial.println("[HW] Power Station turned OFF - triggering warmup period");
-      isWarmedUp = false;
-      warmupStartTime = millis();
+      LOG_INFO("Hardware: Power Station turned OFF - triggering warmup period");
+      requestWarmupRestart();
     }
     
     // Reset all counters and flags
@@ -139,10 +215,9 @@ void HardwareManager::checkEmergencyConditions() {
   }
   
   // If power station just turned ON, trigger warmup
-  if(!wasPowerStationOn && currentData.batteryVoltage >= g_powerStationOffVoltage) {
-    Serial.println("[HW] Power Station turned ON - triggering warmup period");
-    isWarmedUp = false;
-    warmupStartTime = millis();
+  if(!wasPowerStationOn && data.batteryVoltage >= g_powerStationOffVoltage) {
+    LOG_INFO("Hardware: Power Station turned ON - triggering warmup period");
+    requestWarmupRestart();
   }
   
   isPowerStationOn = true;
@@ -150,9 +225,9 @@ void HardwareManager::checkEmergencyConditions() {
   // ===================================================================
   // Se in carica, resetta tutti gli allarmi
   // ===================================================================
-  if(currentState == STATE_CHARGING) {
+  if(data.batteryState == STATE_CHARGING) {
     if(lowBatteryAlertActive || criticalBatteryAlertActive) {
-      Serial.println("[HW] Battery charging - resetting all alerts");
+      LOG_INFO("Hardware: Battery charging - resetting all alerts");
       lowBatteryAlertActive = false;
       criticalBatteryAlertActive = false;
       lastLowBatteryAlertTime = 0;
@@ -168,7 +243,7 @@ void HardwareManager::checkEmergencyConditions() {
   // Se in bypass, ignora tutti gli eventi basati sulla percentuale
   // (le variazioni sono solo rumore, la batteria è carica)
   // ===================================================================
-  if(currentState == STATE_BYPASS) {
+  if(data.batteryState == STATE_BYPASS) {
     // Reset counters ma non resettare gli allarmi attivi (potrebbero essere validi)
     // Solo impedire che nuovi eventi vengano triggerati
     voltageMinSafeCounter = 0;
@@ -177,17 +252,17 @@ void HardwareManager::checkEmergencyConditions() {
     return;
   }
   
-  unsigned long currentTime = millis();
+  unsigned long currentTime = hal->nowMs();
   
   // ===================================================================
   // LIVELLO 1: VOLTAGE_MIN_SAFE (< 23.5V per 5 cicli)
   // Azione: UPS Shutdown + 5 beep (IMMEDIATO, non periodico)
   // ===================================================================
-  if(currentData.batteryVoltage < g_voltageMinSafe) {
+  if(data.batteryVoltage < g_voltageMinSafe) {
     voltageMinSafeCounter++;
     
     if(voltageMinSafeCounter >= 5) {
-      LOG_ERROR("Battery voltage critically low: " + String(currentData.batteryVoltage, 2) + "V");
+      LOG_ERROR("Battery voltage critically low: %.2fV", data.batteryVoltage);
       LOG_ERROR("Sending UPS shutdown signal...");
       emergencyShutdownUPS();
       triggerBeepAlert(5);
@@ -201,25 +276,25 @@ void HardwareManager::checkEmergencyConditions() {
   // LIVELLO 2: BATTERY_LOW_WARNING (< 20% per 5 cicli)
   // Azione: 5 beep ogni 5 minuti + UPS Shutdown ad ogni ciclo
   // ===================================================================
-  if(currentData.batteryPercentage < g_batteryLowWarning) {
+  if(data.batteryPercentage < g_batteryLowWarning) {
     batteryLowWarningCounter++;
     
     // Attiva allarme Low Battery dopo 5 cicli consecutivi
     if(batteryLowWarningCounter >= 5 && !lowBatteryAlertActive) {
-      LOG_WARNING("Low Battery Warning activated: " + String(currentData.batteryPercentage, 1) + "%");
+      LOG_WARNING("Low Battery Warning activated: %.1f%%", data.batteryPercentage);
       lowBatteryAlertActive = true;
       lastLowBatteryAlertTime = currentTime;
       
       // Primo allarme: 5 beep + shutdown
-      Serial.println("[WARNING] Sending UPS shutdown signal...");
+      LOG_WARNING("Sending UPS shutdown signal...");
       emergencyShutdownUPS();
       triggerBeepAlert(5);
     }
     
     // Se allarme attivo, ripeti ogni 5 minuti (300000 ms)
-    if(lowBatteryAlertActive && timeElapsed(lastLowBatteryAlertTime, 300000)) {
-      Serial.println("[WARNING] Low Battery periodic alert: " + String(currentData.batteryPercentage, 1) + "%");
-      Serial.println("[WARNING] Sending UPS shutdown signal...");
+    if(lowBatteryAlertActive && timeElapsed(currentTime, lastLowBatteryAlertTime, 300000)) {
+      LOG_WARNING("Low Battery periodic alert: %.1f%%", data.batteryPercentage);
+      LOG_WARNING("Sending UPS shutdown signal...");
       emergencyShutdownUPS();
       triggerBeepAlert(5);
       lastLowBatteryAlertTime = currentTime;
@@ -228,7 +303,7 @@ void HardwareManager::checkEmergencyConditions() {
   } else {
     // Batteria sopra 20% - disattiva allarme Low Battery
     if(lowBatteryAlertActive) {
-      Serial.println("[WARNING] Battery recovered above " + String(g_batteryLowWarning, 1) + "% - Low Battery alert deactivated");
+      LOG_WARNING("Battery recovered above %.1f%% - Low Battery alert deactivated", g_batteryLowWarning);
       lowBatteryAlertActive = false;
       lastLowBatteryAlertTime = 0;
     }
@@ -239,13 +314,13 @@ void HardwareManager::checkEmergencyConditions() {
   // LIVELLO 3: BATTERY_CRITICAL (< 10% per 3 cicli)
   // Azione: 10 beep ogni 1 minuto fino a scarica totale o ripristino
   // ===================================================================
-  if(currentData.batteryPercentage < g_batteryCritical) {
+  if(data.batteryPercentage < g_batteryCritical) {
     batteryCriticalCounter++;
     
     // Attiva allarme Critical Battery dopo 3 cicli consecutivi
     if(batteryCriticalCounter >= 3 && !criticalBatteryAlertActive) {
-      Serial.println("[CRITICAL] Critical Battery Level activated: " + String(currentData.batteryPercentage, 1) + "%");
-      Serial.println("[CRITICAL] BMS intervention imminent!");
+      LOG_ERROR("Critical Battery Level activated: %.1f%%", data.batteryPercentage);
+      LOG_ERROR("BMS intervention imminent!");
       criticalBatteryAlertActive = true;
       lastCriticalBatteryAlertTime = currentTime;
       
@@ -257,8 +332,8 @@ void HardwareManager::checkEmergencyConditions() {
     }
     
     // Se allarme attivo, ripeti ogni 1 minuto (60000 ms)
-    if(criticalBatteryAlertActive && timeElapsed(lastCriticalBatteryAlertTime, 60000)) {
-      Serial.println("[CRITICAL] Critical Battery periodic alert: " + String(currentData.batteryPercentage, 1) + "%");
+    if(criticalBatteryAlertActive && timeElapsed(currentTime, lastCriticalBatteryAlertTime, 60000)) {
+      LOG_ERROR("Critical Battery periodic alert: %.1f%%", data.batteryPercentage);
       triggerBeepAlert(10);
       lastCriticalBatteryAlertTime = currentTime;
     }
@@ -266,15 +341,15 @@ void HardwareManager::checkEmergencyConditions() {
   } else {
     // Batteria sopra 10% - disattiva allarme Critical Battery
     if(criticalBatteryAlertActive) {
-      Serial.println("[CRITICAL] Battery recovered above " + String(g_batteryCritical, 1) + "% - Critical Battery alert deactivated");
+      LOG_WARNING("Battery recovered above %.1f%% - Critical Battery alert deactivated", g_batteryCritical);
       criticalBatteryAlertActive = false;
       lastCriticalBatteryAlertTime = 0;
       
       // Riattiva Low Battery alert se ancora sotto 20%
-      if(currentData.batteryPercentage < g_batteryLowWarning) {
+      if(data.batteryPercentage < g_batteryLowWarning) {
         lowBatteryAlertActive = true;
         lastLowBatteryAlertTime = currentTime;
-        Serial.println("[WARNING] Low Battery alert reactivated");
+        LOG_WARNING("Low Battery alert reactivated");
       }
     }
     batteryCriticalCounter = 0;
@@ -284,27 +359,27 @@ void HardwareManager::checkEmergencyConditions() {
 void HardwareManager::triggerBeepAlert(int pulses) {
   // Respect global beepsEnabled setting
   if (!g_beepsEnabled) {
-    Serial.println("[BEEP] Beep alerts disabled - skipping (" + String(pulses) + ")");
+    LOG_INFO("Beep: Alerts disabled - skipping (%d)", pulses);
     return;
   }
 
-  Serial.println("[BEEP] Triggering alert with " + String(pulses) + " beeps");
+  LOG_INFO("Beep: Triggering alert with %d beeps", pulses);
   
   isBeeping = true;
   beepCount = 0;
   totalBeepsNeeded = pulses;
-  lastBeepTime = millis();
+  lastBeepTime = hal->nowMs();
 }
 
 void HardwareManager::updateBeepState() {
   if(!isBeeping) return;
   
-  unsigned long now = millis();
+  unsigned long now = hal->nowMs();
   
   // Beep pattern: 0.5s ON (press), 0.5s OFF (release)
   const unsigned long beepDuration = 500;  // 0.5s
   
-  if(timeElapsed(lastBeepTime, beepDuration)) {
+  if(timeElapsed(now, lastBeepTime, beepDuration)) {
     beepCount++;
     lastBeepTime = now;
     
@@ -320,7 +395,7 @@ void HardwareManager::updateBeepState() {
       isBeeping = false;
       beepCount = 0;
       totalBeepsNeeded = 0;
-      Serial.println("[BEEP] Alert sequence complete");
+      LogSerial.println("[BEEP] Alert sequence complete");
     }
   }
 }
@@ -329,71 +404,627 @@ void HardwareManager::emergencyShutdownUPS() {
   // Emergency shutdown: UPS protocol handles shutdown via updateStatus()
   // The shutdown is triggered automatically when battery reaches critical level
   if(webServerRef != nullptr) {
-    Serial.println("[UPS] Emergency shutdown command queued");
+    LogSerial.println("[UPS] Emergency shutdown command queued");
   }
 }
 
 bool HardwareManager::runSelfTest() {
-  Serial.println("[HW] Running self-test...");
+  LogSerial.println("[HW] Running self-test...");
   
   float voltage = readBatteryVoltageRaw();
   if(voltage < BATTERY_VMIN || voltage > BATTERY_VMAX) {
-    Serial.println("[HW] Self-test FAILED: Battery voltage out of range");
+    LogSerial.println("[HW] Self-test FAILED: Battery voltage out of range");
     return false;
   }
   
-  double testIN = sctMain.calcIrms(SCT013_SAMPLES);
-  double testOUT = sctOutput.calcIrms(SCT013_SAMPLES);
+  AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT];
+  if(!adcSampler.getLatestWindows(windows)) {
+    LogSerial.println("[HW] Self-test FAILED: No ADC sampler window available");
+    return false;
+  }
+  double testIN = rmsToIrms(windows[ADC_SAMPLER_CH_IN].meanSquare, g_sct013CalIn, ADC_COUNTS);
+  double testOUT = rmsToIrms(windows[ADC_SAMPLER_CH_OUT].meanSquare, g_sct013CalOut, ADC_COUNTS);
   
-  Serial.println("[HW] Self-test results:");
-  Serial.println("  Battery voltage: " + String(voltage, 2) + "V");
-  Serial.println("  Current IN: " + String(testIN, 2) + "A");
-  Serial.println("  Current OUT: " + String(testOUT, 2) + "A");
-  Serial.println("[HW] Self-test passed");
+  // Built-in SOC curves must match the original linear walk at every point
+  static SocCurve socCurve;
+  socCurve.load(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS);
+  for(int i = 0; i < CURVE_NORMAL_POINTS; i++) {
+    float v = BATTERY_CURVE_NORMAL[i][1];
+    if(fabs(socCurve.percentAt(v) - socCurveLinearReference(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS, v)) > 0.001) {
+      LogSerial.println("[HW] Self-test FAILED: SOC curve mismatch at " + String(v, 2) + "V");
+      return false;
+    }
+  }
+  socCurve.load(BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS);
+  for(int i = 0; i < CURVE_CHARGE_POINTS; i++) {
+    float v = BATTERY_CURVE_CHARGE[i][1];
+    if(fabs(socCurve.percentAt(v) - socCurveLinearReference(BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS, v)) > 0.001) {
+      LogSerial.println("[HW] Self-test FAILED: Charge SOC curve mismatch at " + String(v, 2) + "V");
+      return false;
+    }
+  }
+  
+  // Compensation tables must hit their band edges exactly
+  portENTER_CRITICAL(&g_compLock);
+  CompensationTable discharge = g_compDischarge;
+  CompensationTable charge = g_compCharge;
+  portEXIT_CRITICAL(&g_compLock);
+  for(int i = 0; i < discharge.size(); i++) {
+    CompensationPoint p = discharge.point(i);
+    if(fabs(discharge.offsetAt(p.voltage) - p.offset) > 0.001) {
+      LogSerial.println("[HW] Self-test FAILED: Discharge compensation mismatch at " + String(p.voltage, 2) + "V");
+      return false;
+    }
+  }
+  for(int i = 0; i < charge.size(); i++) {
+    CompensationPoint p = charge.point(i);
+    if(fabs(charge.offsetAt(p.voltage) - p.offset) > 0.001) {
+      LogSerial.println("[HW] Self-test FAILED: Charge compensation mismatch at " + String(p.voltage, 2) + "V");
+      return false;
+    }
+  }
+  
+  LogSerial.println("[HW] Self-test results:");
+  LogSerial.println("  Battery voltage: " + String(voltage, 2) + "V");
+  LogSerial.println("  Current IN: " + String(testIN, 2) + "A");
+  LogSerial.println("  Current OUT: " + String(testOUT, 2) + "A");
+  LogSerial.println("[HW] Self-test passed");
   
   return true;
 }
 
 void HardwareManager::printDiagnostics() {
-  Serial.println("\n=== HARDWARE DIAGNOSTICS ===");
-  Serial.println("Battery:");
-  Serial.println("  Voltage: " + String(currentData.batteryVoltage, 2) + "V");
-  Serial.println("  SOC: " + String(currentData.batteryPercentage, 1) + "%");
-  Serial.println("  Ah Remaining: " + String(getEstimatedAh(currentData.batteryPercentage), 1) + "Ah");
-  Serial.println("  State: " + getStateString(currentState));
-  Serial.println("\nPower:");
-  Serial.println("  Main IN: " + String(currentData.mainPower, 0) + "W (" + String(currentData.mainCurrent, 2) + "A)");
-  Serial.println("  Output: " + String(currentData.outputPower, 0) + "W (" + String(currentData.outputCurrent, 2) + "A)");
-  Serial.println("  Net: " + String(currentData.mainPower - currentData.outputPower, 0) + "W");
-  Serial.println("\nStatus:");
-  Serial.println("  Power Station: " + String(isPowerStationOn ? "ON" : "OFF"));
-  Serial.println("  On Battery: " + String(currentData.onBattery ? "YES" : "NO"));
-  Serial.println("  Warm-up: " + String(isWarmedUp ? "Complete" : "In Progress"));
-  Serial.println("  Auto Power On: " + String(autoPowerOnEnabled ? "ENABLED" : "DISABLED"));
-  Serial.println("\nEmergency Alerts:");
-  Serial.println("  Low Battery Alert (20%): " + String(lowBatteryAlertActive ? "ACTIVE" : "INACTIVE"));
-  Serial.println("  Critical Battery Alert (10%): " + String(criticalBatteryAlertActive ? "ACTIVE" : "INACTIVE"));
+  SensorData data = getSensorData();
+  
+  LogSerial.println("\n=== HARDWARE DIAGNOSTICS ===");
+  LogSerial.println("Battery:");
+  LogSerial.println("  Voltage: " + String(data.batteryVoltage, 2) + "V");
+  LogSerial.println("  SOC: " + String(data.batteryPercentage, 1) + "%");
+  LogSerial.println("  SOC Voltage / Fused: " + String(data.socVoltage, 1) + "% / " + String(data.socFused, 1) + "% (+/-" +
+                 String(sqrt(socEstimator.getVariance()), 1) + "%, " + String(g_socFusionEnabled ? "fused" : "voltage") + " in use)");
+  LogSerial.println("  Battery Current: " + String(data.batteryCurrent, 2) + "A");
+  LogSerial.println("  Ah Remaining: " + String(getEstimatedAh(data.batteryPercentage), 1) + "Ah");
+  LogSerial.println("  State: " + getStateString(data.batteryState));
+  LogSerial.println("\nPower:");
+  LogSerial.println("  Main IN: " + String(data.mainPower, 0) + "W (" + String(data.mainCurrent, 2) + "A)");
+  LogSerial.println("  Output: " + String(data.outputPower, 0) + "W (" + String(data.outputCurrent, 2) + "A)");
+  LogSerial.println("  Net: " + String(data.mainPower - data.outputPower, 0) + "W");
+  LogSerial.println("  Mains: " + String(data.mainsFrequency, 2) + "Hz (" + String(adcSampler.getNominalFrequency()) + "Hz standard)");
+  const char* harmonicNames[ADC_SAMPLER_CH_COUNT] = {"IN", "OUT"};
+  for(int ch = 0; ch < ADC_SAMPLER_CH_COUNT; ch++) {
+    HarmonicResult h = getHarmonics((AdcSamplerChannel)ch);
+    if(!h.valid) {
+      LogSerial.println("  Harmonics " + String(harmonicNames[ch]) + ": n/a (idle or disabled)");
+      continue;
+    }
+    LogSerial.println("  Harmonics " + String(harmonicNames[ch]) + ": THD " + String(h.thd, 1) + "%, crest " + String(h.crestFactor, 2) +
+                   ", PF " + String(h.powerFactor, 2) + " (H3 " + String(h.harmonicRms[1] / h.harmonicRms[0] * 100, 1) +
+                   "%, H5 " + String(h.harmonicRms[2] / h.harmonicRms[0] * 100, 1) + "%)");
+  }
+  LogSerial.println("\nStatus:");
+  LogSerial.println("  Power Station: " + String(isPowerStationOn ? "ON" : "OFF"));
+  LogSerial.println("  On Battery: " + String(data.onBattery ? "YES" : "NO"));
+  LogSerial.println("  Mains Lost (fast path): " + String(data.mainsLost ? "YES" : "NO") + ", " +
+                 String(mainsLossStats.events) + " outages, last detect " + String(mainsLossStats.lastDetectMs, 1) +
+                 "ms / notify " + String(mainsLossStats.lastNotifyMs, 1) + "ms (max " + String(mainsLossStats.maxNotifyMs, 1) + "ms)");
+  AcquisitionStats acq = getAcquisitionStats();
+  LogSerial.println("  Acquisition: " + String(acqModeName(acq.mode)) + " (" + String(acq.sampleRateHz) + " Hz, 1/" + String(acq.decimation) +
+                 " per clamp), last change: " + String(acqTriggerName(acq.lastTrigger)) + ", idle " + String(acq.idlePercent, 0) + "%");
+  LogSerial.println("  CPU per second: sampler " + String(acq.samplerCpuUsPerSecond / 1000.0, 2) + "ms, sensors " +
+                 String(acq.sensorCpuUsPerSecond / 1000.0, 2) + "ms");
+  LogSerial.println("  Warm-up: " + String(getIsWarmedUp() ? "Complete" : "In Progress"));
+  LogSerial.println("  Auto Power On: " + String(autoPowerOnEnabled ? "ENABLED" : "DISABLED"));
+  LogSerial.println("\nEmergency Alerts:");
+  LogSerial.println("  Low Battery Alert (20%): " + String(lowBatteryAlertActive ? "ACTIVE" : "INACTIVE"));
+  LogSerial.println("  Critical Battery Alert (10%): " + String(criticalBatteryAlertActive ? "ACTIVE" : "INACTIVE"));
   if(lowBatteryAlertActive) {
-    unsigned long timeSinceLastAlert = (millis() - lastLowBatteryAlertTime) / 1000;
-    Serial.println("  Time since last Low Battery alert: " + String(timeSinceLastAlert) + "s (next in " + String(300 - timeSinceLastAlert) + "s)");
+    unsigned long timeSinceLastAlert = (hal->nowMs() - lastLowBatteryAlertTime) / 1000;
+    LogSerial.println("  Time since last Low Battery alert: " + String(timeSinceLastAlert) + "s (next in " + String(300 - timeSinceLastAlert) + "s)");
   }
   if(criticalBatteryAlertActive) {
-    unsigned long timeSinceLastAlert = (millis() - lastCriticalBatteryAlertTime) / 1000;
-    Serial.println("  Time since last Critical alert: " + String(timeSinceLastAlert) + "s (next in " + String(60 - timeSinceLastAlert) + "s)");
-  }
-  Serial.println("\nEmergency Counters:");
-  Serial.println("  Voltage Min Safe Counter: " + String(voltageMinSafeCounter) + "/5");
-  Serial.println("  Battery Low Warning Counter: " + String(batteryLowWarningCounter) + "/5");
-  Serial.println("  Battery Critical Counter: " + String(batteryCriticalCounter) + "/3");
-  Serial.println("\nCalibration:");
-  Serial.println("  SCT013 Cal In: " + String(g_sct013CalIn, 2));
-  Serial.println("  SCT013 Cal Out: " + String(g_sct013CalOut, 2));
-  Serial.println("  Battery Divider Ratio: " + String(g_batteryDividerRatio, 3));
-  Serial.println("  Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
-  Serial.println("\nAdvanced Settings:");
-  Serial.println("  Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 1) + "V");
-  Serial.println("  Voltage Min Safe: " + String(g_voltageMinSafe, 1) + "V");
-  Serial.println("  Battery Low Warning: " + String(g_batteryLowWarning, 1) + "%");
-  Serial.println("  Battery Critical: " + String(g_batteryCritical, 1) + "%");
-  Serial.println("============================\n");
+    unsigned long timeSinceLastAlert = (hal->nowMs() - lastCriticalBatteryAlertTime) / 1000;
+    LogSerial.println("  Time since last Critical alert: " + String(timeSinceLastAlert) + "s (next in " + String(60 - timeSinceLastAlert) + "s)");
+  }
+  LogSerial.println("\nEmergency Counters:");
+  LogSerial.println("  Voltage Min Safe Counter: " + String(voltageMinSafeCounter) + "/5");
+  LogSerial.println("  Battery Low Warning Counter: " + String(batteryLowWarningCounter) + "/5");
+  LogSerial.println("  Battery Critical Counter: " + String(batteryCriticalCounter) + "/3");
+  LogSerial.println("\nADC Sampler:");
+  LogSerial.println("  Running: " + String(adcSampler.isRunning() ? "YES" : "NO"));
+  LogSerial.println("  Frames Read: " + String(adcSampler.getFramesRead()));
+  LogSerial.println("  Rate per Channel: " + String(adcSampler.getChannelSampleRate(), 0) + " Hz");
+  LogSerial.println("  RMS Window: " + String(adcSampler.getWindowCycles()) + " mains cycles");
+  LogSerial.println("  Battery Raw: " + String(adcSampler.getBatteryRaw(), 1) + " (" +
+                 String(adcSampler.rawToMillivolts(adcSampler.getBatteryRaw()), 0) + " mV)");
+  LogSerial.println("  Calibration: " + String(adcSampler.hasFactoryCalibration() ? "Factory (eFuse)" : "Linear fallback"));
+  LogSerial.println("  Samples Dropped: " + String(adcSampler.getSamplesDropped()));
+  LogSerial.println("\nCalibration:");
+  LogSerial.println("  SCT013 Cal In: " + String(g_sct013CalIn, 2));
+  LogSerial.println("  SCT013 Cal Out: " + String(g_sct013CalOut, 2));
+  LogSerial.println("  Battery Divider Ratio: " + String(g_batteryDividerRatio, 3));
+  LogSerial.println("  Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
+  LogSerial.println("\nAdvanced Settings:");
+  LogSerial.println("  Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 1) + "V");
+  LogSerial.println("  Voltage Min Safe: " + String(g_voltageMinSafe, 1) + "V");
+  LogSerial.println("  Battery Low Warning: " + String(g_batteryLowWarning, 1) + "%");
+  LogSerial.println("  Battery Critical: " + String(g_batteryCritical, 1) + "%");
+  LogSerial.println("============================\n");
+}
+
+void HardwareManager::benchmarkCurrentSampling(int iterations) {
+  if(iterations < 1) iterations = 1;
+  
+  LogSerial.println("\n=== CURRENT SAMPLING BENCHMARK ===");
+  LogSerial.println("calcIrms window: " + String(SCT013_SAMPLES) + " samples/channel, sampler window: " +
+                 String(adcSampler.getWindowCycles()) + " mains cycles, " + String(iterations) + " iterations");
+  
+  // calcIrms() needs the oneshot ADC, the continuous driver must be released
+  // (the sensor task keeps publishing the last readings meanwhile)
+  adcSampler.stop();
+  
+  // --- Sequential: two blocking calcIrms() calls, IN then OUT ---
+  uint32_t totalInUs = 0;
+  uint32_t totalOutUs = 0;
+  for(int i = 0; i < iterations; i++) {
+    unsigned long t0 = micros();
+    sctMain.calcIrms(SCT013_SAMPLES);
+    unsigned long t1 = micros();
+    sctOutput.calcIrms(SCT013_SAMPLES);
+    unsigned long t2 = micros();
+    totalInUs += t1 - t0;
+    totalOutUs += t2 - t1;
+    vTaskDelay(1);
+  }
+  float seqInMs = totalInUs / 1000.0 / iterations;
+  float seqOutMs = totalOutUs / 1000.0 / iterations;
+  float seqTotalMs = seqInMs + seqOutMs;
+  float seqRate = seqInMs > 0 ? SCT013_SAMPLES * 1000.0 / seqInMs : 0;
+  
+  // --- Interleaved: background sampler, both channels in one window ---
+  if(!adcSampler.begin()) {
+    LOG_ERROR("Benchmark: Failed to restart ADC sampler");
+    return;
+  }
+  
+  AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT];
+  adcSampler.getLatestWindows(windows);
+  uint32_t lastSequence = windows[ADC_SAMPLER_CH_IN].sequence;
+  uint32_t totalWindowUs = 0;
+  uint32_t totalPickupUs = 0;
+  float totalRate = 0;
+  int collected = 0;
+  unsigned long startWait = millis();
+  
+  // The first window after a restart starts mid-frame, skip it
+  while(collected < iterations + 1 && !timeElapsed(millis(), startWait, 2000UL * (iterations + 1))) {
+    unsigned long t0 = micros();
+    adcSampler.getLatestWindows(windows);
+    double irmsIN = rmsToIrms(windows[ADC_SAMPLER_CH_IN].meanSquare, g_sct013CalIn, ADC_COUNTS);
+    double irmsOUT = rmsToIrms(windows[ADC_SAMPLER_CH_OUT].meanSquare, g_sct013CalOut, ADC_COUNTS);
+    unsigned long pickupUs = micros() - t0;
+    (void)irmsIN;
+    (void)irmsOUT;
+    
+    if(windows[ADC_SAMPLER_CH_IN].sequence != lastSequence) {
+      lastSequence = windows[ADC_SAMPLER_CH_IN].sequence;
+      if(collected > 0) {
+        totalWindowUs += windows[ADC_SAMPLER_CH_IN].durationUs;
+        totalRate += windows[ADC_SAMPLER_CH_IN].sampleRateHz;
+        totalPickupUs += pickupUs;
+      }
+      collected++;
+    }
+    vTaskDelay(1);
+  }
+  
+  int measured = collected - 1;
+  if(measured < 1) {
+    LogSerial.println("[HW] Benchmark: No sampler windows received");
+    return;
+  }
+  
+  float intWindowMs = totalWindowUs / 1000.0 / measured;
+  float intRate = totalRate / measured;
+  float pickupUs = (float)totalPickupUs / measured;
+  
+  LogSerial.println("Sequential calcIrms (IN then OUT):");
+  LogSerial.println("  IN: " + String(seqInMs, 1) + "ms, OUT: " + String(seqOutMs, 1) + "ms, total: " + String(seqTotalMs, 1) + "ms (blocking)");
+  LogSerial.println("  Rate per Channel: " + String(seqRate, 0) + " Hz");
+  LogSerial.println("  IN/OUT skew: " + String(seqInMs, 1) + "ms (different mains cycles)");
+  LogSerial.println("Interleaved sampler (IN/OUT alternated):");
+  LogSerial.println("  Window: " + String(intWindowMs, 1) + "ms for both channels (background DMA)");
+  LogSerial.println("  Rate per Channel: " + String(intRate, 0) + " Hz");
+  LogSerial.println("  IN/OUT skew: " + String(1000000.0 / adcSampler.getSampleRate(), 0) + "us (one conversion)");
+  LogSerial.println("  Loop-side pickup: " + String(pickupUs, 1) + "us");
+  if(intWindowMs > 0) {
+    LogSerial.println("Wall time ratio (sequential / interleaved): " + String(seqTotalMs / intWindowMs, 2) + "x");
+  }
+  LogSerial.println("==================================\n");
+}
+
+void HardwareManager::benchmarkRmsKernels(int repeats) {
+  static uint16_t trace[ADC_SAMPLER_RING_SAMPLES];
+  if(repeats < 1) repeats = 1;
+  
+  LogSerial.println("\n=== RMS KERNEL BENCHMARK ===");
+  LogSerial.println("Tolerance: " + String(RMS_Q_TOLERANCE_ABS, 2) + " counts + " + String(RMS_Q_TOLERANCE_REL * 100, 1) + "% of RMS");
+  
+  // Recorded: latest raw samples of both clamps from the sampler ring
+  uint32_t count = adcSampler.copyRecentSamples(ADC_SAMPLER_CH_IN, trace, ADC_SAMPLER_RING_SAMPLES);
+  if(count > 0) benchmarkKernelsOnTrace("Recorded IN", trace, count, repeats);
+  count = adcSampler.copyRecentSamples(ADC_SAMPLER_CH_OUT, trace, ADC_SAMPLER_RING_SAMPLES);
+  if(count > 0) benchmarkKernelsOnTrace("Recorded OUT", trace, count, repeats);
+  
+  // Synthetic: idle clamp and a heavy load, at the current mains frequency
+  float rate = adcSampler.getChannelSampleRate();
+  if(rate <= 0) rate = (float)ADC_SAMPLER_RATE_HZ / ADC_SAMPLER_CH_COUNT;
+  synthesizeCurrentTrace(trace, ADC_SAMPLER_RING_SAMPLES, ADC_RESOLUTION / 2 - 150, 0, adcSampler.getNominalFrequency(), rate);
+  benchmarkKernelsOnTrace("Synthetic idle", trace, ADC_SAMPLER_RING_SAMPLES, repeats);
+  synthesizeCurrentTrace(trace, ADC_SAMPLER_RING_SAMPLES, ADC_RESOLUTION / 2 - 150, 1200, adcSampler.getNominalFrequency(), rate);
+  benchmarkKernelsOnTrace("Synthetic load", trace, ADC_SAMPLER_RING_SAMPLES, repeats);
+  
+  LogSerial.println("============================\n");
+}
+
+void HardwareManager::benchmarkSocCurves(int repeats) {
+  if(repeats < 1) repeats = 1;
+  
+  LogSerial.println("\n=== SOC CURVE BENCHMARK ===");
+  benchmarkSocCurve("Normal", BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS, repeats);
+  benchmarkSocCurve("Charge", BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS, repeats);
+  LogSerial.println("===========================\n");
+}
+
+void HardwareManager::benchmarkSocMedian(int windowSize) {
+  static SlidingMedian<SOC_BUFFER_SIZE_MAX> window;
+  static float ring[SOC_BUFFER_SIZE_MAX];
+  static float tmp[SOC_BUFFER_SIZE_MAX];
+  const int samples = 1000;
+  static float trace[samples];
+  windowSize = constrain(windowSize, 1, SOC_BUFFER_SIZE_MAX);
+  
+  LogSerial.println("\n=== SOC MEDIAN BENCHMARK ===");
+  LogSerial.println("Window: " + String(windowSize) + " samples, " + String(samples) + " noisy SOC readings");
+  
+  // Drifting SOC with +/-5% noise and occasional outliers, 0.1% steps
+  float soc = 80.0;
+  randomSeed(windowSize);
+  for(int i = 0; i < samples; i++) {
+    soc -= random(0, 10) * 0.002;
+    float value = soc + random(-50, 51) * 0.1;
+    if(random(0, 50) == 0) value = random(0, 101);
+    trace[i] = roundf(value * 10) / 10;
+  }
+  
+  unsigned long sortUs = 0;
+  unsigned long slidingUs = 0;
+  int mismatches = 0;
+  int head = 0;
+  int count = 0;
+  window.reset(windowSize);
+  
+  for(int i = 0; i < samples; i++) {
+    ring[head] = trace[i];
+    head = (head + 1) % windowSize;
+    if(count < windowSize) count++;
+    
+    unsigned long t0 = micros();
+    float ref = slidingMedianReference(ring, count, tmp);
+    sortUs += micros() - t0;
+    
+    t0 = micros();
+    window.push(trace[i]);
+    float med = window.median();
+    slidingUs += micros() - t0;
+    
+    if(med != ref) mismatches++;
+  }
+  
+  LogSerial.println("  Copy + sort:    " + String((float)sortUs / samples, 1) + " us/sample");
+  LogSerial.println("  Sliding median: " + String((float)slidingUs / samples, 1) + " us/sample");
+  LogSerial.println("  Mismatches: " + String(mismatches) + " -> " + (mismatches == 0 ? "PASS" : "FAIL"));
+  LogSerial.println("============================\n");
+}
+
+// Step response and idle noise of one filter configuration on a trace:
+// idle for 60 readings (one single-reading spike at 40), load step at 60,
+// back to idle at 150
+static void benchmarkPowerFilterConfig(const char* name, const PowerFilterParams& params, float alpha,
+                                       const float* trace, int count, float idleW, float loadW) {
+  PowerFilter filter;
+  filter.configure(params, alpha);
+  
+  double noiseSum = 0;
+  int noiseCount = 0;
+  float spikePeak = 0;
+  int rise = -1;
+  int fall = -1;
+  unsigned long t0 = micros();
+  for(int i = 0; i < count; i++) {
+    float y = filter.update(trace[i]);
+    if(i >= 20 && i < 38) {
+      noiseSum += (y - idleW) * (y - idleW);
+      noiseCount++;
+    }
+    if(i >= 40 && i < 60 && y - idleW > spikePeak) spikePeak = y - idleW;
+    if(i >= 60 && rise < 0 && y >= idleW + 0.9 * (loadW - idleW)) rise = i - 60;
+    if(i >= 150 && fall < 0 && y <= idleW + 0.1 * (loadW - idleW)) fall = i - 150;
+  }
+  unsigned long elapsedUs = micros() - t0;
+  
+  LogSerial.println(String(name) + "rise " + String(rise) + ", fall " + String(fall) + " readings, idle noise " +
+                 String(noiseCount > 0 ? sqrt(noiseSum / noiseCount) : 0, 2) + "W, spike " + String(spikePeak, 0) +
+                 "W, " + String((float)elapsedUs / count, 2) + " us/reading");
+}
+
+void HardwareManager::benchmarkPowerFilters() {
+  const int readings = 240;
+  static float trace[readings];
+  const float idleW = 30.0;
+  const float loadW = 400.0;
+  
+  LogSerial.println("\n=== POWER FILTER BENCHMARK ===");
+  LogSerial.println("Idle " + String(idleW, 0) + "W, step to " + String(loadW, 0) + "W, +/-8W noise, one 300W spike; latency to 90% of the step");
+  
+  // Sum of uniforms ~ gaussian noise, the same trace for every configuration
+  randomSeed(1);
+  for(int i = 0; i < readings; i++) {
+    float noise = 0;
+    for(int k = 0; k < 12; k++) noise += random(0, 1000) / 1000.0;
+    trace[i] = ((i >= 60 && i < 150) ? loadW : idleW) + (noise - 6.0) * 8.0;
+    if(i == 40) trace[i] += 300.0;
+  }
+  
+  PowerFilterParams ema = {POWER_FILTER_EMA, false, g_powerFilterOut.alphaMax, g_powerFilterOut.stepWatts};
+  PowerFilterParams emaMedian = ema;
+  emaMedian.median3 = true;
+  PowerFilterParams adaptive = ema;
+  adaptive.type = POWER_FILTER_ADAPTIVE;
+  PowerFilterParams adaptiveMedian = adaptive;
+  adaptiveMedian.median3 = true;
+  
+  LogSerial.println("Alpha " + String(g_powerFilterAlpha, 2) + ", adaptive max " + String(adaptive.alphaMax, 2) +
+                 " at " + String(adaptive.stepWatts, 0) + "W (OUT channel settings)");
+  benchmarkPowerFilterConfig("  EMA (current):       ", ema, g_powerFilterAlpha, trace, readings, idleW, loadW);
+  benchmarkPowerFilterConfig("  EMA + median-3:      ", emaMedian, g_powerFilterAlpha, trace, readings, idleW, loadW);
+  benchmarkPowerFilterConfig("  Adaptive:            ", adaptive, g_powerFilterAlpha, trace, readings, idleW, loadW);
+  benchmarkPowerFilterConfig("  Adaptive + median-3: ", adaptiveMedian, g_powerFilterAlpha, trace, readings, idleW, loadW);
+  LogSerial.println("==============================\n");
+}
+
+// String work of one simulated 10 s step: a NUT LIST VAR, the MQTT topics
+// and values every 3rd step (30 s), two log lines. Same text either way.
+static const char* const SOAK_TOPICS[] = {
+  "voltage", "soc", "main_current", "output_current", "main_power", "output_power",
+  "on_battery", "instant_power", "daily_consumption", "monthly_consumption", "peak_power", "operating_time"
+};
+static const int SOAK_TOPIC_COUNT = sizeof(SOAK_TOPICS) / sizeof(SOAK_TOPICS[0]);
+
+static size_t soakStringWork(bool useStrBuf, int step, float v) {
+  static const String upsName = "oukitel_p800e";
+  static const String stateTopic = "oukitel_p800e/state";
+  size_t total = 0;
+  
+  if(!useStrBuf) {
+    String response = "BEGIN LIST VAR " + upsName + "\n";
+    response += "VAR " + upsName + " ups.status \"OL\"\n";
+    response += "VAR " + upsName + " battery.charge \"" + String(v, 0) + "\"\n";
+    response += "VAR " + upsName + " battery.voltage \"" + String(v / 4, 1) + "\"\n";
+    response += "VAR " + upsName + " input.current \"" + String(v / 230, 2) + "\"\n";
+    response += "VAR " + upsName + " output.current \"" + String(v / 460, 2) + "\"\n";
+    response += "VAR " + upsName + " ups.load \"" + String(v / 24, 1) + "\"\n";
+    response += "VAR " + upsName + " ups.power \"" + String(v, 0) + "\"\n";
+    response += "END LIST VAR " + upsName;
+    total += response.length();
+    
+    if(step % 3 == 0) {
+      for(int i = 0; i < SOAK_TOPIC_COUNT; i++) {
+        String topic = stateTopic + "/" + SOAK_TOPICS[i];
+        String value = String(v * i, 2);
+        total += topic.length() + value.length();
+      }
+    }
+    
+    String line = "[HW] Power reading exceeds maximum (" + String(3000.0, 0) + "W): IN=" + String(v, 1) + "W, OUT=" + String(v / 2, 1) + "W";
+    total += line.length();
+    line = "[UPS] Command from client " + String(step % UPS_MAX_CLIENTS) + ": LIST VAR " + upsName;
+    total += line.length();
+  } else {
+    StackStr<UPS_RESPONSE_MAX> response;
+    response.add("BEGIN LIST VAR ").add(upsName).add('\n');
+    response.add("VAR ").add(upsName).add(" ups.status \"OL\"\n");
+    response.add("VAR ").add(upsName).add(" battery.charge \"").addFloat(v, 0).add("\"\n");
+    response.add("VAR ").add(upsName).add(" battery.voltage \"").addFloat(v / 4, 1).add("\"\n");
+    response.add("VAR ").add(upsName).add(" input.current \"").addFloat(v / 230, 2).add("\"\n");
+    response.add("VAR ").add(upsName).add(" output.current \"").addFloat(v / 460, 2).add("\"\n");
+    response.add("VAR ").add(upsName).add(" ups.load \"").addFloat(v / 24, 1).add("\"\n");
+    response.add("VAR ").add(upsName).add(" ups.power \"").addFloat(v, 0).add("\"\n");
+    response.add("END LIST VAR ").add(upsName);
+    total += response.length();
+    
+    if(step % 3 == 0) {
+      for(int i = 0; i < SOAK_TOPIC_COUNT; i++) {
+        StackStr<MQTT_TOPIC_MAX> topic;
+        topic.add(stateTopic).add('/').add(SOAK_TOPICS[i]);
+        StackStr<24> value;
+        value.addFloat(v * i, 2);
+        total += topic.length() + value.length();
+      }
+    }
+    
+    StackStr<112> line;
+    line.add("[HW] Power reading exceeds maximum (").addFloat(3000.0, 0).add("W): IN=").addFloat(v, 1)
+        .add("W, OUT=").addFloat(v / 2, 1).add("W");
+    total += line.length();
+    line.clear();
+    line.add("[UPS] Command from client ").addInt(step % UPS_MAX_CLIENTS).add(": LIST VAR ").add(upsName);
+    total += line.length();
+  }
+  return total;
+}
+
+// Simulated days of string work between long-lived blocks of random size
+// (stand-ins for sockets, JSON documents and WebSocket frames), with the
+// largest free block at the end of every day
+static void soakHeap(const char* name, bool useStrBuf, int days) {
+  const int stepsPerDay = 86400 / 10;
+  const int blockCount = 16;
+  void* blocks[blockCount] = {nullptr};
+  volatile size_t sink = 0;
+  
+  randomSeed(7);
+  uint32_t firstLargest = 0;
+  uint32_t minLargest = UINT32_MAX;
+  unsigned long t0 = millis();
+  
+  LogSerial.println(String(name) + ":");
+  for(int day = 1; day <= days; day++) {
+    for(int step = 0; step < stepsPerDay; step++) {
+      int slot = random(0, blockCount);
+      free(blocks[slot]);
+      blocks[slot] = malloc(random(48, 1500));
+      
+      sink = sink + soakStringWork(useStrBuf, step, 50.0f + random(0, 2000) / 10.0f);
+      
+      if(step % 500 == 0) {
+        uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        if(largest < minLargest) minLargest = largest;
+        delay(1);   // Watchdog and the other tasks
+      }
+    }
+    
+    uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if(largest < minLargest) minLargest = largest;
+    if(day == 1) firstLargest = largest;
+    float fragmented = freeHeap > 0 ? (1.0 - (float)largest / freeHeap) * 100.0 : 0;
+    LogSerial.println("  Day " + String(day) + ": free " + String(freeHeap) + ", largest block " + String(largest) +
+                   " (" + String(fragmented, 1) + "% fragmented)");
+  }
+  
+  for(int i = 0; i < blockCount; i++) free(blocks[i]);
+  
+  LogSerial.println("  Largest block day 1 -> " + String(days) + ": " + String((int32_t)(minLargest - firstLargest)) +
+                 " bytes at the worst point, " + String((millis() - t0) / 1000.0, 1) + " s");
+}
+
+void HardwareManager::benchmarkHeapSoak(int days) {
+  LogSerial.println("\n=== HEAP SOAK BENCHMARK ===");
+  LogSerial.println(String(days) + " simulated days, 10 s per step: NUT LIST VAR, MQTT topics every 30 s, log lines,");
+  LogSerial.println("16 long-lived blocks of 48-1500 bytes replaced at random");
+  soakHeap("String concatenation", false, days);
+  soakHeap("StrBuf (stack)", true, days);
+  LogSerial.println("===========================\n");
+}
+
+static void addStageCost(ReplayStageCost& cost, int64_t elapsedUs) {
+  cost.calls++;
+  cost.totalUs += elapsedUs;
+  if(elapsedUs > (int64_t)cost.maxUs) cost.maxUs = (uint32_t)elapsedUs;
+}
+
+static void printStageCost(const char* name, const ReplayStageCost& cost) {
+  float avgUs = cost.calls > 0 ? (float)cost.totalUs / cost.calls : 0;
+  LogSerial.println(String(name) + String(avgUs, 1) + " us avg, " + String(cost.maxUs) + " us max");
+}
+
+// Plays a trace from SPIFFS (format in hal_replay.h) through the same
+// readSensors / checkStateTransition / checkEmergencyConditions code, one
+// SENSOR_READ_INTERVAL of virtual time per step, as fast as the CPU allows.
+// Button presses go to the replay backend, not to the pins. Other tasks see
+// the replayed readings while it runs; afterwards the pipeline restarts
+// from its boot state with a new warm-up.
+bool HardwareManager::runReplay(const char* path) {
+  static ReplayHal replayHal;   // Window engine and file state, kept off the loop stack
+  
+  LogSerial.println("\n=== PIPELINE REPLAY ===");
+  if(buttonActive || flashlightAlertActive || isBeeping) {
+    LogSerial.println("  Button or beep sequence in progress, try again when it has finished");
+    return false;
+  }
+  
+  // SPIFFS is mounted on /spiffs for stdio
+  String vfsPath = "/spiffs" + String(path);
+  if(!replayHal.open(vfsPath.c_str(), adcSampler.getWindowConfig(), BATTERY_SAMPLER_WINDOW_MS, BATTERY_FILTER_ALPHA)) {
+    LogSerial.println("  Cannot open " + String(path));
+    return false;
+  }
+  
+  // Park the sensor task between two readings and keep the last real one
+  sensorTaskPaused = true;
+  while(sensorTaskBusy) {
+    vTaskDelay(1);
+  }
+  SensorData liveData = sensorSnapshot.read();
+  bool livePowerStationOn = isPowerStationOn;
+  BatteryState livePreviousState = previousState;
+  
+  hal = &replayHal;
+  resetPipelineState();
+  
+  ReplayStageCost samplerCost = {0, 0, 0};
+  ReplayStageCost sensorsCost = {0, 0, 0};
+  ReplayStageCost transitionCost = {0, 0, 0};
+  ReplayStageCost emergencyCost = {0, 0, 0};
+  int transitions = 0;
+  BatteryState lastState = previousState;
+  unsigned long wallStart = millis();
+  
+  bool running = true;
+  while(running) {
+    int64_t t0 = esp_timer_get_time();
+    running = replayHal.advance(SENSOR_READ_INTERVAL);
+    int64_t t1 = esp_timer_get_time();
+    readSensors();
+    int64_t t2 = esp_timer_get_time();
+    checkStateTransition();
+    int64_t t3 = esp_timer_get_time();
+    checkEmergencyConditions();
+    int64_t t4 = esp_timer_get_time();
+    updateBeepState();
+    updateButtonState();
+    
+    addStageCost(samplerCost, t1 - t0);
+    addStageCost(sensorsCost, t2 - t1);
+    addStageCost(transitionCost, t3 - t2);
+    addStageCost(emergencyCost, t4 - t3);
+    if(previousState != lastState) {
+      transitions++;
+      lastState = previousState;
+    }
+    
+    // Long traces: give the idle task a tick now and then
+    if(samplerCost.calls % 50 == 0) {
+      vTaskDelay(1);
+    }
+  }
+  
+  unsigned long wallMs = millis() - wallStart;
+  unsigned long virtualMs = replayHal.nowMs();
+  SensorData last = sensorSnapshot.read();
+  
+  LogSerial.println("Trace: " + String(path) + ", " + String((uint32_t)replayHal.getSamplesRead()) + " samples/channel at " +
+                 String(replayHal.getSampleRate(), 0) + " Hz");
+  LogSerial.println("  Replayed " + String(virtualMs / 1000.0, 1) + "s in " + String(wallMs) + "ms (" +
+                 String(wallMs > 0 ? (float)virtualMs / wallMs : 0, 0) + "x real time, " + String(samplerCost.calls) + " steps)");
+  printStageCost("  Window engine:         ", samplerCost);
+  printStageCost("  readSensors:           ", sensorsCost);
+  printStageCost("  checkStateTransition:  ", transitionCost);
+  printStageCost("  checkEmergencyConds:   ", emergencyCost);
+  LogSerial.println("  State transitions: " + String(transitions) + ", button presses: " + String(replayHal.getPinRises()));
+  LogSerial.println("  Final: " + getStateString(last.batteryState) + ", " + String(last.batteryVoltage, 2) + "V, " +
+                 String(last.batteryPercentage, 1) + "%, IN " + String(last.mainPower, 0) + "W, OUT " + String(last.outputPower, 0) + "W");
+  LogSerial.println("=======================\n");
+  
+  // Back to the hardware with the last real reading and a fresh warm-up
+  replayHal.close();
+  hal = &espHal;
+  resetPipelineState();
+  isPowerStationOn = livePowerStationOn;
+  previousState = livePreviousState;
+  warmupStartTime = hal->nowMs();
+  currentData = liveData;
+  sensorSnapshot.write(liveData);
+  sensorTaskPaused = false;
+  return true;
 }
\ No newline at end of file
@@ -11,13 +11,12 @@ float HardwareManager::readBatteryVoltageRaw() {
     return g_fixedVoltage;
   }
 
-  uint32_t adcSum = 0;
-  for(int i = 0; i < BATTERY_ADC_SAMPLES; i++) {
-    adcSum += analogRead(PIN_BATTERY_VOLTAGE);
-    delayMicroseconds(100);
+  // Oversampled and filtered in the background, calibrated via the cached curve
+  float adcMillivolts = 0;
+  if(!hal->getBatteryMillivolts(adcMillivolts)) {
+    return 0.0f;  // No battery window yet
   }
-  float adcValue = adcSum / (float)BATTERY_ADC_SAMPLES;
-  float adcVoltage = (adcValue / 4095.0) * 3.3;
+  float adcVoltage = adcMillivolts / 1000.0;
   
   float batteryVoltage = adcVoltage * g_batteryAdcCalibration * g_batteryDividerRatio;
   
@@ -39,79 +38,29 @@ float HardwareManager::readBatteryVoltageRaw() {
   return batteryVoltage;
 }
 
+// Compensation tables live in calibration_data.cpp (defaults in config.h,
+// optional SPIFFS override uploaded via /api/compensation)
 float HardwareManager::compensateVoltageDischarge(float measuredV) {
-  if(measuredV >= 28.5) return measuredV - 1.00;
-  else if(measuredV >= 27.0) return measuredV - 0; 
-  else if(measuredV >= 26.5) return measuredV - 0;
-  else if(measuredV >= 26.0) return measuredV - 0;   
-  else if(measuredV >= 25.5) return measuredV + 0.10;
-  else if(measuredV >= 25.2) return measuredV + 0.20;
-  else if(measuredV >= 25.0) return measuredV + 0.30;
-  else if(measuredV >= 24.8) return measuredV + 0.40;
-  else if(measuredV >= 24.5) return measuredV + 0.50;
-  else if(measuredV >= 24.0) return measuredV + 0.50;
-  else if(measuredV >= 23.5) return measuredV + 0;
-  else if(measuredV >= 23.0) return measuredV + 0;
-  else if(measuredV >= 22.5) return measuredV + 0;
-  else if(measuredV >= 22.0) return measuredV + 0;
-  else if(measuredV >= 21.5) return measuredV + 1.50;
-  else return measuredV;
+  portENTER_CRITICAL(&g_compLock);
+  float compensated = g_compDischarge.apply(measuredV);
+  portEXIT_CRITICAL(&g_compLock);
+  return compensated;
 }
 
 float HardwareManager::compensateVoltageCharge(float measuredV) {
-  if(measuredV >= 28.5) return measuredV - 1.00;
-  else if(measuredV >= 28.4) return measuredV - 0.95;
-  else if(measuredV >= 28.3) return measuredV - 0.90;
-  else if(measuredV >= 28.2) return measuredV - 0.85;
-  else if(measuredV >= 28.1) return measuredV - 0.80;
-  else if(measuredV >= 28.0) return measuredV - 0.75;
-  else if(measuredV >= 27.8) return measuredV - 0.70;
-  else if(measuredV >= 27.6) return measuredV - 0.60;
-  else if(measuredV >= 27.4) return measuredV - 0.50;
-  else if(measuredV >= 27.2) return measuredV - 0.40;
-  else if(measuredV >= 27.0) return measuredV - 0.30;
-  else if(measuredV >= 26.5) return measuredV - 0.25;
-  else if(measuredV >= 26.0) return measuredV + 0;
-  else if(measuredV >= 25.5) return measuredV + 0.40;
-  else if(measuredV >= 25.0) return measuredV + 0.50;
-  else if(measuredV >= 24.5) return measuredV + 0.60;
-  else if(measuredV >= 24.0) return measuredV + 0.70;
-  else if(measuredV >= 23.5) return measuredV + 0.80;
-  else if(measuredV >= 23.0) return measuredV + 1.00;
-  else if(measuredV >= 22.5) return measuredV + 1.00;
-  else if(measuredV >= 22.0) return measuredV + 1.00;
-  else if(measuredV >= 21.5) return measuredV + 1.00;
-  else if(measuredV >= 21.0) return measuredV + 1.00;
-  else return measuredV;
+  portENTER_CRITICAL(&g_compLock);
+  float compensated = g_compCharge.apply(measuredV);
+  portEXIT_CRITICAL(&g_compLock);
+  return compensated;
 }
 
+// SOC curves live in calibration_data.cpp (built-in "normal"/"charge" from
+// config.h, extra curves and the selection via /api/soc_curves)
 float HardwareManager::voltageToBatteryPercent(float voltage) {
-  const float (*curve)[2];
-  int points;
-  
-  if(currentState == STATE_CHARGING) {
-    curve = BATTERY_CURVE_CHARGE;
-    points = CURVE_CHARGE_POINTS;
-  } else {
-    curve = BATTERY_CURVE_NORMAL;
-    points = CURVE_NORMAL_POINTS;
-  }
-  
-  if(voltage <= curve[points-1][1]) return 0.0;
-  if(voltage >= curve[0][1]) return 100.0;
-  
-  for(int i = 0; i < points - 1; i++) {
-    float percentHigh = curve[i][0];
-    float voltageHigh = curve[i][1];
-    float percentLow = curve[i+1][0];
-    float voltageLow = curve[i+1][1];
-    
-    if(voltage >= voltageLow && voltage <= voltageHigh) {
-    return percentLow + (voltage - voltageLow) * 
-      (percentHigh - percentLow) / (voltageHigh - voltageLow);
-    }
-  }
-  return 0.0;
+  portENTER_CRITICAL(&g_socCurveLock);
+  float percent = g_socCurves->percentAt(currentState == STATE_CHARGING, voltage);
+  portEXIT_CRITICAL(&g_socCurveLock);
+  return constrain(percent, 0.0, 100.0);
 }
 
 BatteryState HardwareManager::detectState(float powerIN, float powerOUT) {
@@ -137,46 +86,14 @@ BatteryState HardwareManager::detectState(float powerIN, float powerOUT) {
   return STATE_REST;
 }
 
-void HardwareManager::sortArray(float arr[], int n) {
-  for(int i = 0; i < n-1; i++) {
-    for(int j = i+1; j < n; j++) {
-      if(arr[i] > arr[j]) {
-        float temp = arr[i];
-        arr[i] = arr[j];
-        arr[j] = temp;
-      }
-    }
-  }
-}
-
-float HardwareManager::getMedianSOC() {
-  int count = socBufferFull ? g_socBufferSize : socBufferIndex;
-  if(count == 0) return 0;
-  
-  float tempArray[SOC_BUFFER_SIZE];
-  for(int i = 0; i < count; i++) {
-    tempArray[i] = socBuffer[i];
+float HardwareManager::getStableSOC(float currentSOC) {
+  // A new window size from the settings restarts the window here, in the
+  // sensor task that owns it
+  int windowSize = constrain(g_socBufferSize, 1, SOC_BUFFER_SIZE_MAX);
+  if(socWindow.capacity() != windowSize) {
+    socWindow.reset(windowSize);
   }
   
-  sortArray(tempArray, count);
-  
-  if(count % 2 == 0) {
-    return (tempArray[count/2 - 1] + tempArray[count/2]) / 2.0;
-  } else {
-    return tempArray[count/2];
-  }
-}
-
-void HardwareManager::updateSOCBuffer(float newSOC) {
-  socBuffer[socBufferIndex] = newSOC;
-  socBufferIndex++;
-  if(socBufferIndex >= g_socBufferSize) {
-    socBufferIndex = 0;
-    socBufferFull = true;
-  }
-}
-
-float HardwareManager::getStableSOC(float currentSOC) {
   // In stato BYPASS, scarta variazioni sotto 90% (sono solo rumore)
   if(currentState == STATE_BYPASS && currentSOC < 90.0) {
     // Se displayedSOC è già >= 90%, mantienilo
@@ -187,14 +104,14 @@ float HardwareManager::getStableSOC(float currentSOC) {
     currentSOC = 90.0;
   }
   
-  updateSOCBuffer(currentSOC);
+  socWindow.push(currentSOC);
   
-  if(displayedSOC == 0 && socBufferIndex == 1) {
+  if(displayedSOC == 0 && socWindow.nextSlot() == 1) {
     displayedSOC = currentSOC;
     return displayedSOC;
   }
   
-  float medianSOC = getMedianSOC();
+  float medianSOC = socWindow.median();
   
   // In stato BYPASS, assicurati che medianSOC non scenda sotto 90%
   if(currentState == STATE_BYPASS && medianSOC < 90.0) {
@@ -207,15 +124,11 @@ float HardwareManager::getStableSOC(float currentSOC) {
   }
   
   if(abs(medianSOC - displayedSOC) > 3.0) {
-    int agreeCount = 0;
-    int count = socBufferFull ? g_socBufferSize : socBufferIndex;
-    
-    for(int i = 0; i < count; i++) {
-      if(medianSOC > displayedSOC) {
-        if(socBuffer[i] > displayedSOC + 1.0) agreeCount++;
-      } else {
-        if(socBuffer[i] < displayedSOC - 1.0) agreeCount++;
-      }
+    int agreeCount;
+    if(medianSOC > displayedSOC) {
+      agreeCount = socWindow.countAbove(displayedSOC + 1.0);
+    } else {
+      agreeCount = socWindow.countBelow(displayedSOC - 1.0);
     }
     
     if(agreeCount >= g_socChangeThreshold) {
@@ -228,46 +141,95 @@ float HardwareManager::getStableSOC(float currentSOC) {
   return displayedSOC;
 }
 
+float HardwareManager::updateFusedSOC(float voltageSOC, float batteryAmps, float batteryVoltage) {
+  unsigned long now = hal->nowMs();
+  
+  // Power station off: no usable voltage, start again from the curve once it is back
+  if(batteryVoltage < g_powerStationOffVoltage) {
+    socEstimator.reset();
+    return voltageSOC;
+  }
+  
+  float capacity = constrain(g_socCapacityAh, SOC_CAPACITY_AH_MIN, SOC_CAPACITY_AH_MAX);
+  if(socEstimator.getCapacity() != capacity) {
+    socEstimator.setCapacity(capacity);
+  }
+  
+  if(!socEstimator.isInitialized()) {
+    socEstimator.initialize(voltageSOC, SOC_INITIAL_VARIANCE);
+    lastSocUpdateTime = now;
+    restStartTime = now;
+    floatStartTime = now;
+    return socEstimator.getSoc();
+  }
+  
+  // Coulomb counting: every reading, so a load step shows up at once
+  unsigned long stepMs = now - lastSocUpdateTime;
+  if(stepMs > SOC_MAX_STEP_MS) stepMs = SOC_MAX_STEP_MS;
+  lastSocUpdateTime = now;
+  socEstimator.predict(batteryAmps, stepMs / 1000.0, SOC_PROCESS_NOISE);
+  
+  // Drift correction once the voltage has relaxed at REST
+  if(currentState != STATE_REST) {
+    restStartTime = now;
+  } else if(now - restStartTime >= SOC_REST_SETTLE_MS) {
+    socEstimator.correct(voltageSOC, SOC_VOLTAGE_NOISE);
+  }
+  
+  // BYPASS under a load almost never reaches REST: keep the floor of the
+  // voltage path, and once the IN surplus is gone the battery is floating
+  if(currentState != STATE_BYPASS || batteryAmps > 0) {
+    floatStartTime = now;
+  }
+  if(currentState == STATE_BYPASS) {
+    socEstimator.bypass(SOC_BYPASS_FLOOR, now - floatStartTime >= SOC_FLOAT_SETTLE_MS, SOC_VOLTAGE_NOISE);
+  }
+  
+  return socEstimator.getSoc();
+}
+
 void HardwareManager::initializePowerFilters(float powerIN, float powerOUT) {
-  if(!powerFilterInitialized) {
-    filteredPowerIN = powerIN;
-    filteredPowerOUT = powerOUT;
+  if(!powerFilterIn.isInitialized() || !powerFilterOut.isInitialized()) {
+    powerFilterIn.initialize(powerIN);
+    powerFilterOut.initialize(powerOUT);
     lastValidPowerIN = powerIN;
     lastValidPowerOUT = powerOUT;
-    powerFilterInitialized = true;
   }
 }
 
-float HardwareManager::filterPowerIN(float rawPowerIN) {
-  if(!powerFilterInitialized) {
-    filteredPowerIN = rawPowerIN;
-    return filteredPowerIN;
-  }
-  
-  // Usa g_powerFilterAlpha dinamico al posto della costante
-  filteredPowerIN = (g_powerFilterAlpha * rawPowerIN) + 
-                    ((1.0 - g_powerFilterAlpha) * filteredPowerIN);
+// The globals are written by other tasks, the sensor task only sees the
+// published copy (never torn) and reconfigures when it changes
+void HardwareManager::publishPowerFilterConfig() {
+  PowerFilterConfig config;
+  config.in = g_powerFilterIn;
+  config.out = g_powerFilterOut;
+  config.alpha = g_powerFilterAlpha;
+  powerFilterConfig.write(config);
+}
+
+void HardwareManager::updatePowerFilterConfig() {
+  uint32_t sequence = powerFilterConfig.getSequence();
+  if(sequence == powerFilterConfigSequence) return;
+  powerFilterConfigSequence = sequence;
   
-  return filteredPowerIN;
+  PowerFilterConfig config = powerFilterConfig.read();
+  powerFilterIn.configure(config.in, config.alpha);
+  powerFilterOut.configure(config.out, config.alpha);
+}
+
+float HardwareManager::filterPowerIN(float rawPowerIN) {
+  return powerFilterIn.update(rawPowerIN);
 }
 
 float HardwareManager::filterPowerOUT(float rawPowerOUT) {
-  if(!powerFilterInitialized) {
-    filteredPowerOUT = rawPowerOUT;
-    return filteredPowerOUT;
-  }
-  
-  // Usa g_powerFilterAlpha dinamico al posto della costante
-  filteredPowerOUT = (g_powerFilterAlpha * rawPowerOUT) + 
-                     ((1.0 - g_powerFilterAlpha) * filteredPowerOUT);
-  
-  return filteredPowerOUT;
+  return powerFilterOut.update(rawPowerOUT);
 }
 
 bool HardwareManager::validatePowerReadings(float powerIN, float powerOUT) {
   // Check if readings exceed maximum valid power
   if(powerIN > g_maxPowerReading || powerOUT > g_maxPowerReading) {
-    Serial.println("[HW] Power reading exceeds maximum (" + String(g_maxPowerReading, 0) + "W): IN=" + String(powerIN, 1) + "W, OUT=" + String(powerOUT, 1) + "W - DISCARDED");
+    LOG_WARNING("Hardware: Power reading exceeds maximum (%.0fW): IN=%.1fW, OUT=%.1fW - DISCARDED",
+                g_maxPowerReading, powerIN, powerOUT);
     return false;
   }
   
@@ -296,12 +258,19 @@ AdvancedSettings HardwareManager::getAdvancedSettings() {
   settings.socChangeThreshold = g_socChangeThreshold;
   settings.warmupDelay = g_warmupDelay;
   settings.maxPowerReading = g_maxPowerReading;
+  settings.rmsWindowCycles = g_rmsWindowCycles;
+  settings.socFusionEnabled = g_socFusionEnabled;
+  settings.socCapacityAh = g_socCapacityAh;
+  settings.powerFilterIn = g_powerFilterIn;
+  settings.powerFilterOut = g_powerFilterOut;
+  settings.harmonicAnalysisEnabled = g_harmonicAnalysisEnabled;
+  settings.lowPowerEnabled = g_lowPowerEnabled;
   settings.valid = true;
   return settings;
 }
 
 void HardwareManager::applyAdvancedSettings(const AdvancedSettings& settings) {
-  Serial.println("[HW] Applying advanced settings...");
+  LOG_DEBUG("Hardware: Applying advanced settings...");
   
   g_powerStationOffVoltage = settings.powerStationOffVoltage;
   g_powerThreshold = settings.powerThreshold;
@@ -314,20 +283,31 @@ void HardwareManager::applyAdvancedSettings(const AdvancedSettings& settings) {
   g_socChangeThreshold = settings.socChangeThreshold;
   g_warmupDelay = settings.warmupDelay;
   g_maxPowerReading = settings.maxPowerReading;
+  g_rmsWindowCycles = settings.rmsWindowCycles;
+  adcSampler.setWindowCycles(g_rmsWindowCycles);
+  g_socFusionEnabled = settings.socFusionEnabled;
+  g_socCapacityAh = settings.socCapacityAh;
+  g_powerFilterIn = settings.powerFilterIn;
+  g_powerFilterOut = settings.powerFilterOut;
+  g_harmonicAnalysisEnabled = settings.harmonicAnalysisEnabled;
+  g_lowPowerEnabled = settings.lowPowerEnabled;
+  publishPowerFilterConfig();
   
-  Serial.println("[HW] Advanced settings applied successfully");
-  Serial.println("     Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 1) + "V");
-  Serial.println("     Power Threshold: " + String(g_powerThreshold, 2) + "W");
-  Serial.println("     Power Filter Alpha: " + String(g_powerFilterAlpha, 2));
-  Serial.println("     Voltage Min Safe: " + String(g_voltageMinSafe, 2) + "V");
-  Serial.println("     Battery Low Warning: " + String(g_batteryLowWarning, 1) + "%");
-  Serial.println("     Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
-  Serial.println("     Warmup Delay: " + String(g_warmupDelay) + "ms");
-  Serial.println("     Max Power Reading: " + String(g_maxPowerReading, 1) + "W");
+  LOG_INFO("Hardware: Advanced settings applied successfully");
+  LOG_DEBUG("     Power Station OFF Voltage: %.1fV", g_powerStationOffVoltage);
+  LOG_DEBUG("     Power Threshold: %.2fW", g_powerThreshold);
+  LOG_DEBUG("     Power Filter Alpha: %.2f", g_powerFilterAlpha);
+  LOG_DEBUG("     Voltage Min Safe: %.2fV", g_voltageMinSafe);
+  LOG_DEBUG("     Battery Low Warning: %.1f%%", g_batteryLowWarning);
+  LOG_DEBUG("     Auto Power On Delay: %lums", (unsigned long)g_autoPowerOnDelay);
+  LOG_DEBUG("     Warmup Delay: %lums", (unsigned long)g_warmupDelay);
+  LOG_DEBUG("     Max Power Reading: %.1fW", g_maxPowerReading);
+  LOG_DEBUG("     RMS Window: %d cycles", g_rmsWindowCycles);
+  LOG_DEBUG("     SOC Fusion: %s (%.1fAh)", g_socFusionEnabled ? "ON" : "OFF", g_socCapacityAh);
 }
 
 void HardwareManager::saveAdvancedSettings() {
-  Serial.println("[HW] Saving advanced settings to SPIFFS...");
+  LOG_DEBUG("Hardware: Saving advanced settings to SPIFFS...");
   
   AdvancedSettings settings = getAdvancedSettings();
   saveAdvancedSettingsToSPIFFS(settings);
@@ -354,7 +334,7 @@ CalibrationData HardwareManager::getCalibrationData() {
 }
 
 void HardwareManager::applyCalibration(const CalibrationData& cal) {
-  Serial.println("[HW] Applying calibration...");
+  LOG_DEBUG("Hardware: Applying calibration...");
   
   g_sct013CalIn = cal.sct013CalIn;
   g_sct013OffsetIn = cal.sct013OffsetIn;
@@ -371,15 +351,15 @@ void HardwareManager::applyCalibration(const CalibrationData& cal) {
   sctMain.current(PIN_SCT013_MAIN, g_sct013CalIn);
   sctOutput.current(PIN_SCT013_OUTPUT, g_sct013CalOut);
   
-  Serial.println("[HW] Calibration applied successfully");
-  Serial.println("     SCT013 Cal In: " + String(g_sct013CalIn, 2));
-  Serial.println("     Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
-  Serial.println("     Fixed Voltage: " + String(g_fixedVoltage, 1) + "V");
-  Serial.println("     Mains Voltage: " + String(g_mainsVoltage, 1) + "V");
+  LOG_INFO("Hardware: Calibration applied successfully");
+  LOG_DEBUG("     SCT013 Cal In: %.2f", g_sct013CalIn);
+  LOG_DEBUG("     Voltage Offset Rest: %.2f", g_voltageOffsetRest);
+  LOG_DEBUG("     Fixed Voltage: %.1fV", g_fixedVoltage);
+  LOG_DEBUG("     Mains Voltage: %.1fV", g_mainsVoltage);
 }
 
 void HardwareManager::saveCalibration() {
-  Serial.println("[HW] Saving calibration to SPIFFS...");
+  LOG_DEBUG("Hardware: Saving calibration to SPIFFS...");
   
   CalibrationData cal = getCalibrationData();
   saveCalibrationToSPIFFS(cal);
@@ -0,0 +1,224 @@
+/*
+ * Harmonic Analyzer - Fundamental, odd harmonics, THD and crest factor of
+ * a clamp waveform. Plain C++ (no Arduino dependencies) so it can be
+ * compiled on a PC.
+ *
+ * A block of raw samples is copied in, trimmed to whole mains cycles and
+ * analysed with one Goertzel filter per harmonic (Hann window, so a slightly
+ * wrong mains frequency does not leak the fundamental into the harmonics).
+ * step() processes a bounded number of samples per call, so the analysis
+ * can be spread over many loop() iterations.
+ *
+ * There is no voltage waveform, only the clamp currents, so the real power
+ * and the displacement part of the power factor cannot be measured. The
+ * distortion power factor I1/Irms is the power factor of the load for a
+ * sinusoidal mains voltage and a resistive fundamental, and an upper bound
+ * otherwise.
+ */
+
+#ifndef HARMONIC_ANALYZER_H
+#define HARMONIC_ANALYZER_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define HARMONIC_COUNT  5               // Fundamental + 3rd, 5th, 7th, 9th
+
+struct HarmonicResult {
+  float fundamentalHz;                  // Frequency the bins were tuned to
+  float rms;                            // Total RMS (ADC counts, DC removed)
+  float harmonicRms[HARMONIC_COUNT];    // Per order, [0] = fundamental (ADC counts)
+  float thd;                            // % of the fundamental (odd harmonics up to the 9th)
+  float crestFactor;                    // Peak / RMS (1.41 for a sine)
+  float powerFactor;                    // Distortion power factor I1/Irms
+  uint32_t samples;                     // Samples analysed (whole cycles)
+  uint32_t sequence;                    // Incremented on every finished analysis
+  bool valid;                           // Enough signal for meaningful ratios
+};
+
+template <int N>
+class HarmonicAnalyzer {
+private:
+  enum Phase {
+    PHASE_IDLE,
+    PHASE_MEAN,
+    PHASE_GOERTZEL
+  };
+
+  uint16_t buffer[N];
+  uint32_t count;
+  uint32_t position;
+  Phase phase;
+
+  float rateHz;
+  float fundamentalHz;
+  float minRms;
+
+  // Pass 1: DC offset
+  double sum;
+  float mean;
+
+  // Pass 2: Goertzel states per harmonic, RMS and peak of the raw signal
+  float coeff[HARMONIC_COUNT];
+  float s1[HARMONIC_COUNT];
+  float s2[HARMONIC_COUNT];
+  double sumSquares;
+  float peak;
+
+  // Hann window by rotation: w[n] = 0.5 - 0.5 * cos(2*pi*n / (count - 1))
+  float windowCos;
+  float windowSin;
+  float windowStepCos;
+  float windowStepSin;
+
+  HarmonicResult current;
+
+  static int orderOf(int index) {
+    return 2 * index + 1;
+  }
+
+  void startGoertzel() {
+    mean = (float)(sum / count);
+    for (int h = 0; h < HARMONIC_COUNT; h++) {
+      coeff[h] = 2.0f * cosf(2.0f * (float)M_PI * fundamentalHz * orderOf(h) / rateHz);
+      s1[h] = 0;
+      s2[h] = 0;
+    }
+    sumSquares = 0;
+    peak = 0;
+    windowCos = 1;
+    windowSin = 0;
+    float step = 2.0f * (float)M_PI / (count - 1);
+    windowStepCos = cosf(step);
+    windowStepSin = sinf(step);
+    position = 0;
+    phase = PHASE_GOERTZEL;
+  }
+
+  void finish() {
+    float rms = (float)sqrt(sumSquares / count);
+    // Hann coherent gain is 0.5: peak amplitude = 2 * |X| / (0.5 * count)
+    float scale = 4.0f / count / (float)M_SQRT2;
+    for (int h = 0; h < HARMONIC_COUNT; h++) {
+      float power = s1[h] * s1[h] + s2[h] * s2[h] - coeff[h] * s1[h] * s2[h];
+      current.harmonicRms[h] = (power > 0 ? sqrtf(power) : 0) * scale;
+    }
+
+    float fundamental = current.harmonicRms[0];
+    float harmonicSquares = 0;
+    for (int h = 1; h < HARMONIC_COUNT; h++) {
+      harmonicSquares += current.harmonicRms[h] * current.harmonicRms[h];
+    }
+
+    current.fundamentalHz = fundamentalHz;
+    current.rms = rms;
+    current.samples = count;
+    current.valid = (rms >= minRms && fundamental > 0);
+    current.thd = current.valid ? sqrtf(harmonicSquares) / fundamental * 100.0f : 0;
+    current.crestFactor = rms > 0 ? peak / rms : 0;
+    current.powerFactor = current.valid ? fundamental / rms : 1.0f;
+    if (current.powerFactor > 1.0f) current.powerFactor = 1.0f;
+    current.sequence++;
+    phase = PHASE_IDLE;
+  }
+
+public:
+  HarmonicAnalyzer() : count(0), position(0), phase(PHASE_IDLE), rateHz(1), fundamentalHz(50),
+                       minRms(0), sum(0), mean(0), sumSquares(0), peak(0), windowCos(1), windowSin(0),
+                       windowStepCos(1), windowStepSin(0) {
+    for (int h = 0; h < HARMONIC_COUNT; h++) {
+      coeff[h] = 0;
+      s1[h] = 0;
+      s2[h] = 0;
+      current.harmonicRms[h] = 0;
+    }
+    current.fundamentalHz = 0;
+    current.rms = 0;
+    current.thd = 0;
+    current.crestFactor = 0;
+    current.powerFactor = 1.0f;
+    current.samples = 0;
+    current.sequence = 0;
+    current.valid = false;
+  }
+
+  // Copies the samples (oldest first) and keeps the newest whole mains
+  // cycles. minRmsCounts: below this the result is flagged invalid (idle
+  // clamp noise has no meaningful THD). False if not even one cycle fits
+  // or the 9th harmonic would be above Nyquist.
+  bool start(const uint16_t* samples, uint32_t sampleCount, float sampleRateHz, float mainsHz, float minRmsCounts) {
+    if (sampleRateHz <= 0 || mainsHz <= 0) return false;
+    if (orderOf(HARMONIC_COUNT - 1) * mainsHz >= sampleRateHz / 2) return false;
+    if (sampleCount > (uint32_t)N) sampleCount = N;
+
+    uint32_t cycles = (uint32_t)(sampleCount * mainsHz / sampleRateHz);
+    if (cycles < 1) return false;
+    uint32_t used = (uint32_t)(cycles * sampleRateHz / mainsHz + 0.5f);
+    if (used > sampleCount) used = sampleCount;
+    if (used < 2) return false;
+
+    const uint16_t* first = samples + (sampleCount - used);
+    for (uint32_t i = 0; i < used; i++) {
+      buffer[i] = first[i];
+    }
+    count = used;
+    rateHz = sampleRateHz;
+    fundamentalHz = mainsHz;
+    minRms = minRmsCounts;
+    sum = 0;
+    position = 0;
+    phase = PHASE_MEAN;
+    return true;
+  }
+
+  bool isBusy() const {
+    return phase != PHASE_IDLE;
+  }
+
+  // Processes up to maxSamples samples. Returns true when the analysis
+  // finished in this call (result() then holds the new values).
+  bool step(uint32_t maxSamples) {
+    if (phase == PHASE_MEAN) {
+      uint32_t end = position + maxSamples;
+      if (end > count) end = count;
+      for (; position < end; position++) {
+        sum += buffer[position];
+      }
+      if (position >= count) startGoertzel();
+      return false;
+    }
+
+    if (phase != PHASE_GOERTZEL) return false;
+
+    // Goertzel costs HARMONIC_COUNT multiply-adds per sample
+    uint32_t end = position + maxSamples;
+    if (end > count) end = count;
+    for (; position < end; position++) {
+      float x = buffer[position] - mean;
+      float absX = x < 0 ? -x : x;
+      if (absX > peak) peak = absX;
+      sumSquares += x * x;
+
+      float windowed = x * (0.5f - 0.5f * windowCos);
+      for (int h = 0; h < HARMONIC_COUNT; h++) {
+        float s0 = windowed + coeff[h] * s1[h] - s2[h];
+        s2[h] = s1[h];
+        s1[h] = s0;
+      }
+
+      float nextCos = windowCos * windowStepCos - windowSin * windowStepSin;
+      windowSin = windowSin * windowStepCos + windowCos * windowStepSin;
+      windowCos = nextCos;
+    }
+
+    if (position < count) return false;
+    finish();
+    return true;
+  }
+
+  const HarmonicResult& result() const {
+    return current;
+  }
+};
+
+#endif // HARMONIC_ANALYZER_H
@@ -5,10 +5,14 @@
 #include "http_client.h"
 #include "hardware_manager.h"
 #include "logger.h"
+#include "memory_telemetry.h"
+#include "json_arena.h"
 #include <SPIFFS.h>
 
 // External references
 extern HardwareManager hardware;
+extern MemoryTelemetry memTelemetry;
+extern JsonPool jsonPool;
 
 HTTPClientManager::HTTPClientManager() {
   initialized = false;
@@ -24,18 +28,18 @@ HTTPClientManager::HTTPClientManager() {
 }
 
 bool HTTPClientManager::begin() {
-  Serial.println("[HTTP] Initializing HTTP client...");
+  LogSerial.println("[HTTP] Initializing HTTP client...");
   
   loadConfig();
   
   if (!config.enabled || config.server.length() == 0) {
-    Serial.println("[HTTP] HTTP client disabled or not configured");
+    LogSerial.println("[HTTP] HTTP client disabled or not configured");
     return true;
   }
   
-  Serial.println("[HTTP] HTTP client configured");
-  Serial.println("  Server: " + config.server + ":" + String(config.port));
-  Serial.println("  Endpoint: " + config.endpoint);
+  LogSerial.println("[HTTP] HTTP client configured");
+  LogSerial.println("  Server: " + config.server + ":" + String(config.port));
+  LogSerial.println("  Endpoint: " + config.endpoint);
   
   initialized = true;
   return true;
@@ -51,14 +55,17 @@ void HTTPClientManager::loop() {
   }
 }
 
-void HTTPClientManager::publishData(const SensorData& sensorData, const EnergyData& energyData) {
+void HTTPClientManager::publishData(const TelemetryFrame& frame) {
   if (!initialized || !config.enabled) return;
+  const SensorData& sensorData = frame.sensor;
+  const EnergyData& energyData = frame.energy;
   
   // Check battery shutdown threshold
   checkBatteryShutdownThreshold(sensorData);
   
-  // Create JSON payload - increased size for safety
-  DynamicJsonDocument doc(1536);
+  // Create JSON payload
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["state"] = sensorData.batteryPercentage;
   
   JsonObject attributes = doc.createNestedObject("attributes");
@@ -76,14 +83,16 @@ void HTTPClientManager::publishData(const SensorData& sensorData, const EnergyDa
   attributes["peak_power"] = energyData.peakPower;
   attributes["operating_time"] = energyData.operatingTime;
   attributes["timestamp"] = sensorData.timestamp;
+  attributes["sequence"] = frame.sequence;
   
-  String payload;
-  size_t bytesWritten = serializeJson(doc, payload);
+  size_t length;
+  const char* payload = lease.serialize(length);
   
-  if (bytesWritten == 0 || payload.length() == 0) {
-    Serial.println("[HTTP] ERROR: Failed to serialize data JSON");
+  if (length == 0) {
+    LOG_ERROR("HTTP: Failed to serialize data JSON");
     return;
   }
+  memTelemetry.noteUse(MEM_USE_HTTP, length + 1);
   
   // Send to Home Assistant
   String url = "http://" + config.server + ":" + String(config.port) + config.endpoint;
@@ -93,16 +102,16 @@ void HTTPClientManager::publishData(const SensorData& sensorData, const EnergyDa
   http.addHeader("Content-Type", "application/json");
   http.addHeader("Authorization", "Bearer " + config.apiKey);
   
-  int httpCode = http.POST(payload);
+  int httpCode = http.POST((uint8_t*)payload, length);
   
   if (httpCode > 0) {
     if (httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_CREATED) {
-      Serial.println("[HTTP] Data published successfully");
+      LOG_INFO("HTTP: Data published successfully");
     } else {
-      Serial.println("[HTTP] Publish failed with code: " + String(httpCode));
+      LOG_ERROR("HTTP: Publish failed with code: %d", httpCode);
     }
   } else {
-    Serial.println("[HTTP] Connection failed: " + http.errorToString(httpCode));
+    LOG_ERROR("HTTP: Connection failed: %s", http.errorToString(httpCode).c_str());
   }
   
   http.end();
@@ -124,30 +133,30 @@ void HTTPClientManager::checkBatteryShutdownThreshold(const SensorData& sensorDa
     // Reset flag if battery is above threshold + 5% hysteresis
     if (sensorData.batteryPercentage > (g_httpShutdownThreshold + 5.0)) {
       g_httpShutdownSent = false;
-      Serial.println("[SHUTDOWN] Battery recovered, reset shutdown notification flag");
+      LOG_INFO("HTTP Shutdown: Battery recovered, reset shutdown notification flag");
     }
     return;
   }
   
   // Check if battery is below threshold
   if (sensorData.batteryPercentage <= g_httpShutdownThreshold) {
-    Serial.println("[SHUTDOWN] Battery below threshold (" + String(sensorData.batteryPercentage, 1) + "% <= " + String(g_httpShutdownThreshold, 1) + "%)");
+    LOG_WARNING("HTTP Shutdown: Battery below threshold (%.1f%% <= %.1f%%)", sensorData.batteryPercentage, g_httpShutdownThreshold);
     
-    if (sendShutdownNotification()) {
+    if (sendShutdownNotification(sensorData)) {
       g_httpShutdownSent = true;
-      Serial.println("[SHUTDOWN] Shutdown notification sent successfully");
+      LOG_INFO("HTTP Shutdown: Shutdown notification sent successfully");
     } else {
-      Serial.println("[SHUTDOWN] Failed to send shutdown notification");
+      LOG_ERROR("HTTP Shutdown: Failed to send shutdown notification");
     }
   }
 }
 
-bool HTTPClientManager::sendShutdownNotification() {
+bool HTTPClientManager::sendShutdownNotification(const SensorData& sensorData) {
   // Create JSON payload with password
   DynamicJsonDocument doc(512);
   doc["event"] = "battery_shutdown";
-  doc["battery_percentage"] = hardware.getSensorData().batteryPercentage;
-  doc["battery_voltage"] = hardware.getSensorData().batteryVoltage;
+  doc["battery_percentage"] = sensorData.batteryPercentage;
+  doc["battery_voltage"] = sensorData.batteryVoltage;
   doc["password"] = g_httpShutdownPassword;
   doc["timestamp"] = millis();
   doc["device"] = DEVICE_NAME;
@@ -158,8 +167,8 @@ bool HTTPClientManager::sendShutdownNotification() {
   // Send to configured shutdown server
   String url = "http://" + g_httpShutdownServer + ":" + String(g_httpShutdownPort) + "/shutdown";
   
-  Serial.println("[SHUTDOWN] Sending shutdown notification to: " + url);
-  Serial.println("[SHUTDOWN] Payload: " + payload);
+  LOG_INFO("HTTP Shutdown: Sending shutdown notification to: %s", url.c_str());
+  LOG_DEBUG("HTTP Shutdown: Payload: %s", payload.c_str());
   
   HTTPClient http;
   http.begin(url);
@@ -171,15 +180,15 @@ bool HTTPClientManager::sendShutdownNotification() {
   bool success = false;
   if (httpCode > 0) {
     if (httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_CREATED || httpCode == HTTP_CODE_ACCEPTED) {
-      Serial.println("[SHUTDOWN] Shutdown notification accepted (HTTP " + String(httpCode) + ")");
+      LOG_INFO("HTTP Shutdown: Shutdown notification accepted (HTTP %d)", httpCode);
       String response = http.getString();
-      Serial.println("[SHUTDOWN] Response: " + response);
+      LOG_DEBUG("HTTP Shutdown: Response: %s", response.c_str());
       success = true;
     } else {
-      Serial.println("[SHUTDOWN] Shutdown notification failed with HTTP code: " + String(httpCode));
+      LOG_ERROR("HTTP Shutdown: Shutdown notification failed with HTTP code: %d", httpCode);
     }
   } else {
-    Serial.println("[SHUTDOWN] Connection failed: " + http.errorToString(httpCode));
+    LOG_ERROR("HTTP Shutdown: Connection failed: %s", http.errorToString(httpCode).c_str());
   }
   
   http.end();
@@ -189,23 +198,23 @@ bool HTTPClientManager::sendShutdownNotification() {
 bool HTTPClientManager::executeCommand(const String& command, const String& value) {
   if (!initialized || !config.enabled) return false;
   
-  Serial.println("[HTTP] Executing command: " + command + " = " + value);
+  LOG_INFO("HTTP: Executing command: %s = %s", command.c_str(), value.c_str());
   
   // Map commands to button presses
   if (command == "usb") {
-    hardware.pressButton(BTN_USB, BUTTON_STANDARD_DURATION);
+    hardware.requestButtonPress(BTN_USB, BUTTON_STANDARD_DURATION);
     return true;
   } else if (command == "dc") {
-    hardware.pressButton(BTN_DC, BUTTON_STANDARD_DURATION);
+    hardware.requestButtonPress(BTN_DC, BUTTON_STANDARD_DURATION);
     return true;
   } else if (command == "ac") {
-    hardware.pressButton(BTN_AC, BUTTON_STANDARD_DURATION);
+    hardware.requestButtonPress(BTN_AC, BUTTON_STANDARD_DURATION);
     return true;
   } else if (command == "flashlight") {
-    hardware.pressButton(BTN_FLASHLIGHT, BUTTON_STANDARD_DURATION);
+    hardware.requestButtonPress(BTN_FLASHLIGHT, BUTTON_STANDARD_DURATION);
     return true;
   } else if (command == "power") {
-    hardware.pressButton(BTN_POWER, BUTTON_POWER_DURATION);
+    hardware.requestButtonPress(BTN_POWER, BUTTON_POWER_DURATION);
     return true;
   }
   
@@ -235,13 +244,13 @@ HTTPConfig HTTPClientManager::getConfig() {
 
 void HTTPClientManager::loadConfig() {
   if (!SPIFFS.exists("/ha_config.json")) {
-    Serial.println("[HTTP] No saved HTTP configuration found");
+    LOG_INFO("HTTP: No saved HTTP configuration found");
     return;
   }
   
   File file = SPIFFS.open("/ha_config.json", "r");
   if (!file) {
-    Serial.println("[HTTP] Failed to open HTTP config file");
+    LOG_ERROR("HTTP: Failed to open HTTP config file");
     return;
   }
   
@@ -250,7 +259,7 @@ void HTTPClientManager::loadConfig() {
   file.close();
   
   if (error) {
-    Serial.println("[HTTP] Failed to parse HTTP config file");
+    LOG_ERROR("HTTP: Failed to parse HTTP config file");
     return;
   }
   
@@ -264,7 +273,7 @@ void HTTPClientManager::loadConfig() {
     config.endpoint = "/api/states/sensor.oukitel_p800e";
   }
   
-  Serial.println("[HTTP] Loaded HTTP configuration");
+  LOG_INFO("HTTP: Loaded HTTP configuration");
 }
 
 void HTTPClientManager::saveConfig() {
@@ -277,12 +286,12 @@ void HTTPClientManager::saveConfig() {
   
   File file = SPIFFS.open("/ha_config.json", "w");
   if (!file) {
-    Serial.println("[HTTP] Failed to save HTTP configuration");
+    LOG_ERROR("HTTP: Failed to save HTTP configuration");
     return;
   }
   
   serializeJson(doc, file);
   file.close();
   
-  Serial.println("[HTTP] HTTP configuration saved");
+  LOG_INFO("HTTP: HTTP configuration saved");
 }
\ No newline at end of file
@@ -24,7 +24,7 @@ private:
   // Shutdown notification tracking
   bool shutdownNotificationSent;
   void checkBatteryShutdownThreshold(const SensorData& sensorData);
-  bool sendShutdownNotification();
+  bool sendShutdownNotification(const SensorData& sensorData);
 
 public:
   HTTPClientManager();
@@ -37,7 +37,7 @@ public:
   HTTPConfig getConfig();
   
   // Publishing methods
-  void publishData(const SensorData& sensorData, const EnergyData& energyData);
+  void publishData(const TelemetryFrame& frame);
   bool executeCommand(const String& command, const String& value);
 };
 
@@ -0,0 +1,299 @@
+/*
+ * JSON Arena - Pre-allocated buffers for the ArduinoJson documents, leased
+ * per request instead of a malloc/free of 0.5-4 KB per document.
+ * Plain C++ (ArduinoJson 7 allocator interface).
+ *
+ * A lease takes a free arena from the pool. The document allocates from it
+ * by bumping an offset (the last block can be freed or grown in place), and
+ * the arena is reset when the lease ends. What does not fit spills to the
+ * heap, and a lease made while every arena is taken uses the heap as before:
+ * both are counted, a document is never cut off.
+ *
+ *   JsonLease lease(jsonPool);
+ *   JsonDocument& doc = lease.doc();
+ *   doc["voltage"] = 26.4;
+ *   size_t length;
+ *   const char* text = lease.serialize(length);   // Valid until the lease ends
+ *
+ * A lease is used by one task; the pool can be shared by several tasks.
+ */
+
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <ArduinoJson.h>
+#include <atomic>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_ARENA_MAX  4
+
+// Documents without an arena (pool exhausted)
+class JsonHeapAllocator : public ArduinoJson::Allocator {
+public:
+  void* allocate(size_t size) override {
+    return malloc(size);
+  }
+
+  void deallocate(void* ptr) override {
+    free(ptr);
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    return realloc(ptr, newSize);
+  }
+
+  static JsonHeapAllocator* instance() {
+    static JsonHeapAllocator allocator;
+    return &allocator;
+  }
+};
+
+class JsonArena : public ArduinoJson::Allocator {
+private:
+  // Before every block: its size and the offset of the previous block
+  struct Header {
+    uint32_t size;
+    uint32_t prevOffset;
+  };
+  static const uint32_t NONE = 0xFFFFFFFF;
+
+  uint8_t* buf;
+  size_t size;
+  size_t used;
+  uint32_t lastOffset;        // Header of the last block, NONE when empty
+  size_t peak;
+  uint32_t spills;
+
+  static size_t blockBytes(size_t n) {
+    return sizeof(Header) + ((n + 7) & ~(size_t)7);
+  }
+
+  bool owns(const void* ptr) const {
+    return ptr >= buf && ptr < buf + size;
+  }
+
+  Header* headerOf(void* ptr) const {
+    return (Header*)((uint8_t*)ptr - sizeof(Header));
+  }
+
+public:
+  std::atomic<bool> leased;
+
+  JsonArena() : buf(nullptr), size(0), used(0), lastOffset(NONE), peak(0), spills(0), leased(false) {}
+
+  // storage: 8-byte aligned
+  void attach(uint8_t* storage, size_t bytes) {
+    buf = storage;
+    size = bytes;
+    reset();
+  }
+
+  void reset() {
+    used = 0;
+    lastOffset = NONE;
+  }
+
+  void* allocate(size_t n) override {
+    size_t need = blockBytes(n);
+    if (need > size - used) {
+      spills++;
+      return malloc(n);
+    }
+    Header* header = (Header*)(buf + used);
+    header->size = n;
+    header->prevOffset = lastOffset;
+    lastOffset = used;
+    used += need;
+    if (used > peak) peak = used;
+    return header + 1;
+  }
+
+  // Only the last block returns its space; the rest comes back with reset()
+  void deallocate(void* ptr) override {
+    if (ptr == nullptr) return;
+    if (!owns(ptr)) {
+      free(ptr);
+      return;
+    }
+    Header* header = headerOf(ptr);
+    uint32_t offset = (uint8_t*)header - buf;
+    if (offset == lastOffset) {
+      used = offset;
+      lastOffset = header->prevOffset;
+    }
+  }
+
+  void* reallocate(void* ptr, size_t n) override {
+    if (ptr == nullptr) return allocate(n);
+    if (!owns(ptr)) return realloc(ptr, n);
+
+    Header* header = headerOf(ptr);
+    uint32_t offset = (uint8_t*)header - buf;
+    if (offset == lastOffset && blockBytes(n) <= size - offset) {
+      header->size = n;
+      used = offset + blockBytes(n);
+      if (used > peak) peak = used;
+      return ptr;
+    }
+    if (n <= header->size) {
+      header->size = n;
+      return ptr;
+    }
+
+    void* moved = allocate(n);
+    if (moved == nullptr) return nullptr;
+    memcpy(moved, ptr, header->size);
+    deallocate(ptr);
+    return moved;
+  }
+
+  size_t getSize() const {
+    return size;
+  }
+
+  size_t getPeak() const {
+    return peak;
+  }
+
+  uint32_t getSpills() const {
+    return spills;
+  }
+};
+
+struct JsonPoolStats {
+  int arenas;
+  uint32_t arenaSize;
+  int inUse;
+  int maxInUse;
+  uint32_t leases;
+  uint32_t fallbacks;         // Leases that got no arena (heap document)
+  uint32_t spills;            // Allocations that did not fit their arena
+  uint32_t peakBytes;         // Most of one arena ever used
+};
+
+class JsonPool {
+private:
+  JsonArena arenas[JSON_ARENA_MAX];
+  int count;
+  std::atomic<int> inUse;
+  std::atomic<int> maxInUse;
+  std::atomic<uint32_t> leases;
+  std::atomic<uint32_t> fallbacks;
+
+public:
+  // storage: count * arenaSize bytes, 8-byte aligned
+  JsonPool(uint8_t* storage, int arenaCount, size_t arenaSize)
+    : count(arenaCount < JSON_ARENA_MAX ? arenaCount : JSON_ARENA_MAX),
+      inUse(0), maxInUse(0), leases(0), fallbacks(0) {
+    size_t bytes = arenaSize & ~(size_t)7;
+    for (int i = 0; i < count; i++) {
+      arenas[i].attach(storage + i * bytes, bytes);
+    }
+  }
+
+  // nullptr when every arena is leased
+  JsonArena* acquire() {
+    leases++;
+    for (int i = 0; i < count; i++) {
+      bool expected = false;
+      if (arenas[i].leased.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        int now = ++inUse;
+        int max = maxInUse.load();
+        while (now > max && !maxInUse.compare_exchange_weak(max, now)) {}
+        return &arenas[i];
+      }
+    }
+    fallbacks++;
+    return nullptr;
+  }
+
+  void release(JsonArena* arena) {
+    if (arena == nullptr) return;
+    arena->reset();
+    inUse--;
+    arena->leased.store(false, std::memory_order_release);
+  }
+
+  JsonPoolStats getStats() const {
+    JsonPoolStats stats;
+    stats.arenas = count;
+    stats.arenaSize = count > 0 ? arenas[0].getSize() : 0;
+    stats.inUse = inUse.load();
+    stats.maxInUse = maxInUse.load();
+    stats.leases = leases.load();
+    stats.fallbacks = fallbacks.load();
+    stats.spills = 0;
+    stats.peakBytes = 0;
+    for (int i = 0; i < count; i++) {
+      stats.spills += arenas[i].getSpills();
+      if (arenas[i].getPeak() > stats.peakBytes) stats.peakBytes = arenas[i].getPeak();
+    }
+    return stats;
+  }
+};
+
+// A document on a leased arena (or the heap when none is free)
+class JsonLease {
+private:
+  // Declared before the document: the arena goes back after the document
+  // has freed its memory
+  struct Claim {
+    JsonPool& pool;
+    JsonArena* arena;
+    explicit Claim(JsonPool& owner) : pool(owner), arena(owner.acquire()) {}
+    ~Claim() { pool.release(arena); }
+  };
+
+  Claim claim;
+  ArduinoJson::Allocator* allocator;
+  JsonDocument document;
+  char* text;
+
+  JsonLease(const JsonLease&);
+  JsonLease& operator=(const JsonLease&);
+
+public:
+  explicit JsonLease(JsonPool& pool)
+    : claim(pool),
+      allocator(claim.arena ? (ArduinoJson::Allocator*)claim.arena : JsonHeapAllocator::instance()),
+      document(allocator),
+      text(nullptr) {}
+
+  ~JsonLease() {
+    allocator->deallocate(text);
+  }
+
+  JsonDocument& doc() {
+    return document;
+  }
+
+  // An empty document on the same arena, for the next message
+  JsonDocument& next() {
+    allocator->deallocate(text);
+    text = nullptr;
+    document.clear();
+    if (claim.arena) claim.arena->reset();
+    return document;
+  }
+
+  // JSON text of the document, on the arena. Empty when out of memory.
+  const char* serialize(size_t& length) {
+    allocator->deallocate(text);
+    length = measureJson(document);
+    text = (char*)allocator->allocate(length + 1);
+    if (text == nullptr) {
+      length = 0;
+      return "";
+    }
+    serializeJson(document, text, length + 1);
+    return text;
+  }
+
+  bool hasArena() const {
+    return claim.arena != nullptr;
+  }
+};
+
+#endif // JSON_ARENA_H
@@ -0,0 +1,162 @@
+/*
+ * Log Ring - Byte ring holding the last log text, in storage that can
+ * survive a reset (RTC_NOINIT on the ESP32). Plain C++: the caller
+ * provides the storage and the locking.
+ *
+ * Positions count the bytes written since the ring was cleared (32-bit,
+ * differences stay valid when they wrap). A write is at most two memcpy,
+ * the oldest text is overwritten. A reader whose position fell behind the
+ * oldest byte still held continues there and is told how much it lost.
+ *
+ *   uint32_t pos = ring.lineStart(ring.getHead() - 1024);
+ *   size_t n = ring.read(pos, out, sizeof(out), &lost);
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOG_RING_MAGIC  0x4C4F4731   // "LOG1"
+
+// Kept with the text: a reset finds it valid only if check still matches
+struct LogRingHeader {
+  uint32_t magic;
+  uint32_t size;
+  uint32_t head;              // Next byte written
+  uint32_t tail;              // Oldest byte held
+  uint32_t drained;           // Next byte for the serial port
+  uint32_t check;
+};
+
+class LogRing {
+private:
+  LogRingHeader* header;
+  char* data;
+  uint32_t mask;
+
+  uint32_t checksum() const {
+    return header->magic ^ header->size ^ header->head ^ header->tail ^ header->drained ^ 0xA5A5A5A5;
+  }
+
+  void seal() {
+    header->check = checksum();
+  }
+
+  static bool before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+  }
+
+public:
+  LogRing() : header(nullptr), data(nullptr), mask(0) {}
+
+  // size: power of two. Returns true when the storage still held a valid
+  // log (warm reset), false when it was cleared.
+  bool attach(LogRingHeader* storageHeader, char* storage, uint32_t size) {
+    header = storageHeader;
+    data = storage;
+    mask = size - 1;
+
+    bool valid = header->magic == LOG_RING_MAGIC && header->size == size &&
+                 header->check == checksum() &&
+                 header->head - header->tail <= size &&
+                 !before(header->drained, header->tail) && !before(header->head, header->drained);
+    if (!valid) {
+      header->magic = LOG_RING_MAGIC;
+      header->size = size;
+      clear();
+    }
+    return valid;
+  }
+
+  bool isAttached() const {
+    return header != nullptr;
+  }
+
+  void clear() {
+    header->head = 0;
+    header->tail = 0;
+    header->drained = 0;
+    seal();
+  }
+
+  void write(const char* text, size_t n) {
+    uint32_t size = mask + 1;
+    if (n > size) {
+      text += n - size;
+      n = size;
+    }
+    uint32_t at = header->head & mask;
+    size_t first = size - at;
+    if (first > n) first = n;
+    memcpy(data + at, text, first);
+    memcpy(data, text + first, n - first);
+
+    header->head += n;
+    if (header->head - header->tail > size) header->tail = header->head - size;
+    if (before(header->drained, header->tail)) header->drained = header->tail;
+    seal();
+  }
+
+  // Copies up to max bytes from pos and moves pos past them. lost: bytes
+  // overwritten before pos got to them.
+  size_t read(uint32_t& pos, char* out, size_t max, uint32_t* lost = nullptr) const {
+    uint32_t skipped = 0;
+    if (before(pos, header->tail)) {
+      skipped = header->tail - pos;
+      pos = header->tail;
+    }
+    if (before(header->head, pos)) pos = header->head;
+    if (lost) *lost = skipped;
+
+    uint32_t available = header->head - pos;
+    size_t n = available < max ? available : max;
+    uint32_t at = pos & mask;
+    size_t first = (mask + 1) - at;
+    if (first > n) first = n;
+    memcpy(out, data + at, first);
+    memcpy(out + first, data, n - first);
+    pos += n;
+    return n;
+  }
+
+  // First line start at or after pos (within maxScan bytes, else pos)
+  uint32_t lineStart(uint32_t pos, uint32_t maxScan = 256) const {
+    if (before(pos, header->tail)) pos = header->tail;
+    if (before(header->head, pos)) return header->head;
+    // The text starts with a line until it is first overwritten
+    if (pos == header->tail && header->head - header->tail < mask + 1) return pos;
+    if (pos != header->tail && data[(pos - 1) & mask] == '\n') return pos;
+    for (uint32_t p = pos; p != header->head && p - pos < maxScan; p++) {
+      if (data[p & mask] == '\n') return p + 1;
+    }
+    return pos;
+  }
+
+  uint32_t getHead() const {
+    return header->head;
+  }
+
+  uint32_t getTail() const {
+    return header->tail;
+  }
+
+  uint32_t getDrained() const {
+    return header->drained;
+  }
+
+  void setDrained(uint32_t pos) {
+    if (before(pos, header->tail)) pos = header->tail;
+    if (before(header->head, pos)) pos = header->head;
+    header->drained = pos;
+    seal();
+  }
+
+  uint32_t getSize() const {
+    return mask + 1;
+  }
+};
+
+#endif // LOG_RING_H
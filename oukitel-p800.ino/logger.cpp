@@ -3,8 +3,191 @@
  */
 
 #include "logger.h"
+#include "log_ring.h"
+#include <stdarg.h>
+#include <esp_system.h>
+#include <esp_attr.h>
 
-String getLogLevelName(int level) {
+// Not cleared by a reset; LogRing::attach() checks it is still valid
+static RTC_NOINIT_ATTR LogRingHeader ringHeader;
+static RTC_NOINIT_ATTR char ringData[LOG_RING_SIZE];
+
+static LogRing ring;
+static portMUX_TYPE ringLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drainTaskHandle = nullptr;
+static bool ringKept = false;
+
+static volatile uint32_t linesWritten = 0;
+static volatile uint32_t bytesLost = 0;
+
+LogPrint LogSerial;
+
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:  return "power on";
+    case ESP_RST_EXT:      return "external";
+    case ESP_RST_SW:       return "software";
+    case ESP_RST_PANIC:    return "panic";
+    case ESP_RST_INT_WDT:  return "interrupt watchdog";
+    case ESP_RST_TASK_WDT: return "task watchdog";
+    case ESP_RST_WDT:      return "watchdog";
+    case ESP_RST_BROWNOUT: return "brownout";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    default:               return "unknown";
+  }
+}
+
+
+// Sends the ring to the serial port. Blocks on the UART itself, nobody waits on it.
+static void logDrainTask(void* arg) {
+  char chunk[256];
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    for (;;) {
+      // The copy is taken, so the bytes count as drained (lost ones too,
+      // or they would be reported again on the next pass)
+      uint32_t lost;
+      portENTER_CRITICAL(&ringLock);
+      uint32_t pos = ring.getDrained();
+      size_t n = ring.read(pos, chunk, sizeof(chunk), &lost);
+      ring.setDrained(pos);
+      portEXIT_CRITICAL(&ringLock);
+
+      if (lost > 0) {
+        bytesLost += lost;
+        char note[64];
+        int length = snprintf(note, sizeof(note), "\r\n[LOG] %lu bytes lost (serial too slow)\r\n",
+                              (unsigned long)lost);
+        Serial.write((const uint8_t*)note, length);
+      }
+      if (n == 0) break;
+
+      Serial.write((const uint8_t*)chunk, n);
+    }
+  }
+}
+
+
+void logBegin() {
+  if (ring.isAttached()) return;
+
+  portENTER_CRITICAL(&ringLock);
+  ringKept = ring.attach(&ringHeader, ringData, LOG_RING_SIZE);
+  portEXIT_CRITICAL(&ringLock);
+
+  if (xTaskCreatePinnedToCore(logDrainTask, "logDrain", LOG_TASK_STACK, nullptr,
+                              LOG_TASK_PRIORITY, &drainTaskHandle, LOG_TASK_CORE) != pdPASS) {
+    drainTaskHandle = nullptr;
+    Serial.println("[LOG] Drain task creation failed, log is kept in RAM only");
+  }
+
+  char line[96];
+  int length = snprintf(line, sizeof(line), "\r\n[LOG] ----- restart (%s reset)%s -----\r\n",
+                        resetReasonName(esp_reset_reason()), ringKept ? ", log before it kept" : "");
+  logRaw(line, length);
+}
+
+
+void logRaw(const char* text, size_t length) {
+  if (!ring.isAttached()) {
+    Serial.write((const uint8_t*)text, length);
+    return;
+  }
+
+  portENTER_CRITICAL(&ringLock);
+  ring.write(text, length);
+  portEXIT_CRITICAL(&ringLock);
+
+  if (drainTaskHandle != nullptr) {
+    xTaskNotifyGive(drainTaskHandle);
+  }
+}
+
+
+void logWrite(int level, const char* format, ...) {
+  char line[LOG_LINE_MAX];
+
+  int length = snprintf(line, sizeof(line), "[%s] ", logLevelTag(level));
+  va_list args;
+  va_start(args, format);
+  int body = vsnprintf(line + length, sizeof(line) - length, format, args);
+  va_end(args);
+  if (body < 0) body = 0;
+
+  // Cut to fit, keeping room for CRLF
+  length += body;
+  if (length > (int)sizeof(line) - 3) length = sizeof(line) - 3;
+  line[length++] = '\r';
+  line[length++] = '\n';
+  line[length] = '\0';
+  logRaw(line, length);
+  linesWritten++;
+}
+
+
+uint32_t logHead() {
+  if (!ring.isAttached()) return 0;
+  portENTER_CRITICAL(&ringLock);
+  uint32_t head = ring.getHead();
+  portEXIT_CRITICAL(&ringLock);
+  return head;
+}
+
+
+uint32_t logTailStart(size_t bytes) {
+  if (!ring.isAttached()) return 0;
+  portENTER_CRITICAL(&ringLock);
+  uint32_t pos = ring.lineStart(ring.getHead() - (uint32_t)bytes);
+  portEXIT_CRITICAL(&ringLock);
+  return pos;
+}
+
+
+size_t logRead(uint32_t& pos, char* out, size_t max, uint32_t* lost) {
+  if (!ring.isAttached()) {
+    if (lost) *lost = 0;
+    return 0;
+  }
+  portENTER_CRITICAL(&ringLock);
+  size_t n = ring.read(pos, out, max, lost);
+  portEXIT_CRITICAL(&ringLock);
+  return n;
+}
+
+
+LogStats getLogStats() {
+  LogStats stats;
+  stats.written = linesWritten;
+  stats.lostBytes = bytesLost;
+  stats.ringSize = LOG_RING_SIZE;
+  stats.kept = ringKept;
+  stats.buffered = 0;
+  if (ring.isAttached()) {
+    portENTER_CRITICAL(&ringLock);
+    stats.buffered = ring.getHead() - ring.getDrained();
+    portEXIT_CRITICAL(&ringLock);
+  }
+  return stats;
+}
+
+
+size_t LogPrint::write(uint8_t c) {
+  char text = (char)c;
+  logRaw(&text, 1);
+  return 1;
+}
+
+
+size_t LogPrint::write(const uint8_t* buffer, size_t size) {
+  logRaw((const char*)buffer, size);
+  return size;
+}
+
+
+const char* logLevelTag(int level) {
   switch (level) {
     case LOG_LEVEL_DEBUG:   return "DEBUG";
     case LOG_LEVEL_INFO:     return "INFO";
@@ -15,3 +198,7 @@ String getLogLevelName(int level) {
   }
 }
 
+
+String getLogLevelName(int level) {
+  return String(logLevelTag(level));
+}
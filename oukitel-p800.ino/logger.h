@@ -1,6 +1,16 @@
 /*
  * Logger Implementation with Log Levels
  * Provides DEBUG, INFO, WARNING, ERROR log levels
+ *
+ * printf-style: LOG_INFO("Hardware: Sensor task started on core %d", core).
+ * The line is formatted on the stack, no String is built. A level below
+ * LOG_COMPILE_LEVEL compiles to nothing (arguments are not evaluated), a
+ * level below the runtime g_logLevel costs one comparison.
+ *
+ * Output never blocks: the text is copied into the log ring (RTC memory)
+ * and a low-priority task sends it to the serial port. Dumps without a
+ * level (diagnostics, calibration, boot) print to LogSerial, which takes
+ * the same path. The ring is also read by /api/logs and the WebSocket tail.
  */
 
 #ifndef LOGGER_H
@@ -12,14 +22,52 @@
 // External log level variable (defined in calibration_data.cpp)
 extern int g_logLevel;
 
+#define LOG_ENABLED(level) (LOG_COMPILE_LEVEL <= (level) && g_logLevel <= (level))
+
 // Log level checking macros
-#define LOG_DEBUG(msg)   if (g_logLevel <= LOG_LEVEL_DEBUG) { Serial.println("[DEBUG] " + String(msg)); }
-#define LOG_INFO(msg)    if (g_logLevel <= LOG_LEVEL_INFO) { Serial.println("[INFO] " + String(msg)); }
-#define LOG_WARNING(msg) if (g_logLevel <= LOG_LEVEL_WARNING) { Serial.println("[WARNING] " + String(msg)); }
-#define LOG_ERROR(msg)   if (g_logLevel <= LOG_LEVEL_ERROR) { Serial.println("[ERROR] " + String(msg)); }
+#define LOG_AT(level, ...) do { if (LOG_ENABLED(level)) logWrite((level), __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...)   LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+struct LogStats {
+  uint32_t written;             // Lines
+  uint32_t lostBytes;           // Overwritten before the serial port got them
+  uint32_t ringSize;
+  uint32_t buffered;            // Waiting for the serial port
+  bool kept;                    // The log from before the last reset was kept
+};
+
+// Attaches the ring and starts the drain task (first thing in setup(),
+// until then the text goes straight to Serial)
+void logBegin();
+
+// Formats "[LEVEL] message" and hands it to the ring; use the macros
+void logWrite(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+// Text as is (no level, no line end), constant time
+void logRaw(const char* text, size_t length);
+
+// Ring readers. Positions count bytes; logRead() moves pos past the bytes
+// copied, lost reports the ones overwritten before pos got to them.
+uint32_t logHead();
+uint32_t logTailStart(size_t bytes);      // Line start about bytes before the head
+size_t logRead(uint32_t& pos, char* out, size_t max, uint32_t* lost = nullptr);
+
+LogStats getLogStats();
 
 // Helper function to get log level name
 String getLogLevelName(int level);
+const char* logLevelTag(int level);
 
-#endif
+// Print on the log ring, for the dumps that used Serial.print()
+class LogPrint : public Print {
+public:
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+};
 
+extern LogPrint LogSerial;
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Loop Profiler - CPU cycle timing of the main firmware stages (sensor read,
+ * energy update, web/NUT/MQTT handling, publishing, data log).
+ * Plain C++: on the ESP32 the CPU cycle counter is read directly, on a PC a
+ * nanosecond clock stands in for it (1000 "MHz").
+ *
+ * Every stage keeps min, max, mean and a log-spaced histogram of its run
+ * time. A record is two cycle counter reads, a division and a few adds, so
+ * the profiler stays enabled in production.
+ *
+ * The cycle counter is per core and wraps after ~17 s at 240 MHz: a stage
+ * is always started and ended by the same (pinned) task, and each stage is
+ * written by one task only. A reset from another task is a request that the
+ * writer carries out on its next record.
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stdint.h>
+#include "task_scheduler.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_cpu.h>
+inline uint32_t perfCycleCount() {
+  return (uint32_t)esp_cpu_get_cycle_count();
+}
+#else
+#include <chrono>
+inline uint32_t perfCycleCount() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+enum PerfStage {
+  PERF_STAGE_READ_SENSORS = 0,    // Sensor task
+  PERF_STAGE_ENERGY_UPDATE = 1,   // Main loop
+  PERF_STAGE_HANDLE_CLIENT = 2,   // Network task: web server + WebSocket
+  PERF_STAGE_HANDLE_CLIENTS = 3,  // Network task: NUT
+  PERF_STAGE_MQTT_LOOP = 4,       // Network task
+  PERF_STAGE_PUBLISH = 5,         // Network task: MQTT and HTTP publishData()
+  PERF_STAGE_LOG_DATA = 6,        // Main loop
+  PERF_STAGE_COUNT
+};
+
+inline const char* perfStageName(int stage) {
+  switch (stage) {
+    case PERF_STAGE_READ_SENSORS:   return "readSensors";
+    case PERF_STAGE_ENERGY_UPDATE:  return "energyUpdate";
+    case PERF_STAGE_HANDLE_CLIENT:  return "handleClient";
+    case PERF_STAGE_HANDLE_CLIENTS: return "handleClients";
+    case PERF_STAGE_MQTT_LOOP:      return "mqttLoop";
+    case PERF_STAGE_PUBLISH:        return "publishData";
+    case PERF_STAGE_LOG_DATA:       return "logData";
+    default:                        return "unknown";
+  }
+}
+
+struct PerfStageStats {
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  LatencyHistogram histogram;     // Microseconds
+  volatile bool resetRequested;
+};
+
+class LoopProfiler {
+private:
+  PerfStageStats stages[PERF_STAGE_COUNT];
+  uint32_t cyclesPerUs;
+
+  static void clear(PerfStageStats& stats) {
+    stats.count = 0;
+    stats.minCycles = 0;
+    stats.maxCycles = 0;
+    stats.totalCycles = 0;
+    stats.histogram.reset();
+  }
+
+public:
+  explicit LoopProfiler(uint32_t cpuMhz = 240) : cyclesPerUs(cpuMhz > 0 ? cpuMhz : 1) {
+    for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+      clear(stages[i]);
+      stages[i].resetRequested = false;
+    }
+  }
+
+  // The CPU clock the cycle counts are converted with
+  void setCpuMhz(uint32_t cpuMhz) {
+    cyclesPerUs = cpuMhz > 0 ? cpuMhz : 1;
+  }
+
+  uint32_t getCpuMhz() const {
+    return cyclesPerUs;
+  }
+
+  void record(int stage, uint32_t cycles) {
+    if (stage < 0 || stage >= PERF_STAGE_COUNT) return;
+    PerfStageStats& stats = stages[stage];
+    if (stats.resetRequested) {
+      clear(stats);
+      stats.resetRequested = false;
+    }
+    if (stats.count == 0 || cycles < stats.minCycles) stats.minCycles = cycles;
+    if (cycles > stats.maxCycles) stats.maxCycles = cycles;
+    stats.totalCycles += cycles;
+    stats.count++;
+    stats.histogram.add(cycles / cyclesPerUs);
+  }
+
+  // Safe from any task
+  void requestReset() {
+    for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+      stages[i].resetRequested = true;
+    }
+  }
+
+  const PerfStageStats& getStage(int stage) const {
+    return stages[stage];
+  }
+
+  float toUs(uint64_t cycles) const {
+    return (float)cycles / cyclesPerUs;
+  }
+
+  float getMeanUs(int stage) const {
+    const PerfStageStats& stats = stages[stage];
+    return stats.count > 0 ? toUs(stats.totalCycles) / stats.count : 0;
+  }
+};
+
+// Times the enclosing block as one run of a stage
+class PerfScope {
+private:
+  LoopProfiler& profiler;
+  int stage;
+  uint32_t startCycles;
+
+public:
+  PerfScope(LoopProfiler& owner, int measuredStage)
+    : profiler(owner), stage(measuredStage), startCycles(perfCycleCount()) {}
+
+  ~PerfScope() {
+    profiler.record(stage, perfCycleCount() - startCycles);
+  }
+};
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,132 @@
+/*
+ * Mains Loss Detector - Sub-cycle outage detection on the IN clamp
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * Fed with every offset-free IN and OUT sample. A sample counts as
+ * activity when it exceeds the threshold, which a loaded clamp does near
+ * every half-cycle peak. Once IN has been active for restore half-cycles
+ * the detector is armed. If IN then stays silent for loss half-cycles
+ * while OUT still carries current, the supply was lost (the same IN/OUT
+ * rule as detectState(), a whole RMS window earlier). If both go silent
+ * the load was switched off, which is not an outage.
+ *
+ * A loss is cleared by IN activity for restore half-cycles, by OUT going
+ * silent for loss half-cycles as well (nothing left to tell an outage
+ * from an idle load), or by clear() when the slow path disagrees.
+ */
+
+#ifndef MAINS_LOSS_H
+#define MAINS_LOSS_H
+
+#include <stdint.h>
+
+enum MainsLossEvent {
+  MAINS_EVENT_NONE = 0,
+  MAINS_EVENT_LOST,
+  MAINS_EVENT_RESTORED
+};
+
+class MainsLossDetector {
+private:
+  int32_t threshold;          // |sample| above this is activity (same units as the input)
+  uint32_t lossSamples;       // IN silence that means an outage
+  uint32_t restoreSamples;    // IN activity needed to arm / to report a restore
+  uint32_t halfCycleSamples;
+  uint32_t inSilent;          // IN samples since the last active one
+  uint32_t outSilent;
+  uint32_t inActiveRun;       // IN samples since activity resumed (gaps < half-cycle)
+  bool armed;
+  bool lost;
+
+public:
+  MainsLossDetector()
+    : threshold(0), lossSamples(1), restoreSamples(1), halfCycleSamples(1),
+      inSilent(0), outSilent(0), inActiveRun(0), armed(false), lost(false) {}
+
+  // halfCycle: samples per mains half-cycle on one channel
+  void configure(int32_t activityThreshold, uint32_t halfCycle, int lossHalfCycles, int restoreHalfCycles) {
+    if (halfCycle < 1) halfCycle = 1;
+    threshold = activityThreshold;
+    halfCycleSamples = halfCycle;
+    lossSamples = halfCycle * lossHalfCycles;
+    restoreSamples = halfCycle * restoreHalfCycles;
+  }
+
+  void reset() {
+    inSilent = 0;
+    outSilent = 0;
+    inActiveRun = 0;
+    armed = false;
+    lost = false;
+  }
+
+  void updateOut(int32_t sample) {
+    if (sample > threshold || sample < -threshold) outSilent = 0;
+    else if (outSilent < 0xFFFFFFFF) outSilent++;
+  }
+
+  MainsLossEvent updateIn(int32_t sample) {
+    if (sample > threshold || sample < -threshold) {
+      // Gaps shorter than a half-cycle are just the zero crossings
+      inActiveRun = (inSilent <= halfCycleSamples) ? inActiveRun + inSilent + 1 : 1;
+      inSilent = 0;
+    } else if (inSilent < 0xFFFFFFFF) {
+      inSilent++;
+    }
+
+    if (lost) {
+      if (inActiveRun >= restoreSamples) {
+        lost = false;
+        armed = true;
+        return MAINS_EVENT_RESTORED;
+      }
+      if (outSilent >= lossSamples) {
+        // Re-armed by IN activity, as after reset()
+        lost = false;
+        inActiveRun = 0;
+        return MAINS_EVENT_RESTORED;
+      }
+      return MAINS_EVENT_NONE;
+    }
+
+    if (!armed) {
+      armed = (inSilent == 0 && inActiveRun >= restoreSamples);
+      return MAINS_EVENT_NONE;
+    }
+
+    if (inSilent >= lossSamples) {
+      armed = false;
+      inActiveRun = 0;
+      if (outSilent < lossSamples) {
+        lost = true;
+        return MAINS_EVENT_LOST;
+      }
+    }
+    return MAINS_EVENT_NONE;
+  }
+
+  // Drops a reported loss (re-armed by IN activity). Returns true if one was
+  // reported, the caller then owes a RESTORED.
+  bool clear() {
+    if (!lost) return false;
+    lost = false;
+    armed = false;
+    inActiveRun = 0;
+    return true;
+  }
+
+  // IN samples since the last active one (outage onset when LOST fires)
+  uint32_t silentSamples() const {
+    return inSilent;
+  }
+
+  bool isArmed() const {
+    return armed;
+  }
+
+  bool isLost() const {
+    return lost;
+  }
+};
+
+#endif // MAINS_LOSS_H
@@ -0,0 +1,131 @@
+/*
+ * Memory Telemetry Implementation
+ */
+
+#include "memory_telemetry.h"
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+// Per-core allocation counters, incremented inside the allocator
+static volatile uint32_t allocCount[portNUM_PROCESSORS];
+static volatile uint32_t failedAllocCount = 0;
+static volatile uint32_t lastFailedAllocSize = 0;
+
+#if defined(CONFIG_HEAP_USE_HOOKS) && CONFIG_HEAP_USE_HOOKS
+static const bool ALLOC_COUNTING = true;
+
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  // Only this core writes its counter; an ISR allocation may rarely be lost
+  allocCount[xPortGetCoreID()]++;
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void* ptr) {
+}
+#else
+static const bool ALLOC_COUNTING = false;
+#endif
+
+static void onAllocFailed(size_t size, uint32_t caps, const char* functionName) {
+  failedAllocCount++;
+  lastFailedAllocSize = size;
+}
+
+
+MemoryTelemetry::MemoryTelemetry() {
+  for (int i = 0; i < MEM_USE_COUNT; i++) {
+    highWater[i] = 0;
+  }
+  loopIterations = 0;
+  netIterations = 0;
+  loopCore = 1;
+  lastSampleUs = 0;
+  lastLoopIterations = 0;
+  lastNetIterations = 0;
+  lastLoopAllocs = 0;
+  lastNetAllocs = 0;
+  lastTotalAllocs = 0;
+  minLargestBlock = UINT32_MAX;
+  samples = 0;
+}
+
+
+void MemoryTelemetry::begin() {
+  loopCore = xPortGetCoreID();
+  heap_caps_register_failed_alloc_callback(onAllocFailed);
+  lastSampleUs = esp_timer_get_time();
+  sample();
+}
+
+
+void MemoryTelemetry::loopIteration() {
+  loopIterations++;
+}
+
+
+void MemoryTelemetry::netIteration() {
+  netIterations++;
+}
+
+
+void MemoryTelemetry::noteUse(int use, size_t bytes) {
+  if (use < 0 || use >= MEM_USE_COUNT) return;
+  if (bytes > highWater[use]) highWater[use] = bytes;
+}
+
+
+uint32_t MemoryTelemetry::getHighWater(int use) const {
+  return (use >= 0 && use < MEM_USE_COUNT) ? highWater[use] : 0;
+}
+
+
+void MemoryTelemetry::sample() {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+
+  MemoryStats stats;
+  stats.freeBytes = info.total_free_bytes;
+  stats.minFreeBytes = info.minimum_free_bytes;
+  stats.largestBlock = info.largest_free_block;
+  if (stats.largestBlock < minLargestBlock) minLargestBlock = stats.largestBlock;
+  stats.minLargestBlock = minLargestBlock;
+  stats.fragmentationPercent = stats.freeBytes > 0 ? (1.0f - (float)stats.largestBlock / stats.freeBytes) * 100.0f : 0;
+  stats.allocatedBlocks = info.allocated_blocks;
+  stats.freeBlocks = info.free_blocks;
+
+  // Allocation rates since the previous sample
+  int64_t now = esp_timer_get_time();
+  uint32_t loopIters = loopIterations;
+  uint32_t netIters = netIterations;
+  int netCore = NET_TASK_CORE < portNUM_PROCESSORS ? NET_TASK_CORE : 0;
+  uint32_t loopAllocs = allocCount[loopCore];
+  uint32_t netAllocs = allocCount[netCore];
+  uint32_t totalAllocs = 0;
+  for (int i = 0; i < portNUM_PROCESSORS; i++) {
+    totalAllocs += allocCount[i];
+  }
+
+  stats.allocCounting = ALLOC_COUNTING;
+  stats.allocsPerLoop = loopIters != lastLoopIterations ?
+    (float)(loopAllocs - lastLoopAllocs) / (loopIters - lastLoopIterations) : 0;
+  stats.allocsPerNetLoop = netIters != lastNetIterations ?
+    (float)(netAllocs - lastNetAllocs) / (netIters - lastNetIterations) : 0;
+  stats.allocsPerSecond = now > lastSampleUs ?
+    (float)((totalAllocs - lastTotalAllocs) * 1000000.0 / (now - lastSampleUs)) : 0;
+
+  lastSampleUs = now;
+  lastLoopIterations = loopIters;
+  lastNetIterations = netIters;
+  lastLoopAllocs = loopAllocs;
+  lastNetAllocs = netAllocs;
+  lastTotalAllocs = totalAllocs;
+
+  stats.failedAllocs = failedAllocCount;
+  stats.lastFailedSize = lastFailedAllocSize;
+  stats.samples = ++samples;
+  snapshot.write(stats);
+}
+
+
+MemoryStats MemoryTelemetry::getStats() const {
+  return snapshot.read();
+}
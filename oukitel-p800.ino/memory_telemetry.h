@@ -0,0 +1,104 @@
+/*
+ * Memory Telemetry - Heap health beyond the free byte count: largest free
+ * block, fragmentation, allocation rates and the largest buffer each
+ * subsystem has needed (high-water)
+ *
+ * The 20 KB web page needs 20 KB in ONE block; 60 KB free in small pieces
+ * is not enough. Fragmentation = 1 - largest block / free bytes. A
+ * subsystem whose high-water exceeds the largest block is reported as not
+ * fitting any more.
+ *
+ * Allocations are counted by the IDF heap hooks, which need
+ * CONFIG_HEAP_USE_HOOKS in the sdkconfig (not set in the stock Arduino
+ * core; the counts are reported as unavailable then). They are counted per
+ * core: the loop() core, and the network core, which it shares with the
+ * sensor, WiFi and lwIP tasks (an upper bound per network iteration).
+ *
+ * The heap walk runs once a second on the main loop; the other tasks read
+ * the last sample.
+ */
+
+#ifndef MEMORY_TELEMETRY_H
+#define MEMORY_TELEMETRY_H
+
+#include "config.h"
+#include "seqlock.h"
+
+enum MemUse {
+  MEM_USE_WEB_PAGE = 0,     // Network task: generateHTML()
+  MEM_USE_WEB_API = 1,      // Network task: /api JSON responses
+  MEM_USE_WEBSOCKET = 2,    // Network task: WebSocket messages
+  MEM_USE_MQTT = 3,         // Network task: MQTT payloads
+  MEM_USE_HTTP = 4,         // Network task: HTTP POST payload
+  MEM_USE_DATA_LOG = 5,     // Main loop: data log lines
+  MEM_USE_COUNT
+};
+
+inline const char* memUseName(int use) {
+  switch (use) {
+    case MEM_USE_WEB_PAGE:  return "webPage";
+    case MEM_USE_WEB_API:   return "webApi";
+    case MEM_USE_WEBSOCKET: return "websocket";
+    case MEM_USE_MQTT:      return "mqtt";
+    case MEM_USE_HTTP:      return "http";
+    case MEM_USE_DATA_LOG:  return "dataLog";
+    default:                return "unknown";
+  }
+}
+
+struct MemoryStats {
+  uint32_t freeBytes;
+  uint32_t minFreeBytes;          // Since boot
+  uint32_t largestBlock;
+  uint32_t minLargestBlock;       // Lowest sampled since boot
+  float fragmentationPercent;
+  uint32_t allocatedBlocks;
+  uint32_t freeBlocks;
+  bool allocCounting;             // Heap hooks compiled in
+  float allocsPerLoop;            // loop() core, per loop() iteration
+  float allocsPerNetLoop;         // Network core, per network task iteration
+  float allocsPerSecond;          // All cores
+  uint32_t failedAllocs;
+  uint32_t lastFailedSize;
+  uint32_t samples;
+};
+
+class MemoryTelemetry {
+private:
+  SeqLockSnapshot<MemoryStats> snapshot;
+  volatile uint32_t highWater[MEM_USE_COUNT];
+  volatile uint32_t loopIterations;
+  volatile uint32_t netIterations;
+  int loopCore;
+
+  // Previous sample (main loop)
+  int64_t lastSampleUs;
+  uint32_t lastLoopIterations;
+  uint32_t lastNetIterations;
+  uint32_t lastLoopAllocs;
+  uint32_t lastNetAllocs;
+  uint32_t lastTotalAllocs;
+  uint32_t minLargestBlock;
+  uint32_t samples;
+
+public:
+  MemoryTelemetry();
+  void begin();                           // From setup() (the loop() task)
+
+  // Once per iteration of the loop() / network task
+  void loopIteration();
+  void netIteration();
+
+  // Largest buffer a subsystem built in one piece; each use is written by
+  // one task only
+  void noteUse(int use, size_t bytes);
+  uint32_t getHighWater(int use) const;
+
+  // Main loop, every MEMORY_SAMPLE_INTERVAL
+  void sample();
+
+  // Any task: the last sample
+  MemoryStats getStats() const;
+};
+
+#endif // MEMORY_TELEMETRY_H
@@ -6,6 +6,7 @@
 #include "mqtt_client.h"
 #include "hardware_manager.h"
 #include "logger.h"
+#include "json_arena.h"
 #include <SPIFFS.h>
 
 
@@ -15,6 +16,8 @@ MQTTClientManager* MQTTClientManager::instance = nullptr;
 
 // External references
 extern HardwareManager hardware;
+extern MemoryTelemetry memTelemetry;
+extern JsonPool jsonPool;
 
 
 MQTTClientManager::MQTTClientManager() : mqttClient(wifiClient) {
@@ -53,12 +56,12 @@ MQTTClientManager::MQTTClientManager() : mqttClient(wifiClient) {
 
 
 bool MQTTClientManager::begin() {
-  Serial.println("[MQTT] Initializing MQTT client...");
+  LogSerial.println("[MQTT] Initializing MQTT client...");
   
   loadConfig();
   
   if (!config.enabled || config.server.length() == 0) {
-    Serial.println("[MQTT] MQTT disabled or not configured");
+    LogSerial.println("[MQTT] MQTT disabled or not configured");
     return true;
   }
   
@@ -67,10 +70,10 @@ bool MQTTClientManager::begin() {
   mqttClient.setKeepAlive(MQTT_KEEPALIVE);
   mqttClient.setBufferSize(1024);
   
-  Serial.println("[MQTT] MQTT client configured");
-  Serial.println("  Server: " + config.server + ":" + String(config.port));
-  Serial.println("  Client ID: " + config.clientId);
-  Serial.println("  Base Topic: " + baseTopic);
+  LogSerial.println("[MQTT] MQTT client configured");
+  LogSerial.println("  Server: " + config.server + ":" + String(config.port));
+  LogSerial.println("  Client ID: " + config.clientId);
+  LogSerial.println("  Base Topic: " + baseTopic);
   
   initialized = true;
   return true;
@@ -95,7 +98,7 @@ void MQTTClientManager::loop() {
     
     if (!connected) {
       connected = true;
-      Serial.println("[MQTT] Connected to MQTT broker");
+      LOG_INFO("MQTT: Connected to MQTT broker");
       publishAvailability(true);
       publishDiscoveryConfig();
     }
@@ -110,7 +113,7 @@ void MQTTClientManager::loop() {
 
 
 bool MQTTClientManager::reconnect() {
-  Serial.println("[MQTT] Attempting MQTT connection...");
+  LOG_INFO("MQTT: Attempting MQTT connection...");
   
   // Create will message for availability
   String willTopic = availabilityTopic;
@@ -138,7 +141,7 @@ bool MQTTClientManager::reconnect() {
   }
   
   if (connected) {
-    Serial.println("[MQTT] MQTT connected");
+    LOG_INFO("MQTT: MQTT connected");
     
     // Subscribe to command topics for output control
     String usbTopic = commandTopic + "/usb";
@@ -157,14 +160,14 @@ bool MQTTClientManager::reconnect() {
     
     return true;
   } else {
-    LOG_ERROR("MQTT connection failed, rc=" + String(mqttClient.state()));
+    LOG_ERROR("MQTT connection failed, rc=%d", mqttClient.state());
     return false;
   }
 }
 
 
 void MQTTClientManager::publishDiscoveryConfig() {
-  Serial.println("[MQTT] Publishing Home Assistant discovery configuration...");
+  LOG_INFO("MQTT: Publishing Home Assistant discovery configuration...");
   
   String deviceId = WiFi.macAddress();
   deviceId.replace(":", "");
@@ -192,15 +195,15 @@ void MQTTClientManager::publishDiscoveryConfig() {
   publishSwitchDiscovery("ac_output", commandTopic + "/ac", stateTopic + "/ac");
   publishSwitchDiscovery("flashlight", commandTopic + "/flashlight", stateTopic + "/flashlight");
   
-  Serial.println("[MQTT] Discovery configuration published");
+  LOG_INFO("MQTT: Discovery configuration published");
 }
 
 
 void MQTTClientManager::publishSensorDiscovery(const String& name, const String& deviceClass, const String& unit, const String& stateTopic) {
   String topic = "homeassistant/sensor/" + baseTopic + "_" + name + "/config";
   
-  // Increased size to prevent overflow (was 1024)
-  DynamicJsonDocument doc(1536);
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["name"] = "Oukitel P800E " + name;
   doc["unique_id"] = baseTopic + "_" + name;
   doc["state_topic"] = stateTopic;
@@ -217,28 +220,29 @@ void MQTTClientManager::publishSensorDiscovery(const String& name, const String&
   doc["device"]["manufacturer"] = "Oukitel";
   doc["device"]["sw_version"] = FIRMWARE_VERSION;
   
-  String payload;
-  size_t bytesWritten = serializeJson(doc, payload);
+  size_t length;
+  const char* payload = lease.serialize(length);
   
   // Check for overflow
-  if (bytesWritten == 0 || payload.length() == 0) {
-    LOG_ERROR("MQTT: Failed to serialize sensor discovery JSON for " + name);
+  if (length == 0) {
+    LOG_ERROR("MQTT: Failed to serialize sensor discovery JSON for %s", name.c_str());
     return;
   }
   
-  if (payload.length() > 1400) {
-    LOG_WARNING("MQTT: Sensor discovery payload large (" + String(payload.length()) + " bytes) for " + name);
+  if (length > 1400) {
+    LOG_WARNING("MQTT: Sensor discovery payload large (%u bytes) for %s", (unsigned)length, name.c_str());
   }
+  memTelemetry.noteUse(MEM_USE_MQTT, length + 1);
   
-  mqttClient.publish(topic.c_str(), payload.c_str(), MQTT_RETAIN);
+  mqttClient.publish(topic.c_str(), payload, MQTT_RETAIN);
 }
 
 
 void MQTTClientManager::publishBinaryDiscovery(const String& name, const String& deviceClass, const String& stateTopic) {
   String topic = "homeassistant/binary_sensor/" + baseTopic + "_" + name + "/config";
   
-  // Increased size to prevent overflow (was 1024)
-  DynamicJsonDocument doc(1536);
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["name"] = "Oukitel P800E " + name;
   doc["unique_id"] = baseTopic + "_" + name;
   doc["state_topic"] = stateTopic;
@@ -256,23 +260,23 @@ void MQTTClientManager::publishBinaryDiscovery(const String& name, const String&
   doc["device"]["manufacturer"] = "Oukitel";
   doc["device"]["sw_version"] = FIRMWARE_VERSION;
   
-  String payload;
-  size_t bytesWritten = serializeJson(doc, payload);
+  size_t length;
+  const char* payload = lease.serialize(length);
   
-  if (bytesWritten == 0 || payload.length() == 0) {
-    LOG_ERROR("MQTT: Failed to serialize binary discovery JSON for " + name);
+  if (length == 0) {
+    LOG_ERROR("MQTT: Failed to serialize binary discovery JSON for %s", name.c_str());
     return;
   }
   
-  mqttClient.publish(topic.c_str(), payload.c_str(), MQTT_RETAIN);
+  mqttClient.publish(topic.c_str(), payload, MQTT_RETAIN);
 }
 
 
 void MQTTClientManager::publishSwitchDiscovery(const String& name, const String& commandTopic, const String& stateTopic) {
   String topic = "homeassistant/switch/" + baseTopic + "_" + name + "/config";
   
-  // Increased size to prevent overflow (was 1024)
-  DynamicJsonDocument doc(1536);
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["name"] = "Oukitel P800E " + name;
   doc["unique_id"] = baseTopic + "_" + name;
   doc["command_topic"] = commandTopic;
@@ -290,15 +294,15 @@ void MQTTClientManager::publishSwitchDiscovery(const String& name, const String&
   doc["device"]["manufacturer"] = "Oukitel";
   doc["device"]["sw_version"] = FIRMWARE_VERSION;
   
-  String payload;
-  size_t bytesWritten = serializeJson(doc, payload);
+  size_t length;
+  const char* payload = lease.serialize(length);
   
-  if (bytesWritten == 0 || payload.length() == 0) {
-    LOG_ERROR("MQTT: Failed to serialize switch discovery JSON for " + name);
+  if (length == 0) {
+    LOG_ERROR("MQTT: Failed to serialize switch discovery JSON for %s", name.c_str());
     return;
   }
   
-  mqttClient.publish(topic.c_str(), payload.c_str(), MQTT_RETAIN);
+  mqttClient.publish(topic.c_str(), payload, MQTT_RETAIN);
 }
 
 
@@ -317,61 +321,69 @@ void MQTTClientManager::messageCallback(char* topic, byte* payload, unsigned int
     payloadStr += (char)payload[i];
   }
   
-  Serial.println("[MQTT] Message received: " + topicStr + " = " + payloadStr);
+  LOG_DEBUG("MQTT: Message received: %s = %s", topicStr.c_str(), payloadStr.c_str());
   
   // Handle output control commands
   if (topicStr == commandTopic + "/usb") {
     if (payloadStr == "ON" || payloadStr == "1") {
-      hardware.pressButton(BTN_USB, BUTTON_STANDARD_DURATION);
-      Serial.println("[MQTT] USB output toggled via MQTT");
+      hardware.requestButtonPress(BTN_USB, BUTTON_STANDARD_DURATION);
+      LOG_INFO("MQTT: USB output toggled via MQTT");
     }
   } else if (topicStr == commandTopic + "/dc") {
     if (payloadStr == "ON" || payloadStr == "1") {
-      hardware.pressButton(BTN_DC, BUTTON_STANDARD_DURATION);
-      Serial.println("[MQTT] DC output toggled via MQTT");
+      hardware.requestButtonPress(BTN_DC, BUTTON_STANDARD_DURATION);
+      LOG_INFO("MQTT: DC output toggled via MQTT");
     }
   } else if (topicStr == commandTopic + "/ac") {
     if (payloadStr == "ON" || payloadStr == "1") {
-      hardware.pressButton(BTN_AC, BUTTON_STANDARD_DURATION);
-      Serial.println("[MQTT] AC output toggled via MQTT");
+      hardware.requestButtonPress(BTN_AC, BUTTON_STANDARD_DURATION);
+      LOG_INFO("MQTT: AC output toggled via MQTT");
     }
   } else if (topicStr == commandTopic + "/flashlight") {
     if (payloadStr == "ON" || payloadStr == "1") {
-      hardware.pressButton(BTN_FLASHLIGHT, BUTTON_STANDARD_DURATION);
-      Serial.println("[MQTT] Flashlight toggled via MQTT");
+      hardware.requestButtonPress(BTN_FLASHLIGHT, BUTTON_STANDARD_DURATION);
+      LOG_INFO("MQTT: Flashlight toggled via MQTT");
     }
   } else if (topicStr == commandTopic + "/power") {
     if (payloadStr == "ON" || payloadStr == "1") {
-      hardware.pressButton(BTN_POWER, BUTTON_POWER_DURATION);
-      Serial.println("[MQTT] Power button pressed via MQTT");
+      hardware.requestButtonPress(BTN_POWER, BUTTON_POWER_DURATION);
+      LOG_INFO("MQTT: Power button pressed via MQTT");
     }
   }
 }
 
 
-void MQTTClientManager::publishData(const SensorData& sensorData, const EnergyData& energyData) {
+void MQTTClientManager::publishData(const TelemetryFrame& frame) {
   if (!connected) return;
+  const SensorData& sensorData = frame.sensor;
+  const EnergyData& energyData = frame.energy;
   
   // Publish ALL individual sensor values
-  mqttClient.publish((stateTopic + "/voltage").c_str(), String(sensorData.batteryVoltage, 2).c_str());
-  mqttClient.publish((stateTopic + "/soc").c_str(), String(sensorData.batteryPercentage, 1).c_str());
-  mqttClient.publish((stateTopic + "/main_current").c_str(), String(sensorData.mainCurrent, 2).c_str());
-  mqttClient.publish((stateTopic + "/output_current").c_str(), String(sensorData.outputCurrent, 2).c_str());
-  mqttClient.publish((stateTopic + "/main_power").c_str(), String(sensorData.mainPower, 0).c_str());
-  mqttClient.publish((stateTopic + "/output_power").c_str(), String(sensorData.outputPower, 0).c_str());
-  mqttClient.publish((stateTopic + "/on_battery").c_str(), sensorData.onBattery ? "ON" : "OFF");
+  publishState("voltage", sensorData.batteryVoltage, 2);
+  publishState("soc", sensorData.batteryPercentage, 1);
+  publishState("main_current", sensorData.mainCurrent, 2);
+  publishState("output_current", sensorData.outputCurrent, 2);
+  publishState("main_power", sensorData.mainPower, 0);
+  publishState("output_power", sensorData.outputPower, 0);
+  publishState("on_battery", sensorData.onBattery ? "ON" : "OFF");
   
   // Publish ALL energy data
-  mqttClient.publish((stateTopic + "/instant_power").c_str(), String(energyData.instantPower, 0).c_str());
-  mqttClient.publish((stateTopic + "/daily_consumption").c_str(), String(energyData.dailyConsumption, 3).c_str());
-  mqttClient.publish((stateTopic + "/monthly_consumption").c_str(), String(energyData.monthlyConsumption, 3).c_str());
-  mqttClient.publish((stateTopic + "/peak_power").c_str(), String(energyData.peakPower, 0).c_str());
-  mqttClient.publish((stateTopic + "/operating_time").c_str(), String(energyData.operatingTime).c_str());
-  
-  // Publish combined JSON payload - increased size for safety
-  DynamicJsonDocument doc(1536);
+  publishState("instant_power", energyData.instantPower, 0);
+  publishState("daily_consumption", energyData.dailyConsumption, 3);
+  publishState("monthly_consumption", energyData.monthlyConsumption, 3);
+  publishState("peak_power", energyData.peakPower, 0);
+  StackStr<12> operatingTime;
+  operatingTime.addUInt(energyData.operatingTime);
+  publishState("operating_time", operatingTime.c_str());
+  
+  // Publish combined JSON payload
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["voltage"] = sensorData.batteryVoltage;
   doc["soc"] = sensorData.batteryPercentage;
+  doc["soc_voltage"] = sensorData.socVoltage;
+  doc["soc_fused"] = sensorData.socFused;
+  doc["battery_current"] = sensorData.batteryCurrent;
   doc["main_current"] = sensorData.mainCurrent;
   doc["output_current"] = sensorData.outputCurrent;
   doc["main_power"] = sensorData.mainPower;
@@ -384,29 +396,117 @@ void MQTTClientManager::publishData(const SensorData& sensorData, const EnergyDa
   doc["peak_power"] = energyData.peakPower;
   doc["operating_time"] = energyData.operatingTime;
   doc["timestamp"] = sensorData.timestamp;
+  doc["sequence"] = frame.sequence;
   
-  String payload;
-  size_t bytesWritten = serializeJson(doc, payload);
+  size_t length;
+  const char* payload = lease.serialize(length);
   
-  if (bytesWritten == 0 || payload.length() == 0) {
+  if (length == 0) {
     LOG_ERROR("MQTT: Failed to serialize data JSON");
     return;
   }
+  memTelemetry.noteUse(MEM_USE_MQTT, length + 1);
   
-  mqttClient.publish(stateTopic.c_str(), payload.c_str());
+  mqttClient.publish(stateTopic.c_str(), payload);
+}
+
+
+// <state topic>/<suffix>, topic and value built on the stack
+void MQTTClientManager::publishState(const char* suffix, const char* value) {
+  StackStr<MQTT_TOPIC_MAX> topic;
+  topic.add(stateTopic).add('/').add(suffix);
+  mqttClient.publish(topic.c_str(), value);
+}
+
+
+void MQTTClientManager::publishState(const char* suffix, float value, int decimals) {
+  StackStr<24> text;
+  text.addFloat(value, decimals);
+  publishState(suffix, text.c_str());
 }
 
 
 void MQTTClientManager::publishStatus(const String& status) {
   if (!connected) return;
   
-  mqttClient.publish((baseTopic + "/status").c_str(), status.c_str());
+  StackStr<MQTT_TOPIC_MAX> topic;
+  topic.add(baseTopic).add("/status");
+  mqttClient.publish(topic.c_str(), status.c_str());
+}
+
+
+void MQTTClientManager::publishOnBattery(bool onBattery) {
+  if (!connected) return;
+  
+  publishState("on_battery", onBattery ? "ON" : "OFF");
+}
+
+
+void MQTTClientManager::publishPerf(const LoopProfiler& profiler) {
+  if (!connected) return;
+  
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+    const PerfStageStats& stage = profiler.getStage(i);
+    JsonObject obj = doc.createNestedObject(perfStageName(i));
+    obj["count"] = stage.count;
+    obj["mean_us"] = profiler.getMeanUs(i);
+    obj["p99_us"] = stage.histogram.percentile(99);
+    obj["max_us"] = profiler.toUs(stage.maxCycles);
+  }
+  
+  size_t length;
+  const char* payload = lease.serialize(length);
+  if (length == 0) {
+    LOG_ERROR("MQTT: Failed to serialize perf JSON");
+    return;
+  }
+  
+  publishState("perf", payload);
+}
+
+
+void MQTTClientManager::publishMemory(const MemoryTelemetry& memory) {
+  if (!connected) return;
+  
+  MemoryStats stats = memory.getStats();
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
+  doc["free"] = stats.freeBytes;
+  doc["min_free"] = stats.minFreeBytes;
+  doc["largest_block"] = stats.largestBlock;
+  doc["min_largest_block"] = stats.minLargestBlock;
+  doc["fragmentation"] = stats.fragmentationPercent;
+  if (stats.allocCounting) {
+    doc["allocs_per_loop"] = stats.allocsPerLoop;
+    doc["allocs_per_net_loop"] = stats.allocsPerNetLoop;
+    doc["allocs_per_second"] = stats.allocsPerSecond;
+  }
+  doc["failed_allocs"] = stats.failedAllocs;
+  JsonPoolStats json = jsonPool.getStats();
+  doc["json_arena_peak"] = json.peakBytes;
+  doc["json_arena_fallbacks"] = json.fallbacks;
+  doc["json_arena_spills"] = json.spills;
+  JsonObject highWater = doc.createNestedObject("high_water");
+  for (int i = 0; i < MEM_USE_COUNT; i++) {
+    highWater[memUseName(i)] = memory.getHighWater(i);
+  }
+  
+  size_t length;
+  const char* payload = lease.serialize(length);
+  if (length == 0) {
+    LOG_ERROR("MQTT: Failed to serialize memory JSON");
+    return;
+  }
+  
+  publishState("memory", payload);
 }
 
 
 void MQTTClientManager::publishAvailability(bool online) {
   String payload = online ? "online" : "offline";
-  mqttClient.publish(availabilityTopic.c_str(), payload.c_str(), MQTT_RETAIN);
+  mqttClient.publish(availabilityTopic.c_str(), payload, MQTT_RETAIN);
 }
 
 
@@ -446,7 +546,7 @@ void MQTTClientManager::updateClientIdWithMAC() {
   
   // Verifica se il MAC è valido (non tutti zeri e non vuoto)
   if (realMAC == "00:00:00:00:00:00" || realMAC.length() == 0) {
-    Serial.println("[MQTT] ⚠️ updateClientIdWithMAC() called but MAC is still invalid (" + realMAC + ") - skipping");
+    LOG_WARNING("MQTT: updateClientIdWithMAC() called but MAC is still invalid (%s) - skipping", realMAC.c_str());
     return;
   }
   
@@ -463,7 +563,7 @@ void MQTTClientManager::updateClientIdWithMAC() {
   }
   
   if (needsUpdate) {
-    Serial.println("[MQTT] ✓ MAC Address updated: " + config.clientId + " → " + newClientId);
+    LOG_INFO("MQTT: MAC Address updated: %s -> %s", config.clientId.c_str(), newClientId.c_str());
     config.clientId = newClientId;
     saveConfig();
     
@@ -473,7 +573,7 @@ void MQTTClientManager::updateClientIdWithMAC() {
     newBaseTopic.toLowerCase();
     
     if (baseTopic != newBaseTopic) {
-      Serial.println("[MQTT] ✓ Base Topic updated: " + baseTopic + " → " + newBaseTopic);
+      LOG_INFO("MQTT: Base Topic updated: %s -> %s", baseTopic.c_str(), newBaseTopic.c_str());
       baseTopic = newBaseTopic;
       stateTopic = baseTopic + "/state";
       commandTopic = baseTopic + "/command";
@@ -482,20 +582,20 @@ void MQTTClientManager::updateClientIdWithMAC() {
     
     // Se MQTT è connesso, disconnetti e riconnetti con nuovo clientId
     if (mqttClient.connected()) {
-      Serial.println("[MQTT] Disconnecting to reconnect with new clientId...");
+      LOG_INFO("MQTT: Disconnecting to reconnect with new clientId...");
       mqttClient.disconnect();
       connected = false;
       lastReconnectAttempt = 0;  // Force immediate reconnect attempt
     }
   } else {
-    Serial.println("[MQTT] updateClientIdWithMAC() called - already synchronized with real MAC");
+    LOG_INFO("MQTT: updateClientIdWithMAC() called - already synchronized with real MAC");
   }
 }
 
 
 void MQTTClientManager::loadConfig() {
   if (!SPIFFS.exists("/mqtt_config.json")) {
-    Serial.println("[MQTT] No saved MQTT configuration found");
+    LOG_INFO("MQTT: No saved MQTT configuration found");
     return;
   }
   
@@ -525,7 +625,7 @@ void MQTTClientManager::loadConfig() {
     config.clientId = "oukitel_p800e_" + WiFi.macAddress();
   }
   
-  Serial.println("[MQTT] Loaded MQTT configuration");
+  LOG_INFO("MQTT: Loaded MQTT configuration");
 }
 
 
@@ -547,5 +647,5 @@ void MQTTClientManager::saveConfig() {
   serializeJson(doc, file);
   file.close();
   
-  Serial.println("[MQTT] MQTT configuration saved");
+  LOG_INFO("MQTT: MQTT configuration saved");
 }
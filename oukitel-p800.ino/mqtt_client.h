@@ -11,6 +11,9 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include "loop_profiler.h"
+#include "memory_telemetry.h"
+#include "str_buf.h"
 
 
 class MQTTClientManager {
@@ -37,6 +40,10 @@ private:
   void publishButtonDiscovery(const String& name, const String& commandTopic);
   void publishSwitchDiscovery(const String& name, const String& commandTopic, const String& stateTopic);
   
+  // <state topic>/<suffix> without heap allocations
+  void publishState(const char* suffix, const char* value);
+  void publishState(const char* suffix, float value, int decimals);
+  
   // Message handlers
   void messageCallback(char* topic, byte* payload, unsigned int length);
   static void messageCallbackStatic(char* topic, byte* payload, unsigned int length);
@@ -58,9 +65,12 @@ public:
   MQTTConfig getConfig();
   
   // Publishing methods
-  void publishData(const SensorData& sensorData, const EnergyData& energyData);
+  void publishData(const TelemetryFrame& frame);
   void publishStatus(const String& status);
+  void publishOnBattery(bool onBattery);   // Fast path, ahead of the next publishData()
   void publishAvailability(bool online);
+  void publishPerf(const LoopProfiler& profiler);  // Per-stage mean/p99/max (us)
+  void publishMemory(const MemoryTelemetry& memory);  // Largest block, fragmentation, high-water
   
   // ===================================================================
   // MAC ADDRESS SYNCHRONIZATION (NEW! - FIX #3)
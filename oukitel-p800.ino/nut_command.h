@@ -0,0 +1,94 @@
+/*
+ * NUT Command - Parsing of one upsd command line, split in place.
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ *   char* command = nutTrimLine(line, length);
+ *   NutCommand parsed = nutParseCommand(command);
+ *   if (parsed.type == NUT_CMD_GET_VAR) handleGetVar(parsed.upsName, parsed.argument, response);
+ *
+ * Command names are case-insensitive, words are separated by any number of
+ * spaces. GET VAR and INST CMD without their second word are unknown.
+ */
+
+#ifndef NUT_COMMAND_H
+#define NUT_COMMAND_H
+
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+
+enum NutCommandType {
+  NUT_CMD_UNKNOWN,
+  NUT_CMD_LIST_UPS,
+  NUT_CMD_LIST_VAR,     // upsName
+  NUT_CMD_GET_VAR,      // upsName, argument = variable
+  NUT_CMD_INST_CMD,     // upsName, argument = command
+  NUT_CMD_LIST_CMD,     // upsName
+  NUT_CMD_VER,
+  NUT_CMD_HELP
+};
+
+struct NutCommand {
+  NutCommandType type;
+  const char* upsName;  // "" when not given
+  const char* argument; // "" when not given
+};
+
+// Leading blanks and trailing CR/blanks off a received line (terminated at length)
+inline char* nutTrimLine(char* line, size_t length) {
+  line[length] = '\0';
+  char* command = line;
+  while (*command == ' ' || *command == '\t') command++;
+  while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+    line[--length] = '\0';
+  }
+  return command;
+}
+
+// Next space-separated word, terminated in place ("" at the end)
+inline char* nutNextWord(char*& cursor) {
+  while (*cursor == ' ') cursor++;
+  char* word = cursor;
+  while (*cursor != '\0' && *cursor != ' ') cursor++;
+  if (*cursor != '\0') *cursor++ = '\0';
+  return word;
+}
+
+// Command prefix, case-insensitive, followed by a space or the end
+inline bool nutIsCommand(char* command, const char* name, char*& args) {
+  size_t n = strlen(name);
+  if (strncasecmp(command, name, n) != 0) return false;
+  if (command[n] != '\0' && command[n] != ' ') return false;
+  args = command + n;
+  return true;
+}
+
+inline NutCommand nutParseCommand(char* command) {
+  NutCommand parsed = {NUT_CMD_UNKNOWN, "", ""};
+  char* args = nullptr;
+
+  if (nutIsCommand(command, "LIST UPS", args)) {
+    parsed.type = NUT_CMD_LIST_UPS;
+  } else if (nutIsCommand(command, "LIST VAR", args)) {
+    parsed.type = NUT_CMD_LIST_VAR;
+    parsed.upsName = nutNextWord(args);
+  } else if (nutIsCommand(command, "GET VAR", args)) {
+    parsed.upsName = nutNextWord(args);
+    parsed.argument = nutNextWord(args);
+    if (*parsed.argument != '\0') parsed.type = NUT_CMD_GET_VAR;
+  } else if (nutIsCommand(command, "INST CMD", args)) {
+    parsed.upsName = nutNextWord(args);
+    parsed.argument = nutNextWord(args);
+    if (*parsed.argument != '\0') parsed.type = NUT_CMD_INST_CMD;
+  } else if (nutIsCommand(command, "LIST CMD", args)) {
+    parsed.type = NUT_CMD_LIST_CMD;
+    parsed.upsName = nutNextWord(args);
+  } else if (strcasecmp(command, "VER") == 0) {
+    parsed.type = NUT_CMD_VER;
+  } else if (strcasecmp(command, "HELP") == 0) {
+    parsed.type = NUT_CMD_HELP;
+  }
+  return parsed;
+}
+
+#endif // NUT_COMMAND_H
@@ -22,6 +22,14 @@
 #include "data_logger.h"
 #include "energy_monitor.h"
 #include "logger.h"
+#include "task_scheduler.h"
+#include "loop_profiler.h"
+#include "power_manager.h"
+#include "memory_telemetry.h"
+#include "json_arena.h"
+#include "seqlock.h"
+#include "telemetry_fanout.h"
+#include <esp_timer.h>
 
 
 
@@ -37,24 +45,43 @@ PowerStationMonitor energyMonitor;
 
 
 
-// Timing variables
-unsigned long lastSensorUpdate = 0;
-unsigned long lastDataLog = 0;
-unsigned long lastHealthCheck = 0;
-unsigned long lastMqttPublish = 0;
-unsigned long lastHttpPublish = 0;
-unsigned long lastSerialLog = 0;
-unsigned long lastSerialHeader = 0;
-unsigned long lastStateCheck = 0;
-unsigned long lastEmergencyCheck = 0;
-unsigned long lastBeepUpdate = 0;
+// Periodic loop() work, see registerLoopTasks()
+TaskScheduler scheduler(esp_timer_get_time, SCHED_TICK_BUDGET_US);
 bool headerPrinted = false;
 
+// Networking runs on its own task, see networkTask()
+TaskScheduler netScheduler(esp_timer_get_time, NET_TICK_BUDGET_US);
+TaskHandle_t networkTaskHandle = nullptr;
+
+// Per-stage cycle timing (sensor, main loop and network tasks), /api/perf
+LoopProfiler profiler;
+
+// ESP32 power saving while the station runs on its battery
+PowerManager powerMgr;
+
+// Largest free block, fragmentation, allocation rates, per-subsystem high-water
+MemoryTelemetry memTelemetry;
+
+// Pre-allocated ArduinoJson buffers, leased per request (json_arena.h)
+alignas(8) static uint8_t jsonArenaStorage[JSON_ARENA_COUNT * JSON_ARENA_SIZE];
+JsonPool jsonPool(jsonArenaStorage, JSON_ARENA_COUNT, JSON_ARENA_SIZE);
+
+// One telemetry frame per sensor tick, fanned out to the consumers of each
+// task, see registerTelemetrySinks()
+SeqLockSnapshot<TelemetryFrame> telemetry;
+TelemetryFanout<TelemetryFrame> loopSinks(esp_timer_get_time);
+TelemetryFanout<TelemetryFrame> netSinks(esp_timer_get_time);
+
 
 
 void setup() {
+  Serial.setTxBufferSize(LOG_TX_BUFFER);   // Before begin()
   Serial.begin(115200);
+  logBegin();                              // Log ring (kept across a reset) and its drain task
   delay(1000);
+  profiler.setCpuMhz(getCpuFrequencyMhz());
+  powerMgr.begin();
+  memTelemetry.begin();
   
   // Configure watchdog timer for automatic recovery
   // ESP32 has built-in watchdog, but we can configure it explicitly
@@ -62,10 +89,10 @@ void setup() {
   // If you experience frequent resets, increase timeout or disable
   // Note: Watchdog is automatically enabled on ESP32
   
-  Serial.println("\n╔═════════════════════════════════════════════════╗");
-  Serial.println("║   OUKITEL P800E DOMOTIZATION SYSTEM            ║");
-  Serial.println("║   ESP32 WROOM-32D Firmware v1.1.0              ║");
-  Serial.println("╚═════════════════════════════════════════════════╝\n");
+  LogSerial.println("\n╔═════════════════════════════════════════════════╗");
+  LogSerial.println("║   OUKITEL P800E DOMOTIZATION SYSTEM            ║");
+  LogSerial.println("║   ESP32 WROOM-32D Firmware v1.1.0              ║");
+  LogSerial.println("╚═════════════════════════════════════════════════╝\n");
   
   // Initialize SPIFFS for persistent storage
   LOG_INFO("Initializing SPIFFS...");
@@ -76,41 +103,47 @@ void setup() {
   }
   
   // Load calibration from SPIFFS
-  Serial.println("[INIT] Loading calibration data from SPIFFS...");
+  LogSerial.println("[INIT] Loading calibration data from SPIFFS...");
   loadCalibrationFromSPIFFS();
-  Serial.println("[INIT] Calibration data loaded");
-  Serial.println("      SCT013 Cal In: " + String(g_sct013CalIn, 2));
-  Serial.println("      Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
+  LogSerial.println("[INIT] Calibration data loaded");
+  LogSerial.println("      SCT013 Cal In: " + String(g_sct013CalIn, 2));
+  LogSerial.println("      Voltage Offset Rest: " + String(g_voltageOffsetRest, 2));
   
   // Load advanced settings from SPIFFS
-  Serial.println("[INIT] Loading advanced settings from SPIFFS...");
+  LogSerial.println("[INIT] Loading advanced settings from SPIFFS...");
   loadAdvancedSettingsFromSPIFFS();
-  Serial.println("[INIT] Advanced settings loaded");
-  Serial.println("      Power Threshold: " + String(g_powerThreshold, 2) + "W");
-  Serial.println("      Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 1) + "V");
-  Serial.println("      Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
-  Serial.println("      Warmup Delay: " + String(g_warmupDelay) + "ms");
+  LogSerial.println("[INIT] Advanced settings loaded");
+  LogSerial.println("      Power Threshold: " + String(g_powerThreshold, 2) + "W");
+  LogSerial.println("      Power Station OFF Voltage: " + String(g_powerStationOffVoltage, 1) + "V");
+  LogSerial.println("      Auto Power On Delay: " + String(g_autoPowerOnDelay) + "ms");
+  LogSerial.println("      Warmup Delay: " + String(g_warmupDelay) + "ms");
+  
+  // Load voltage compensation tables (built-in or SPIFFS override)
+  loadCompensationFromSPIFFS();
+  
+  // Load SOC curves (built-in or SPIFFS curves and selection)
+  loadSocCurvesFromSPIFFS();
   
   // Load API password from SPIFFS
-  Serial.println("[INIT] Loading API password from SPIFFS...");
+  LogSerial.println("[INIT] Loading API password from SPIFFS...");
   loadAPIPasswordFromSPIFFS();
-  Serial.println("[INIT] API password loaded");
+  LogSerial.println("[INIT] API password loaded");
   
   // Load system settings from SPIFFS (NEW!)
-  Serial.println("[INIT] Loading system settings from SPIFFS...");
+  LogSerial.println("[INIT] Loading system settings from SPIFFS...");
   loadSystemSettingsFromSPIFFS();
-  Serial.println("[INIT] System settings loaded");
-  Serial.println("      NTP Server: " + g_ntpServer);
-  Serial.println("      GMT Offset: " + String(g_gmtOffset) + "s");
-  Serial.println("      Daylight Offset: " + String(g_daylightOffset) + "s");
+  LogSerial.println("[INIT] System settings loaded");
+  LogSerial.println("      NTP Server: " + g_ntpServer);
+  LogSerial.println("      GMT Offset: " + String(g_gmtOffset) + "s");
+  LogSerial.println("      Daylight Offset: " + String(g_daylightOffset) + "s");
   
   // Load HTTP shutdown config from SPIFFS (NEW!)
-  Serial.println("[INIT] Loading HTTP shutdown config from SPIFFS...");
+  LogSerial.println("[INIT] Loading HTTP shutdown config from SPIFFS...");
   loadHttpShutdownConfigFromSPIFFS();
-  Serial.println("[INIT] HTTP shutdown config loaded");
-  Serial.println("      Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
-  Serial.println("      Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
-  Serial.println("      Server: " + g_httpShutdownServer);
+  LogSerial.println("[INIT] HTTP shutdown config loaded");
+  LogSerial.println("      Enabled: " + String(g_httpShutdownEnabled ? "YES" : "NO"));
+  LogSerial.println("      Threshold: " + String(g_httpShutdownThreshold, 1) + "%");
+  LogSerial.println("      Server: " + g_httpShutdownServer);
   
   // Initialize hardware
   LOG_INFO("Initializing hardware...");
@@ -120,245 +153,431 @@ void setup() {
   }
   
   // Initialize data storage
-  Serial.println("[INIT] Initializing data storage...");
+  LogSerial.println("[INIT] Initializing data storage...");
   if (!dataLogger.begin()) {
-    Serial.println("[ERROR] Data storage initialization failed!");
+    LogSerial.println("[ERROR] Data storage initialization failed!");
   }
   
   // Initialize energy monitoring
-  Serial.println("[INIT] Initializing energy monitor...");
+  LogSerial.println("[INIT] Initializing energy monitor...");
   energyMonitor.begin();
   
   // Initialize WiFi
-  Serial.println("[INIT] Initializing WiFi...");
+  LogSerial.println("[INIT] Initializing WiFi...");
   wifiMgr.begin();
   
   // Initialize NTP time synchronization with configured server (UPDATED!)
-  Serial.println("[INIT] Initializing NTP time sync...");
-  Serial.println("[INIT] Using NTP server: " + g_ntpServer);
+  LogSerial.println("[INIT] Initializing NTP time sync...");
+  LogSerial.println("[INIT] Using NTP server: " + g_ntpServer);
   configTime(g_gmtOffset, g_daylightOffset, g_ntpServer.c_str());
-  Serial.println("[INIT] NTP configured. Waiting for time sync...");
+  LogSerial.println("[INIT] NTP configured. Waiting for time sync...");
   
   // Wait for NTP sync (max 10 seconds)
   int ntpRetries = 0;
   while (time(nullptr) < 1000000000 && ntpRetries < 20) {
     delay(500);
-    Serial.print(".");
+    LogSerial.print(".");
     ntpRetries++;
   }
-  Serial.println();
+  LogSerial.println();
   
   if (time(nullptr) >= 1000000000) {
     time_t now = time(nullptr);
     struct tm* timeinfo = localtime(&now);
     char timeStr[64];
     strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-    Serial.println("[INIT] NTP time synchronized: " + String(timeStr));
+    LogSerial.println("[INIT] NTP time synchronized: " + String(timeStr));
     
     // Synchronize energy monitor with NTP time
     energyMonitor.syncTimeAfterNTP();
-    Serial.println("[INIT] Energy monitor time synchronized");
+    LogSerial.println("[INIT] Energy monitor time synchronized");
   } else {
-    Serial.println("[INIT] NTP sync timeout - will retry in background");
+    LogSerial.println("[INIT] NTP sync timeout - will retry in background");
   }
   
   // Initialize web server
-  Serial.println("[INIT] Initializing web server...");
+  LogSerial.println("[INIT] Initializing web server...");
   webServer.begin();
   
   // Set WebServer reference in HardwareManager
   hardware.setWebServerReference(&webServer);
     
   // Initialize UPS protocol
-  Serial.println("[INIT] Initializing UPS protocol...");
+  LogSerial.println("[INIT] Initializing UPS protocol...");
   upsProtocol.begin();
   
   // Initialize MQTT client
-  Serial.println("[INIT] Initializing MQTT client...");
+  LogSerial.println("[INIT] Initializing MQTT client...");
   mqttClient.begin();
   
   // Update MQTT client ID with real MAC address
   if (wifiMgr.isConnected()) {
-    Serial.println("[INIT] Updating MQTT client ID with real MAC address...");
+    LogSerial.println("[INIT] Updating MQTT client ID with real MAC address...");
     mqttClient.updateClientIdWithMAC();
   }
   
   // Initialize HTTP client
-  Serial.println("[INIT] Initializing HTTP client...");
+  LogSerial.println("[INIT] Initializing HTTP client...");
   httpClient.begin();
   
-  Serial.println("\n[INIT] System initialization complete!");
+  LogSerial.println("\n[INIT] System initialization complete!");
   
   // Print connection info
   if (wifiMgr.isConnected()) {
-    Serial.println("WiFi: Connected to " + wifiMgr.getSSID());
-    Serial.println("Web interface: http://" + wifiMgr.getLocalIP());
-    Serial.println("IP Address: " + wifiMgr.getLocalIP());
+    LogSerial.println("WiFi: Connected to " + wifiMgr.getSSID());
+    LogSerial.println("Web interface: http://" + wifiMgr.getLocalIP());
+    LogSerial.println("IP Address: " + wifiMgr.getLocalIP());
   } else if (wifiMgr.isAPMode()) {
-    Serial.println("WiFi: AP Mode - " + String(AP_SSID));
-    Serial.println("Web interface: http://" + wifiMgr.getAPIP());
+    LogSerial.println("WiFi: AP Mode - " + String(AP_SSID));
+    LogSerial.println("Web interface: http://" + wifiMgr.getAPIP());
   }
   
   if (upsProtocol.isEnabled()) {
-    Serial.println("UPS protocol: Listening on port " + String(upsProtocol.getConfig().port));
+    LogSerial.println("UPS protocol: Listening on port " + String(upsProtocol.getConfig().port));
   }
   
   if (mqttClient.isConnected()) {
-    Serial.println("MQTT: Connected to broker");
+    LogSerial.println("MQTT: Connected to broker");
   }
   
   if (httpClient.isEnabled()) {
-    Serial.println("HTTP: Home Assistant integration enabled");
+    LogSerial.println("HTTP: Home Assistant integration enabled");
   }
   
   if (g_httpShutdownEnabled) {
-    Serial.println("HTTP Shutdown: Enabled (Threshold: " + String(g_httpShutdownThreshold, 1) + "%)");
+    LogSerial.println("HTTP Shutdown: Enabled (Threshold: " + String(g_httpShutdownThreshold, 1) + "%)");
   }
   
-  Serial.println();
+  registerTelemetrySinks();
+  registerLoopTasks();
+  registerNetworkTasks();
+  startNetworkTask();
+  
+  LogSerial.println();
 }
 
 
 
 void loop() {
-  // Update WiFi connection
-  static bool wasConnected = false;
-  bool isConnected = wifiMgr.isConnected();
+  scheduler.loopStart();
+  memTelemetry.loopIteration();
   
-  // Check if WiFi just connected (transition from disconnected to connected)
-  if (isConnected && !wasConnected) {
-    LOG_INFO("WiFi just connected - updating MQTT client ID with MAC address");
-    mqttClient.updateClientIdWithMAC();
-  }
-  wasConnected = isConnected;
+  // Button, auto power on and settings requests queued by the network task
+  hardware.processCommands();
   
-  wifiMgr.handleConnection();
+  // Check Auto Power On
+  hardware.checkAutoPowerOn();
   
-  // Handle web server and websocket
-  webServer.handleClient();
+  // Update beep state continuously (non-blocking)
+  hardware.updateBeepState();
   
-  // Handle UPS protocol
-  upsProtocol.handleClients();
+  // Update button state continuously (non-blocking)
+  hardware.updateButtonState();
+  
+  // Waveform analysis (THD, crest factor), a slice of samples per iteration
+  hardware.updateHarmonics();
   
-  // Handle MQTT client (only if WiFi is connected)
-  if (isConnected) {
-    mqttClient.loop();
-    httpClient.loop();
+  // Periodic work (sensor snapshot, state/emergency checks, logging),
+  // spread over iterations by the scheduler
+  scheduler.tick();
+  scheduler.loopEnd();
+  
+  // Sleep until the next task is due (LOW POWER) or 1 ms; a queued request
+  // wakes the loop at once. The idle task runs meanwhile (watchdog).
+  uint32_t idleMs = 1;
+  if (powerMgr.isLowPower() && !hardware.needsFastLoop()) {
+    idleMs = constrain(scheduler.getMsUntilNextDue(LOW_POWER_MAX_IDLE_MS), 1, LOW_POWER_MAX_IDLE_MS);
+  }
+  powerMgr.sleepStart();
+  hardware.waitForCommand(idleMs);
+  powerMgr.sleepEnd();
+}
+
+// ===================================================================
+// NETWORK TASK
+// ===================================================================
+// Web server, WebSocket, NUT, MQTT and HTTP run here, on the core of the
+// sensor task but below its priority. loop() keeps the safety checks and
+// never waits on a socket: the network side reads the sensor and energy
+// snapshots and queues its button/settings requests (processCommands()).
+
+void startNetworkTask() {
+  if (xTaskCreatePinnedToCore(networkTask, "network", NET_TASK_STACK, nullptr,
+                              NET_TASK_PRIORITY, &networkTaskHandle, NET_TASK_CORE) != pdPASS) {
+    LOG_ERROR("Network task creation failed!");
+    ESP.restart();
   }
+  LogSerial.println("[INIT] Network task started on core " + String(NET_TASK_CORE));
+}
+
+void networkTask(void* arg) {
+  bool wasConnected = false;
   
-  // Update sensor readings every second
-  if (timeElapsed(lastSensorUpdate, 1000)) {
-    hardware.readSensors();
-    SensorData data = hardware.getSensorData();
+  for (;;) {
+    netScheduler.loopStart();
+    memTelemetry.netIteration();
     
-    // Update energy monitor only after warm-up is complete
-    if (hardware.getIsWarmedUp()) {
-      energyMonitor.update(data);
+    // Update WiFi connection
+    bool isConnected = wifiMgr.isConnected();
+    
+    // Check if WiFi just connected (transition from disconnected to connected)
+    if (isConnected && !wasConnected) {
+      LOG_INFO("WiFi just connected - updating MQTT client ID with MAC address");
+      mqttClient.updateClientIdWithMAC();
     }
+    wasConnected = isConnected;
+    
+    wifiMgr.handleConnection();
     
-    // Print header after first valid reading
-    if (!headerPrinted && data.batteryVoltage > 0) {
-      hardware.printStatusHeader();
-      headerPrinted = true;
-      lastSerialHeader = millis();
+    // Handle web server and websocket
+    {
+      PerfScope scope(profiler, PERF_STAGE_HANDLE_CLIENT);
+      webServer.handleClient();
     }
     
-    // Update UPS status only after warm-up
-    if (data.batteryVoltage > 0) {
-      upsProtocol.updateStatus(data);
+    // Handle UPS protocol
+    {
+      PerfScope scope(profiler, PERF_STAGE_HANDLE_CLIENTS);
+      upsProtocol.handleClients();
     }
     
-    lastSensorUpdate = millis();
-  }
-  
-  // Check state transitions every second
-  if (timeElapsed(lastStateCheck, 1000)) {
-    hardware.checkStateTransition();
-    lastStateCheck = millis();
+    // Handle MQTT client (only if WiFi is connected)
+    if (isConnected) {
+      {
+        PerfScope scope(profiler, PERF_STAGE_MQTT_LOOP);
+        mqttClient.loop();
+      }
+      httpClient.loop();
+    }
+    
+    // New telemetry frame to NUT, WebSocket, MQTT and HTTP
+    pollTelemetry(netSinks);
+    
+    // Fast mains-loss path: push OB as soon as the sampler misses half-cycles,
+    // without waiting for the 1 s sensor tick
+    AdcMainsEvent mainsEvent;
+    if (hardware.pollMainsEvent(mainsEvent)) {
+      handleMainsEvent(mainsEvent);
+    }
+    
+    // AC switched on by Auto Power On (main loop)
+    if (hardware.pollACActivated()) {
+      webServer.notifyACActivated();
+    }
+    
+    // Periodic publishing, spread over iterations by its own scheduler
+    netScheduler.tick();
+    netScheduler.loopEnd();
+    
+    // Lets the idle task on this core run (task watchdog). In LOW POWER
+    // the radio sleeps between beacons anyway, a longer pause costs nothing.
+    vTaskDelay(powerMgr.isLowPower() ? pdMS_TO_TICKS(LOW_POWER_NET_DELAY_MS) : 1);
   }
+}
+
+// ===================================================================
+// PERIODIC LOOP TASKS
+// ===================================================================
+// Same-period tasks get different phases so they never share an iteration.
+// The 1 s chain keeps its order: snapshot -> state check -> emergency check.
+
+// Consume the latest sensor snapshot (acquired by the sensor task) and
+// publish the telemetry frame every consumer works from
+void taskSensorUpdate() {
+  SensorData data = hardware.getSensorData();
   
-  // Check Auto Power On
-  hardware.checkAutoPowerOn();
-  
-  // Check emergency conditions every second
-  if (timeElapsed(lastEmergencyCheck, 1000)) {
-    hardware.checkEmergencyConditions();
-    lastEmergencyCheck = millis();
+  // Update energy monitor only after warm-up is complete
+  if (hardware.getIsWarmedUp()) {
+    PerfScope scope(profiler, PERF_STAGE_ENERGY_UPDATE);
+    energyMonitor.update(data);
   }
   
-  // Update beep state continuously (non-blocking)
-  hardware.updateBeepState();
-  
-  // Update button state continuously (non-blocking)
-  hardware.updateButtonState();
-  
-  // Log data every 5 minutes
-  if (timeElapsed(lastDataLog, 300000)) {
-    SensorData data = hardware.getSensorData();
-    EnergyData energyData = energyMonitor.getEnergyData();
-    dataLogger.logData(data, energyData);
-    lastDataLog = millis();
-  }
+  TelemetryFrame frame;
+  frame.sequence = telemetry.getSequence() + 1;   // Only writer
+  frame.sensor = data;
+  frame.energy = energyMonitor.getEnergyData();
+  frame.stableEnergy = energyMonitor.getStableEnergyData();
+  telemetry.write(frame);
   
-  // Publish MQTT data every 30 seconds (if connected)
-  if (wifiMgr.isConnected() && mqttClient.isConnected()) {
-    if (timeElapsed(lastMqttPublish, 30000)) {
-      SensorData data = hardware.getSensorData();
-      EnergyData energyData = energyMonitor.getEnergyData();
-      mqttClient.publishData(data, energyData);
-      lastMqttPublish = millis();
-    }
+  // Print header after first valid reading
+  if (!headerPrinted && data.batteryVoltage > 0) {
+    hardware.printStatusHeader();
+    headerPrinted = true;
   }
-  
-  // Publish HTTP data every 30 seconds (if enabled)
-  if (wifiMgr.isConnected() && httpClient.isEnabled()) {
-    if (timeElapsed(lastHttpPublish, 30000)) {
-      SensorData data = hardware.getSensorData();
-      EnergyData energyData = energyMonitor.getEnergyData();
-      httpClient.publishData(data, energyData);
-      lastHttpPublish = millis();
-    }
+}
+
+void taskStateCheck() {
+  hardware.checkStateTransition();
+}
+
+void taskEmergencyCheck() {
+  hardware.checkEmergencyConditions();
+}
+
+// Main loop telemetry sinks (data log)
+void taskTelemetry() {
+  pollTelemetry(loopSinks);
+}
+
+// System health check (memory only, publishing is on the network task)
+void taskHealthCheck() {
+  if (telemetry.read().sensor.batteryVoltage > 0) {
+    checkSystemHealth();
   }
   
-  // System health check every 30 seconds
-  if (timeElapsed(lastHealthCheck, 30000)) {
-    SensorData data = hardware.getSensorData();
-    if (data.batteryVoltage > 0) {
-      checkSystemHealth();
-    }
-    
-    // Log memory status for debugging
-    uint32_t freeHeap = ESP.getFreeHeap();
-    uint32_t minFreeHeap = ESP.getMinFreeHeap();
-    if (freeHeap < 15000) {
-      LOG_WARNING("Low free heap: " + String(freeHeap) + " bytes (min: " + String(minFreeHeap) + ")");
-    }
-    
-    lastHealthCheck = millis();
+  // Log memory status for debugging
+  MemoryStats mem = memTelemetry.getStats();
+  if (mem.freeBytes < 15000 || mem.largestBlock < WEB_PAGE_RESERVE) {
+    LOG_WARNING("Low free heap: %lu bytes (min: %lu, largest block: %lu, %.1f%% fragmented)",
+                (unsigned long)mem.freeBytes, (unsigned long)mem.minFreeBytes,
+                (unsigned long)mem.largestBlock, mem.fragmentationPercent);
   }
-  
-  // Formatted serial log every 30 seconds (only after warm-up)
-  if (headerPrinted && timeElapsed(lastSerialLog, SERIAL_LOG_INTERVAL)) {
+}
+
+// Heap walk for the memory telemetry
+void taskMemorySample() {
+  memTelemetry.sample();
+}
+
+// Formatted serial log (only after warm-up)
+void taskSerialLog() {
+  if (headerPrinted) {
     hardware.printStatusLine();
-    lastSerialLog = millis();
   }
-  
-  // Print header every 5 minutes
-  if (headerPrinted && timeElapsed(lastSerialHeader, SERIAL_LOG_HEADER_INTERVAL)) {
+}
+
+void taskSerialHeader() {
+  if (headerPrinted) {
     hardware.printStatusHeader();
-    lastSerialHeader = millis();
   }
-  
-  // Prevent watchdog timeout and allow other tasks to run
-  yield();
-  
-  // Small delay to help with timing and watchdog
-  delay(1);
 }
 
-// Helper function to safely check if time has elapsed (handles millis() overflow)
-bool timeElapsed(unsigned long startTime, unsigned long interval) {
-  return (millis() - startTime) >= interval;
+// LOW POWER while enabled and the station is DISCHARGING
+void taskPowerMode() {
+  bool wanted = g_lowPowerEnabled && telemetry.read().sensor.batteryState == STATE_DISCHARGING;
+  if (powerMgr.update(wanted)) {
+    profiler.setCpuMhz(getCpuFrequencyMhz());
+    hardware.setLowPowerAcquisition(wanted);
+  }
+}
+
+void registerLoopTasks() {
+  //           name              function            period                      phase  budget (us)
+  scheduler.add("sensorUpdate",  taskSensorUpdate,   SENSOR_UPDATE_INTERVAL,     0,     20000);
+  scheduler.add("telemetry",     taskTelemetry,      SENSOR_UPDATE_INTERVAL,     5,     100000);
+  scheduler.add("stateCheck",    taskStateCheck,     1000,                       10,    10000);
+  scheduler.add("emergency",     taskEmergencyCheck, 1000,                       20,    10000);
+  scheduler.add("powerMode",     taskPowerMode,      POWER_MODE_INTERVAL,        30,    10000);
+  scheduler.add("memory",        taskMemorySample,   MEMORY_SAMPLE_INTERVAL,     40,    10000);
+  scheduler.add("healthCheck",   taskHealthCheck,    HEALTH_CHECK_INTERVAL,      15550, 20000);
+  scheduler.add("serialLog",     taskSerialLog,      SERIAL_LOG_INTERVAL,        20750, 20000);
+  scheduler.add("serialHeader",  taskSerialHeader,   SERIAL_LOG_HEADER_INTERVAL, 25850, 20000);
+  LogSerial.println("[INIT] Loop scheduler: " + String(scheduler.getTaskCount()) + " periodic tasks");
+}
+
+// ===================================================================
+// PERIODIC NETWORK TASKS
+// ===================================================================
+
+// Profiler summary on <state topic>/perf
+void taskPerfPublish() {
+  if (!wifiMgr.isConnected() || !mqttClient.isConnected()) return;
+  mqttClient.publishPerf(profiler);
+}
+
+// Memory telemetry on <state topic>/memory
+void taskMemoryPublish() {
+  if (!wifiMgr.isConnected() || !mqttClient.isConnected()) return;
+  mqttClient.publishMemory(memTelemetry);
+}
+
+// New log text to the WebSocket clients that asked for the tail
+void taskLogTail() {
+  webServer.pushLogTail();
+}
+
+void registerNetworkTasks() {
+  //               name             function           period                 phase  budget (us)
+  netScheduler.add("perfPublish",   taskPerfPublish,   PERF_PUBLISH_INTERVAL, 20750, 50000);
+  netScheduler.add("memoryPublish", taskMemoryPublish, MEMORY_PUBLISH_INTERVAL, 35750, 50000);
+  netScheduler.add("logTail",       taskLogTail,       LOG_TAIL_INTERVAL,     250,   20000);
+  LogSerial.println("[INIT] Network scheduler: " + String(netScheduler.getTaskCount()) + " periodic tasks");
+}
+
+// ===================================================================
+// TELEMETRY SINKS
+// ===================================================================
+// Every consumer gets the same frame (one sample, one sequence number),
+// at its own rate. A sink returns false while it cannot deliver, the next
+// frame is offered again. MQTT, HTTP and WebSocket publish early when the
+// readings change and otherwise keep their heartbeat interval.
+
+// Offers the latest frame to the sinks of the calling task, once per frame.
+// A frame built just before a mains event would flip NUT/MQTT back to the
+// state handleMainsEvent() replaced, so the live fast-path state wins.
+void pollTelemetry(TelemetryFanout<TelemetryFrame>& sinks) {
+  if (sinks.isNew(telemetry.getSequence())) {
+    TelemetryFrame frame = telemetry.read();
+    hardware.refreshMainsState(frame.sensor);
+    sinks.publish(frame);
+  }
+}
+
+bool telemetryChanged(const TelemetryFrame& last, const TelemetryFrame& now) {
+  const SensorData& a = last.sensor;
+  const SensorData& b = now.sensor;
+  return a.batteryState != b.batteryState ||
+         a.onBattery != b.onBattery ||
+         a.mainsLost != b.mainsLost ||
+         fabsf(b.mainPower - a.mainPower) >= TELEMETRY_POWER_DELTA_W ||
+         fabsf(b.outputPower - a.outputPower) >= TELEMETRY_POWER_DELTA_W ||
+         fabsf(b.batteryVoltage - a.batteryVoltage) >= TELEMETRY_VOLTAGE_DELTA_V ||
+         fabsf(b.batteryPercentage - a.batteryPercentage) >= TELEMETRY_SOC_DELTA;
+}
+
+// Main loop
+bool sinkDataLog(const TelemetryFrame& frame) {
+  if (!hardware.getIsWarmedUp() || frame.sensor.batteryVoltage <= 0) return false;
+  PerfScope scope(profiler, PERF_STAGE_LOG_DATA);
+  dataLogger.logData(frame.sensor, frame.energy);
+  return true;
+}
+
+// Network task: NUT status (only after warm-up)
+bool sinkNut(const TelemetryFrame& frame) {
+  if (frame.sensor.batteryVoltage <= 0) return false;
+  upsProtocol.updateStatus(frame.sensor);
+  return true;
+}
+
+bool sinkWebSocket(const TelemetryFrame& frame) {
+  return webServer.broadcastData(frame);
+}
+
+bool sinkMqtt(const TelemetryFrame& frame) {
+  if (!wifiMgr.isConnected() || !mqttClient.isConnected()) return false;
+  PerfScope scope(profiler, PERF_STAGE_PUBLISH);
+  mqttClient.publishData(frame);
+  return true;
+}
+
+bool sinkHttp(const TelemetryFrame& frame) {
+  if (!wifiMgr.isConnected() || !httpClient.isEnabled()) return false;
+  PerfScope scope(profiler, PERF_STAGE_PUBLISH);
+  httpClient.publishData(frame);
+  return true;
+}
+
+void registerTelemetrySinks() {
+  //           name          sink           min interval (ms)          heartbeat (ms)          change filter
+  loopSinks.add("dataLog",   sinkDataLog,   DATA_LOG_INTERVAL,         DATA_LOG_INTERVAL,      nullptr);
+  netSinks.add("nut",        sinkNut,       0,                         0,                      nullptr);
+  netSinks.add("websocket",  sinkWebSocket, WS_BROADCAST_MIN_INTERVAL, WS_BROADCAST_INTERVAL,  telemetryChanged);
+  netSinks.add("mqtt",       sinkMqtt,      MQTT_PUBLISH_MIN_INTERVAL, MQTT_PUBLISH_INTERVAL,  telemetryChanged);
+  netSinks.add("http",       sinkHttp,      HTTP_PUBLISH_MIN_INTERVAL, HTTP_PUBLISH_INTERVAL,  telemetryChanged);
+  // The data log writes its first entry one interval after boot, as it always did
+  loopSinks.deferFirst(0);
+  LogSerial.println("[INIT] Telemetry: " + String(loopSinks.getSinkCount() + netSinks.getSinkCount()) + " sinks");
 }
 
 
@@ -366,24 +585,26 @@ bool timeElapsed(unsigned long startTime, unsigned long interval) {
 void checkSystemHealth() {
   // Check for low memory
   if (ESP.getFreeHeap() < 10000) {
-    LOG_WARNING("Low memory: " + String(ESP.getFreeHeap()) + " bytes");
+    LOG_WARNING("Low memory: %lu bytes", (unsigned long)ESP.getFreeHeap());
   }
   
-  // Check sensor health
+  // Emergency conditions are handled in checkEmergencyConditions(),
+  // publishing by the telemetry sinks on the network task
+}
+
+
+// Network task
+void handleMainsEvent(const AdcMainsEvent& event) {
+  // getSensorData() already reports onBattery while the fast path flags an outage
   SensorData data = hardware.getSensorData();
   
-  // Emergency conditions are handled in checkEmergencyConditions()
-  
-  // Publish data during health check if connected
-  if (wifiMgr.isConnected()) {
-    EnergyData energyData = energyMonitor.getEnergyData();
-    
-    if (mqttClient.isConnected()) {
-      mqttClient.publishData(data, energyData);
-    }
-    
-    if (httpClient.isEnabled()) {
-      httpClient.publishData(data, energyData);
-    }
+  if (data.batteryVoltage > 0) {
+    upsProtocol.updateStatus(data);
   }
+  webServer.notifyMainsEvent(event.lost, (event.detectedUs - event.onsetUs) / 1000.0);
+  if (wifiMgr.isConnected() && mqttClient.isConnected()) {
+    mqttClient.publishOnBattery(data.onBattery);
+  }
+  
+  hardware.recordMainsNotified(event);
 }
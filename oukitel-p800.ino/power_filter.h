@@ -0,0 +1,117 @@
+/*
+ * Power Filter - Selectable smoothing for the IN/OUT power readings
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * EMA:       fixed alpha, the original filterPowerIN/OUT behaviour.
+ * ADAPTIVE:  the cutoff follows the innovation |raw - filtered|. Small
+ *            deviations (clamp noise at idle) use alpha, a deviation of
+ *            stepWatts or more uses alphaMax, so a load switching on is
+ *            tracked within a reading while idle jitter stays smoothed.
+ * Median-of-3 can be put in front of either one to drop single-reading
+ * spikes (costs one reading of delay on a real step).
+ */
+
+#ifndef POWER_FILTER_H
+#define POWER_FILTER_H
+
+#include <stdint.h>
+
+enum PowerFilterType {
+  POWER_FILTER_EMA = 0,
+  POWER_FILTER_ADAPTIVE = 1,
+  POWER_FILTER_TYPE_COUNT
+};
+
+// Per-channel settings (the base alpha is the shared powerFilterAlpha)
+struct PowerFilterParams {
+  uint8_t type;           // PowerFilterType
+  bool median3;           // Median-of-3 pre-filter
+  float alphaMax;         // ADAPTIVE: alpha for deviations >= stepWatts
+  float stepWatts;        // ADAPTIVE: deviation treated as a real load step
+};
+
+class PowerFilter {
+private:
+  PowerFilterParams params;
+  float alpha;
+  float value;
+  float history[3];       // Last raw readings for the median (oldest first)
+  int historyCount;
+  bool initialized;
+
+  static float median3(float a, float b, float c) {
+    if (a > b) { float t = a; a = b; b = t; }
+    if (b > c) { b = c; }
+    return (a > b) ? a : b;
+  }
+
+public:
+  PowerFilter() : alpha(1), value(0), historyCount(0), initialized(false) {
+    params.type = POWER_FILTER_EMA;
+    params.median3 = false;
+    params.alphaMax = 1;
+    params.stepWatts = 1;
+    history[0] = history[1] = history[2] = 0;
+  }
+
+  // Cheap, can be called before every update to follow the settings
+  void configure(const PowerFilterParams& newParams, float baseAlpha) {
+    params = newParams;
+    if (params.type >= POWER_FILTER_TYPE_COUNT) params.type = POWER_FILTER_EMA;
+    if (params.stepWatts < 1) params.stepWatts = 1;
+    alpha = baseAlpha;
+    if (params.alphaMax < alpha) params.alphaMax = alpha;
+  }
+
+  void reset() {
+    initialized = false;
+    historyCount = 0;
+    value = 0;
+  }
+
+  // First reading, taken as is
+  void initialize(float raw) {
+    value = raw;
+    history[0] = history[1] = history[2] = raw;
+    historyCount = 3;
+    initialized = true;
+  }
+
+  bool isInitialized() const {
+    return initialized;
+  }
+
+  float update(float raw) {
+    if (!initialized) {
+      initialize(raw);
+      return value;
+    }
+
+    float input = raw;
+    if (params.median3) {
+      history[0] = history[1];
+      history[1] = history[2];
+      history[2] = raw;
+      input = median3(history[0], history[1], history[2]);
+    }
+
+    float k = alpha;
+    if (params.type == POWER_FILTER_ADAPTIVE) {
+      float deviation = input - value;
+      if (deviation < 0) deviation = -deviation;
+      float ratio = deviation / params.stepWatts;
+      if (ratio > 1) ratio = 1;
+      // Squared, so noise well below the step size stays at the base alpha
+      k = alpha + (params.alphaMax - alpha) * ratio * ratio;
+    }
+
+    value += k * (input - value);
+    return value;
+  }
+
+  float get() const {
+    return value;
+  }
+};
+
+#endif // POWER_FILTER_H
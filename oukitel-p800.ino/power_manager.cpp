@@ -0,0 +1,107 @@
+/*
+ * Power Manager Implementation
+ */
+
+#include "power_manager.h"
+#include "logger.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+
+
+PowerManager::PowerManager() {
+  lowPower = false;
+  transitions = 0;
+  startUs = 0;
+  lowPowerSinceUs = 0;
+  lowPowerTotalUs = 0;
+  awakeSinceUs = 0;
+}
+
+
+void PowerManager::begin() {
+  startUs = esp_timer_get_time();
+  awakeSinceUs = startUs;
+}
+
+
+void PowerManager::applyWiFiSleep(bool save) {
+  if (!(WiFi.getMode() & WIFI_MODE_STA)) return;   // AP mode cannot sleep
+
+  if (save) {
+    // Used by max modem sleep; a reconnect keeps it (0 would mean the default of 3)
+    wifi_config_t conf;
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK) {
+      conf.sta.listen_interval = LOW_POWER_LISTEN_INTERVAL;
+      esp_wifi_set_config(WIFI_IF_STA, &conf);
+    }
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+  } else {
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);   // Arduino default
+  }
+}
+
+
+bool PowerManager::update(bool wanted) {
+  if (wanted == lowPower) return false;
+
+  int64_t now = esp_timer_get_time();
+  lowPower = wanted;
+  transitions++;
+
+  if (lowPower) {
+    lowPowerSinceUs = now;
+    setCpuFrequencyMhz(LOW_POWER_CPU_MHZ);
+    applyWiFiSleep(true);
+    LOG_INFO("Power: low power on battery (%lu MHz, WiFi max modem sleep)", (unsigned long)getCpuFrequencyMhz());
+  } else {
+    lowPowerTotalUs += now - lowPowerSinceUs;
+    setCpuFrequencyMhz(NORMAL_CPU_MHZ);
+    applyWiFiSleep(false);
+    LOG_INFO("Power: normal (%lu MHz)", (unsigned long)getCpuFrequencyMhz());
+  }
+  return true;
+}
+
+
+bool PowerManager::isLowPower() const {
+  return lowPower;
+}
+
+
+void PowerManager::sleepStart() {
+  int64_t now = esp_timer_get_time();
+  loopAwake.add(now - awakeSinceUs, now);
+}
+
+
+void PowerManager::sleepEnd() {
+  awakeSinceUs = esp_timer_get_time();
+}
+
+
+PowerStats PowerManager::getStats() {
+  PowerStats stats;
+  int64_t now = esp_timer_get_time();
+
+  stats.lowPower = lowPower;
+  stats.cpuMhz = getCpuFrequencyMhz();
+
+  wifi_ps_type_t ps = WIFI_PS_NONE;
+  esp_wifi_get_ps(&ps);
+  stats.wifiSleep = (int)ps;
+
+  wifi_config_t conf;
+  stats.listenInterval = 0;
+  if ((WiFi.getMode() & WIFI_MODE_STA) && esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK) {
+    stats.listenInterval = conf.sta.listen_interval;
+  }
+
+  stats.loopDutyPercent = loopAwake.getUsPerSecond() / 10000.0f;
+
+  int64_t lowPowerUs = lowPowerTotalUs + (lowPower ? now - lowPowerSinceUs : 0);
+  int64_t totalUs = now - startUs;
+  stats.lowPowerPercent = totalUs > 0 ? (float)(lowPowerUs * 100.0 / totalUs) : 0;
+  stats.transitions = transitions;
+  return stats;
+}
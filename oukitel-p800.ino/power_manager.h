@@ -0,0 +1,70 @@
+/*
+ * Power Manager - Power saving for the ESP32 itself while the power station
+ * is DISCHARGING (the ESP32 is supplied from that same battery)
+ *
+ * LOW POWER: CPU at 80 MHz, WiFi modem sleep (radio off between beacons,
+ * listen interval LOW_POWER_LISTEN_INTERVAL) and a main loop that sleeps
+ * until its next scheduled task instead of waking every 1 ms. While every
+ * task waits, the idle task parks the cores (WAITI).
+ *
+ * Light sleep is not used: the continuous ADC driver keeps the APB clock
+ * locked, and the clamps have to keep sampling on battery for the SOC and
+ * the mains-restore detection.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include "config.h"
+#include "acq_scheduler.h"
+
+struct PowerStats {
+  bool lowPower;
+  uint32_t cpuMhz;
+  int wifiSleep;                // wifi_ps_type_t in use
+  int listenInterval;           // Beacons between wake-ups in max modem sleep
+  float loopDutyPercent;        // Main loop awake share of the last ~1 s
+  float lowPowerPercent;        // Share of the uptime spent in LOW POWER
+  uint32_t transitions;
+};
+
+class PowerManager {
+private:
+  bool lowPower;
+  uint32_t transitions;
+  int64_t startUs;
+  int64_t lowPowerSinceUs;
+  int64_t lowPowerTotalUs;
+
+  // Main loop duty cycle
+  CpuLoadMeter loopAwake;
+  int64_t awakeSinceUs;
+
+  void applyWiFiSleep(bool save);
+
+public:
+  PowerManager();
+  void begin();
+
+  // Main loop. wanted: power saving enabled and the station discharging.
+  // Returns true when the mode changed.
+  bool update(bool wanted);
+  bool isLowPower() const;
+
+  // Bracket the main loop's sleep between iterations (duty cycle)
+  void sleepStart();
+  void sleepEnd();
+
+  PowerStats getStats();
+};
+
+inline const char* wifiSleepName(int mode) {
+  switch (mode) {
+    case 0:  return "none";
+    case 1:  return "min_modem";
+    case 2:  return "max_modem";
+    default: return "unknown";
+  }
+}
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,196 @@
+/*
+ * RMS Kernel - Per-sample current RMS math shared by the ADC sampler
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC
+ * and fed with synthetic or recorded ADC traces.
+ */
+
+#ifndef RMS_KERNEL_H
+#define RMS_KERNEL_H
+
+#include <stdint.h>
+#include <math.h>
+
+// EmonLib tracks the DC bias with a 1/ADC_COUNTS low-pass (ADC_COUNTS is
+// 1024 on ESP32 builds of EmonLib), keep the same time constant
+#define RMS_OFFSET_FILTER_DIV   1024.0
+#define RMS_OFFSET_FILTER_SHIFT 10        // log2(RMS_OFFSET_FILTER_DIV)
+
+// Fixed-point kernel formats: offset in Q16, filtered samples in Q4
+#define RMS_Q_OFFSET_BITS       16
+#define RMS_Q_SAMPLE_BITS       4
+
+// Documented agreement between the fixed-point and the reference kernel,
+// on the RMS in ADC counts: |rmsQ - rmsRef| <= ABS + REL * rmsRef
+#define RMS_Q_TOLERANCE_ABS     0.05
+#define RMS_Q_TOLERANCE_REL     0.001
+
+// ===================================================================
+// REFERENCE KERNEL (same math as EmonLib calcIrms)
+// ===================================================================
+struct RmsAccumulator {
+  double offset;      // Running DC offset estimate (ADC counts)
+  double sumSq;       // Sum of squared, offset-free samples in the window
+  uint32_t count;     // Samples accumulated in the window
+
+  void reset(double initialOffset) {
+    offset = initialOffset;
+    sumSq = 0;
+    count = 0;
+  }
+
+  // Returns the offset-free sample
+  inline double add(int sample) {
+    offset = offset + (sample - offset) / RMS_OFFSET_FILTER_DIV;
+    double filtered = sample - offset;
+    sumSq += filtered * filtered;
+    count++;
+    return filtered;
+  }
+
+  double meanSquare() const {
+    return count > 0 ? sumSq / count : 0.0;
+  }
+
+  void clearWindow() {
+    sumSq = 0;
+    count = 0;
+  }
+};
+
+// ===================================================================
+// FIXED-POINT KERNEL (no double math per sample, used by the sampler)
+// ===================================================================
+// The ESP32 has no double-precision FPU, so the reference kernel runs in
+// software emulation. This one keeps the offset in Q16, the high-passed
+// sample in Q4 (+/-65520 for 12-bit input) and accumulates the squares in
+// 64 bits, which never overflows for any realistic window length.
+struct RmsAccumulatorQ {
+  int32_t offsetQ;    // Running DC offset estimate, Q16 ADC counts
+  uint64_t sumSq;     // Sum of squared Q4 samples (Q8)
+  uint32_t count;     // Samples accumulated in the window
+
+  void reset(double initialOffset) {
+    offsetQ = (int32_t)(initialOffset * (1 << RMS_Q_OFFSET_BITS));
+    sumSq = 0;
+    count = 0;
+  }
+
+  // Returns the offset-free sample in Q4 (used for zero-crossing detection)
+  inline int32_t add(int sample) {
+    int32_t diffQ = (sample << RMS_Q_OFFSET_BITS) - offsetQ;
+    offsetQ += diffQ >> RMS_OFFSET_FILTER_SHIFT;
+    diffQ = (sample << RMS_Q_OFFSET_BITS) - offsetQ;
+    // Round to Q4
+    int32_t filtered = (diffQ + (1 << (RMS_Q_OFFSET_BITS - RMS_Q_SAMPLE_BITS - 1))) >> (RMS_Q_OFFSET_BITS - RMS_Q_SAMPLE_BITS);
+    sumSq += (uint64_t)((int64_t)filtered * filtered);
+    count++;
+    return filtered;
+  }
+
+  // Mean square in ADC counts^2 (same units as RmsAccumulator)
+  double meanSquare() const {
+    if (count == 0) return 0.0;
+    return (double)sumSq / count / (double)(1 << (2 * RMS_Q_SAMPLE_BITS));
+  }
+
+  void clearWindow() {
+    sumSq = 0;
+    count = 0;
+  }
+};
+
+// True if a fixed-point RMS (ADC counts) is within the documented tolerance
+inline bool rmsWithinTolerance(double rmsQ, double rmsRef) {
+  return fabs(rmsQ - rmsRef) <= RMS_Q_TOLERANCE_ABS + RMS_Q_TOLERANCE_REL * rmsRef;
+}
+
+// ===================================================================
+// KERNEL COMPARISON HELPERS (benchmark on recorded or synthetic traces)
+// ===================================================================
+// RMS (ADC counts) of a whole trace with the reference kernel
+inline double referenceTraceRms(const uint16_t* samples, uint32_t count, double initialOffset) {
+  RmsAccumulator acc;
+  acc.reset(initialOffset);
+  for (uint32_t i = 0; i < count; i++) {
+    acc.add(samples[i]);
+  }
+  return sqrt(acc.meanSquare());
+}
+
+// RMS (ADC counts) of a whole trace with the fixed-point kernel
+inline double fixedTraceRms(const uint16_t* samples, uint32_t count, double initialOffset) {
+  RmsAccumulatorQ acc;
+  acc.reset(initialOffset);
+  for (uint32_t i = 0; i < count; i++) {
+    acc.add(samples[i]);
+  }
+  return sqrt(acc.meanSquare());
+}
+
+// Synthetic clamp signal: DC bias + sine (peak in ADC counts) + a little
+// deterministic dither, clipped to the 12-bit ADC range
+inline void synthesizeCurrentTrace(uint16_t* dest, uint32_t count, double bias, double peak,
+                                   double mainsHz, double sampleRateHz) {
+  uint32_t dither = 12345;
+  for (uint32_t i = 0; i < count; i++) {
+    dither = dither * 1103515245u + 12345u;
+    double v = bias + peak * sin(2.0 * M_PI * mainsHz * i / sampleRateHz) + (int)((dither >> 16) % 5) - 2;
+    if (v < 0) v = 0;
+    if (v > 4095) v = 4095;
+    dest[i] = (uint16_t)v;
+  }
+}
+
+// ===================================================================
+// ZERO-CROSSING DETECTOR (rising edges of the offset-free signal)
+// ===================================================================
+struct ZeroCrossDetector {
+  int32_t hysteresis;     // Signal must leave +/- hysteresis to count as a crossing
+  int polarity;           // -1 below -hysteresis, +1 above +hysteresis, 0 unknown
+  uint32_t sampleIndex;   // Samples seen since reset
+  uint32_t lastCross;     // sampleIndex of the last rising crossing (0 = none)
+  uint32_t period;        // Samples between the last two rising crossings (0 = unknown)
+
+  void reset(int32_t hyst) {
+    hysteresis = hyst;
+    polarity = 0;
+    sampleIndex = 0;
+    lastCross = 0;
+    period = 0;
+  }
+
+  // Returns true on a negative -> positive transition
+  inline bool update(int32_t filtered) {
+    sampleIndex++;
+    if (filtered < -hysteresis) {
+      polarity = -1;
+      return false;
+    }
+    if (filtered > hysteresis) {
+      bool rising = (polarity < 0);
+      polarity = 1;
+      if (rising) {
+        if (lastCross > 0) period = sampleIndex - lastCross;
+        lastCross = sampleIndex;
+      }
+      return rising;
+    }
+    return false;
+  }
+};
+
+// Snap a measured frequency to the 50 or 60 Hz mains standard, 0 if neither
+inline int nominalMainsFrequency(double hz) {
+  if (hz >= 45.0 && hz < 55.0) return 50;
+  if (hz >= 55.0 && hz <= 65.0) return 60;
+  return 0;
+}
+
+// Convert a mean square (ADC counts^2) into amps, using the same ratio as
+// EmonLib: ICAL * ((SupplyVoltage / 1000.0) / ADC_COUNTS) with 3300 mV supply
+inline double rmsToIrms(double meanSquare, double calibration, double adcCounts) {
+  double ratio = calibration * (3.3 / adcCounts);
+  return ratio * sqrt(meanSquare);
+}
+
+#endif // RMS_KERNEL_H
@@ -0,0 +1,60 @@
+/*
+ * SeqLock Snapshot - Single-writer / multi-reader snapshot of a POD struct
+ * Readers never block and never see a torn value: they retry if the
+ * writer was active while they were copying.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+template <typename T>
+class SeqLockSnapshot {
+private:
+  std::atomic<uint32_t> sequence;
+  T value;
+  portMUX_TYPE writerLock;
+
+public:
+  SeqLockSnapshot() : sequence(0) {
+    memset(&value, 0, sizeof(T));
+    writerLock = portMUX_INITIALIZER_UNLOCKED;
+  }
+
+  // Writer side (one task only). The critical section keeps the writer from
+  // being preempted mid-copy, so readers on the same core cannot spin forever.
+  void write(const T& newValue) {
+    portENTER_CRITICAL(&writerLock);
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&value, &newValue, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_release);
+    sequence.store(seq + 2, std::memory_order_release);
+    portEXIT_CRITICAL(&writerLock);
+  }
+
+  // Reader side (any task/core), never blocks
+  T read() const {
+    T copy;
+    uint32_t before;
+    uint32_t after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      memcpy(&copy, (const void*)&value, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copy;
+  }
+
+  // Number of completed writes (even values only)
+  uint32_t getSequence() const {
+    return sequence.load(std::memory_order_acquire) / 2;
+  }
+};
+
+#endif // SEQLOCK_H
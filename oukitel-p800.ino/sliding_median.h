@@ -0,0 +1,136 @@
+/*
+ * Sliding Median - Median and rank counts over the last N samples
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * Samples are kept twice: in a ring (arrival order, to know which one
+ * leaves the window) and in an ascending array. A new sample is placed by
+ * binary search and the oldest one is removed the same way, so the median
+ * is a direct read and "how many samples are above/below x" is a binary
+ * search instead of a scan. Moving the tail of the sorted array is one
+ * memmove of at most N floats.
+ */
+
+#ifndef SLIDING_MEDIAN_H
+#define SLIDING_MEDIAN_H
+
+#include <string.h>
+
+template <int N>
+class SlidingMedian {
+private:
+  float ring[N];        // Arrival order
+  float sorted[N];      // Ascending
+  int window;           // Active window size (1..N)
+  int count;
+  int head;             // Next ring slot to write
+
+  // First index with sorted[i] >= value
+  int lowerBound(float value) const {
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (sorted[mid] < value) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+public:
+  SlidingMedian() : window(N), count(0), head(0) {}
+
+  // Empty the window and set its size (clamped to 1..N)
+  void reset(int size) {
+    if (size < 1) size = 1;
+    if (size > N) size = N;
+    window = size;
+    count = 0;
+    head = 0;
+  }
+
+  void push(float value) {
+    if (count == window) {
+      // Drop the sample that leaves the window (equal values are interchangeable)
+      int old = lowerBound(ring[head]);
+      memmove(&sorted[old], &sorted[old + 1], sizeof(float) * (count - old - 1));
+      count--;
+    }
+    int pos = lowerBound(value);
+    memmove(&sorted[pos + 1], &sorted[pos], sizeof(float) * (count - pos));
+    sorted[pos] = value;
+    count++;
+
+    ring[head] = value;
+    head++;
+    if (head >= window) head = 0;
+  }
+
+  // Same rule as the original sort-based median: mean of the two middle
+  // samples for an even count
+  float median() const {
+    if (count == 0) return 0;
+    if (count % 2 == 0) {
+      return (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0;
+    }
+    return sorted[count / 2];
+  }
+
+  // Samples strictly above / below a threshold (compared in double, as
+  // the original loops did with "sample > displayed + 1.0")
+  int countAbove(double threshold) const {
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if ((double)sorted[mid] > threshold) hi = mid;
+      else lo = mid + 1;
+    }
+    return count - lo;
+  }
+
+  int countBelow(double threshold) const {
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if ((double)sorted[mid] < threshold) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  int size() const {
+    return count;
+  }
+
+  int capacity() const {
+    return window;
+  }
+
+  // Ring slot the next sample goes to (wraps at the window size)
+  int nextSlot() const {
+    return head;
+  }
+};
+
+// Original getMedianSOC(): copy and sort (O(n^2)), kept as the reference
+// for benchmarks and agreement checks. tmp must hold count floats.
+inline float slidingMedianReference(const float* samples, int count, float* tmp) {
+  if (count == 0) return 0;
+  for (int i = 0; i < count; i++) tmp[i] = samples[i];
+  for (int i = 0; i < count - 1; i++) {
+    for (int j = i + 1; j < count; j++) {
+      if (tmp[i] > tmp[j]) {
+        float t = tmp[i];
+        tmp[i] = tmp[j];
+        tmp[j] = t;
+      }
+    }
+  }
+  if (count % 2 == 0) {
+    return (tmp[count / 2 - 1] + tmp[count / 2]) / 2.0;
+  }
+  return tmp[count / 2];
+}
+
+#endif // SLIDING_MEDIAN_H
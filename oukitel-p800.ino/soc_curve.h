@@ -0,0 +1,213 @@
+/*
+ * SOC Curve - Voltage to state-of-charge lookup engine
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * Curves use the same {percent, voltage} rows as BATTERY_CURVE_* in
+ * config.h, in any order. Points are stored by ascending voltage and the
+ * result is linearly interpolated between them. A uniform voltage grid
+ * (SOC_CURVE_GRID_STEP) built at load time maps a voltage to the segment
+ * it falls in, so a lookup is O(1). When a grid cell spans more than one
+ * curve point, a binary search over that cell's range finishes the job.
+ */
+
+#ifndef SOC_CURVE_H
+#define SOC_CURVE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define SOC_CURVE_MAX_POINTS    48
+#define SOC_CURVE_GRID_STEP     0.01f   // 10 mV
+#define SOC_CURVE_GRID_MAX      512     // Cells, the step widens beyond 5.12 V span
+#define SOC_CURVE_MAX_CURVES    6
+#define SOC_CURVE_NAME_LEN      16
+
+class SocCurve {
+private:
+  float volts[SOC_CURVE_MAX_POINTS];      // Ascending
+  float percents[SOC_CURVE_MAX_POINTS];
+  int count;
+
+  // grid[c] = last point with volts <= start of cell c (cells + 1 entries)
+  float gridMin;
+  float gridInvStep;
+  int gridCells;
+  uint8_t grid[SOC_CURVE_GRID_MAX + 1];
+
+  // Last index in [lo, hi] with volts[i] <= v (volts[lo] <= v assumed)
+  int searchRange(float v, int lo, int hi) const {
+    while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if (volts[mid] <= v) lo = mid;
+      else hi = mid - 1;
+    }
+    return lo;
+  }
+
+  float interpolate(int i, float v) const {
+    if (i >= count - 1) return percents[count - 1];
+    float span = volts[i + 1] - volts[i];
+    if (span <= 0) return percents[i];
+    return percents[i] + (v - volts[i]) * (percents[i + 1] - percents[i]) / span;
+  }
+
+  void buildGrid() {
+    gridMin = volts[0];
+    float range = volts[count - 1] - gridMin;
+    gridCells = (int)(range / SOC_CURVE_GRID_STEP) + 1;
+    if (gridCells > SOC_CURVE_GRID_MAX) gridCells = SOC_CURVE_GRID_MAX;
+    float step = range > 0 ? range / gridCells : SOC_CURVE_GRID_STEP;
+    gridInvStep = 1.0f / step;
+
+    int i = 0;
+    for (int c = 0; c <= gridCells; c++) {
+      float cellStart = gridMin + c * step;
+      while (i < count - 1 && volts[i + 1] <= cellStart) {
+        i++;
+      }
+      grid[c] = (uint8_t)i;
+    }
+  }
+
+public:
+  SocCurve() : count(0), gridMin(0), gridInvStep(0), gridCells(0) {}
+
+  // Load {percent, voltage} rows. Needs at least 2 points, percent 0..100.
+  // On error the current curve is left untouched.
+  bool load(const float (*table)[2], int n) {
+    if (n < 2 || n > SOC_CURVE_MAX_POINTS) return false;
+    for (int i = 0; i < n; i++) {
+      if (table[i][0] < 0.0f || table[i][0] > 100.0f || table[i][1] <= 0.0f) return false;
+    }
+
+    // Insertion sort by (voltage, percent): with equal voltages the higher
+    // percent wins, as with the original top-down linear walk
+    float v[SOC_CURVE_MAX_POINTS];
+    float p[SOC_CURVE_MAX_POINTS];
+    for (int i = 0; i < n; i++) {
+      int j = i;
+      while (j > 0 && (v[j - 1] > table[i][1] || (v[j - 1] == table[i][1] && p[j - 1] > table[i][0]))) {
+        v[j] = v[j - 1];
+        p[j] = p[j - 1];
+        j--;
+      }
+      v[j] = table[i][1];
+      p[j] = table[i][0];
+    }
+    if (!(v[n - 1] > v[0])) return false;
+
+    memcpy(volts, v, sizeof(float) * n);
+    memcpy(percents, p, sizeof(float) * n);
+    count = n;
+    buildGrid();
+    return true;
+  }
+
+  // Grid lookup, O(1) unless a 10 mV cell holds several curve points
+  float percentAt(float voltage) const {
+    if (count < 2) return 0.0f;
+    if (voltage <= volts[0]) return percents[0];
+    if (voltage >= volts[count - 1]) return percents[count - 1];
+
+    int cell = (int)((voltage - gridMin) * gridInvStep);
+    if (cell < 0) cell = 0;
+    if (cell >= gridCells) cell = gridCells - 1;
+
+    int lo = grid[cell];
+    int hi = grid[cell + 1];
+    int i = (lo == hi) ? lo : searchRange(voltage, lo, hi);
+    return interpolate(i, voltage);
+  }
+
+  // Pure binary search over all points (fallback / benchmark reference)
+  float percentAtBinary(float voltage) const {
+    if (count < 2) return 0.0f;
+    if (voltage <= volts[0]) return percents[0];
+    if (voltage >= volts[count - 1]) return percents[count - 1];
+    return interpolate(searchRange(voltage, 0, count - 1), voltage);
+  }
+
+  int size() const {
+    return count;
+  }
+
+  // Point i as {percent, voltage}, ascending voltage
+  void point(int i, float& percent, float& voltage) const {
+    percent = percents[i];
+    voltage = volts[i];
+  }
+};
+
+// Original linear walk over a {percent, voltage} table ordered from 100%
+// down to 0% (voltageToBatteryPercent before the curve engine), kept as
+// the reference for benchmarks and agreement checks
+inline float socCurveLinearReference(const float (*curve)[2], int points, float voltage) {
+  if (voltage <= curve[points - 1][1]) return 0.0f;
+  if (voltage >= curve[0][1]) return 100.0f;
+  for (int i = 0; i < points - 1; i++) {
+    float percentHigh = curve[i][0];
+    float voltageHigh = curve[i][1];
+    float percentLow = curve[i + 1][0];
+    float voltageLow = curve[i + 1][1];
+    if (voltage >= voltageLow && voltage <= voltageHigh) {
+      return percentLow + (voltage - voltageLow) * (percentHigh - percentLow) / (voltageHigh - voltageLow);
+    }
+  }
+  return 0.0f;
+}
+
+// ===================================================================
+// CURVE SET (named curves, one selected for discharge/rest and one for charge)
+// ===================================================================
+struct SocCurveSet {
+  SocCurve curves[SOC_CURVE_MAX_CURVES];
+  char names[SOC_CURVE_MAX_CURVES][SOC_CURVE_NAME_LEN];
+  int count;
+  int dischargeIndex;
+  int chargeIndex;
+
+  void clear() {
+    count = 0;
+    dischargeIndex = 0;
+    chargeIndex = 0;
+  }
+
+  int find(const char* name) const {
+    for (int i = 0; i < count; i++) {
+      if (strncmp(names[i], name, SOC_CURVE_NAME_LEN) == 0) return i;
+    }
+    return -1;
+  }
+
+  // Add or replace a named curve, returns its index or -1
+  int add(const char* name, const float (*table)[2], int n) {
+    if (name == nullptr || name[0] == '\0' || strlen(name) >= SOC_CURVE_NAME_LEN) return -1;
+    int idx = find(name);
+    if (idx < 0) {
+      if (count >= SOC_CURVE_MAX_CURVES) return -1;
+      idx = count;
+    }
+    if (!curves[idx].load(table, n)) return -1;
+    if (idx == count) {
+      strncpy(names[idx], name, SOC_CURVE_NAME_LEN);
+      count++;
+    }
+    return idx;
+  }
+
+  bool select(const char* dischargeName, const char* chargeName) {
+    int d = find(dischargeName);
+    int c = find(chargeName);
+    if (d < 0 || c < 0) return false;
+    dischargeIndex = d;
+    chargeIndex = c;
+    return true;
+  }
+
+  float percentAt(bool charging, float voltage) const {
+    if (count == 0) return 0.0f;
+    return curves[charging ? chargeIndex : dischargeIndex].percentAt(voltage);
+  }
+};
+
+#endif // SOC_CURVE_H
@@ -0,0 +1,111 @@
+/*
+ * SOC Estimator - Coulomb counting fused with the voltage curve
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * One-state Kalman filter on SOC (%). predict() integrates the battery
+ * current over the time step and grows the variance by the process noise
+ * (current clamp and efficiency errors). correct() pulls the estimate
+ * towards the voltage-curve SOC, weighted by the two variances. It is only
+ * meant to be called at REST, where the terminal voltage is close to the
+ * open-circuit voltage the curves were measured for. bypass() covers the
+ * pass-through case, where REST rarely happens under a load.
+ */
+
+#ifndef SOC_ESTIMATOR_H
+#define SOC_ESTIMATOR_H
+
+// AC-side powers -> battery-side current (A, positive = charging).
+// Net power below the deadband (clamp noise, standby) counts as zero.
+inline float socBatteryCurrent(float powerIn, float powerOut, float batteryVoltage,
+                               float chargeEfficiency, float dischargeEfficiency,
+                               float deadbandW, float minVoltage) {
+  float netW = powerIn - powerOut;
+  if (netW > -deadbandW && netW < deadbandW) return 0;
+  float batteryW = (netW > 0) ? netW * chargeEfficiency : netW / dischargeEfficiency;
+  if (batteryVoltage < minVoltage) batteryVoltage = minVoltage;
+  return batteryW / batteryVoltage;
+}
+
+class SocEstimator {
+private:
+  float soc;              // %
+  float variance;         // %^2
+  float capacityAh;
+  bool initialized;
+
+  void clampSoc() {
+    if (soc < 0) soc = 0;
+    if (soc > 100) soc = 100;
+  }
+
+public:
+  SocEstimator() : soc(0), variance(0), capacityAh(1), initialized(false) {}
+
+  void setCapacity(float ampHours) {
+    capacityAh = ampHours > 0.1f ? ampHours : 0.1f;
+  }
+
+  float getCapacity() const {
+    return capacityAh;
+  }
+
+  // Forget the estimate, the next reading re-initializes it
+  void reset() {
+    initialized = false;
+    soc = 0;
+    variance = 0;
+  }
+
+  // Start from a voltage-curve SOC with its (large) uncertainty
+  void initialize(float initialSoc, float initialVariance) {
+    soc = initialSoc;
+    variance = initialVariance;
+    initialized = true;
+    clampSoc();
+  }
+
+  bool isInitialized() const {
+    return initialized;
+  }
+
+  // batteryAmps: positive = charging. processNoise in %^2 per second.
+  void predict(float batteryAmps, float dtSeconds, float processNoise) {
+    if (!initialized || dtSeconds <= 0) return;
+    soc += batteryAmps * dtSeconds / 3600.0f / capacityAh * 100.0f;
+    variance += processNoise * dtSeconds;
+    clampSoc();
+  }
+
+  // measurementNoise: variance (%^2) of one voltage-curve SOC reading
+  void correct(float measuredSoc, float measurementNoise) {
+    if (!initialized) return;
+    float gain = variance / (variance + measurementNoise);
+    soc += gain * (measuredSoc - soc);
+    variance *= (1.0f - gain);
+    clampSoc();
+  }
+
+  // BYPASS: the battery is at least floorSoc (as on the voltage-curve path).
+  // floating: no surplus on IN for a while, the charger holds it at full.
+  void bypass(float floorSoc, bool floating, float measurementNoise) {
+    if (!initialized) return;
+    if (floating) correct(100.0f, measurementNoise);
+    if (soc < floorSoc) soc = floorSoc;
+    clampSoc();
+  }
+
+  float getSoc() const {
+    return soc;
+  }
+
+  // Uncertainty of the estimate (%^2)
+  float getVariance() const {
+    return variance;
+  }
+
+  float getAmpHours() const {
+    return soc / 100.0f * capacityAh;
+  }
+};
+
+#endif // SOC_ESTIMATOR_H
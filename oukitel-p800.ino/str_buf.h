@@ -0,0 +1,154 @@
+/*
+ * String Buffer - Fixed-capacity string builder on caller storage (normally
+ * the stack), for the paths that run every second or on every request.
+ * Plain C++; Arduino String arguments are accepted when built for Arduino.
+ *
+ * Every "String + String" allocates a new heap block, and a NUT LIST VAR
+ * or an MQTT publish did dozens of them. Over weeks the short-lived blocks
+ * split the heap around the long-lived ones. StrBuf never allocates: text
+ * beyond the capacity is cut off (truncated() reports it), the result is
+ * always terminated.
+ *
+ *   StackStr<64> topic;
+ *   topic.add(stateTopic).add("/voltage");
+ *   value.addFloat(voltage, 2);
+ */
+
+#ifndef STR_BUF_H
+#define STR_BUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <WString.h>
+#endif
+
+class StrBuf {
+private:
+  char* buf;
+  size_t cap;                 // Characters, without the terminator
+  size_t len;
+  bool cut;
+
+  StrBuf(const StrBuf&);
+  StrBuf& operator=(const StrBuf&);
+
+public:
+  // storage: size bytes, size >= 1 (size - 1 characters + terminator)
+  StrBuf(char* storage, size_t size) : buf(storage), cap(size - 1), len(0), cut(false) {
+    buf[0] = '\0';
+  }
+
+  void clear() {
+    len = 0;
+    cut = false;
+    buf[0] = '\0';
+  }
+
+  StrBuf& add(const char* text, size_t n) {
+    if (text == nullptr) return *this;
+    size_t room = cap - len;
+    if (n > room) {
+      n = room;
+      cut = true;
+    }
+    memcpy(buf + len, text, n);
+    len += n;
+    buf[len] = '\0';
+    return *this;
+  }
+
+  StrBuf& add(const char* text) {
+    return text ? add(text, strlen(text)) : *this;
+  }
+
+  StrBuf& add(char c) {
+    return add(&c, 1);
+  }
+
+#if defined(ARDUINO)
+  StrBuf& add(const String& text) {
+    return add(text.c_str(), text.length());
+  }
+#endif
+
+  StrBuf& addUInt(uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+      digits[n++] = (char)('0' + value % 10);
+      value /= 10;
+    } while (value > 0);
+    char out[10];
+    for (int i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+    return add(out, n);
+  }
+
+  StrBuf& addInt(int32_t value) {
+    if (value < 0) {
+      add('-');
+      return addUInt((uint32_t)0 - (uint32_t)value);
+    }
+    return addUInt((uint32_t)value);
+  }
+
+  // Fixed decimals (0-6), rounded half away from zero like String(value, n)
+  StrBuf& addFloat(double value, int decimals) {
+    if (value != value) return add("nan");
+    if (decimals < 0) decimals = 0;
+    if (decimals > 6) decimals = 6;
+    if (value < 0) {
+      add('-');
+      value = -value;
+    }
+    if (value > 4294967040.0) return add("ovf");
+
+    uint32_t scale = 1;
+    for (int i = 0; i < decimals; i++) scale *= 10;
+    uint64_t scaled = (uint64_t)(value * scale + 0.5);
+    uint64_t whole = scaled / scale;
+    if (whole > 0xFFFFFFFFull) return add("ovf");
+    addUInt((uint32_t)whole);
+    if (decimals > 0) {
+      char frac[7];
+      uint32_t part = (uint32_t)(scaled % scale);
+      for (int i = decimals - 1; i >= 0; i--) {
+        frac[i] = (char)('0' + part % 10);
+        part /= 10;
+      }
+      add('.');
+      add(frac, decimals);
+    }
+    return *this;
+  }
+
+  const char* c_str() const {
+    return buf;
+  }
+
+  size_t length() const {
+    return len;
+  }
+
+  size_t capacity() const {
+    return cap;
+  }
+
+  bool truncated() const {
+    return cut;
+  }
+};
+
+// StrBuf with its own storage (declare it as a local)
+template <size_t N>
+class StackStr : public StrBuf {
+private:
+  char storage[N];
+
+public:
+  StackStr() : StrBuf(storage, N) {}
+};
+
+#endif // STR_BUF_H
@@ -0,0 +1,262 @@
+/*
+ * Task Scheduler - Cooperative deadline scheduler for the periodic work of
+ * loop(), plus latency histograms for the loop itself.
+ * Plain C++ (no Arduino dependencies): the clock is passed in.
+ *
+ * Every task has a period, a phase offset (so tasks with the same period do
+ * not land in the same iteration) and a CPU budget. tick() runs the due
+ * tasks earliest deadline first and stops once the tick budget is used, so
+ * the rest moves to the next loop() iteration instead of stacking up into
+ * one long stall. A task that runs longer than its budget is counted as an
+ * overrun. A task that fell more than one period behind skips the missed
+ * runs instead of catching up in a burst.
+ */
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS          12
+#define SCHED_HISTOGRAM_BUCKETS  72     // 4 per octave from 16 us to ~4 s
+
+// Log-spaced latency histogram: constant-time add, percentiles without
+// keeping the samples (resolution ~19% of the value)
+class LatencyHistogram {
+private:
+  uint32_t buckets[SCHED_HISTOGRAM_BUCKETS];
+  uint32_t samples;
+  uint32_t maxUs;
+  uint64_t totalUs;
+
+  static int bucketFor(uint32_t us) {
+    if (us < 16) return 0;
+    int octave = 31 - __builtin_clz(us);          // 4 for 16..31 us
+    int sub = (us >> (octave - 2)) & 3;           // Next two bits
+    int index = (octave - 4) * 4 + sub;
+    return index < SCHED_HISTOGRAM_BUCKETS ? index : SCHED_HISTOGRAM_BUCKETS - 1;
+  }
+
+  // Upper edge of a bucket
+  static uint32_t bucketLimit(int index) {
+    int octave = index / 4 + 4;
+    int sub = index % 4;
+    return (uint32_t)((4u + sub + 1) << (octave - 2));
+  }
+
+public:
+  LatencyHistogram() {
+    reset();
+  }
+
+  void reset() {
+    for (int i = 0; i < SCHED_HISTOGRAM_BUCKETS; i++) buckets[i] = 0;
+    samples = 0;
+    maxUs = 0;
+    totalUs = 0;
+  }
+
+  void add(uint32_t us) {
+    buckets[bucketFor(us)]++;
+    samples++;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // Upper bound of the bucket holding the given percentile (0-100)
+  uint32_t percentile(float percent) const {
+    if (samples == 0) return 0;
+    uint32_t target = (uint32_t)(samples * percent / 100.0f);
+    if (target >= samples) target = samples - 1;
+    uint32_t seen = 0;
+    for (int i = 0; i < SCHED_HISTOGRAM_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen > target) {
+        // The last bucket also holds everything above it
+        if (i == SCHED_HISTOGRAM_BUCKETS - 1) return maxUs;
+        uint32_t limit = bucketLimit(i);
+        return limit < maxUs ? limit : maxUs;
+      }
+    }
+    return maxUs;
+  }
+
+  uint32_t getSamples() const {
+    return samples;
+  }
+
+  uint32_t getMax() const {
+    return maxUs;
+  }
+
+  float getMean() const {
+    return samples > 0 ? (float)totalUs / samples : 0;
+  }
+};
+
+typedef void (*SchedTaskFn)();
+
+struct SchedTask {
+  const char* name;
+  SchedTaskFn fn;
+  uint32_t periodMs;
+  uint32_t budgetUs;          // Longer runs are counted as overruns
+  int64_t nextDueUs;
+
+  // Statistics
+  uint32_t runs;
+  uint32_t overruns;
+  uint32_t skipped;           // Periods dropped after falling behind
+  uint32_t lastUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t maxLateUs;         // Start after the deadline
+};
+
+class TaskScheduler {
+private:
+  SchedTask tasks[SCHED_MAX_TASKS];
+  int taskCount;
+  int64_t (*clockUs)();
+  uint32_t tickBudgetUs;
+  uint32_t deferredTicks;     // Ticks that left due tasks for the next one
+
+  LatencyHistogram loopHistogram;   // Work time of one loop() iteration
+  int64_t loopStartUs;
+  volatile bool resetRequested;     // From another task, done in loopStart()
+
+public:
+  // clock: monotonic microseconds. tickBudget: work per tick() before the
+  // remaining due tasks are deferred (at least one task always runs)
+  TaskScheduler(int64_t (*clock)(), uint32_t tickBudget)
+    : taskCount(0), clockUs(clock), tickBudgetUs(tickBudget), deferredTicks(0), loopStartUs(0),
+      resetRequested(false) {}
+
+  // First run at now + phaseMs. Returns the task index, -1 if full.
+  int add(const char* name, SchedTaskFn fn, uint32_t periodMs, uint32_t phaseMs, uint32_t budgetUs) {
+    if (taskCount >= SCHED_MAX_TASKS || fn == nullptr || periodMs == 0) return -1;
+    SchedTask& task = tasks[taskCount];
+    task.name = name;
+    task.fn = fn;
+    task.periodMs = periodMs;
+    task.budgetUs = budgetUs;
+    task.nextDueUs = clockUs() + (int64_t)phaseMs * 1000;
+    task.runs = 0;
+    task.overruns = 0;
+    task.skipped = 0;
+    task.lastUs = 0;
+    task.maxUs = 0;
+    task.totalUs = 0;
+    task.maxLateUs = 0;
+    return taskCount++;
+  }
+
+  // Runs due tasks, earliest deadline first, within the tick budget
+  void tick() {
+    int64_t tickStartUs = clockUs();
+    bool ran = false;
+    for (;;) {
+      int64_t now = clockUs();
+      int next = -1;
+      for (int i = 0; i < taskCount; i++) {
+        if (tasks[i].nextDueUs <= now && (next < 0 || tasks[i].nextDueUs < tasks[next].nextDueUs)) {
+          next = i;
+        }
+      }
+      if (next < 0) return;
+
+      if (ran && now - tickStartUs >= tickBudgetUs) {
+        deferredTicks++;
+        return;
+      }
+
+      SchedTask& task = tasks[next];
+      uint32_t lateUs = (uint32_t)(now - task.nextDueUs);
+      if (lateUs > task.maxLateUs) task.maxLateUs = lateUs;
+
+      task.fn();
+      ran = true;
+
+      int64_t end = clockUs();
+      uint32_t runUs = (uint32_t)(end - now);
+      task.runs++;
+      task.lastUs = runUs;
+      task.totalUs += runUs;
+      if (runUs > task.maxUs) task.maxUs = runUs;
+      if (runUs > task.budgetUs) task.overruns++;
+
+      // Keep the phase; after a long stall drop the missed periods
+      int64_t periodUs = (int64_t)task.periodMs * 1000;
+      task.nextDueUs += periodUs;
+      if (task.nextDueUs <= end) {
+        int64_t missed = (end - task.nextDueUs) / periodUs + 1;
+        task.nextDueUs += missed * periodUs;
+        task.skipped += (uint32_t)missed;
+      }
+    }
+  }
+
+  // Bracket one loop() iteration (without the trailing delay)
+  void loopStart() {
+    if (resetRequested) {
+      resetRequested = false;
+      resetStats();
+    }
+    loopStartUs = clockUs();
+  }
+
+  void loopEnd() {
+    loopHistogram.add((uint32_t)(clockUs() - loopStartUs));
+  }
+
+  void resetStats() {
+    loopHistogram.reset();
+    deferredTicks = 0;
+    for (int i = 0; i < taskCount; i++) {
+      tasks[i].runs = 0;
+      tasks[i].overruns = 0;
+      tasks[i].skipped = 0;
+      tasks[i].maxUs = 0;
+      tasks[i].totalUs = 0;
+      tasks[i].maxLateUs = 0;
+    }
+  }
+
+  // Safe from another task: the owner clears the statistics itself
+  void requestReset() {
+    resetRequested = true;
+  }
+
+  // Time until the earliest task is due (0 if one is due, cap if none)
+  uint32_t getMsUntilNextDue(uint32_t capMs) const {
+    int64_t now = clockUs();
+    int64_t waitUs = (int64_t)capMs * 1000;
+    for (int i = 0; i < taskCount; i++) {
+      int64_t untilUs = tasks[i].nextDueUs - now;
+      if (untilUs < waitUs) waitUs = untilUs;
+    }
+    return waitUs > 0 ? (uint32_t)(waitUs / 1000) : 0;
+  }
+
+  uint32_t getTickBudgetUs() const {
+    return tickBudgetUs;
+  }
+
+  int getTaskCount() const {
+    return taskCount;
+  }
+
+  const SchedTask& getTask(int index) const {
+    return tasks[index];
+  }
+
+  const LatencyHistogram& getLoopHistogram() const {
+    return loopHistogram;
+  }
+
+  uint32_t getDeferredTicks() const {
+    return deferredTicks;
+  }
+};
+
+#endif // TASK_SCHEDULER_H
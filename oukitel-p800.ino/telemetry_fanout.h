@@ -0,0 +1,150 @@
+/*
+ * Telemetry Fan-out - Delivers one telemetry frame to its consumers (NUT,
+ * WebSocket, MQTT, HTTP, data log), each with its own rate and change filter.
+ * Plain C++ (no Arduino dependencies): the clock is passed in.
+ *
+ * The frame is built once per sensor tick and carries a sequence number, so
+ * every consumer sees the same sample. A sink gets a frame when
+ * - its minimum interval has passed since its last delivery, and
+ * - the change filter reports a difference to the last delivered frame, or
+ *   the heartbeat interval has passed (or there is no filter).
+ * A sink that is not available (deliver() returns false) is retried with
+ * the next frame and keeps its last delivered frame. The first frame goes
+ * out at once, unless deferFirst() holds it for one minimum interval.
+ *
+ * The frame type needs a uint32_t "sequence" member.
+ */
+
+#ifndef TELEMETRY_FANOUT_H
+#define TELEMETRY_FANOUT_H
+
+#include <stdint.h>
+
+#define TELEMETRY_MAX_SINKS  6
+
+template <typename Frame>
+struct TelemetrySink {
+  const char* name;
+  bool (*deliver)(const Frame& frame);                  // False: not available
+  bool (*changed)(const Frame& last, const Frame& now); // nullptr: every frame counts
+  uint32_t minIntervalMs;     // Rate limit (0 = every frame)
+  uint32_t maxIntervalMs;     // Heartbeat while unchanged (0 = changes only)
+
+  Frame last;
+  bool hasLast;
+  int64_t lastUs;
+  int64_t notBeforeUs;        // deferFirst(): no delivery before this time
+
+  // Statistics
+  uint32_t delivered;
+  uint32_t unchanged;         // Frames dropped by the change filter
+  uint32_t rateLimited;       // Frames dropped by the minimum interval
+  uint32_t unavailable;       // deliver() returned false
+  uint32_t lastSequence;      // Last delivered frame
+};
+
+template <typename Frame, int MaxSinks = TELEMETRY_MAX_SINKS>
+class TelemetryFanout {
+private:
+  TelemetrySink<Frame> sinks[MaxSinks];
+  int sinkCount;
+  int64_t (*clockUs)();
+  uint32_t lastSequence;
+  uint32_t frames;
+
+public:
+  explicit TelemetryFanout(int64_t (*clock)())
+    : sinkCount(0), clockUs(clock), lastSequence(0), frames(0) {}
+
+  // Returns the sink index, -1 if full
+  int add(const char* name, bool (*deliver)(const Frame&), uint32_t minIntervalMs,
+          uint32_t maxIntervalMs, bool (*changed)(const Frame&, const Frame&)) {
+    if (sinkCount >= MaxSinks || deliver == nullptr) return -1;
+    TelemetrySink<Frame>& sink = sinks[sinkCount];
+    sink.name = name;
+    sink.deliver = deliver;
+    sink.changed = changed;
+    sink.minIntervalMs = minIntervalMs;
+    sink.maxIntervalMs = maxIntervalMs;
+    sink.hasLast = false;
+    sink.lastUs = 0;
+    sink.notBeforeUs = 0;
+    sink.delivered = 0;
+    sink.unchanged = 0;
+    sink.rateLimited = 0;
+    sink.unavailable = 0;
+    sink.lastSequence = 0;
+    return sinkCount++;
+  }
+
+  // First delivery one minimum interval from now (a periodic log that
+  // should not write an entry at boot)
+  void deferFirst(int index) {
+    if (index < 0 || index >= sinkCount) return;
+    sinks[index].notBeforeUs = clockUs() + (int64_t)sinks[index].minIntervalMs * 1000;
+  }
+
+  // True when the given sequence has not been offered yet
+  bool isNew(uint32_t sequence) const {
+    return sequence != lastSequence;
+  }
+
+  // Offers a frame to every sink. Returns the number of deliveries.
+  int publish(const Frame& frame) {
+    lastSequence = frame.sequence;
+    frames++;
+    int count = 0;
+
+    for (int i = 0; i < sinkCount; i++) {
+      TelemetrySink<Frame>& sink = sinks[i];
+      int64_t now = clockUs();
+      int64_t sinceUs = now - sink.lastUs;
+
+      if (!sink.hasLast && now < sink.notBeforeUs) {
+        sink.rateLimited++;
+        continue;
+      }
+      if (sink.hasLast) {
+        if (sinceUs < (int64_t)sink.minIntervalMs * 1000) {
+          sink.rateLimited++;
+          continue;
+        }
+        bool heartbeat = sink.maxIntervalMs > 0 && sinceUs >= (int64_t)sink.maxIntervalMs * 1000;
+        if (sink.changed != nullptr && !heartbeat && !sink.changed(sink.last, frame)) {
+          sink.unchanged++;
+          continue;
+        }
+      }
+
+      if (!sink.deliver(frame)) {
+        sink.unavailable++;
+        continue;
+      }
+      sink.last = frame;
+      sink.hasLast = true;
+      sink.lastUs = now;
+      sink.lastSequence = frame.sequence;
+      sink.delivered++;
+      count++;
+    }
+    return count;
+  }
+
+  int getSinkCount() const {
+    return sinkCount;
+  }
+
+  const TelemetrySink<Frame>& getSink(int index) const {
+    return sinks[index];
+  }
+
+  uint32_t getFrames() const {
+    return frames;
+  }
+
+  uint32_t getLastSequence() const {
+    return lastSequence;
+  }
+};
+
+#endif // TELEMETRY_FANOUT_H
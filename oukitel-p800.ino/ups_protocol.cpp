@@ -4,6 +4,8 @@
 
 #include "ups_protocol.h"
 #include "logger.h"
+#include "str_buf.h"
+#include "nut_command.h"
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
 
@@ -39,24 +41,24 @@ bool UPSProtocol::begin() {
   loadConfig();
   
   if (!config.enabled) {
-    Serial.println("[UPS] UPS protocol disabled");
+    LogSerial.println("[UPS] UPS protocol disabled");
     return true;
   }
   
-  Serial.println("[UPS] Starting UPS protocol server on port " + String(config.port));
-  Serial.println("[UPS] UPS Name: " + upsName);
-  Serial.println("[UPS] UPS Description: " + upsDescription);
+  LogSerial.println("[UPS] Starting UPS protocol server on port " + String(config.port));
+  LogSerial.println("[UPS] UPS Name: " + upsName);
+  LogSerial.println("[UPS] UPS Description: " + upsDescription);
   
   // Check memory before allocating server
   if (ESP.getFreeHeap() < 10000) {
-    Serial.println("[UPS] ERROR: Insufficient memory to start server");
+    LogSerial.println("[UPS] ERROR: Insufficient memory to start server");
     return false;
   }
   
   // Allocate server with error handling
   WiFiServer* newServer = new WiFiServer(config.port);
   if (!newServer) {
-    Serial.println("[UPS] ERROR: Failed to allocate WiFiServer");
+    LogSerial.println("[UPS] ERROR: Failed to allocate WiFiServer");
     return false;
   }
   
@@ -80,7 +82,7 @@ bool UPSProtocol::begin() {
   }
   
   currentStatus = STATUS_NORMAL;
-  Serial.println("[UPS] UPS protocol server started");
+  LogSerial.println("[UPS] UPS protocol server started");
   return true;
 }
 
@@ -95,7 +97,7 @@ void UPSProtocol::handleClients() {
       if (!clients[i] || !clients[i].connected()) {
         clients[i] = newClient;
         clientLastActivity[i] = millis();  // Initialize activity time
-        Serial.println("[UPS] New client connected: " + newClient.remoteIP().toString());
+        LOG_INFO("UPS: New client connected: %s", newClient.remoteIP().toString().c_str());
         sendResponse(clients[i], "Network UPS Tools upsd 2.7.4 - http://www.networkupstools.org/");
         break;
       }
@@ -113,25 +115,31 @@ void UPSProtocol::handleClients() {
       
       if (clients[i].available()) {
         clientLastActivity[i] = currentTime;  // Reset timeout on activity
-        String command = clients[i].readStringUntil('\n');
-        command.trim();
+        char line[UPS_COMMAND_MAX];
+        size_t length = clients[i].readBytesUntil('\n', line, sizeof(line) - 1);
+        char* command = nutTrimLine(line, length);
         
-        if (command.length() > 0) {
-          Serial.println("[UPS] Command from client " + String(i) + ": " + command);
-          String response = processCommand(command);
-          sendResponse(clients[i], response);
+        if (*command != '\0') {
+          LOG_DEBUG("UPS: Command from client %d: %s", i, command);
+          
+          StackStr<UPS_RESPONSE_MAX> response;
+          processCommand(command, response);
+          if (response.truncated()) {
+            LOG_WARNING("UPS: Response truncated");
+          }
+          sendResponse(clients[i], response.c_str());
         }
       } else if (currentTime - clientLastActivity[i] > 30000) {
         // Client timeout - disconnect (handles millis() overflow)
         if ((currentTime - clientLastActivity[i]) < 0x7FFFFFFF) {  // Check for overflow
-          Serial.println("[UPS] Client " + String(i) + " timeout, disconnecting");
+          LOG_INFO("UPS: Client %d timeout, disconnecting", i);
           clients[i].stop();
           clientLastActivity[i] = 0;
         }
       }
     } else if (clients[i]) {
       // Client disconnected
-      Serial.println("[UPS] Client " + String(i) + " disconnected");
+      LOG_INFO("UPS: Client %d disconnected", i);
       clients[i].stop();
       clientLastActivity[i] = 0;
     }
@@ -139,11 +147,13 @@ void UPSProtocol::handleClients() {
   
   // Handle shutdown request
   if (shutdownRequested && shutdownTime > 0 && millis() >= shutdownTime) {
-    Serial.println("[UPS] Executing shutdown command");
+    LOG_INFO("UPS: Executing shutdown command");
     // Broadcast shutdown message to all clients
     for (int i = 0; i < UPS_MAX_CLIENTS; i++) {
       if (clients[i] && clients[i].connected()) {
-        sendResponse(clients[i], "NOTIFY " + upsName + " SHUTDOWN");
+        StackStr<64> notification;
+        notification.add("NOTIFY ").add(upsName).add(" SHUTDOWN");
+        sendResponse(clients[i], notification.c_str());
       }
     }
     shutdownRequested = false;
@@ -158,20 +168,21 @@ void UPSProtocol::updateStatus(const SensorData& sensorData) {
   SystemStatus newStatus = determineStatus(sensorData);
   
   if (newStatus != currentStatus) {
-    Serial.println("[UPS] Status changed: " + String(currentStatus) + " -> " + String(newStatus));
+    LOG_INFO("UPS: Status changed: %d -> %d", (int)currentStatus, (int)newStatus);
     currentStatus = newStatus;
     
     // Notify clients of status change
-    String notification = "NOTIFY " + upsName + " " + getStatusString();
+    StackStr<64> notification;
+    notification.add("NOTIFY ").add(upsName).add(' ').add(getStatusString());
     for (int i = 0; i < UPS_MAX_CLIENTS; i++) {
       if (clients[i] && clients[i].connected()) {
-        sendResponse(clients[i], notification);
+        sendResponse(clients[i], notification.c_str());
       }
     }
     
     // Auto-shutdown on critical battery
     if (currentStatus == STATUS_CRITICAL_BATTERY && !shutdownRequested) {
-      Serial.println("[UPS] Critical battery level, requesting shutdown");
+      LOG_INFO("UPS: Critical battery level, requesting shutdown");
       requestShutdown(30); // 30 second delay
     }
   }
@@ -189,7 +200,7 @@ SystemStatus UPSProtocol::determineStatus(const SensorData& data) {
   }
 }
 
-String UPSProtocol::getStatusString() {
+const char* UPSProtocol::getStatusString() {
   switch (currentStatus) {
     case STATUS_NORMAL:
       return "OL"; // On Line
@@ -206,139 +217,141 @@ String UPSProtocol::getStatusString() {
   }
 }
 
-void UPSProtocol::sendResponse(WiFiClient& client, const String& response) {
+void UPSProtocol::sendResponse(WiFiClient& client, const char* response) {
   if (client && client.connected()) {
     client.println(response);
     client.flush();
   }
 }
 
-String UPSProtocol::processCommand(const String& command) {
-  String cmd = command;
-  cmd.toUpperCase();
-  
-  if (cmd.startsWith("LIST UPS")) {
-    return handleListUPS();
-  } else if (cmd.startsWith("LIST VAR")) {
-    String upsName = command.substring(9);
-    upsName.trim();
-    return handleListVar(upsName);
-  } else if (cmd.startsWith("GET VAR")) {
-    int firstSpace = command.indexOf(' ', 8);
-    if (firstSpace > 0) {
-      String upsName = command.substring(8, firstSpace);
-      String varName = command.substring(firstSpace + 1);
-      upsName.trim();
-      varName.trim();
-      return handleGetVar(upsName, varName);
-    }
-  } else if (cmd.startsWith("INST CMD")) {
-    int firstSpace = command.indexOf(' ', 9);
-    if (firstSpace > 0) {
-      String upsName = command.substring(9, firstSpace);
-      String cmdName = command.substring(firstSpace + 1);
-      upsName.trim();
-      cmdName.trim();
-      return handleInstCmd(upsName, cmdName);
-    }
-  } else if (cmd.startsWith("LIST CMD")) {
-    String upsName = command.substring(9);
-    upsName.trim();
-    return handleListCmd(upsName);
-  } else if (cmd == "VER") {
-    return "Network UPS Tools upsd 2.7.4";
-  } else if (cmd == "HELP") {
-    return "Commands: LIST UPS, LIST VAR <ups>, GET VAR <ups> <var>, INST CMD <ups> <cmd>, LIST CMD <ups>, VER, HELP";
+// Parsing lives in nut_command.h (host-tested), this only dispatches
+void UPSProtocol::processCommand(char* command, StrBuf& response) {
+  NutCommand parsed = nutParseCommand(command);
+  
+  switch (parsed.type) {
+    case NUT_CMD_LIST_UPS:
+      handleListUPS(response);
+      break;
+    case NUT_CMD_LIST_VAR:
+      handleListVar(parsed.upsName, response);
+      break;
+    case NUT_CMD_GET_VAR:
+      handleGetVar(parsed.upsName, parsed.argument, response);
+      break;
+    case NUT_CMD_INST_CMD:
+      handleInstCmd(parsed.upsName, parsed.argument, response);
+      break;
+    case NUT_CMD_LIST_CMD:
+      handleListCmd(parsed.upsName, response);
+      break;
+    case NUT_CMD_VER:
+      response.add("Network UPS Tools upsd 2.7.4");
+      break;
+    case NUT_CMD_HELP:
+      response.add("Commands: LIST UPS, LIST VAR <ups>, GET VAR <ups> <var>, INST CMD <ups> <cmd>, LIST CMD <ups>, VER, HELP");
+      break;
+    default:
+      response.add("ERR UNKNOWN-COMMAND");
+      break;
   }
-  
-  return "ERR UNKNOWN-COMMAND";
 }
 
-String UPSProtocol::handleListUPS() {
-  return "UPS " + upsName + " \"" + upsDescription + "\"";
+void UPSProtocol::handleListUPS(StrBuf& response) {
+  response.add("UPS ").add(upsName).add(" \"").add(upsDescription).add('"');
 }
 
-String UPSProtocol::handleListVar(const String& upsName) {
-  if (upsName != this->upsName) {
-    return "ERR UNKNOWN-UPS";
+// Variables of LIST VAR, in this order
+static const char* const NUT_VARIABLES[] = {
+  "ups.status", "battery.charge", "battery.voltage", "input.current", "output.current",
+  "ups.load", "ups.power", "ups.mfr", "ups.model", "ups.serial", "device.type"
+};
+
+bool UPSProtocol::appendVarValue(const char* varName, StrBuf& out) {
+  if (strcmp(varName, "ups.status") == 0) {
+    out.add(getStatusString());
+  } else if (strcmp(varName, "battery.charge") == 0) {
+    out.addFloat(lastSensorData.batteryPercentage, 0);
+  } else if (strcmp(varName, "battery.voltage") == 0) {
+    out.addFloat(lastSensorData.batteryVoltage, 1);
+  } else if (strcmp(varName, "input.current") == 0) {
+    out.addFloat(lastSensorData.mainCurrent, 2);
+  } else if (strcmp(varName, "output.current") == 0) {
+    out.addFloat(lastSensorData.outputCurrent, 2);
+  } else if (strcmp(varName, "ups.load") == 0) {
+    out.addFloat((lastSensorData.outputPower / 2400.0) * 100, 1);
+  } else if (strcmp(varName, "ups.power") == 0) {
+    out.addFloat(lastSensorData.outputPower, 0);
+  } else if (strcmp(varName, "ups.mfr") == 0) {
+    out.add(manufacturer);
+  } else if (strcmp(varName, "ups.model") == 0) {
+    out.add(model);
+  } else if (strcmp(varName, "ups.serial") == 0) {
+    out.add(serial);
+  } else if (strcmp(varName, "device.type") == 0) {
+    out.add("ups");
+  } else {
+    return false;
   }
-  
-  String response = "BEGIN LIST VAR " + upsName + "\n";
-  response += "VAR " + upsName + " ups.status \"" + getStatusString() + "\"\n";
-  response += "VAR " + upsName + " battery.charge \"" + String(lastSensorData.batteryPercentage, 0) + "\"\n";
-  response += "VAR " + upsName + " battery.voltage \"" + String(lastSensorData.batteryVoltage, 1) + "\"\n";
-  response += "VAR " + upsName + " input.current \"" + String(lastSensorData.mainCurrent, 2) + "\"\n";
-  response += "VAR " + upsName + " output.current \"" + String(lastSensorData.outputCurrent, 2) + "\"\n";
-  response += "VAR " + upsName + " ups.load \"" + String((lastSensorData.outputPower / 2400.0) * 100, 1) + "\"\n";
-  response += "VAR " + upsName + " ups.power \"" + String(lastSensorData.outputPower, 0) + "\"\n";
-  response += "VAR " + upsName + " ups.mfr \"" + manufacturer + "\"\n";
-  response += "VAR " + upsName + " ups.model \"" + model + "\"\n";
-  response += "VAR " + upsName + " ups.serial \"" + serial + "\"\n";
-  response += "VAR " + upsName + " device.type \"ups\"\n";
-  response += "END LIST VAR " + upsName;
-  
-  return response;
+  return true;
 }
 
-String UPSProtocol::handleGetVar(const String& upsName, const String& varName) {
-  if (upsName != this->upsName) {
-    return "ERR UNKNOWN-UPS";
+void UPSProtocol::handleListVar(const char* name, StrBuf& response) {
+  if (upsName != name) {
+    response.add("ERR UNKNOWN-UPS");
+    return;
   }
   
-  if (varName == "ups.status") {
-    return "VAR " + upsName + " " + varName + " \"" + getStatusString() + "\"";
-  } else if (varName == "battery.charge") {
-    return "VAR " + upsName + " " + varName + " \"" + String(lastSensorData.batteryPercentage, 0) + "\"";
-  } else if (varName == "battery.voltage") {
-    return "VAR " + upsName + " " + varName + " \"" + String(lastSensorData.batteryVoltage, 1) + "\"";
-  } else if (varName == "input.current") {
-    return "VAR " + upsName + " " + varName + " \"" + String(lastSensorData.mainCurrent, 2) + "\"";
-  } else if (varName == "output.current") {
-    return "VAR " + upsName + " " + varName + " \"" + String(lastSensorData.outputCurrent, 2) + "\"";
-  } else if (varName == "ups.load") {
-    return "VAR " + upsName + " " + varName + " \"" + String((lastSensorData.outputPower / 2400.0) * 100, 1) + "\"";
-  } else if (varName == "ups.power") {
-    return "VAR " + upsName + " " + varName + " \"" + String(lastSensorData.outputPower, 0) + "\"";
-  } else if (varName == "ups.mfr") {
-    return "VAR " + upsName + " " + varName + " \"" + manufacturer + "\"";
-  } else if (varName == "ups.model") {
-    return "VAR " + upsName + " " + varName + " \"" + model + "\"";
-  } else if (varName == "ups.serial") {
-    return "VAR " + upsName + " " + varName + " \"" + serial + "\"";
-  } else if (varName == "device.type") {
-    return "VAR " + upsName + " " + varName + " \"ups\"";
+  response.add("BEGIN LIST VAR ").add(upsName).add('\n');
+  for (size_t i = 0; i < sizeof(NUT_VARIABLES) / sizeof(NUT_VARIABLES[0]); i++) {
+    response.add("VAR ").add(upsName).add(' ').add(NUT_VARIABLES[i]).add(" \"");
+    appendVarValue(NUT_VARIABLES[i], response);
+    response.add("\"\n");
+  }
+  response.add("END LIST VAR ").add(upsName);
+}
+
+void UPSProtocol::handleGetVar(const char* name, const char* varName, StrBuf& response) {
+  if (upsName != name) {
+    response.add("ERR UNKNOWN-UPS");
+    return;
   }
   
-  return "ERR VAR-NOT-SUPPORTED";
+  response.add("VAR ").add(upsName).add(' ').add(varName).add(" \"");
+  if (!appendVarValue(varName, response)) {
+    response.clear();
+    response.add("ERR VAR-NOT-SUPPORTED");
+    return;
+  }
+  response.add('"');
 }
 
-String UPSProtocol::handleInstCmd(const String& upsName, const String& command) {
-  if (upsName != this->upsName) {
-    return "ERR UNKNOWN-UPS";
+void UPSProtocol::handleInstCmd(const char* name, const char* command, StrBuf& response) {
+  if (upsName != name) {
+    response.add("ERR UNKNOWN-UPS");
+    return;
   }
   
-  if (command == "shutdown.return") {
+  if (strcmp(command, "shutdown.return") == 0) {
     requestShutdown(10);
-    return "OK";
-  } else if (command == "shutdown.stop") {
+    response.add("OK");
+  } else if (strcmp(command, "shutdown.stop") == 0) {
     cancelShutdown();
-    return "OK";
+    response.add("OK");
+  } else {
+    response.add("ERR CMD-NOT-SUPPORTED");
   }
-  
-  return "ERR CMD-NOT-SUPPORTED";
 }
 
-String UPSProtocol::handleListCmd(const String& upsName) {
-  if (upsName != this->upsName) {
-    return "ERR UNKNOWN-UPS";
+void UPSProtocol::handleListCmd(const char* name, StrBuf& response) {
+  if (upsName != name) {
+    response.add("ERR UNKNOWN-UPS");
+    return;
   }
   
-  String response = "BEGIN LIST CMD " + upsName + "\n";
-  response += "CMD " + upsName + " shutdown.return\n";
-  response += "CMD " + upsName + " shutdown.stop\n";
-  response += "END LIST CMD " + upsName;
-  
-  return response;
+  response.add("BEGIN LIST CMD ").add(upsName).add('\n');
+  response.add("CMD ").add(upsName).add(" shutdown.return\n");
+  response.add("CMD ").add(upsName).add(" shutdown.stop\n");
+  response.add("END LIST CMD ").add(upsName);
 }
 
 SystemStatus UPSProtocol::getStatus() {
@@ -353,13 +366,14 @@ void UPSProtocol::requestShutdown(int delaySeconds) {
   shutdownRequested = true;
   shutdownTime = millis() + (delaySeconds * 1000);
   
-  Serial.println("[UPS] Shutdown requested with " + String(delaySeconds) + " second delay");
+  LOG_INFO("UPS: Shutdown requested with %d second delay", delaySeconds);
   
   // Notify all clients
-  String notification = "NOTIFY " + upsName + " SHUTDOWN " + String(delaySeconds);
+  StackStr<64> notification;
+  notification.add("NOTIFY ").add(upsName).add(" SHUTDOWN ").addInt(delaySeconds);
   for (int i = 0; i < UPS_MAX_CLIENTS; i++) {
     if (clients[i] && clients[i].connected()) {
-      sendResponse(clients[i], notification);
+      sendResponse(clients[i], notification.c_str());
     }
   }
 }
@@ -368,13 +382,14 @@ void UPSProtocol::cancelShutdown() {
   shutdownRequested = false;
   shutdownTime = 0;
   
-  Serial.println("[UPS] Shutdown cancelled");
+  LOG_INFO("UPS: Shutdown cancelled");
   
   // Notify all clients
-  String notification = "NOTIFY " + upsName + " SHUTDOWN-CANCELLED";
+  StackStr<64> notification;
+  notification.add("NOTIFY ").add(upsName).add(" SHUTDOWN-CANCELLED");
   for (int i = 0; i < UPS_MAX_CLIENTS; i++) {
     if (clients[i] && clients[i].connected()) {
-      sendResponse(clients[i], notification);
+      sendResponse(clients[i], notification.c_str());
     }
   }
 }
@@ -431,13 +446,13 @@ bool UPSProtocol::isEnabled() {
 
 void UPSProtocol::loadConfig() {
   if (!SPIFFS.exists("/ups_config.json")) {
-    Serial.println("[UPS] No saved UPS configuration found, using defaults");
+    LOG_INFO("UPS: No saved UPS configuration found, using defaults");
     return;
   }
   
   File file = SPIFFS.open("/ups_config.json", "r");
   if (!file) {
-    Serial.println("[UPS] Failed to open UPS config file");
+    LOG_ERROR("UPS: Failed to open UPS config file");
     return;
   }
   
@@ -446,7 +461,7 @@ void UPSProtocol::loadConfig() {
   file.close();
   
   if (error) {
-    Serial.println("[UPS] Failed to parse UPS config file");
+    LOG_ERROR("UPS: Failed to parse UPS config file");
     return;
   }
   
@@ -454,7 +469,7 @@ void UPSProtocol::loadConfig() {
   config.port = doc["port"] | UPS_PORT;
   config.shutdownThreshold = doc["shutdownThreshold"] | UPS_SHUTDOWN_THRESHOLD;
   
-  Serial.println("[UPS] Loaded UPS configuration");
+  LOG_INFO("UPS: Loaded UPS configuration");
 }
 
 void UPSProtocol::saveConfig() {
@@ -465,12 +480,12 @@ void UPSProtocol::saveConfig() {
   
   File file = SPIFFS.open("/ups_config.json", "w");
   if (!file) {
-    Serial.println("[UPS] Failed to save UPS configuration");
+    LOG_ERROR("UPS: Failed to save UPS configuration");
     return;
   }
   
   serializeJson(doc, file);
   file.close();
   
-  Serial.println("[UPS] UPS configuration saved");
+  LOG_INFO("UPS: UPS configuration saved");
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #define UPS_PROTOCOL_H
 
 #include "config.h"
+#include "str_buf.h"
 #include <WiFi.h>
 
 // UPSConfig is defined in config.h
@@ -31,19 +32,20 @@ private:
   String serial;
   
   void handleClient(WiFiClient& client);
-  void sendResponse(WiFiClient& client, const String& response);
-  String processCommand(const String& command);
+  void sendResponse(WiFiClient& client, const char* response);
+  void processCommand(char* command, StrBuf& response);   // Splits the command in place
   
-  // NUT protocol commands
-  String handleListUPS();
-  String handleListVar(const String& upsName);
-  String handleGetVar(const String& upsName, const String& varName);
-  String handleInstCmd(const String& upsName, const String& command);
-  String handleListCmd(const String& upsName);
+  // NUT protocol commands (responses are built on the stack, no heap)
+  void handleListUPS(StrBuf& response);
+  void handleListVar(const char* name, StrBuf& response);
+  void handleGetVar(const char* name, const char* varName, StrBuf& response);
+  void handleInstCmd(const char* name, const char* command, StrBuf& response);
+  void handleListCmd(const char* name, StrBuf& response);
+  bool appendVarValue(const char* varName, StrBuf& out);  // False if not supported
   
   // Status determination
   SystemStatus determineStatus(const SensorData& data);
-  String getStatusString();
+  const char* getStatusString();
   
   // Configuration
   void loadConfig();
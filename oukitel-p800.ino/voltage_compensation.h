@@ -0,0 +1,107 @@
+/*
+ * Voltage Compensation - Table-driven battery voltage correction
+ * Plain C++ (no Arduino dependencies) so it can be compiled on a PC.
+ *
+ * A table is a list of points {measured voltage, offset} in ascending
+ * voltage order. Between two points the offset is linearly interpolated,
+ * outside the table it is clamped to the first/last offset. A voltage
+ * listed twice is a step: below it the first offset applies, from it up
+ * the second (this is how the built-in tables reproduce the old ladders).
+ * A uniform grid maps a voltage to its segment directly, so a lookup costs
+ * the same for any table size.
+ */
+
+#ifndef VOLTAGE_COMPENSATION_H
+#define VOLTAGE_COMPENSATION_H
+
+#include <stdint.h>
+
+#define COMP_TABLE_MAX_POINTS   40
+#define COMP_GRID_CELLS         128
+
+struct CompensationPoint {
+  float voltage;    // Measured battery voltage (band edge)
+  float offset;     // Correction added at this voltage
+};
+
+class CompensationTable {
+private:
+  CompensationPoint points[COMP_TABLE_MAX_POINTS];
+  int count;
+
+  // grid[c] = segment containing the start of cell c
+  float gridMin;
+  float gridInvStep;
+  uint8_t grid[COMP_GRID_CELLS];
+
+  void buildGrid() {
+    gridMin = points[0].voltage;
+    float span = points[count - 1].voltage - gridMin;
+    gridInvStep = span > 0 ? COMP_GRID_CELLS / span : 0;
+
+    int segment = 0;
+    for (int c = 0; c < COMP_GRID_CELLS; c++) {
+      float cellStart = gridMin + c * (span / COMP_GRID_CELLS);
+      while (segment < count - 2 && points[segment + 1].voltage <= cellStart) {
+        segment++;
+      }
+      grid[c] = (uint8_t)segment;
+    }
+  }
+
+public:
+  CompensationTable() : count(0), gridMin(0), gridInvStep(0) {}
+
+  // Load {voltage, offset} pairs. Voltages must be ascending, a voltage
+  // may appear twice (step). On error the current table is left untouched.
+  bool load(const float (*table)[2], int n) {
+    if (n < 1 || n > COMP_TABLE_MAX_POINTS) return false;
+    for (int i = 1; i < n; i++) {
+      if (!(table[i][0] >= table[i - 1][0])) return false;
+      if (i >= 2 && table[i][0] == table[i - 2][0]) return false;
+    }
+    for (int i = 0; i < n; i++) {
+      points[i].voltage = table[i][0];
+      points[i].offset = table[i][1];
+    }
+    count = n;
+    buildGrid();
+    return true;
+  }
+
+  float offsetAt(float measuredV) const {
+    if (count == 0) return 0;
+    if (measuredV < points[0].voltage) return points[0].offset;
+    if (measuredV >= points[count - 1].voltage) return points[count - 1].offset;
+
+    int cell = (int)((measuredV - gridMin) * gridInvStep);
+    if (cell < 0) cell = 0;
+    if (cell >= COMP_GRID_CELLS) cell = COMP_GRID_CELLS - 1;
+
+    // At most one step unless points are closer than a grid cell. Moving
+    // past a step's first point means a zero-width segment is never used.
+    int i = grid[cell];
+    while (i < count - 2 && measuredV >= points[i + 1].voltage) {
+      i++;
+    }
+
+    const CompensationPoint& a = points[i];
+    const CompensationPoint& b = points[i + 1];
+    float frac = (measuredV - a.voltage) / (b.voltage - a.voltage);
+    return a.offset + frac * (b.offset - a.offset);
+  }
+
+  float apply(float measuredV) const {
+    return measuredV + offsetAt(measuredV);
+  }
+
+  int size() const {
+    return count;
+  }
+
+  CompensationPoint point(int i) const {
+    return points[i];
+  }
+};
+
+#endif // VOLTAGE_COMPENSATION_H
@@ -9,7 +9,14 @@
 #include "energy_monitor.h"
 #include "config.h"
 #include "logger.h"
+#include "task_scheduler.h"
+#include "loop_profiler.h"
+#include "power_manager.h"
+#include "memory_telemetry.h"
+#include "json_arena.h"
+#include "seqlock.h"
 #include <SPIFFS.h>
+#include <esp_heap_caps.h>
 
 // Static instance pointer
 WebServerManager* WebServerManager::instance = nullptr;
@@ -19,16 +26,29 @@ extern HardwareManager hardware;
 extern WiFiManager wifiMgr;
 extern DataLogger dataLogger;
 extern PowerStationMonitor energyMonitor;
+extern TaskScheduler scheduler;
+extern TaskScheduler netScheduler;
+extern LoopProfiler profiler;
+extern PowerManager powerMgr;
+extern MemoryTelemetry memTelemetry;
+extern JsonPool jsonPool;
+extern SeqLockSnapshot<TelemetryFrame> telemetry;
+extern TelemetryFanout<TelemetryFrame> loopSinks;
+extern TelemetryFanout<TelemetryFrame> netSinks;
 extern String g_apiPassword;
 
 WebServerManager::WebServerManager() : server(WEB_SERVER_PORT), webSocket(WEBSOCKET_PORT) {
   initialized = false;
-  lastDataBroadcast = 0;
+  dataMessageSequence = 0;
+  for (int i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    logTailOn[i] = false;
+    logTailPos[i] = 0;
+  }
   instance = this;
 }
 
 bool WebServerManager::begin() {
-  Serial.println("[WEB] Initializing web server...");
+  LogSerial.println("[WEB] Initializing web server...");
 
   // Setup routes
   server.on("/", HTTP_GET, [this]() { handleRoot(); });
@@ -39,6 +59,15 @@ bool WebServerManager::begin() {
   server.on("/api/wifi", HTTP_GET, [this]() { handleWiFiConfig(); });
   server.on("/api/wifi", HTTP_POST, [this]() { handleWiFiConfig(); });
   server.on("/api/button", HTTP_POST, [this]() { handleButtonPress(); });
+  server.on("/api/compensation", HTTP_GET, [this]() { handleCompensation(); });
+  server.on("/api/compensation", HTTP_POST, [this]() { handleCompensation(); });
+  server.on("/api/soc_curves", HTTP_GET, [this]() { handleSocCurves(); });
+  server.on("/api/soc_curves", HTTP_POST, [this]() { handleSocCurves(); });
+  server.on("/api/scheduler", HTTP_GET, [this]() { handleScheduler(); });
+  server.on("/api/scheduler", HTTP_POST, [this]() { handleScheduler(); });
+  server.on("/api/perf", HTTP_GET, [this]() { handlePerf(); });
+  server.on("/api/perf", HTTP_POST, [this]() { handlePerf(); });
+  server.on("/api/logs", HTTP_GET, [this]() { handleLogs(); });
   server.onNotFound([this]() { handleNotFound(); });
 
   // WebSocket server
@@ -47,9 +76,9 @@ bool WebServerManager::begin() {
 
   server.begin();
 
-  Serial.println("[WEB] Web server started on port " + String(WEB_SERVER_PORT));
-  Serial.println("[WEB] WebSocket server started on port " + String(WEBSOCKET_PORT));
-  Serial.println("[WEB] HTTP API endpoint: /api/command (password protected)");
+  LogSerial.println("[WEB] Web server started on port " + String(WEB_SERVER_PORT));
+  LogSerial.println("[WEB] WebSocket server started on port " + String(WEBSOCKET_PORT));
+  LogSerial.println("[WEB] HTTP API endpoint: /api/command (password protected)");
 
   initialized = true;
   return true;
@@ -69,7 +98,7 @@ void WebServerManager::handleClient() {
     // Critical memory low - skip non-essential operations
     static unsigned long lastMemoryWarning = 0;
     if (webTimeElapsed(lastMemoryWarning, 60000)) {  // Warn every minute
-      LOG_ERROR("Web server: Low memory (" + String(freeHeap) + " bytes) - skipping broadcasts");
+      LOG_ERROR("Web server: Low memory (%lu bytes) - skipping broadcasts", (unsigned long)freeHeap);
       lastMemoryWarning = millis();
     }
     // Still handle client requests but skip broadcasts
@@ -80,21 +109,8 @@ void WebServerManager::handleClient() {
 
   server.handleClient();
   webSocket.loop();
-
-  // Broadcast every 5 seconds
-  if (webTimeElapsed(lastDataBroadcast, 5000)) {
-    // Check memory before broadcast
-    if (ESP.getFreeHeap() > 10000) {
-      SensorData sensorData = hardware.getSensorData();
-      EnergyData energyData = energyMonitor.getStableEnergyData();
-      
-      broadcastData(sensorData, energyData);
-      lastDataBroadcast = millis();
-    } else {
-      // Skip broadcast if memory is low
-      LOG_WARNING("Web server: Low memory, skipping WebSocket broadcast");
-    }
-  }
+  
+  // Sensor data broadcasts come from the telemetry fan-out (broadcastData())
 }
 
 void WebServerManager::handleRoot() {
@@ -103,8 +119,9 @@ void WebServerManager::handleRoot() {
     return server.requestAuthentication();
   }
   
-  // Check memory before generating large HTML
-  if (ESP.getFreeHeap() < 20000) {
+  // The page is built in one block: check the largest one, not the free total
+  uint32_t pageBytes = max((uint32_t)WEB_PAGE_RESERVE, memTelemetry.getHighWater(MEM_USE_WEB_PAGE));
+  if (heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) < pageBytes) {
     LOG_WARNING("Web server: Low memory, sending simplified response");
     server.send(200, "text/html", "<html><body><h1>Oukitel P800E</h1><p>System is running but memory is low. Please refresh.</p></body></html>");
     return;
@@ -115,10 +132,11 @@ void WebServerManager::handleRoot() {
   // Generate HTML with error handling
   String html = generateHTML();
   if (html.length() == 0) {
-    Serial.println("[WEB] ERROR: Failed to generate HTML");
+    LOG_ERROR("Web server: Failed to generate HTML");
     server.send(500, "text/html", "<html><body><h1>Error</h1><p>Failed to generate page. Please try again.</p></body></html>");
     return;
   }
+  memTelemetry.noteUse(MEM_USE_WEB_PAGE, html.length() + 1);
   
   server.send(200, "text/html", html);
 }
@@ -126,26 +144,80 @@ void WebServerManager::handleRoot() {
 void WebServerManager::handleAPI() {
   sendCORS();
 
-  SensorData data = hardware.getSensorData();
+  TelemetryFrame frame = telemetry.read();
+  const SensorData& data = frame.sensor;
 
-  // Increased buffer size for safety
-  DynamicJsonDocument doc(2048);
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["timestamp"] = data.timestamp;
+  doc["sequence"] = frame.sequence;
   doc["mainCurrent"] = data.mainCurrent;
   doc["outputCurrent"] = data.outputCurrent;
   doc["batteryVoltage"] = data.batteryVoltage;
   doc["batteryPercentage"] = data.batteryPercentage;
+  doc["socVoltage"] = data.socVoltage;
+  doc["socFused"] = data.socFused;
+  doc["batteryCurrent"] = data.batteryCurrent;
   doc["mainPower"] = data.mainPower;
   doc["outputPower"] = data.outputPower;
   doc["onBattery"] = data.onBattery;
+  doc["mainsFrequency"] = data.mainsFrequency;
+  doc["mainsLost"] = data.mainsLost;
+  
+  MainsLossStats mainsLoss = hardware.getMainsLossStats();
+  JsonObject mainsLossObj = doc.createNestedObject("mainsLoss");
+  mainsLossObj["events"] = mainsLoss.events;
+  mainsLossObj["lastDetectMs"] = mainsLoss.lastDetectMs;
+  mainsLossObj["lastNotifyMs"] = mainsLoss.lastNotifyMs;
+  mainsLossObj["maxNotifyMs"] = mainsLoss.maxNotifyMs;
+  
+  AcquisitionStats acq = hardware.getAcquisitionStats();
+  JsonObject acqObj = doc.createNestedObject("acquisition");
+  acqObj["mode"] = acqModeName(acq.mode);
+  acqObj["lastTrigger"] = acqTriggerName(acq.lastTrigger);
+  acqObj["switches"] = acq.switches;
+  acqObj["idlePercent"] = acq.idlePercent;
+  acqObj["sampleRateHz"] = acq.sampleRateHz;
+  acqObj["decimation"] = acq.decimation;
+  acqObj["samplerCpuUsPerSec"] = acq.samplerCpuUsPerSecond;
+  acqObj["sensorCpuUsPerSec"] = acq.sensorCpuUsPerSecond;
+  
+  JsonObject harmonicsObj = doc.createNestedObject("harmonics");
+  const char* harmonicNames[ADC_SAMPLER_CH_COUNT] = {"in", "out"};
+  for (int ch = 0; ch < ADC_SAMPLER_CH_COUNT; ch++) {
+    HarmonicResult h = hardware.getHarmonics((AdcSamplerChannel)ch);
+    JsonObject chObj = harmonicsObj.createNestedObject(harmonicNames[ch]);
+    chObj["valid"] = h.valid;
+    chObj["fundamentalHz"] = h.fundamentalHz;
+    chObj["thd"] = h.thd;
+    chObj["crestFactor"] = h.crestFactor;
+    chObj["powerFactor"] = h.powerFactor;
+    JsonArray orders = chObj.createNestedArray("oddHarmonics");  // 3rd..9th, % of fundamental
+    for (int i = 1; i < HARMONIC_COUNT; i++) {
+      orders.add(h.harmonicRms[0] > 0 ? h.harmonicRms[i] / h.harmonicRms[0] * 100.0 : 0);
+    }
+  }
+  
+  PowerStats power = powerMgr.getStats();
+  JsonObject powerObj = doc.createNestedObject("power");
+  powerObj["mode"] = power.lowPower ? "low" : "normal";
+  powerObj["cpuMhz"] = power.cpuMhz;
+  powerObj["wifiSleep"] = wifiSleepName(power.wifiSleep);
+  powerObj["listenInterval"] = power.listenInterval;
+  powerObj["loopDutyPercent"] = power.loopDutyPercent;
+  powerObj["lowPowerPercent"] = power.lowPowerPercent;
+  powerObj["transitions"] = power.transitions;
+  
+  addMemoryStats(doc.createNestedObject("memory"), true);
 
   doc["wifiStatus"] = wifiMgr.getConnectionStatus();
   doc["freeHeap"] = ESP.getFreeHeap();
   doc["uptime"] = millis() / 1000;
   doc["autoPowerOn"] = hardware.getAutoPowerOn();
 
-  String response;
-  serializeJson(doc, response);
+  size_t length;
+  const char* response = lease.serialize(length);
+  memTelemetry.noteUse(MEM_USE_WEB_API, length + 1);
   server.send(200, "application/json", response);
 }
 
@@ -153,10 +225,8 @@ bool WebServerManager::validateAPIPassword(const String& password) {
   return password == g_apiPassword;
 }
 
-void WebServerManager::handleAPICommand() {
-  sendCORS();
-  
-  // Check for password in header
+// Check the API password (header or argument), sends 401 when it does not match
+bool WebServerManager::authorizeAPIRequest() {
   String password = "";
   if (server.hasHeader("X-API-Password")) {
     password = server.header("X-API-Password");
@@ -165,8 +235,17 @@ void WebServerManager::handleAPICommand() {
   }
   
   if (!validateAPIPassword(password)) {
-    Serial.println("[API] Unauthorized API command attempt");
+    LOG_WARNING("API: Unauthorized API command attempt");
     server.send(401, "application/json", "{\"error\":\"Unauthorized - Invalid password\"}");
+    return false;
+  }
+  return true;
+}
+
+void WebServerManager::handleAPICommand() {
+  sendCORS();
+  
+  if (!authorizeAPIRequest()) {
     return;
   }
   
@@ -188,7 +267,7 @@ void WebServerManager::handleAPICommand() {
   DeserializationError error = deserializeJson(doc, body);
   
   if (error) {
-    Serial.println("[API] JSON parse error: " + String(error.c_str()));
+    LOG_WARNING("API: JSON parse error: %s", error.c_str());
     server.send(400, "application/json", "{\"error\":\"Invalid JSON: " + String(error.c_str()) + "\"}");
     return;
   }
@@ -232,9 +311,13 @@ void WebServerManager::handleAPICommand() {
       duration = (button == 0) ? BUTTON_POWER_DURATION : BUTTON_STANDARD_DURATION;
     }
     
-    hardware.pressButton(button, duration);
+    // Pressed by the main loop; refused only when its queue is full
+    if (!hardware.requestButtonPress(button, duration)) {
+      server.send(503, "application/json", "{\"error\":\"Command queue full, retry\"}");
+      return;
+    }
     
-    Serial.println("[API] Button " + String(button) + " pressed via HTTP API");
+    LOG_INFO("API: Button %d pressed via HTTP API", button);
     server.send(200, "application/json", "{\"success\":true,\"message\":\"Button pressed\"}");
     
   } else if (command == "setAutoPowerOn") {
@@ -245,14 +328,18 @@ void WebServerManager::handleAPICommand() {
     }
     
     bool enabled = doc["enabled"].as<bool>();
-    hardware.setAutoPowerOn(enabled);
+    if (!hardware.requestAutoPowerOn(enabled)) {
+      server.send(503, "application/json", "{\"error\":\"Command queue full, retry\"}");
+      return;
+    }
     
-    Serial.println("[API] Auto Power On set to " + String(enabled ? "ENABLED" : "DISABLED") + " via HTTP API");
+    LOG_INFO("API: Auto Power On set to %s via HTTP API", enabled ? "ENABLED" : "DISABLED");
     server.send(200, "application/json", "{\"success\":true,\"message\":\"Auto Power On updated\"}");
     
   } else if (command == "getData") {
-    SensorData data = hardware.getSensorData();
-    EnergyData energyData = energyMonitor.getStableEnergyData();
+    TelemetryFrame frame = telemetry.read();
+    const SensorData& data = frame.sensor;
+    const EnergyData& energyData = frame.stableEnergy;
     
     // Increased buffer size for response
     DynamicJsonDocument response(2048);
@@ -341,7 +428,7 @@ void WebServerManager::handleButtonPress() {
     duration = BUTTON_POWER_DURATION;
   }
 
-  if (hardware.pressButton(buttonIndex, duration)) {
+  if (hardware.requestButtonPress(buttonIndex, duration)) {
     server.send(200, "application/json", "{\"success\":true}");
 
     DynamicJsonDocument doc(256);
@@ -357,6 +444,276 @@ void WebServerManager::handleButtonPress() {
   }
 }
 
+void WebServerManager::handleCompensation() {
+  sendCORS();
+  
+  if (server.method() == HTTP_GET) {
+    server.send(200, "application/json", getCompensationJson());
+    return;
+  }
+  
+  if (!authorizeAPIRequest()) {
+    return;
+  }
+  
+  String body = server.arg("plain");
+  if (body.length() == 0 || body.length() > 4096) {
+    server.send(400, "application/json", "{\"error\":\"Invalid request body size\"}");
+    return;
+  }
+  
+  StaticJsonDocument<64> filter;
+  filter["reset"] = true;
+  StaticJsonDocument<64> resetDoc;
+  deserializeJson(resetDoc, body, DeserializationOption::Filter(filter));
+  if (resetDoc["reset"] | false) {
+    resetCompensationToDefaults();
+    server.send(200, "application/json", getCompensationJson());
+    return;
+  }
+  
+  String error;
+  if (!saveCompensationJson(body, error)) {
+    server.send(400, "application/json", "{\"error\":\"" + error + "\"}");
+    return;
+  }
+  
+  LOG_INFO("API: Voltage compensation tables updated via HTTP API");
+  server.send(200, "application/json", getCompensationJson());
+}
+
+void WebServerManager::handleSocCurves() {
+  sendCORS();
+  
+  if (server.method() == HTTP_GET) {
+    server.send(200, "application/json", getSocCurvesJson());
+    return;
+  }
+  
+  if (!authorizeAPIRequest()) {
+    return;
+  }
+  
+  String body = server.arg("plain");
+  if (body.length() == 0 || body.length() > 8192) {
+    server.send(400, "application/json", "{\"error\":\"Invalid request body size\"}");
+    return;
+  }
+  
+  StaticJsonDocument<64> filter;
+  filter["reset"] = true;
+  StaticJsonDocument<64> resetDoc;
+  deserializeJson(resetDoc, body, DeserializationOption::Filter(filter));
+  if (resetDoc["reset"] | false) {
+    resetSocCurvesToDefaults();
+    server.send(200, "application/json", getSocCurvesJson());
+    return;
+  }
+  
+  String error;
+  if (!saveSocCurvesJson(body, error)) {
+    server.send(400, "application/json", "{\"error\":\"" + error + "\"}");
+    return;
+  }
+  
+  LOG_INFO("API: SOC curves updated via HTTP API");
+  server.send(200, "application/json", getSocCurvesJson());
+}
+
+// Loop latency percentiles and per-task timing of the loop() scheduler
+void WebServerManager::handleScheduler() {
+  sendCORS();
+  
+  if (server.method() == HTTP_POST) {
+    if (!authorizeAPIRequest()) return;
+    scheduler.requestReset();
+    netScheduler.requestReset();
+    server.send(200, "application/json", "{\"success\":true}");
+    return;
+  }
+  
+  JsonLease lease(jsonPool);
+  JsonObject root = lease.doc().to<JsonObject>();
+  addSchedulerStats(root, scheduler);
+  addSchedulerStats(root.createNestedObject("network"), netScheduler);
+  
+  CommandQueueStats commands = hardware.getCommandQueueStats();
+  JsonObject cmdObj = root.createNestedObject("commands");
+  cmdObj["posted"] = commands.posted;
+  cmdObj["dropped"] = commands.dropped;
+  cmdObj["executed"] = commands.executed;
+  cmdObj["maxWaitUs"] = commands.maxWaitUs;
+  
+  JsonObject telObj = root.createNestedObject("telemetry");
+  telObj["sequence"] = telemetry.getSequence();
+  JsonArray sinks = telObj.createNestedArray("sinks");
+  addTelemetrySinks(sinks, loopSinks);
+  addTelemetrySinks(sinks, netSinks);
+  
+  size_t length;
+  const char* response = lease.serialize(length);
+  memTelemetry.noteUse(MEM_USE_WEB_API, length + 1);
+  server.send(200, "application/json", response);
+}
+
+// Last heap sample; withUses adds the block counts, high-water marks and JSON arena
+void WebServerManager::addMemoryStats(JsonObject obj, bool withUses) {
+  MemoryStats mem = memTelemetry.getStats();
+  obj["free"] = mem.freeBytes;
+  obj["minFree"] = mem.minFreeBytes;
+  obj["largestBlock"] = mem.largestBlock;
+  obj["minLargestBlock"] = mem.minLargestBlock;
+  obj["fragmentationPercent"] = mem.fragmentationPercent;
+  if (mem.allocCounting) {
+    obj["allocsPerLoop"] = mem.allocsPerLoop;
+    obj["allocsPerNetLoop"] = mem.allocsPerNetLoop;
+    obj["allocsPerSecond"] = mem.allocsPerSecond;
+  } else {
+    obj["allocsPerLoop"] = nullptr;   // Needs CONFIG_HEAP_USE_HOOKS
+  }
+  if (!withUses) return;
+  
+  obj["allocatedBlocks"] = mem.allocatedBlocks;
+  obj["freeBlocks"] = mem.freeBlocks;
+  obj["failedAllocs"] = mem.failedAllocs;
+  obj["lastFailedSize"] = mem.lastFailedSize;
+  
+  JsonPoolStats json = jsonPool.getStats();
+  JsonObject arenaObj = obj.createNestedObject("jsonArena");
+  arenaObj["arenas"] = json.arenas;
+  arenaObj["arenaSize"] = json.arenaSize;
+  arenaObj["inUse"] = json.inUse;
+  arenaObj["maxInUse"] = json.maxInUse;
+  arenaObj["leases"] = json.leases;
+  arenaObj["fallbacks"] = json.fallbacks;
+  arenaObj["spills"] = json.spills;
+  arenaObj["peakBytes"] = json.peakBytes;
+  
+  JsonObject uses = obj.createNestedObject("highWater");
+  for (int i = 0; i < MEM_USE_COUNT; i++) {
+    JsonObject u = uses.createNestedObject(memUseName(i));
+    uint32_t bytes = memTelemetry.getHighWater(i);
+    u["bytes"] = bytes;
+    u["fits"] = bytes <= mem.largestBlock;
+  }
+}
+
+// Delivery counters of the telemetry sinks of one task
+void WebServerManager::addTelemetrySinks(JsonArray sinks, const TelemetryFanout<TelemetryFrame>& fanout) {
+  for (int i = 0; i < fanout.getSinkCount(); i++) {
+    const TelemetrySink<TelemetryFrame>& sink = fanout.getSink(i);
+    JsonObject s = sinks.createNestedObject();
+    s["name"] = sink.name;
+    s["minIntervalMs"] = sink.minIntervalMs;
+    s["maxIntervalMs"] = sink.maxIntervalMs;
+    s["delivered"] = sink.delivered;
+    s["unchanged"] = sink.unchanged;
+    s["rateLimited"] = sink.rateLimited;
+    s["unavailable"] = sink.unavailable;
+    s["lastSequence"] = sink.lastSequence;
+  }
+}
+
+// Loop histogram and per-task timing of one scheduler
+void WebServerManager::addSchedulerStats(JsonObject doc, const TaskScheduler& sched) {
+  const LatencyHistogram& loopHist = sched.getLoopHistogram();
+  JsonObject loopObj = doc.createNestedObject("loop");
+  loopObj["iterations"] = loopHist.getSamples();
+  loopObj["meanUs"] = loopHist.getMean();
+  loopObj["p50Us"] = loopHist.percentile(50);
+  loopObj["p90Us"] = loopHist.percentile(90);
+  loopObj["p99Us"] = loopHist.percentile(99);
+  loopObj["p999Us"] = loopHist.percentile(99.9);
+  loopObj["maxUs"] = loopHist.getMax();
+  doc["tickBudgetUs"] = sched.getTickBudgetUs();
+  doc["deferredTicks"] = sched.getDeferredTicks();
+  
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (int i = 0; i < sched.getTaskCount(); i++) {
+    const SchedTask& task = sched.getTask(i);
+    JsonObject t = tasks.createNestedObject();
+    t["name"] = task.name;
+    t["periodMs"] = task.periodMs;
+    t["budgetUs"] = task.budgetUs;
+    t["runs"] = task.runs;
+    t["overruns"] = task.overruns;
+    t["skipped"] = task.skipped;
+    t["lastUs"] = task.lastUs;
+    t["avgUs"] = task.runs > 0 ? (float)task.totalUs / task.runs : 0;
+    t["maxUs"] = task.maxUs;
+    t["maxLateUs"] = task.maxLateUs;
+  }
+}
+
+// Per-stage cycle timing of the sensor, main loop and network tasks
+void WebServerManager::handlePerf() {
+  sendCORS();
+  
+  if (server.method() == HTTP_POST) {
+    if (!authorizeAPIRequest()) return;
+    profiler.requestReset();
+    server.send(200, "application/json", "{\"success\":true}");
+    return;
+  }
+  
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
+  doc["cpuMhz"] = profiler.getCpuMhz();
+  JsonArray stages = doc.createNestedArray("stages");
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+    const PerfStageStats& stage = profiler.getStage(i);
+    JsonObject s = stages.createNestedObject();
+    s["name"] = perfStageName(i);
+    s["count"] = stage.count;
+    s["minUs"] = profiler.toUs(stage.minCycles);
+    s["meanUs"] = profiler.getMeanUs(i);
+    s["p50Us"] = stage.histogram.percentile(50);
+    s["p90Us"] = stage.histogram.percentile(90);
+    s["p99Us"] = stage.histogram.percentile(99);
+    s["maxUs"] = profiler.toUs(stage.maxCycles);
+  }
+  
+  LogStats logStats = getLogStats();
+  JsonObject log = doc.createNestedObject("log");
+  log["written"] = logStats.written;
+  log["lostBytes"] = logStats.lostBytes;
+  log["buffered"] = logStats.buffered;
+  log["ringSize"] = logStats.ringSize;
+  log["kept"] = logStats.kept;
+  
+  size_t length;
+  const char* response = lease.serialize(length);
+  memTelemetry.noteUse(MEM_USE_WEB_API, length + 1);
+  server.send(200, "application/json", response);
+}
+
+// Last ?kb= kilobytes of the log ring (all of it by default), streamed in
+// chunks from the network task stack
+void WebServerManager::handleLogs() {
+  sendCORS();
+  
+  size_t bytes = LOG_RING_SIZE;
+  if (server.hasArg("kb")) {
+    long kb = server.arg("kb").toInt();
+    if (kb > 0 && (size_t)kb * 1024 < bytes) bytes = kb * 1024;
+  }
+  
+  uint32_t pos = logTailStart(bytes);
+  uint32_t end = logHead();
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; charset=utf-8", "");
+  
+  char chunk[512];
+  while (pos != end) {
+    size_t want = end - pos;
+    if (want > sizeof(chunk)) want = sizeof(chunk);
+    size_t n = logRead(pos, chunk, want);
+    if (n == 0) break;
+    server.sendContent(chunk, n);
+  }
+  server.sendContent("");
+}
+
 void WebServerManager::handleNotFound() {
   sendCORS();
   server.send(404, "text/plain", "Not Found");
@@ -374,18 +731,24 @@ void WebServerManager::webSocketEventStatic(uint8_t num, WStype_t type, uint8_t
   }
 }
 
-void WebServerManager::broadcastData(const SensorData& sensorData, const EnergyData& energyData) {
-  // Check memory before creating JSON
-  if (ESP.getFreeHeap() < 10000) {
-    return;  // Skip broadcast if memory too low
+// Serialized once per telemetry frame, shared by the broadcast and getData
+bool WebServerManager::buildDataMessage(const TelemetryFrame& frame) {
+  if (dataMessage.length() > 0 && dataMessageSequence == frame.sequence) {
+    return true;
   }
   
-  // Increased buffer size
-  DynamicJsonDocument doc(2048);
+  const SensorData& sensorData = frame.sensor;
+  const EnergyData& energyData = frame.stableEnergy;
+  
+  JsonLease lease(jsonPool);
+  JsonDocument& doc = lease.doc();
   doc["type"] = "sensorData";
   doc["timestamp"] = sensorData.timestamp;
+  doc["sequence"] = frame.sequence;
   doc["voltage"] = sensorData.batteryVoltage;
   doc["soc"] = sensorData.batteryPercentage;
+  doc["socVoltage"] = sensorData.socVoltage;
+  doc["socFused"] = sensorData.socFused;
   doc["powerIn"] = sensorData.mainPower;
   doc["powerOut"] = sensorData.outputPower;
   doc["state"] = hardware.getStateString(sensorData.batteryState);
@@ -394,6 +757,7 @@ void WebServerManager::broadcastData(const SensorData& sensorData, const EnergyD
   doc["acOutputActive"] = (sensorData.outputPower > 5.0) || (sensorData.outputCurrent > 0.05);
   doc["heap"] = ESP.getFreeHeap();
   doc["uptime"] = millis() / 1000;
+  addMemoryStats(doc.createNestedObject("memory"), false);
 
   // Energy data from energyMonitor
   doc["instantPower"] = energyData.instantPower;
@@ -401,20 +765,43 @@ void WebServerManager::broadcastData(const SensorData& sensorData, const EnergyD
   doc["monthCurrent"] = energyData.monthlyConsumption;
   doc["yearEstimate"] = energyData.monthlyConsumption * 12.0;
 
-  String message;
-  size_t bytesWritten = serializeJson(doc, message);
+  // Kept between frames: the copy reuses its buffer
+  size_t length;
+  dataMessage = lease.serialize(length);
   
-  if (bytesWritten == 0 || message.length() == 0) {
-    Serial.println("[WEB] ERROR: Failed to serialize broadcast data");
-    return;
+  if (length == 0 || dataMessage.length() == 0) {
+    LOG_ERROR("Web server: Failed to serialize broadcast data");
+    dataMessage = "";
+    return false;
+  }
+  memTelemetry.noteUse(MEM_USE_WEBSOCKET, dataMessage.length() + 1);
+  dataMessageSequence = frame.sequence;
+  return true;
+}
+
+// Telemetry sink: false when nobody listens or memory is low (retried)
+bool WebServerManager::broadcastData(const TelemetryFrame& frame) {
+  if (!initialized || webSocket.connectedClients() == 0) {
+    return false;
+  }
+  
+  // Check memory before creating JSON
+  if (ESP.getFreeHeap() < 10000) {
+    LOG_WARNING("Web server: Low memory, skipping WebSocket broadcast");
+    return false;
+  }
+  
+  if (!buildDataMessage(frame)) {
+    return false;
   }
   
   // Broadcast with error handling
   try {
-    webSocket.broadcastTXT(message);
+    webSocket.broadcastTXT(dataMessage);
   } catch (...) {
-    Serial.println("[WEB] ERROR: Exception during WebSocket broadcast");
+    LOG_ERROR("Web server: Exception during WebSocket broadcast");
   }
+  return true;
 }
 
 void WebServerManager::broadcastStatus(const String& message) {
@@ -437,7 +824,7 @@ void WebServerManager::broadcastStatus(const String& message) {
   try {
     webSocket.broadcastTXT(output);
   } catch (...) {
-    Serial.println("[WEB] ERROR: Exception during status broadcast");
+    LOG_ERROR("Web server: Exception during status broadcast");
   }
 }
 
@@ -455,15 +842,67 @@ void WebServerManager::notifyACActivated() {
   size_t bytesWritten = serializeJson(doc, message);
   
   if (bytesWritten == 0 || message.length() == 0) {
-    Serial.println("[WEB] ERROR: Failed to serialize AC activation notification");
+    LOG_ERROR("Web server: Failed to serialize AC activation notification");
     return;
   }
   
   try {
     webSocket.broadcastTXT(message);
-    Serial.println("[WEB] Sent AC activation notification to all WebSocket clients");
+    LOG_INFO("Web server: Sent AC activation notification to all WebSocket clients");
   } catch (...) {
-    Serial.println("[WEB] ERROR: Exception during AC activation broadcast");
+    LOG_ERROR("Web server: Exception during AC activation broadcast");
+  }
+}
+
+void WebServerManager::notifyMainsEvent(bool lost, float detectMs) {
+  // Check memory before broadcast
+  if (ESP.getFreeHeap() < 5000) {
+    return;
+  }
+  
+  DynamicJsonDocument doc(128);
+  doc["type"] = "mains";
+  doc["lost"] = lost;
+  doc["detectMs"] = detectMs;
+
+  String message;
+  size_t bytesWritten = serializeJson(doc, message);
+  
+  if (bytesWritten == 0 || message.length() == 0) {
+    return;
+  }
+  
+  try {
+    webSocket.broadcastTXT(message);
+  } catch (...) {
+    LOG_ERROR("Web server: Exception during mains event broadcast");
+  }
+}
+
+// Network task, every LOG_TAIL_INTERVAL: at most LOG_TAIL_CHUNK of new log
+// text per subscribed client. "lost" counts text overwritten before it was sent.
+void WebServerManager::pushLogTail() {
+  char text[LOG_TAIL_CHUNK + 1];
+  uint32_t head = logHead();
+  
+  for (int i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (!logTailOn[i] || logTailPos[i] == head) continue;
+    
+    uint32_t lost;
+    size_t n = logRead(logTailPos[i], text, LOG_TAIL_CHUNK, &lost);
+    text[n] = '\0';
+    
+    JsonLease lease(jsonPool);
+    JsonDocument& doc = lease.doc();
+    doc["type"] = "log";
+    doc["text"] = (const char*)text;
+    if (lost > 0) doc["lost"] = lost;
+    
+    size_t length;
+    const char* message = lease.serialize(length);
+    if (length == 0) continue;
+    memTelemetry.noteUse(MEM_USE_WEBSOCKET, length + 1);
+    webSocket.sendTXT(i, message, length);
   }
 }
 
@@ -10,6 +10,8 @@
 #include <WebSocketsServer.h>
 #include <ArduinoJson.h>
 #include "config.h"
+#include "task_scheduler.h"
+#include "telemetry_fanout.h"
 
 // Forward declarations
 class HardwareManager;
@@ -19,7 +21,12 @@ private:
   WebServer server;
   WebSocketsServer webSocket;
   bool initialized;
-  unsigned long lastDataBroadcast;
+  String dataMessage;                 // Last serialized sensorData message
+  uint32_t dataMessageSequence;       // Telemetry frame it was built from
+  
+  // WebSocket log tail: next log ring position per subscribed client
+  bool logTailOn[WEBSOCKETS_SERVER_CLIENT_MAX];
+  uint32_t logTailPos[WEBSOCKETS_SERVER_CLIENT_MAX];
   
   static WebServerManager* instance;
   static HardwareManager* hwManager;
@@ -30,13 +37,24 @@ private:
   void handleConfig();
   void handleWiFiConfig();
   void handleButtonPress();
+  void handleCompensation();
+  void handleSocCurves();
+  void handleScheduler();
+  void addSchedulerStats(JsonObject doc, const TaskScheduler& sched);
+  void addTelemetrySinks(JsonArray sinks, const TelemetryFanout<TelemetryFrame>& fanout);
+  void addMemoryStats(JsonObject obj, bool withUses);
+  void handlePerf();
+  void handleLogs();
   void handleNotFound();
   void sendCORS();
   bool validateAPIPassword(const String& password);
+  bool authorizeAPIRequest();
   
   static void webSocketEventStatic(uint8_t num, WStype_t type, uint8_t * payload, size_t length);
   void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length);
   
+  bool buildDataMessage(const TelemetryFrame& frame);
+  
   String generateHTML();
   String generateConfigHTML();
   String generateWiFiConfigHTML();
@@ -45,10 +63,12 @@ public:
   WebServerManager();
   bool begin();
   void handleClient();
-  void broadcastData(const SensorData& sensorData, const EnergyData& energyData);
+  bool broadcastData(const TelemetryFrame& frame);  // Telemetry sink
   void broadcastStatus(const String& message);
   void setHardwareManager(HardwareManager* hw);
   void notifyACActivated();
+  void notifyMainsEvent(bool lost, float detectMs);
+  void pushLogTail();                               // New log text to the tail subscribers
 };
 
 #endif // WEB_SERVER_H
\ No newline at end of file
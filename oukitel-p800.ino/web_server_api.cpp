@@ -11,6 +11,9 @@
 #include "http_client.h"
 #include "ups_protocol.h"
 #include "logger.h"
+#include "seqlock.h"
+#include "memory_telemetry.h"
+#include "json_arena.h"
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
 
@@ -22,26 +25,35 @@ extern PowerStationMonitor energyMonitor;
 extern MQTTClientManager mqttClient;
 extern HTTPClientManager httpClient;
 extern UPSProtocol upsProtocol;
+extern SeqLockSnapshot<TelemetryFrame> telemetry;
+extern MemoryTelemetry memTelemetry;
+extern JsonPool jsonPool;
 
 void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length) {
   switch (type) {
     case WStype_DISCONNECTED:
-      Serial.println("[WS] Client " + String(num) + " disconnected");
+      LOG_INFO("WebSocket: Client %u disconnected", num);
+      if (num < WEBSOCKETS_SERVER_CLIENT_MAX) logTailOn[num] = false;
       break;
 
     case WStype_CONNECTED:
       {
-        Serial.println("[WS] Client " + String(num) + " connected");
+        LOG_INFO("WebSocket: Client %u connected", num);
 
-        SensorData data = hardware.getSensorData();
-        EnergyData energyData = energyMonitor.getStableEnergyData();
+        TelemetryFrame frame = telemetry.read();
+        const SensorData& data = frame.sensor;
+        const EnergyData& energyData = frame.stableEnergy;
 
-        // Increased size to prevent overflow (was 1024)
-        DynamicJsonDocument doc(2048);
+        // One arena for all connect messages, each reuses it after sending
+        JsonLease lease(jsonPool);
+        JsonDocument& doc = lease.doc();
         doc["type"] = "sensorData";
         doc["timestamp"] = data.timestamp;
+        doc["sequence"] = frame.sequence;
         doc["voltage"] = data.batteryVoltage;
         doc["soc"] = data.batteryPercentage;
+        doc["socVoltage"] = data.socVoltage;
+        doc["socFused"] = data.socFused;
         doc["powerIn"] = data.mainPower;
         doc["powerOut"] = data.outputPower;
         doc["state"] = hardware.getStateString(data.batteryState);
@@ -58,26 +70,28 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
         doc["macAddress"] = WiFi.macAddress();
         doc["ssid"] = WiFi.SSID();
         doc["rssi"] = WiFi.RSSI();
+        addMemoryStats(doc.createNestedObject("memory"), false);
 
-        String message;
-        size_t bytesWritten = serializeJson(doc, message);
+        size_t length;
+        const char* message = lease.serialize(length);
         
-        if (bytesWritten == 0 || message.length() == 0) {
-          LOG_ERROR("WebSocket: Failed to serialize sensor data for client " + String(num));
+        if (length == 0) {
+          LOG_ERROR("WebSocket: Failed to serialize sensor data for client %u", num);
           break;
         }
+        memTelemetry.noteUse(MEM_USE_WEBSOCKET, length + 1);
         
         // Check memory before sending
         if (ESP.getFreeHeap() < 5000) {
-          LOG_WARNING("WebSocket: Low memory, skipping data send to client " + String(num));
+          LOG_WARNING("WebSocket: Low memory, skipping data send to client %u", num);
           break;
         }
         
-        webSocket.sendTXT(num, message);
+        webSocket.sendTXT(num, message, length);
 
-        // Send calibration data - increased size for safety
+        // Send calibration data
         CalibrationData cal = hardware.getCalibrationData();
-        DynamicJsonDocument calDoc(1024);
+        JsonDocument& calDoc = lease.next();
         calDoc["type"] = "calibrationData";
         calDoc["sct013CalIn"] = cal.sct013CalIn;
         calDoc["sct013OffsetIn"] = cal.sct013OffsetIn;
@@ -90,16 +104,16 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
         calDoc["voltageOffsetRest"] = cal.voltageOffsetRest;
         calDoc["fixedVoltage"] = cal.fixedVoltage;     // NEW
         calDoc["mainsVoltage"] = cal.mainsVoltage;     // NEW
-        String calMessage;
-        size_t calBytesWritten = serializeJson(calDoc, calMessage);
+        size_t calLength;
+        const char* calMessage = lease.serialize(calLength);
         
-        if (calBytesWritten > 0 && calMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, calMessage);
+        if (calLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, calMessage, calLength);
         }
 
         // Send advanced settings
         AdvancedSettings adv = hardware.getAdvancedSettings();
-        DynamicJsonDocument advDoc(512);
+        JsonDocument& advDoc = lease.next();
         advDoc["type"] = "advancedSettings";
         advDoc["powerStationOffVoltage"] = adv.powerStationOffVoltage;
         advDoc["powerThreshold"] = adv.powerThreshold;
@@ -111,17 +125,30 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
         advDoc["socBufferSize"] = adv.socBufferSize;
         advDoc["socChangeThreshold"] = adv.socChangeThreshold;
         advDoc["warmupDelay"] = adv.warmupDelay;
-
-        String advMessage;
-        size_t advBytesWritten = serializeJson(advDoc, advMessage);
+        advDoc["rmsWindowCycles"] = adv.rmsWindowCycles;
+        advDoc["socFusionEnabled"] = adv.socFusionEnabled;
+        advDoc["socCapacityAh"] = adv.socCapacityAh;
+        advDoc["powerFilterInType"] = adv.powerFilterIn.type;
+        advDoc["powerFilterInMedian3"] = adv.powerFilterIn.median3;
+        advDoc["powerFilterInAlphaMax"] = adv.powerFilterIn.alphaMax;
+        advDoc["powerFilterInStepWatts"] = adv.powerFilterIn.stepWatts;
+        advDoc["powerFilterOutType"] = adv.powerFilterOut.type;
+        advDoc["powerFilterOutMedian3"] = adv.powerFilterOut.median3;
+        advDoc["powerFilterOutAlphaMax"] = adv.powerFilterOut.alphaMax;
+        advDoc["powerFilterOutStepWatts"] = adv.powerFilterOut.stepWatts;
+        advDoc["harmonicAnalysisEnabled"] = adv.harmonicAnalysisEnabled;
+        advDoc["lowPowerEnabled"] = adv.lowPowerEnabled;
+
+        size_t advLength;
+        const char* advMessage = lease.serialize(advLength);
         
-        if (advBytesWritten > 0 && advMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, advMessage);
+        if (advLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, advMessage, advLength);
         }
         
         // Send MQTT config
         MQTTConfig mqttConfig = mqttClient.getConfig();
-        DynamicJsonDocument mqttDoc(512);
+        JsonDocument& mqttDoc = lease.next();
         mqttDoc["type"] = "mqttConfig";
         mqttDoc["enabled"] = mqttConfig.enabled;
         mqttDoc["server"] = mqttConfig.server;
@@ -129,71 +156,71 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
         mqttDoc["username"] = mqttConfig.username;
         mqttDoc["password"] = mqttConfig.password;
         mqttDoc["clientId"] = mqttConfig.clientId;
-        String mqttMessage;
-        size_t mqttBytes = serializeJson(mqttDoc, mqttMessage);
-        if (mqttBytes > 0 && mqttMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, mqttMessage);
+        size_t mqttLength;
+        const char* mqttMessage = lease.serialize(mqttLength);
+        if (mqttLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, mqttMessage, mqttLength);
         }
         
         // Send HTTP config
         HTTPConfig httpConfig = httpClient.getConfig();
-        DynamicJsonDocument httpDoc(512);
+        JsonDocument& httpDoc = lease.next();
         httpDoc["type"] = "httpConfig";
         httpDoc["enabled"] = httpConfig.enabled;
         httpDoc["server"] = httpConfig.server;
         httpDoc["port"] = httpConfig.port;
         httpDoc["endpoint"] = httpConfig.endpoint;
         httpDoc["apiKey"] = httpConfig.apiKey;
-        String httpMessage;
-        size_t httpBytes = serializeJson(httpDoc, httpMessage);
-        if (httpBytes > 0 && httpMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, httpMessage);
+        size_t httpLength;
+        const char* httpMessage = lease.serialize(httpLength);
+        if (httpLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, httpMessage, httpLength);
         }
         
         // Send UPS config
         UPSConfig upsConfig = upsProtocol.getConfig();
-        DynamicJsonDocument upsDoc(512);
+        JsonDocument& upsDoc = lease.next();
         upsDoc["type"] = "upsConfig";
         upsDoc["enabled"] = upsConfig.enabled;
         upsDoc["port"] = upsConfig.port;
         upsDoc["shutdownThreshold"] = upsConfig.shutdownThreshold;
-        String upsMessage;
-        size_t upsBytes = serializeJson(upsDoc, upsMessage);
-        if (upsBytes > 0 && upsMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, upsMessage);
+        size_t upsLength;
+        const char* upsMessage = lease.serialize(upsLength);
+        if (upsLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, upsMessage, upsLength);
         }
         
         // Send System Settings (NTP + Beeps) - NEW!
-        DynamicJsonDocument sysDoc(512);
+        JsonDocument& sysDoc = lease.next();
         sysDoc["type"] = "systemSettings";
         sysDoc["ntpServer"] = g_ntpServer;
         sysDoc["gmtOffset"] = g_gmtOffset;
         sysDoc["daylightOffset"] = g_daylightOffset;
         sysDoc["beepsEnabled"] = g_beepsEnabled;
         sysDoc["logLevel"] = g_logLevel;
-        String sysMessage;
-        size_t sysBytes = serializeJson(sysDoc, sysMessage);
-        if (sysBytes > 0 && sysMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, sysMessage);
+        size_t sysLength;
+        const char* sysMessage = lease.serialize(sysLength);
+        if (sysLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, sysMessage, sysLength);
         }
         
         // Send HTTP Shutdown Config - NEW!
-        DynamicJsonDocument shutdownDoc(512);
+        JsonDocument& shutdownDoc = lease.next();
         shutdownDoc["type"] = "httpShutdownConfig";
         shutdownDoc["enabled"] = g_httpShutdownEnabled;
         shutdownDoc["batteryThreshold"] = g_httpShutdownThreshold;
         shutdownDoc["server"] = g_httpShutdownServer;
         shutdownDoc["port"] = g_httpShutdownPort;
         shutdownDoc["password"] = g_httpShutdownPassword;
-        String shutdownMessage;
-        size_t shutdownBytes = serializeJson(shutdownDoc, shutdownMessage);
-        if (shutdownBytes > 0 && shutdownMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, shutdownMessage);
+        size_t shutdownLength;
+        const char* shutdownMessage = lease.serialize(shutdownLength);
+        if (shutdownLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, shutdownMessage, shutdownLength);
         }
         
         // Send monthly history
         std::vector<MonthlyEnergyRecord> history = energyMonitor.getMonthlyHistory();
-        DynamicJsonDocument histDoc(2048);
+        JsonDocument& histDoc = lease.next();
         histDoc["type"] = "monthlyHistory";
         JsonArray histArray = histDoc.createNestedArray("history");
         for (const auto& record : history) {
@@ -202,19 +229,20 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
           obj["month"] = record.month;
           obj["consumption"] = record.consumption;
         }
-        String histMessage;
-        size_t histBytes = serializeJson(histDoc, histMessage);
-        if (histBytes > 0 && histMessage.length() > 0 && ESP.getFreeHeap() > 5000) {
-          webSocket.sendTXT(num, histMessage);
+        size_t histLength;
+        const char* histMessage = lease.serialize(histLength);
+        if (histLength > 0 && ESP.getFreeHeap() > 5000) {
+          webSocket.sendTXT(num, histMessage, histLength);
         }
       }
       break;
 
     case WStype_TEXT:
       {
-        Serial.println("[WS] Received: " + String((char*)payload));
+        LOG_DEBUG("WebSocket: Received: %s", (const char*)payload);
 
-        DynamicJsonDocument doc(1024);
+        JsonLease lease(jsonPool);
+        JsonDocument& doc = lease.doc();
         DeserializationError error = deserializeJson(doc, payload);
 
         if (!error) {
@@ -228,12 +256,13 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
               duration = BUTTON_POWER_DURATION;
             }
 
-            hardware.pressButton(button, duration);
+            hardware.requestButtonPress(button, duration);
 
           } else if (command == "getData") {
-            SensorData data = hardware.getSensorData();
-            EnergyData energyData = energyMonitor.getStableEnergyData();
-            broadcastData(data, energyData);
+            // Latest frame to this client only, serialized once per frame
+            if (ESP.getFreeHeap() >= 10000 && buildDataMessage(telemetry.read())) {
+              webSocket.sendTXT(num, dataMessage);
+            }
 
           } else if (command == "setAutoPowerOn") {
             // Validate enabled parameter
@@ -248,8 +277,8 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             }
             
             bool enabled = doc["enabled"].as<bool>();
-            hardware.setAutoPowerOn(enabled);
-            Serial.println("[WS] Auto Power On set to: " + String(enabled ? "ENABLED" : "DISABLED"));
+            hardware.requestAutoPowerOn(enabled);
+            LOG_INFO("WebSocket: Auto Power On set to: %s", enabled ? "ENABLED" : "DISABLED");
 
             StaticJsonDocument<128> response;
             response["autoPowerOn"] = enabled;
@@ -337,7 +366,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             CalibrationData cal;
             
             if(getDefaults) {
-              Serial.println("[WS] Loading DEFAULT calibration values");
+              LOG_INFO("WebSocket: Loading DEFAULT calibration values");
               cal.sct013CalIn = SCT013_CALIBRATION_IN_DEFAULT;
               cal.sct013OffsetIn = SCT013_OFFSET_IN_DEFAULT;
               cal.sct013CalOut = SCT013_CALIBRATION_OUT_DEFAULT;
@@ -392,8 +421,8 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             cal.fixedVoltage = doc["fixedVoltage"] | 0.0f;                  // NEW
             cal.mainsVoltage = doc["mainsVoltage"] | MAINS_VOLTAGE;         // NEW
 
-            hardware.applyCalibration(cal);
-            hardware.saveCalibration();
+            // Applied and saved by the main loop
+            hardware.requestCalibration(cal);
 
             StaticJsonDocument<256> resp;
             resp["type"] = "calibrationStatus";
@@ -409,7 +438,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             AdvancedSettings adv;
             
             if(getDefaults) {
-              Serial.println("[WS] Loading DEFAULT advanced settings");
+              LOG_INFO("WebSocket: Loading DEFAULT advanced settings");
               adv.powerStationOffVoltage = POWER_STATION_OFF_VOLTAGE_DEFAULT;
               adv.powerThreshold = POWER_THRESHOLD_DEFAULT;
               adv.powerFilterAlpha = POWER_FILTER_ALPHA_DEFAULT;
@@ -420,11 +449,19 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
               adv.socBufferSize = SOC_BUFFER_SIZE_DEFAULT;
               adv.socChangeThreshold = SOC_CHANGE_THRESHOLD_DEFAULT;
               adv.warmupDelay = WARMUP_DELAY_DEFAULT;
+              adv.rmsWindowCycles = RMS_WINDOW_CYCLES_DEFAULT;
+              adv.socFusionEnabled = SOC_FUSION_ENABLED_DEFAULT;
+              adv.socCapacityAh = SOC_CAPACITY_AH_DEFAULT;
+              adv.powerFilterIn = {POWER_FILTER_TYPE_DEFAULT, POWER_FILTER_MEDIAN3_DEFAULT,
+                                   POWER_FILTER_ALPHA_MAX_DEFAULT, POWER_FILTER_STEP_WATTS_DEFAULT};
+              adv.powerFilterOut = adv.powerFilterIn;
+              adv.harmonicAnalysisEnabled = HARMONIC_ANALYSIS_ENABLED_DEFAULT;
+              adv.lowPowerEnabled = LOW_POWER_ENABLED_DEFAULT;
             } else {
               adv = hardware.getAdvancedSettings();
             }
             
-            StaticJsonDocument<512> resp;
+            StaticJsonDocument<1024> resp;
             resp["type"] = "advancedSettings";
             resp["powerStationOffVoltage"] = adv.powerStationOffVoltage;
             resp["powerThreshold"] = adv.powerThreshold;
@@ -436,14 +473,28 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             resp["socBufferSize"] = adv.socBufferSize;
             resp["socChangeThreshold"] = adv.socChangeThreshold;
             resp["warmupDelay"] = adv.warmupDelay;
+            resp["rmsWindowCycles"] = adv.rmsWindowCycles;
+            resp["socFusionEnabled"] = adv.socFusionEnabled;
+            resp["socCapacityAh"] = adv.socCapacityAh;
+            resp["powerFilterInType"] = adv.powerFilterIn.type;
+            resp["powerFilterInMedian3"] = adv.powerFilterIn.median3;
+            resp["powerFilterInAlphaMax"] = adv.powerFilterIn.alphaMax;
+            resp["powerFilterInStepWatts"] = adv.powerFilterIn.stepWatts;
+            resp["powerFilterOutType"] = adv.powerFilterOut.type;
+            resp["powerFilterOutMedian3"] = adv.powerFilterOut.median3;
+            resp["powerFilterOutAlphaMax"] = adv.powerFilterOut.alphaMax;
+            resp["powerFilterOutStepWatts"] = adv.powerFilterOut.stepWatts;
+            resp["harmonicAnalysisEnabled"] = adv.harmonicAnalysisEnabled;
+            resp["lowPowerEnabled"] = adv.lowPowerEnabled;
             String out;
             serializeJson(resp, out);
             webSocket.sendTXT(num, out);
 
           } else if (command == "saveAdvancedSettings") {
-            Serial.println("[WS] Saving Advanced Settings");
+            LOG_INFO("WebSocket: Saving Advanced Settings");
             
-            AdvancedSettings adv;
+            // Start from the current values so fields not sent by the page are kept
+            AdvancedSettings adv = hardware.getAdvancedSettings();
             adv.powerStationOffVoltage = doc["powerStationOffVoltage"] | POWER_STATION_OFF_VOLTAGE_DEFAULT;
             adv.powerThreshold = doc["powerThreshold"] | POWER_THRESHOLD_DEFAULT;
             adv.powerFilterAlpha = doc["powerFilterAlpha"] | POWER_FILTER_ALPHA_DEFAULT;
@@ -452,11 +503,33 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             adv.batteryCritical = doc["batteryCritical"] | BATTERY_CRITICAL_DEFAULT;
             adv.autoPowerOnDelay = doc["autoPowerOnDelay"] | AUTO_POWER_ON_DELAY_DEFAULT;
             adv.socBufferSize = doc["socBufferSize"] | SOC_BUFFER_SIZE_DEFAULT;
+            adv.socBufferSize = constrain(adv.socBufferSize, 1, SOC_BUFFER_SIZE_MAX);
             adv.socChangeThreshold = doc["socChangeThreshold"] | SOC_CHANGE_THRESHOLD_DEFAULT;
             adv.warmupDelay = doc["warmupDelay"] | WARMUP_DELAY_DEFAULT;
-
-            hardware.applyAdvancedSettings(adv);
-            hardware.saveAdvancedSettings();
+            adv.rmsWindowCycles = doc["rmsWindowCycles"] | RMS_WINDOW_CYCLES_DEFAULT;
+            adv.rmsWindowCycles = constrain(adv.rmsWindowCycles, RMS_WINDOW_CYCLES_MIN, RMS_WINDOW_CYCLES_MAX);
+            adv.socFusionEnabled = doc["socFusionEnabled"] | SOC_FUSION_ENABLED_DEFAULT;
+            adv.socCapacityAh = doc["socCapacityAh"] | SOC_CAPACITY_AH_DEFAULT;
+            adv.socCapacityAh = constrain(adv.socCapacityAh, SOC_CAPACITY_AH_MIN, SOC_CAPACITY_AH_MAX);
+            adv.powerFilterIn.type = doc["powerFilterInType"] | POWER_FILTER_TYPE_DEFAULT;
+            adv.powerFilterIn.type = constrain(adv.powerFilterIn.type, 0, POWER_FILTER_TYPE_COUNT - 1);
+            adv.powerFilterIn.median3 = doc["powerFilterInMedian3"] | POWER_FILTER_MEDIAN3_DEFAULT;
+            adv.powerFilterIn.alphaMax = doc["powerFilterInAlphaMax"] | POWER_FILTER_ALPHA_MAX_DEFAULT;
+            adv.powerFilterIn.alphaMax = constrain(adv.powerFilterIn.alphaMax, 0.1, 1.0);
+            adv.powerFilterIn.stepWatts = doc["powerFilterInStepWatts"] | POWER_FILTER_STEP_WATTS_DEFAULT;
+            adv.powerFilterIn.stepWatts = constrain(adv.powerFilterIn.stepWatts, 1.0, 2000.0);
+            adv.powerFilterOut.type = doc["powerFilterOutType"] | POWER_FILTER_TYPE_DEFAULT;
+            adv.powerFilterOut.type = constrain(adv.powerFilterOut.type, 0, POWER_FILTER_TYPE_COUNT - 1);
+            adv.powerFilterOut.median3 = doc["powerFilterOutMedian3"] | POWER_FILTER_MEDIAN3_DEFAULT;
+            adv.powerFilterOut.alphaMax = doc["powerFilterOutAlphaMax"] | POWER_FILTER_ALPHA_MAX_DEFAULT;
+            adv.powerFilterOut.alphaMax = constrain(adv.powerFilterOut.alphaMax, 0.1, 1.0);
+            adv.powerFilterOut.stepWatts = doc["powerFilterOutStepWatts"] | POWER_FILTER_STEP_WATTS_DEFAULT;
+            adv.powerFilterOut.stepWatts = constrain(adv.powerFilterOut.stepWatts, 1.0, 2000.0);
+            adv.harmonicAnalysisEnabled = doc["harmonicAnalysisEnabled"] | HARMONIC_ANALYSIS_ENABLED_DEFAULT;
+            adv.lowPowerEnabled = doc["lowPowerEnabled"] | LOW_POWER_ENABLED_DEFAULT;
+
+            // Applied and saved by the main loop
+            hardware.requestAdvancedSettings(adv);
 
             StaticJsonDocument<256> resp;
             resp["type"] = "advancedSettingsStatus";
@@ -526,7 +599,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             ESP.restart();
             
           } else if (command == "saveSystemSettings") {
-            Serial.println("[WS] Saving System Settings");
+            LOG_INFO("WebSocket: Saving System Settings");
             
             SystemSettings settings;
             settings.ntpServer = doc["ntpServer"].as<String>();
@@ -560,7 +633,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             ESP.restart();
             
           } else if (command == "saveHttpShutdownConfig") {
-            Serial.println("[WS] Saving HTTP Shutdown Configuration");
+            LOG_INFO("WebSocket: Saving HTTP Shutdown Configuration");
             
             HttpShutdownConfig config;
             config.enabled = doc["enabled"] | false;
@@ -595,7 +668,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
               serializeJson(resp, out);
               webSocket.sendTXT(num, out);
               
-              Serial.println("[API] API password updated via WebSocket");
+              LOG_INFO("API: API password updated via WebSocket");
             } else {
               StaticJsonDocument<256> resp;
               resp["type"] = "apiPasswordStatus";
@@ -607,7 +680,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             }
             
           } else if (command == "resetMonthlyEnergy") {
-            energyMonitor.resetMonthlyStats();
+            energyMonitor.requestMonthlyReset();
             
             StaticJsonDocument<256> resp;
             resp["type"] = "energyStatus";
@@ -618,7 +691,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             webSocket.sendTXT(num, out);
             
           } else if (command == "factoryReset") {
-            Serial.println("[WS] Factory reset requested");
+            LOG_INFO("WebSocket: Factory reset requested");
             
             // Delete all configuration files
             SPIFFS.remove("/wifi.json");
@@ -646,7 +719,7 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             ESP.restart();
             
           } else if (command == "reboot") {
-            Serial.println("[WS] Reboot requested");
+            LOG_INFO("WebSocket: Reboot requested");
             
             StaticJsonDocument<256> resp;
             resp["type"] = "rebootStatus";
@@ -658,6 +731,18 @@ void WebServerManager::webSocketEvent(uint8_t num, WStype_t type, uint8_t * payl
             
             delay(1000);
             ESP.restart();
+            
+          } else if (command == "logTail") {
+            // Last kb of the log (LOG_TAIL_BACKLOG by default), then new
+            // text as it is written; "enabled": false stops it
+            bool enabled = doc["enabled"] | true;
+            if (num < WEBSOCKETS_SERVER_CLIENT_MAX) {
+              logTailOn[num] = enabled;
+              if (enabled) {
+                int kb = doc["kb"] | 0;
+                logTailPos[num] = logTailStart(kb > 0 ? (size_t)kb * 1024 : LOG_TAIL_BACKLOG);
+              }
+            }
           }
         }
       }
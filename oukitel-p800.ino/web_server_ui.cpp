@@ -13,7 +13,7 @@ String WebServerManager::generateHTML() {
   // Pre-allocate String to reduce memory fragmentation
   // Estimated HTML size: ~15-20KB
   String html;
-  html.reserve(20000);  // Pre-allocate 20KB to reduce fragmentation
+  html.reserve(WEB_PAGE_RESERVE);  // Pre-allocate 20KB to reduce fragmentation
   
   html = "<!DOCTYPE html><html><head><meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1,user-scalable=no'>";
   html += "<title>Oukitel P800E</title><style>";
@@ -199,6 +199,17 @@ String WebServerManager::generateHTML() {
   html += "<p style='font-size:11px;color:#666;margin-top:5px'>Minimum power (Watts) to consider the system as actively charging/discharging.</p>";
   html += "<label>Power Filter Alpha</label><input type='number' step='0.01' min='0.1' max='0.9' id='advPowerFilterAlpha' placeholder='Filter responsiveness'>";
   html += "<p style='font-size:11px;color:#666;margin-top:5px'>Higher = smoother readings but slower response (0.1-0.9).</p>";
+  html += "<label>Filter IN</label><select id='advPowerFilterInType' style='width:100%;padding:8px;border:1px solid #ddd;border-radius:4px;margin-bottom:10px'>";
+  html += "<option value='0'>EMA (fixed alpha)</option><option value='1'>Adaptive (fast on load steps)</option></select>";
+  html += "<label class='checkbox-label'><input type='checkbox' id='advPowerFilterInMedian3'> Median-of-3 pre-filter (IN)</label>";
+  html += "<label>Adaptive Alpha Max / Step (W) (IN)</label><input type='number' step='0.05' min='0.1' max='1' id='advPowerFilterInAlphaMax' placeholder='Alpha on a load step'>";
+  html += "<input type='number' step='1' min='1' max='2000' id='advPowerFilterInStepWatts' placeholder='Deviation treated as a load step (W)'>";
+  html += "<label>Filter OUT</label><select id='advPowerFilterOutType' style='width:100%;padding:8px;border:1px solid #ddd;border-radius:4px;margin-bottom:10px'>";
+  html += "<option value='0'>EMA (fixed alpha)</option><option value='1'>Adaptive (fast on load steps)</option></select>";
+  html += "<label class='checkbox-label'><input type='checkbox' id='advPowerFilterOutMedian3'> Median-of-3 pre-filter (OUT)</label>";
+  html += "<label>Adaptive Alpha Max / Step (W) (OUT)</label><input type='number' step='0.05' min='0.1' max='1' id='advPowerFilterOutAlphaMax' placeholder='Alpha on a load step'>";
+  html += "<input type='number' step='1' min='1' max='2000' id='advPowerFilterOutStepWatts' placeholder='Deviation treated as a load step (W)'>";
+  html += "<p style='font-size:11px;color:#666;margin-top:5px'>Adaptive uses the alpha above at idle and moves towards Alpha Max as the reading departs from the filtered value by up to Step watts. Median-of-3 drops single-reading spikes at the cost of one reading of delay.</p>";
   html += "</div>";
 
   html += "<div class='section'>";
@@ -217,14 +228,24 @@ String WebServerManager::generateHTML() {
   html += "<p style='font-size:11px;color:#666;margin-top:5px'>Wait time after power station boot before sensor readings affect system logic. Ignores all sensor data during this period. Default: 20000ms (20 seconds).</p>";
   html += "<label>Auto Power On Delay (ms)</label><input type='number' step='100' min='0' id='advAutoPowerOnDelay' placeholder='Delay in milliseconds'>";
   html += "<p style='font-size:11px;color:#666;margin-top:5px'>Wait time after power station boot before automatically activating AC output.</p>";
+  html += "<label>RMS Window (mains cycles)</label><input type='number' step='1' min='1' max='50' id='advRmsWindowCycles' placeholder='Cycles per current measurement'>";
+  html += "<p style='font-size:11px;color:#666;margin-top:5px'>Current is integrated over whole mains cycles (50/60 Hz auto-detected). 2 = fast response, 10 = smoother. Default: 10.</p>";
+  html += "<label class='checkbox-label'><input type='checkbox' id='advHarmonicAnalysisEnabled'> Harmonic analysis</label>";
+  html += "<p style='font-size:11px;color:#666;margin-top:5px'>THD, crest factor and distortion power factor of both clamps, computed in small slices from the sampled waveforms.</p>";
+  html += "<label class='checkbox-label'><input type='checkbox' id='advLowPowerEnabled'> ESP32 power saving on battery</label>";
+  html += "<p style='font-size:11px;color:#666;margin-top:5px'>While discharging: 80 MHz CPU, WiFi modem sleep and a sleeping main loop between tasks. Adds up to ~300 ms to incoming web/NUT requests.</p>";
   html += "</div>";
 
   html += "<div class='section'>";
   html += "<h3>🔄 SOC Smoothing</h3>";
-  html += "<label>Buffer Size</label><input type='number' step='1' min='1' max='50' id='advSocBufferSize' placeholder='Number of samples'>";
+  html += "<label>Buffer Size</label><input type='number' step='1' min='1' max='300' id='advSocBufferSize' placeholder='Number of samples'>";
   html += "<p style='font-size:11px;color:#666;margin-top:5px'>Number of samples to smooth SOC readings. Higher = smoother but slower updates.</p>";
   html += "<label>Change Threshold</label><input type='number' step='1' min='1' max='10' id='advSocChangeThreshold' placeholder='Agreement count required'>";
   html += "<p style='font-size:11px;color:#666;margin-top:5px'>Number of samples that must agree to trigger SOC change.</p>";
+  html += "<label class='checkbox-label'><input type='checkbox' id='advSocFusionEnabled'> Coulomb counting (fused SOC)</label>";
+  html += "<p style='font-size:11px;color:#666;margin-top:5px'>Integrates the battery current between readings and corrects drift with the voltage curve at rest. Reacts to load changes immediately. Off = voltage curve + smoothing only.</p>";
+  html += "<label>Battery Capacity (Ah)</label><input type='number' step='0.1' min='1' max='500' id='advSocCapacityAh' placeholder='Usable capacity'>";
+  html += "<p style='font-size:11px;color:#666;margin-top:5px'>Usable battery capacity for coulomb counting. Default: 20Ah (512Wh at 25.6V).</p>";
   html += "</div>";
 
   html += "<div class='section'>";
@@ -570,7 +591,20 @@ String WebServerManager::generateHTML() {
   html += "autoPowerOnDelay:parseInt(document.getElementById('advAutoPowerOnDelay').value),";
   html += "socBufferSize:parseInt(document.getElementById('advSocBufferSize').value),";
   html += "socChangeThreshold:parseInt(document.getElementById('advSocChangeThreshold').value),";
-  html += "warmupDelay:parseInt(document.getElementById('advWarmupDelay').value)";
+  html += "warmupDelay:parseInt(document.getElementById('advWarmupDelay').value),";
+  html += "rmsWindowCycles:parseInt(document.getElementById('advRmsWindowCycles').value),";
+  html += "socFusionEnabled:document.getElementById('advSocFusionEnabled').checked,";
+  html += "socCapacityAh:parseFloat(document.getElementById('advSocCapacityAh').value),";
+  html += "powerFilterInType:parseInt(document.getElementById('advPowerFilterInType').value),";
+  html += "powerFilterInMedian3:document.getElementById('advPowerFilterInMedian3').checked,";
+  html += "powerFilterInAlphaMax:parseFloat(document.getElementById('advPowerFilterInAlphaMax').value),";
+  html += "powerFilterInStepWatts:parseFloat(document.getElementById('advPowerFilterInStepWatts').value),";
+  html += "powerFilterOutType:parseInt(document.getElementById('advPowerFilterOutType').value),";
+  html += "powerFilterOutMedian3:document.getElementById('advPowerFilterOutMedian3').checked,";
+  html += "powerFilterOutAlphaMax:parseFloat(document.getElementById('advPowerFilterOutAlphaMax').value),";
+  html += "powerFilterOutStepWatts:parseFloat(document.getElementById('advPowerFilterOutStepWatts').value),";
+  html += "harmonicAnalysisEnabled:document.getElementById('advHarmonicAnalysisEnabled').checked,";
+  html += "lowPowerEnabled:document.getElementById('advLowPowerEnabled').checked";
   html += "};";
   html += "ws.send(JSON.stringify(cmd));";
   html += "showStatus('advStatus','Advanced settings sent to device...', 'info');";
@@ -726,6 +760,19 @@ String WebServerManager::generateHTML() {
   html += "document.getElementById('advSocBufferSize').value=d.socBufferSize;";
   html += "document.getElementById('advSocChangeThreshold').value=d.socChangeThreshold;";
   html += "document.getElementById('advWarmupDelay').value=d.warmupDelay;";
+  html += "document.getElementById('advRmsWindowCycles').value=d.rmsWindowCycles;";
+  html += "document.getElementById('advSocFusionEnabled').checked=d.socFusionEnabled;";
+  html += "document.getElementById('advSocCapacityAh').value=(d.socCapacityAh).toFixed(1);";
+  html += "document.getElementById('advPowerFilterInType').value=d.powerFilterInType;";
+  html += "document.getElementById('advPowerFilterInMedian3').checked=d.powerFilterInMedian3;";
+  html += "document.getElementById('advPowerFilterInAlphaMax').value=(d.powerFilterInAlphaMax).toFixed(2);";
+  html += "document.getElementById('advPowerFilterInStepWatts').value=(d.powerFilterInStepWatts).toFixed(0);";
+  html += "document.getElementById('advPowerFilterOutType').value=d.powerFilterOutType;";
+  html += "document.getElementById('advPowerFilterOutMedian3').checked=d.powerFilterOutMedian3;";
+  html += "document.getElementById('advPowerFilterOutAlphaMax').value=(d.powerFilterOutAlphaMax).toFixed(2);";
+  html += "document.getElementById('advPowerFilterOutStepWatts').value=(d.powerFilterOutStepWatts).toFixed(0);";
+  html += "document.getElementById('advHarmonicAnalysisEnabled').checked=d.harmonicAnalysisEnabled;";
+  html += "document.getElementById('advLowPowerEnabled').checked=d.lowPowerEnabled;";
   html += "showStatus('advStatus','Advanced settings loaded successfully', 'success');";
   html += "return;";
   html += "}";
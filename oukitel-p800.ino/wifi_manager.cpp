@@ -22,7 +22,7 @@ WiFiManager::WiFiManager() {
 }
 
 bool WiFiManager::begin() {
-  Serial.println("[WIFI] Initializing WiFi manager...");
+  LogSerial.println("[WIFI] Initializing WiFi manager...");
   
   // Set hostname
   WiFi.setHostname("OUKITEL-P800");
@@ -33,8 +33,8 @@ bool WiFiManager::begin() {
   // If no saved credentials, try using defaults from config.h
   #ifdef DEFAULT_WIFI_SSID
   if (!credentials.valid) {
-    Serial.println("[WIFI] No saved credentials found");
-    Serial.println("[WIFI] Using default credentials from config.h");
+    LogSerial.println("[WIFI] No saved credentials found");
+    LogSerial.println("[WIFI] Using default credentials from config.h");
     credentials.ssid = DEFAULT_WIFI_SSID;
     credentials.password = DEFAULT_WIFI_PASSWORD;
     credentials.valid = true;
@@ -48,13 +48,13 @@ bool WiFiManager::begin() {
   
   // Start connection process if we have credentials
   if (credentials.valid) {
-    Serial.println("[WIFI] Starting connection to: " + credentials.ssid);
+    LOG_INFO("WiFi: Starting connection to: %s", credentials.ssid.c_str());
     WiFi.begin(credentials.ssid.c_str(), credentials.password.c_str());
     currentState = WIFI_STATE_CONNECTING;
     lastStateChange = millis();
     retryCount = 0;
   } else {
-    Serial.println("[WIFI] No credentials, starting AP mode");
+    LOG_INFO("WiFi: No credentials, starting AP mode");
     startAccessPoint();
   }
   
@@ -68,19 +68,19 @@ void WiFiManager::handleConnection() {
     case WIFI_STATE_CONNECTING:
       if (WiFi.status() == WL_CONNECTED) {
         currentState = WIFI_STATE_CONNECTED;
-        Serial.println("\n[WIFI] Connected successfully!");
+        LOG_INFO("WiFi: Connected successfully!");
         printNetworkInfo();
         retryCount = 0;
       } else if (now - lastStateChange > 10000) { // 10s timeout per attempt
-        Serial.println("\n[WIFI] Connection attempt failed");
+        LOG_WARNING("WiFi: Connection attempt failed");
         retryCount++;
         if (retryCount >= 3) {
-          Serial.println("[WIFI] All attempts failed. Starting AP mode.");
+          LOG_ERROR("WiFi: All attempts failed. Starting AP mode.");
           startAccessPoint();
         } else {
           currentState = WIFI_STATE_WAITING_RETRY;
           lastStateChange = now;
-          Serial.println("[WIFI] Waiting 5s before retry...");
+          LOG_INFO("WiFi: Waiting 5s before retry...");
         }
       }
       break;
@@ -88,7 +88,7 @@ void WiFiManager::handleConnection() {
     case WIFI_STATE_WAITING_RETRY:
       if (now - lastStateChange > 5000) { // 5s wait between retries
         currentState = WIFI_STATE_CONNECTING;
-        Serial.println("[WIFI] Retrying connection (Attempt " + String(retryCount + 1) + ")...");
+        LOG_INFO("WiFi: Retrying connection (Attempt %d)...", retryCount + 1);
         WiFi.begin(credentials.ssid.c_str(), credentials.password.c_str());
         lastStateChange = now;
       }
@@ -96,7 +96,7 @@ void WiFiManager::handleConnection() {
 
     case WIFI_STATE_CONNECTED:
       if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("[WIFI] Connection lost!");
+        LOG_WARNING("WiFi: Connection lost!");
         currentState = WIFI_STATE_CONNECTING;
         WiFi.disconnect();
         WiFi.begin(credentials.ssid.c_str(), credentials.password.c_str());
@@ -116,7 +116,7 @@ void WiFiManager::handleConnection() {
         if (clientCount == 0) {
           // No clients connected - check if timeout passed
           if (now - apStartTime > WIFI_AP_TIMEOUT) {
-            Serial.println("[WIFI] No AP clients for timeout period - retrying WiFi connection");
+            LOG_INFO("WiFi: No AP clients for timeout period - retrying WiFi connection");
             stopAccessPoint();
             currentState = WIFI_STATE_CONNECTING;
             retryCount = 0;
@@ -138,7 +138,7 @@ void WiFiManager::handleConnection() {
 void WiFiManager::startAccessPoint() {
   if (currentState == WIFI_STATE_AP_MODE) return;
   
-  Serial.println("[WIFI] Free heap before AP: " + String(ESP.getFreeHeap()));
+  LOG_DEBUG("WiFi: Free heap before AP: %lu", (unsigned long)ESP.getFreeHeap());
   
   // Stop WiFi first to clean up
   WiFi.disconnect(true);
@@ -150,11 +150,11 @@ void WiFiManager::startAccessPoint() {
   delay(500);
   
   // Start AP with explicit parameters
-  Serial.println("[WIFI] Starting AP: " + String(AP_SSID));
+  LOG_INFO("WiFi: Starting AP: %s", AP_SSID);
   
   bool success;
   if (strlen(AP_PASSWORD) == 0) {
-    Serial.println("[WIFI] Starting open network (no password)");
+    LOG_INFO("WiFi: Starting open network (no password)");
     success = WiFi.softAP(AP_SSID);
   } else {
     success = WiFi.softAP(AP_SSID, AP_PASSWORD, AP_CHANNEL, false, AP_MAX_CONNECTIONS);
@@ -162,10 +162,11 @@ void WiFiManager::startAccessPoint() {
   
   if (success) {
     delay(500);
-    Serial.println("[WIFI] AP started successfully");
-    Serial.println("[WIFI] SSID: " + String(AP_SSID));
-    Serial.println("[WIFI] IP: " + WiFi.softAPIP().toString());
-    Serial.println("[WIFI] Connect to this network and go to: http://" + WiFi.softAPIP().toString());
+    LOG_INFO("WiFi: AP started successfully");
+    String apIP = WiFi.softAPIP().toString();
+    LOG_INFO("WiFi: SSID: %s", AP_SSID);
+    LOG_INFO("WiFi: IP: %s", apIP.c_str());
+    LOG_INFO("WiFi: Connect to this network and go to: http://%s", apIP.c_str());
     
     // Start DNS server for captive portal
     dnsServer.start(53, "*", WiFi.softAPIP());
@@ -175,18 +176,18 @@ void WiFiManager::startAccessPoint() {
     lastApClientCheck = millis();
     retryCount = 0;
   } else {
-    Serial.println("[WIFI] ERROR: Failed to start AP");
+    LOG_ERROR("WiFi: Failed to start AP");
     // Retry once
     delay(100);
     success = WiFi.softAP(AP_SSID);
     if (success) {
-      Serial.println("[WIFI] AP started on retry");
+      LOG_INFO("WiFi: AP started on retry");
       dnsServer.start(53, "*", WiFi.softAPIP());
       currentState = WIFI_STATE_AP_MODE;
       apStartTime = millis();
       lastApClientCheck = millis();
     } else {
-      Serial.println("[WIFI] CRITICAL: Cannot start AP mode");
+      LOG_ERROR("WiFi: CRITICAL: Cannot start AP mode");
     }
   }
 }
@@ -200,7 +201,7 @@ void WiFiManager::stopAccessPoint() {
   WiFi.setHostname("OUKITEL-P800");
   
   currentState = WIFI_STATE_IDLE;
-  Serial.println("[WIFI] AP mode stopped");
+  LOG_INFO("WiFi: AP mode stopped");
 }
 
 bool WiFiManager::setCredentials(const String& ssid, const String& password) {
@@ -216,8 +217,8 @@ bool WiFiManager::setCredentials(const String& ssid, const String& password) {
   // Save to SPIFFS
   saveCredentials();
   
-  Serial.println("[WIFI] New credentials saved: " + ssid);
-  Serial.println("[WIFI] Restarting connection...");
+  LOG_INFO("WiFi: New credentials saved: %s", ssid.c_str());
+  LOG_INFO("WiFi: Restarting connection...");
   
   // If we're in AP mode, stop it
   if (currentState == WIFI_STATE_AP_MODE) {
@@ -246,7 +247,7 @@ void WiFiManager::clearCredentials() {
   
   saveCredentials();
   
-  Serial.println("[WIFI] Credentials cleared");
+  LOG_INFO("WiFi: Credentials cleared");
 }
 
 void WiFiManager::loadCredentials() {
@@ -256,7 +257,7 @@ void WiFiManager::loadCredentials() {
   
   File file = SPIFFS.open(WIFI_CREDS_FILE, "r");
   if (!file) {
-    Serial.println("[WIFI] Failed to open credentials file");
+    LOG_ERROR("WiFi: Failed to open credentials file");
     return;
   }
   
@@ -265,7 +266,7 @@ void WiFiManager::loadCredentials() {
   file.close();
   
   if (error) {
-    Serial.println("[WIFI] Failed to parse credentials file");
+    LOG_ERROR("WiFi: Failed to parse credentials file");
     return;
   }
   
@@ -274,7 +275,7 @@ void WiFiManager::loadCredentials() {
   credentials.valid = !credentials.ssid.isEmpty();
   
   if (credentials.valid) {
-    Serial.println("[WIFI] Loaded saved credentials for: " + credentials.ssid);
+    LOG_INFO("WiFi: Loaded saved credentials for: %s", credentials.ssid.c_str());
     hasDefaultCredentials = false;
   }
 }
@@ -286,14 +287,14 @@ void WiFiManager::saveCredentials() {
   
   File file = SPIFFS.open(WIFI_CREDS_FILE, "w");
   if (!file) {
-    Serial.println("[WIFI] Failed to save credentials");
+    LOG_ERROR("WiFi: Failed to save credentials");
     return;
   }
   
   serializeJson(doc, file);
   file.close();
   
-  Serial.println("[WIFI] Credentials saved to SPIFFS");
+  LOG_INFO("WiFi: Credentials saved to SPIFFS");
 }
 
 bool WiFiManager::isConnected() {
@@ -355,14 +356,14 @@ String WiFiManager::getConnectionStatus() {
 }
 
 void WiFiManager::printNetworkInfo() {
-  Serial.println("[WIFI] Network Information:");
-  Serial.println("  Status: " + getConnectionStatus());
-  Serial.println("  IP Address: " + getLocalIP());
-  Serial.println("  MAC Address: " + getMACAddress());
-  Serial.println("  Hostname: OUKITEL-P800");
+  LogSerial.println("[WIFI] Network Information:");
+  LogSerial.println("  Status: " + getConnectionStatus());
+  LogSerial.println("  IP Address: " + getLocalIP());
+  LogSerial.println("  MAC Address: " + getMACAddress());
+  LogSerial.println("  Hostname: OUKITEL-P800");
   if (isConnected()) {
-    Serial.println("  RSSI: " + String(getRSSI()) + " dBm");
-    Serial.println("  Gateway: " + WiFi.gatewayIP().toString());
-    Serial.println("  DNS: " + WiFi.dnsIP().toString());
+    LogSerial.println("  RSSI: " + String(getRSSI()) + " dBm");
+    LogSerial.println("  Gateway: " + WiFi.gatewayIP().toString());
+    LogSerial.println("  DNS: " + WiFi.dnsIP().toString());
   }
 }
\ No newline at end of file
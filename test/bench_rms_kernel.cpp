@@ -0,0 +1,44 @@
+/*
+ * RMS kernel benchmark - reference (double) against fixed-point kernel on
+ * the same synthetic 1480-sample windows. The host has a double FPU, so
+ * the ratio here understates the gain on the ESP32 (run HardwareManager::
+ * benchmarkRmsKernels() on the board); the agreement figures are the same.
+ */
+
+#include <chrono>
+#include "rms_kernel.h"
+#include "test_common.h"
+
+static const int WINDOW = 1480;
+static const int RUNS = 20000;
+
+template <typename F>
+static double timeNsPerSample(F run) {
+  auto start = std::chrono::steady_clock::now();
+  double sink = 0;
+  for (int r = 0; r < RUNS; r++) sink += run();
+  auto end = std::chrono::steady_clock::now();
+  if (sink < 0) printf("%f\n", sink);     // Keep the work
+  return std::chrono::duration<double, std::nano>(end - start).count() / ((double)RUNS * WINDOW);
+}
+
+int main() {
+  static uint16_t trace[WINDOW];
+  synthesizeCurrentTrace(trace, WINDOW, 1850, 700, 50, 10000);
+
+  double refNs = timeNsPerSample([] { return referenceTraceRms(trace, WINDOW, 2048); });
+  double qNs = timeNsPerSample([] { return fixedTraceRms(trace, WINDOW, 2048); });
+
+  double worst = 0;
+  for (double peak = 0; peak <= 1900; peak += 50) {
+    synthesizeCurrentTrace(trace, WINDOW, 2048, peak, 50, 10000);
+    double ref = referenceTraceRms(trace, WINDOW, 2048);
+    double err = fabs(fixedTraceRms(trace, WINDOW, 2048) - ref) / (RMS_Q_TOLERANCE_ABS + RMS_Q_TOLERANCE_REL * ref);
+    if (err > worst) worst = err;
+  }
+
+  printf("rms_kernel: reference %.2f ns/sample, fixed %.2f ns/sample (x%.1f), worst error %.0f%% of tolerance\n",
+         refNs, qNs, refNs / qNs, worst * 100);
+  CHECK(worst <= 1.0);
+  return testSummary("bench_rms_kernel");
+}
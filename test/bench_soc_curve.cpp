@@ -0,0 +1,46 @@
+/*
+ * SOC curve benchmark - original linear walk, binary search and grid
+ * lookup on the built-in discharge curve, same voltage sweep.
+ */
+
+#include <chrono>
+#include "config.h"
+#include "soc_curve.h"
+#include "test_common.h"
+
+static const int SWEEP = 6000;      // 22.0 .. 28.0 V in 1 mV steps
+static const int RUNS = 500;
+
+template <typename F>
+static double timeNsPerLookup(F lookup) {
+  auto start = std::chrono::steady_clock::now();
+  volatile float sink = 0;
+  for (int r = 0; r < RUNS; r++) {
+    for (int i = 0; i < SWEEP; i++) sink = sink + lookup(22.0f + i * 0.001f);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / ((double)RUNS * SWEEP);
+}
+
+int main() {
+  static SocCurve curve;
+  CHECK(curve.load(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS));
+
+  double linearNs = timeNsPerLookup([](float v) {
+    return socCurveLinearReference(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS, v);
+  });
+  double binaryNs = timeNsPerLookup([](float v) { return curve.percentAtBinary(v); });
+  double gridNs = timeNsPerLookup([](float v) { return curve.percentAt(v); });
+
+  double worst = 0;
+  for (int i = 0; i < SWEEP; i++) {
+    float v = 22.0f + i * 0.001f;
+    double err = fabs(curve.percentAt(v) - socCurveLinearReference(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS, v));
+    if (err > worst) worst = err;
+  }
+
+  printf("soc_curve: linear %.2f ns, binary %.2f ns, grid %.2f ns per lookup (%d points), worst diff %.5f%%\n",
+         linearNs, binaryNs, gridNs, CURVE_NORMAL_POINTS, worst);
+  CHECK(worst < 1e-3);
+  return testSummary("bench_soc_curve");
+}
@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for Arduino.h, enough for config.h (constants and tables)
+ */
+
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <string>
+
+// Only declared (settings structs, locks), never used by the tested modules
+typedef std::string String;
+typedef int portMUX_TYPE;
+
+#endif // ARDUINO_STUB_H
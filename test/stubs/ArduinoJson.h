@@ -0,0 +1,120 @@
+/*
+ * Host stand-in for ArduinoJson 7: the Allocator interface as the library
+ * declares it, and a JsonDocument that uses its allocator the same way
+ * (one copy per string, a pool grown with reallocate, all freed by clear()).
+ * The document only builds flat {"key":value} text, enough for the arena.
+ */
+
+#ifndef ARDUINOJSON_STUB_H
+#define ARDUINOJSON_STUB_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace ArduinoJson {
+
+class Allocator {
+public:
+  virtual void* allocate(size_t size) = 0;
+  virtual void deallocate(void* ptr) = 0;
+  virtual void* reallocate(void* ptr, size_t newSize) = 0;
+
+protected:
+  ~Allocator() = default;
+};
+
+}  // namespace ArduinoJson
+
+class JsonDocument {
+private:
+  static const int MAX_STRINGS = 32;
+
+  ArduinoJson::Allocator* allocator;
+  char* pool;                 // JSON text, grown in place when the allocator can
+  size_t length;
+  size_t capacity;
+  char* strings[MAX_STRINGS];
+  int stringCount;
+
+  JsonDocument(const JsonDocument&);
+  JsonDocument& operator=(const JsonDocument&);
+
+  bool reserve(size_t needed) {
+    if (needed <= capacity) return true;
+    size_t grown = capacity ? capacity * 2 : 32;
+    while (grown < needed) grown *= 2;
+    char* moved = (char*)allocator->reallocate(pool, grown);
+    if (moved == nullptr) return false;
+    pool = moved;
+    capacity = grown;
+    return true;
+  }
+
+public:
+  explicit JsonDocument(ArduinoJson::Allocator* alloc)
+    : allocator(alloc), pool(nullptr), length(0), capacity(0), stringCount(0) {}
+
+  ~JsonDocument() {
+    clear();
+  }
+
+  // Stand-in for doc[key] = value
+  bool set(const char* key, long value) {
+    if (stringCount == MAX_STRINGS) return false;
+    size_t keyLength = strlen(key);
+    char* copy = (char*)allocator->allocate(keyLength + 1);
+    if (copy == nullptr) return false;
+    memcpy(copy, key, keyLength + 1);
+    strings[stringCount++] = copy;
+
+    char member[48];
+    int memberLength = snprintf(member, sizeof(member), "%s\"%s\":%ld",
+                                length > 1 ? "," : "", copy, value);
+    if (memberLength < 0 || memberLength >= (int)sizeof(member)) return false;
+    if (length == 0) {
+      if (!reserve(3)) return false;
+      pool[length++] = '{';
+    }
+    if (!reserve(length + memberLength + 1)) return false;
+    memcpy(pool + length, member, memberLength);
+    length += memberLength;
+    return true;
+  }
+
+  void clear() {
+    for (int i = 0; i < stringCount; i++) allocator->deallocate(strings[i]);
+    stringCount = 0;
+    allocator->deallocate(pool);
+    pool = nullptr;
+    length = 0;
+    capacity = 0;
+  }
+
+  size_t textLength() const {
+    return length == 0 ? 2 : length + 1;
+  }
+
+  void copyText(char* out) const {
+    if (length == 0) {
+      memcpy(out, "{}", 2);
+      return;
+    }
+    memcpy(out, pool, length);
+    out[length] = '}';
+  }
+};
+
+inline size_t measureJson(const JsonDocument& doc) {
+  return doc.textLength();
+}
+
+inline size_t serializeJson(const JsonDocument& doc, char* out, size_t size) {
+  size_t length = doc.textLength();
+  if (size < length + 1) return 0;
+  doc.copyText(out);
+  out[length] = '\0';
+  return length;
+}
+
+#endif // ARDUINOJSON_STUB_H
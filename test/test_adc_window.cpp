@@ -0,0 +1,129 @@
+/*
+ * ADC window engine - synthetic clamp waveforms through the same RMS code
+ * as the sampler (interleaved IN/OUT samples, cycle-aligned windows).
+ */
+
+#include "adc_window.h"
+#include "test_common.h"
+
+static const float CHANNEL_RATE = 10000.0f;   // Per channel, as after decimation
+static const int BIAS = 1850;
+
+static AdcWindowConfig testConfig(int cycles) {
+  AdcWindowConfig config = {BIAS, 20, 50, cycles, 1, 50, CHANNEL_RATE, 40, 2, 20};
+  return config;
+}
+
+struct Feed {
+  AdcWindowEngine engine;
+  uint16_t in[20000];
+  uint16_t out[20000];
+  int windows;
+  AdcRmsWindow last[ADC_SAMPLER_CH_COUNT];
+
+  // Interleaved IN/OUT pairs, one pair every 1/CHANNEL_RATE seconds
+  void run(uint32_t count) {
+    windows = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      int64_t us = (int64_t)(i * 1000000.0 / CHANNEL_RATE);
+      MainsLossEvent event;
+      // Windows close on a sample of the reference channel, either one
+      bool closed = engine.addSample(ADC_SAMPLER_CH_IN, in[i], us, event);
+      closed |= engine.addSample(ADC_SAMPLER_CH_OUT, out[i], us, event);
+      if (closed) {
+        windows++;
+        last[ADC_SAMPLER_CH_IN] = engine.result(ADC_SAMPLER_CH_IN);
+        last[ADC_SAMPLER_CH_OUT] = engine.result(ADC_SAMPLER_CH_OUT);
+      }
+    }
+  }
+};
+
+static Feed feed;
+
+static void testSyncedSine(double mainsHz, int nominal) {
+  const uint32_t count = 20000;                 // 2 s
+  synthesizeCurrentTrace(feed.in, count, BIAS, 600, mainsHz, CHANNEL_RATE);
+  synthesizeCurrentTrace(feed.out, count, BIAS, 250, mainsHz, CHANNEL_RATE);
+  feed.engine.begin(testConfig(10), 0);
+  feed.run(count);
+
+  const AdcRmsWindow& in = feed.last[ADC_SAMPLER_CH_IN];
+  const AdcRmsWindow& out = feed.last[ADC_SAMPLER_CH_OUT];
+  CHECK(feed.windows >= 3);
+  CHECK(in.synced);
+  CHECK(in.cycles == 10);
+  CHECK(in.sequence == out.sequence);
+  CHECK(in.samples == out.samples);
+  CHECK_NEAR(in.samples, 10 * CHANNEL_RATE / mainsHz, 2);
+  CHECK_NEAR(in.frequencyHz, mainsHz, 0.2);
+  CHECK(feed.engine.getNominalFrequency() == nominal);
+
+  // Whole cycles: the RMS of a sine is peak / sqrt(2) (dither adds ~1.4 counts^2)
+  CHECK_NEAR(sqrt(in.meanSquare), 600 / sqrt(2.0), 1.0);
+  CHECK_NEAR(sqrt(out.meanSquare), 250 / sqrt(2.0), 1.0);
+}
+
+static void testWindowCycles() {
+  const uint32_t count = 20000;
+  synthesizeCurrentTrace(feed.in, count, BIAS, 600, 50, CHANNEL_RATE);
+  synthesizeCurrentTrace(feed.out, count, BIAS, 0, 50, CHANNEL_RATE);
+  feed.engine.begin(testConfig(10), 0);
+  feed.engine.setWindowCycles(25);
+  CHECK(feed.engine.getWindowCycles() == 25);
+  feed.run(count);
+
+  CHECK(feed.last[ADC_SAMPLER_CH_IN].synced);
+  CHECK(feed.last[ADC_SAMPLER_CH_IN].cycles == 25);
+  CHECK_NEAR(feed.last[ADC_SAMPLER_CH_IN].samples, 25 * CHANNEL_RATE / 50, 2);
+  // OUT carries only the dither
+  CHECK(sqrt(feed.last[ADC_SAMPLER_CH_OUT].meanSquare) < 2.0);
+
+  feed.engine.setWindowCycles(500);
+  CHECK(feed.engine.getWindowCycles() == 50);
+}
+
+static void testNoLoad() {
+  // No crossings: windows fall back to the expected length, unsynced
+  const uint32_t count = 10000;
+  synthesizeCurrentTrace(feed.in, count, BIAS, 0, 50, CHANNEL_RATE);
+  synthesizeCurrentTrace(feed.out, count, BIAS, 0, 50, CHANNEL_RATE);
+  feed.engine.begin(testConfig(10), 0);
+  feed.run(count);
+
+  CHECK(feed.windows >= 4);
+  CHECK(!feed.last[ADC_SAMPLER_CH_IN].synced);
+  CHECK(feed.last[ADC_SAMPLER_CH_IN].cycles == 0);
+  CHECK(feed.last[ADC_SAMPLER_CH_IN].frequencyHz == 0);
+  CHECK_NEAR(feed.last[ADC_SAMPLER_CH_IN].samples, 10 * CHANNEL_RATE / 50, 1);
+  CHECK(sqrt(feed.last[ADC_SAMPLER_CH_IN].meanSquare) < 2.0);
+}
+
+static void testReferenceFollowsStrongest() {
+  // Only OUT carries current: the windows still sync, on OUT crossings
+  const uint32_t count = 20000;
+  synthesizeCurrentTrace(feed.in, count, BIAS, 0, 50, CHANNEL_RATE);
+  synthesizeCurrentTrace(feed.out, count, BIAS, 400, 50, CHANNEL_RATE);
+  feed.engine.begin(testConfig(10), 0);
+  feed.run(count);
+
+  CHECK(feed.last[ADC_SAMPLER_CH_OUT].synced);
+  CHECK(feed.last[ADC_SAMPLER_CH_OUT].cycles == 10);
+  CHECK_NEAR(sqrt(feed.last[ADC_SAMPLER_CH_OUT].meanSquare), 400 / sqrt(2.0), 1.0);
+}
+
+static void testIrmsConversion() {
+  // EmonLib ratio: ICAL * 3.3 / ADC_COUNTS per count of RMS
+  CHECK_NEAR(rmsToIrms(100.0 * 100.0, 30.0, 1024), 30.0 * 3.3 / 1024 * 100.0, 1e-9);
+  CHECK(rmsToIrms(0, 30.0, 1024) == 0);
+}
+
+int main() {
+  testSyncedSine(50, 50);
+  testSyncedSine(60, 60);
+  testWindowCycles();
+  testNoLoad();
+  testReferenceFollowsStrongest();
+  testIrmsConversion();
+  return testSummary("adc_window");
+}
@@ -0,0 +1,39 @@
+/*
+ * Host test helpers - minimal assertions for the plain C++ modules.
+ * Each test binary counts its checks and returns non-zero on a failure.
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+    testChecks++; \
+    if (!(cond)) { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) do { \
+    testChecks++; \
+    double a_ = (actual), e_ = (expected); \
+    if (!(fabs(a_ - e_) <= (tolerance))) { \
+      testFailures++; \
+      fprintf(stderr, "%s:%d: %s = %.6f, expected %.6f +/- %g\n", \
+              __FILE__, __LINE__, #actual, a_, e_, (double)(tolerance)); \
+    } \
+  } while (0)
+
+static inline int testSummary(const char* name) {
+  printf("%-24s %4d checks, %d failed\n", name, testChecks, testFailures);
+  return testFailures > 0 ? 1 : 0;
+}
+
+#endif // TEST_COMMON_H
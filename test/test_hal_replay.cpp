@@ -0,0 +1,115 @@
+/*
+ * Replay HAL - a generated CSV trace played on the virtual clock: header
+ * and comment parsing, windows, battery filter, GPIO recording and the
+ * fast mains-loss flag through the HAL interface.
+ */
+
+#include "hal_replay.h"
+#include "test_common.h"
+
+static const char* TRACE_PATH = "build/test_hal_replay.csv";
+static const int RATE = 5000;
+
+// 0-2 s: IN and OUT loaded. 2-3 s: IN silent (outage). 3-4 s: OUT silent too.
+static bool writeTrace() {
+  FILE* f = fopen(TRACE_PATH, "w");
+  if (f == nullptr) return false;
+  fprintf(f, "# rate=%d\n", RATE);
+  fprintf(f, "in,out,battery_mv\n");
+  for (int i = 0; i < 4 * RATE; i++) {
+    double s = sin(2 * M_PI * 50.0 * i / RATE);
+    int inPeak = i < 2 * RATE ? 500 : 0;
+    int outPeak = i < 3 * RATE ? 300 : 0;
+    fprintf(f, "%d,%d,%.1f\n", (int)lround(2048 + inPeak * s), (int)lround(2048 + outPeak * s),
+            2100.0 + ((i * 37) % 21) - 10);
+    if (i == RATE) fprintf(f, "# a comment in the middle\n");
+  }
+  fclose(f);
+  return true;
+}
+
+static AdcWindowConfig replayConfig() {
+  AdcWindowConfig config = {2048, 20, 50, 10, 1, 50, 10000.0f, 40, 2, 20};
+  return config;
+}
+
+static void testReplay() {
+  CHECK(writeTrace());
+  ReplayHal replay;
+  Hal* hal = &replay;
+
+  CHECK(!replay.open("build/does-not-exist.csv", replayConfig(), 100, 0.3f));
+  CHECK(replay.open(TRACE_PATH, replayConfig(), 100, 0.3f));
+  CHECK(replay.getSampleRate() == RATE);
+  CHECK(hal->nowMs() == 0);
+
+  AdcRmsWindow windows[ADC_SAMPLER_CH_COUNT];
+  float batteryMv = 0;
+  CHECK(!hal->getLatestWindows(windows));
+  CHECK(!hal->getBatteryMillivolts(batteryMv));
+
+  // First second: 5 windows of 10 cycles, the first one dropped for alignment
+  for (int i = 0; i < 10; i++) CHECK(replay.advance(100));
+  CHECK(hal->nowMs() == 1000);
+  CHECK(hal->nowUs() == 1000000);
+  CHECK(replay.getSamplesRead() == (uint64_t)RATE + 1);
+  CHECK(hal->getLatestWindows(windows));
+  CHECK(windows[ADC_SAMPLER_CH_IN].synced);
+  CHECK(windows[ADC_SAMPLER_CH_IN].sequence >= 3);
+  CHECK_NEAR(sqrt(windows[ADC_SAMPLER_CH_IN].meanSquare), 500 / M_SQRT2, 1.0);
+  CHECK_NEAR(sqrt(windows[ADC_SAMPLER_CH_OUT].meanSquare), 300 / M_SQRT2, 1.0);
+  CHECK_NEAR(windows[ADC_SAMPLER_CH_IN].frequencyHz, 50, 0.1);
+  CHECK(hal->getBatteryMillivolts(batteryMv));
+  CHECK_NEAR(batteryMv, 2100, 2);
+  CHECK(!hal->isMainsLost());
+
+  // GPIO writes are recorded, a press is a LOW -> HIGH edge
+  hal->setPinMode(25, HAL_PIN_OUTPUT);
+  hal->writePin(25, HAL_PIN_HIGH);
+  hal->writePin(25, HAL_PIN_HIGH);
+  hal->writePin(25, HAL_PIN_LOW);
+  hal->writePin(99, HAL_PIN_HIGH);
+  CHECK(hal->readPin(25) == HAL_PIN_LOW);
+  CHECK(replay.getPinWrites() == 3);
+  CHECK(replay.getPinRises() == 1);
+
+  // IN stops at 2 s while OUT still carries current: flagged within ms
+  CHECK(replay.advance(1000));
+  CHECK(!hal->isMainsLost());
+  CHECK(replay.advance(30));
+  CHECK(hal->isMainsLost());
+
+  // Cleared on request (slow path disagrees) ...
+  hal->clearMainsLoss();
+  CHECK(!hal->isMainsLost());
+
+  // ... and once OUT is silent as well, the flag does not come back
+  for (int i = 0; i < 10; i++) replay.advance(100);
+  CHECK(!hal->isMainsLost());
+  while (replay.advance(500)) {}
+  CHECK(replay.isFinished());
+  CHECK(!hal->isMainsLost());
+  CHECK(replay.getSamplesRead() == (uint64_t)4 * RATE);
+  CHECK(!replay.advance(100));
+}
+
+static void testOutageClearedByIdleLoad() {
+  // Without clearMainsLoss(): OUT going silent ends the reported loss
+  ReplayHal replay;
+  CHECK(replay.open(TRACE_PATH, replayConfig(), 100, 0.3f));
+  replay.advance(2050);
+  CHECK(replay.isMainsLost());
+  replay.advance(900);
+  CHECK(replay.isMainsLost());
+  replay.advance(100);
+  CHECK(!replay.isMainsLost());
+  replay.close();
+  CHECK(replay.isFinished());
+}
+
+int main() {
+  testReplay();
+  testOutageClearedByIdleLoad();
+  remove(TRACE_PATH);
+  return testSummary("hal_replay");
+}
@@ -0,0 +1,145 @@
+/*
+ * Harmonic analyzer - synthetic distorted clamp waveforms with known odd
+ * harmonics, a square wave, a mains frequency off nominal, and the
+ * incremental step() contract.
+ */
+
+#include "harmonic_analyzer.h"
+#include "test_common.h"
+
+static const float RATE = 10000.0f;
+static const int BLOCK = 4096;
+
+static HarmonicAnalyzer<BLOCK> analyzer;
+static uint16_t samples[BLOCK];
+
+// bias + sum of odd harmonics (peak amplitudes in ADC counts, [0] = fundamental)
+static void synthesize(const float* amplitudes, float mainsHz) {
+  for (int i = 0; i < BLOCK; i++) {
+    double t = i / (double)RATE;
+    double v = 2048;
+    for (int h = 0; h < HARMONIC_COUNT; h++) {
+      v += amplitudes[h] * sin(2 * M_PI * mainsHz * (2 * h + 1) * t + 0.3 * h);
+    }
+    samples[i] = (uint16_t)lround(v);
+  }
+}
+
+// Runs the analysis in slices, returns the number of step() calls
+static int analyse(float mainsHz, float minRms, uint32_t slice) {
+  CHECK(analyzer.start(samples, BLOCK, RATE, mainsHz, minRms));
+  CHECK(analyzer.isBusy());
+  int calls = 0;
+  bool finished = false;
+  while (!finished && calls < 10000) {
+    finished = analyzer.step(slice);
+    calls++;
+  }
+  CHECK(finished);
+  CHECK(!analyzer.isBusy());
+  return calls;
+}
+
+static void testDistortedWaveform() {
+  const float amplitudes[HARMONIC_COUNT] = {600, 180, 90, 40, 20};
+  synthesize(amplitudes, 50);
+  uint32_t before = analyzer.result().sequence;
+  int calls = analyse(50, 10, 64);
+  const HarmonicResult& r = analyzer.result();
+
+  // Whole cycles only: 20 cycles at 200 samples
+  CHECK(r.samples == 4000);
+  CHECK(calls > 4000 / 64);
+  CHECK(r.sequence == before + 1);
+  CHECK(r.valid);
+  CHECK(r.fundamentalHz == 50);
+
+  double harmonicSquares = 0;
+  double totalSquares = 0;
+  for (int h = 0; h < HARMONIC_COUNT; h++) {
+    double expected = amplitudes[h] / M_SQRT2;
+    CHECK_NEAR(r.harmonicRms[h], expected, 0.01 * amplitudes[0] / M_SQRT2);
+    totalSquares += expected * expected;
+    if (h > 0) harmonicSquares += expected * expected;
+  }
+  double fundamental = amplitudes[0] / M_SQRT2;
+  CHECK_NEAR(r.rms, sqrt(totalSquares), 0.5);
+  CHECK_NEAR(r.thd, sqrt(harmonicSquares) / fundamental * 100, 0.5);
+  CHECK_NEAR(r.powerFactor, fundamental / sqrt(totalSquares), 0.005);
+}
+
+static void testPureSine() {
+  const float amplitudes[HARMONIC_COUNT] = {500, 0, 0, 0, 0};
+  synthesize(amplitudes, 60);
+  analyse(60, 10, 1000);
+  const HarmonicResult& r = analyzer.result();
+
+  CHECK(r.valid);
+  CHECK(r.thd < 0.5f);
+  CHECK_NEAR(r.crestFactor, M_SQRT2, 0.01);
+  CHECK_NEAR(r.powerFactor, 1.0, 0.005);
+  CHECK_NEAR(r.harmonicRms[0], 500 / M_SQRT2, 2);
+}
+
+static void testSquareWave() {
+  // Harmonic n at 4/(pi*n): THD up to the 9th is 42.9%, crest 1, PF 0.90
+  for (int i = 0; i < BLOCK; i++) {
+    double phase = fmod(i * 50.0 / RATE, 1.0);
+    samples[i] = phase < 0.5 ? 2048 + 400 : 2048 - 400;
+  }
+  analyse(50, 10, 256);
+  const HarmonicResult& r = analyzer.result();
+
+  double expectedThd = sqrt(1.0 / 9 + 1.0 / 25 + 1.0 / 49 + 1.0 / 81) * 100;
+  CHECK(r.valid);
+  CHECK_NEAR(r.thd, expectedThd, 1.0);
+  CHECK_NEAR(r.crestFactor, 1.0, 0.02);
+  CHECK_NEAR(r.powerFactor, 2 * M_SQRT2 / M_PI, 0.01);
+  CHECK_NEAR(r.harmonicRms[0], 4 / M_PI * 400 / M_SQRT2, 3);
+}
+
+static void testOffNominalFrequency() {
+  // Mains at 49.8 Hz analysed as 50 Hz: the Hann window keeps the
+  // fundamental out of the harmonic bins
+  const float amplitudes[HARMONIC_COUNT] = {600, 0, 0, 0, 0};
+  synthesize(amplitudes, 49.8f);
+  analyse(50, 10, 500);
+  const HarmonicResult& r = analyzer.result();
+  CHECK(r.valid);
+  CHECK(r.thd < 1.0f);
+  CHECK_NEAR(r.harmonicRms[0], 600 / M_SQRT2, 600 / M_SQRT2 * 0.01);
+}
+
+static void testIdleAndLimits() {
+  // Clamp noise only: analysed, but flagged invalid
+  const float amplitudes[HARMONIC_COUNT] = {3, 0, 0, 0, 0};
+  synthesize(amplitudes, 50);
+  analyse(50, 10, 4096);
+  CHECK(!analyzer.result().valid);
+  CHECK(analyzer.result().thd == 0);
+  CHECK(analyzer.result().powerFactor == 1.0f);
+
+  // 9th harmonic above Nyquist, less than a cycle, bad arguments
+  CHECK(!analyzer.start(samples, BLOCK, 800, 50, 10));
+  CHECK(!analyzer.start(samples, 150, RATE, 50, 10));
+  CHECK(!analyzer.start(samples, BLOCK, 0, 50, 10));
+  CHECK(!analyzer.start(samples, BLOCK, RATE, 0, 10));
+  CHECK(!analyzer.isBusy());
+  CHECK(!analyzer.step(100));
+
+  // More samples than the buffer: the newest whole cycles are kept
+  static uint16_t longTrace[BLOCK * 2];
+  for (int i = 0; i < BLOCK * 2; i++) longTrace[i] = 2048;
+  CHECK(analyzer.start(longTrace, BLOCK * 2, RATE, 50, 10));
+  while (!analyzer.step(1024)) {}
+  CHECK(analyzer.result().samples == 4000);
+}
+
+int main() {
+  testDistortedWaveform();
+  testPureSine();
+  testSquareWave();
+  testOffNominalFrequency();
+  testIdleAndLimits();
+  return testSummary("harmonic_analyzer");
+}
@@ -0,0 +1,302 @@
+/*
+ * JSON arena - the bump allocator behind every ArduinoJson document: last
+ * block freed and grown in place, moves of older blocks, heap spills, lease
+ * reuse via next() and the heap fallback of an exhausted pool. A random
+ * allocate/reallocate/free run checks that no two live blocks overlap.
+ * Heap blocks are freed through the arena, ASan reports any leak.
+ */
+
+#include "json_arena.h"
+#include "test_common.h"
+
+static const size_t ARENA_BYTES = 512;
+
+alignas(8) static uint8_t storage[JSON_ARENA_MAX * ARENA_BYTES];
+
+static bool inArena(const void* ptr, const uint8_t* base, size_t bytes) {
+  return ptr >= base && ptr < base + bytes;
+}
+
+static void testLastBlock() {
+  JsonArena arena;
+  arena.attach(storage, ARENA_BYTES);
+  ArduinoJson::Allocator& alloc = arena;
+
+  uint8_t* a = (uint8_t*)alloc.allocate(64);
+  uint8_t* b = (uint8_t*)alloc.allocate(32);
+  CHECK(inArena(a, storage, ARENA_BYTES));
+  CHECK(b > a + 64);
+  CHECK(((uintptr_t)a & 7) == 0 && ((uintptr_t)b & 7) == 0);
+  memset(b, 0x5B, 32);
+
+  // The last block grows in place, its contents stay
+  uint8_t* grown = (uint8_t*)alloc.reallocate(b, 200);
+  CHECK(grown == b);
+  CHECK(grown[31] == 0x5B);
+  size_t peak = arena.getPeak();
+  CHECK(peak >= (size_t)(b - storage) + 200);
+
+  // Freed last block: the next allocation takes its place, then the one before
+  alloc.deallocate(grown);
+  uint8_t* c = (uint8_t*)alloc.allocate(16);
+  CHECK(c == b);
+  alloc.deallocate(c);
+  alloc.deallocate(a);
+  CHECK(alloc.allocate(8) == a);
+
+  // Shrinking is always in place
+  CHECK(alloc.reallocate(a, 4) == a);
+  CHECK(arena.getSpills() == 0);
+  CHECK(arena.getPeak() == peak);
+}
+
+static void testOlderBlock() {
+  JsonArena arena;
+  arena.attach(storage, ARENA_BYTES);
+  ArduinoJson::Allocator& alloc = arena;
+
+  uint8_t* a = (uint8_t*)alloc.allocate(40);
+  uint8_t* b = (uint8_t*)alloc.allocate(40);
+  for (int i = 0; i < 40; i++) a[i] = (uint8_t)i;
+  memset(b, 0xBB, 40);
+
+  // Not the last block: shrink in place, grow by moving to the end
+  CHECK(alloc.reallocate(a, 24) == a);
+  uint8_t* moved = (uint8_t*)alloc.reallocate(a, 120);
+  CHECK(moved != a);
+  CHECK(moved > b);
+  CHECK(inArena(moved, storage, ARENA_BYTES));
+  bool intact = true;
+  for (int i = 0; i < 24; i++) intact = intact && moved[i] == (uint8_t)i;
+  CHECK(intact);
+  CHECK(b[0] == 0xBB && b[39] == 0xBB);
+
+  // The moved block is now last and grows in place again
+  CHECK(alloc.reallocate(moved, 160) == moved);
+
+  // nullptr behaves like malloc/free
+  void* fresh = alloc.reallocate(nullptr, 8);
+  CHECK(inArena(fresh, storage, ARENA_BYTES));
+  alloc.deallocate(nullptr);
+  CHECK(arena.getSpills() == 0);
+}
+
+static void testSpill() {
+  JsonArena arena;
+  arena.attach(storage, ARENA_BYTES);
+  ArduinoJson::Allocator& alloc = arena;
+
+  // Too big for the arena: heap, counted
+  uint8_t* big = (uint8_t*)alloc.allocate(1000);
+  CHECK(big != nullptr);
+  CHECK(!inArena(big, storage, ARENA_BYTES));
+  CHECK(arena.getSpills() == 1);
+  memset(big, 0xC3, 1000);
+
+  // Heap blocks stay on the heap when resized
+  big = (uint8_t*)alloc.reallocate(big, 2000);
+  CHECK(!inArena(big, storage, ARENA_BYTES));
+  CHECK(big[999] == 0xC3);
+  CHECK(arena.getSpills() == 1);
+
+  // An arena block grown past the end moves to the heap with its contents
+  uint8_t* a = (uint8_t*)alloc.allocate(100);
+  uint8_t* b = (uint8_t*)alloc.allocate(100);
+  memset(a, 0xA1, 100);
+  uint8_t* spilled = (uint8_t*)alloc.reallocate(a, 900);
+  CHECK(!inArena(spilled, storage, ARENA_BYTES));
+  CHECK(spilled[0] == 0xA1 && spilled[99] == 0xA1);
+  CHECK(arena.getSpills() == 2);
+
+  // The last block too, once it no longer fits
+  uint8_t* last = (uint8_t*)alloc.reallocate(b, ARENA_BYTES);
+  CHECK(!inArena(last, storage, ARENA_BYTES));
+  CHECK(arena.getSpills() == 3);
+
+  alloc.deallocate(big);
+  alloc.deallocate(spilled);
+  alloc.deallocate(last);
+
+  // After the spills the arena still hands out its own space
+  arena.reset();
+  CHECK(alloc.allocate(ARENA_BYTES - 16) == storage + 8);
+}
+
+// Live blocks with a fill byte each, checked after every operation
+struct Block {
+  uint8_t* ptr;
+  size_t size;
+  uint8_t fill;
+};
+
+static bool blocksIntact(const Block* blocks, int count) {
+  for (int i = 0; i < count; i++) {
+    for (size_t k = 0; k < blocks[i].size; k++) {
+      if (blocks[i].ptr[k] != blocks[i].fill) return false;
+    }
+  }
+  return true;
+}
+
+static void testRandomSequences() {
+  JsonArena arena;
+  arena.attach(storage, ARENA_BYTES);
+  ArduinoJson::Allocator& alloc = arena;
+
+  static const int MAX_BLOCKS = 24;
+  Block blocks[MAX_BLOCKS];
+  int count = 0;
+  uint32_t seed = 7;
+  int failures = 0;
+  int heapBlocks = 0;
+
+  for (int step = 0; step < 200000; step++) {
+    seed = seed * 1103515245u + 12345u;
+    int op = (seed >> 16) % 10;
+    size_t size = 1 + ((seed >> 8) % 160);
+    if (op < 4 && count < MAX_BLOCKS) {
+      uint8_t* ptr = (uint8_t*)alloc.allocate(size);
+      uint8_t fill = (uint8_t)(step & 0xFF);
+      memset(ptr, fill, size);
+      blocks[count++] = {ptr, size, fill};
+    } else if (op < 7 && count > 0) {
+      // Mostly the last block (the document pool), sometimes an older one
+      int i = (op == 6) ? (int)((seed >> 4) % count) : count - 1;
+      uint8_t* ptr = (uint8_t*)alloc.reallocate(blocks[i].ptr, size);
+      size_t kept = size < blocks[i].size ? size : blocks[i].size;
+      for (size_t k = 0; k < kept; k++) {
+        if (ptr[k] != blocks[i].fill) {
+          failures++;
+          break;
+        }
+      }
+      memset(ptr, blocks[i].fill, size);
+      blocks[i].ptr = ptr;
+      blocks[i].size = size;
+    } else if (op < 9 && count > 0) {
+      int i = (op == 8) ? (int)((seed >> 4) % count) : count - 1;
+      alloc.deallocate(blocks[i].ptr);
+      blocks[i] = blocks[--count];
+    } else {
+      // Lease ends: heap blocks are freed by the document, the rest by reset()
+      for (int i = 0; i < count; i++) {
+        if (!inArena(blocks[i].ptr, storage, ARENA_BYTES)) {
+          alloc.deallocate(blocks[i].ptr);
+          heapBlocks++;
+        }
+      }
+      count = 0;
+      arena.reset();
+    }
+    if (!blocksIntact(blocks, count)) failures++;
+  }
+  for (int i = 0; i < count; i++) alloc.deallocate(blocks[i].ptr);
+
+  printf("  random: %u spills, %d heap blocks at reset, peak %u of %u bytes\n",
+         (unsigned)arena.getSpills(), heapBlocks, (unsigned)arena.getPeak(), (unsigned)ARENA_BYTES);
+  CHECK(failures == 0);
+  CHECK(arena.getSpills() > 0);
+  CHECK(arena.getPeak() <= ARENA_BYTES);
+}
+
+static void testLeaseNext() {
+  JsonPool pool(storage, 1, ARENA_BYTES);
+  {
+    JsonLease lease(pool);
+    CHECK(lease.hasArena());
+    JsonDocument& doc = lease.doc();
+    CHECK(doc.set("voltage", 26));
+    CHECK(doc.set("percent", 80));
+    size_t length;
+    const char* text = lease.serialize(length);
+    CHECK(strcmp(text, "{\"voltage\":26,\"percent\":80}") == 0);
+    CHECK(length == strlen(text));
+    CHECK(inArena(text, storage, ARENA_BYTES));
+
+    // Same arena, from its start: the next message lands where the first did
+    JsonDocument& again = lease.next();
+    CHECK(again.set("voltage", 25));
+    const char* second = lease.serialize(length);
+    CHECK(strcmp(second, "{\"voltage\":25}") == 0);
+    CHECK(inArena(second, storage, ARENA_BYTES));
+    CHECK(second <= text);
+
+    // Many messages on one lease never run the arena out
+    for (int i = 0; i < 1000; i++) {
+      JsonDocument& message = lease.next();
+      message.set("sequence", i);
+      message.set("power", i * 3);
+      lease.serialize(length);
+    }
+    CHECK(pool.getStats().spills == 0);
+    CHECK(pool.getStats().inUse == 1);
+  }
+  JsonPoolStats stats = pool.getStats();
+  CHECK(stats.inUse == 0);
+  CHECK(stats.leases == 1);
+  CHECK(stats.peakBytes <= ARENA_BYTES);
+}
+
+static void testDocumentSpill() {
+  JsonPool pool(storage, 1, 128);
+  JsonLease lease(pool);
+  JsonDocument& doc = lease.doc();
+  char key[16];
+  bool ok = true;
+  for (int i = 0; i < 20; i++) {
+    snprintf(key, sizeof(key), "k%02d", i);
+    ok = doc.set(key, 1000 + i) && ok;
+  }
+  CHECK(ok);
+  size_t length;
+  const char* text = lease.serialize(length);
+  CHECK(strncmp(text, "{\"k00\":1000,", 12) == 0);
+  CHECK(strcmp(text + length - 11, "\"k19\":1019}") == 0);
+  CHECK(pool.getStats().spills > 0);
+}
+
+static void testPoolExhausted() {
+  JsonPool pool(storage, 2, ARENA_BYTES);
+  JsonLease first(pool);
+  JsonLease second(pool);
+  CHECK(first.hasArena() && second.hasArena());
+  {
+    // Every arena taken: heap document, same output
+    JsonLease third(pool);
+    CHECK(!third.hasArena());
+    third.doc().set("fallback", 1);
+    size_t length;
+    const char* text = third.serialize(length);
+    CHECK(strcmp(text, "{\"fallback\":1}") == 0);
+    CHECK(!inArena(text, storage, 2 * ARENA_BYTES));
+    third.next().set("again", 2);
+    CHECK(strcmp(third.serialize(length), "{\"again\":2}") == 0);
+
+    JsonPoolStats stats = pool.getStats();
+    CHECK(stats.inUse == 2);
+    CHECK(stats.maxInUse == 2);
+    CHECK(stats.leases == 3);
+    CHECK(stats.fallbacks == 1);
+  }
+  {
+    // A released arena is leased again
+    JsonPool other(storage + 2 * ARENA_BYTES, 1, ARENA_BYTES);
+    { JsonLease a(other); CHECK(a.hasArena()); }
+    JsonLease b(other);
+    CHECK(b.hasArena());
+    CHECK(other.getStats().fallbacks == 0);
+  }
+  CHECK(pool.getStats().arenas == 2);
+  CHECK(pool.getStats().arenaSize == ARENA_BYTES);
+}
+
+int main() {
+  testLastBlock();
+  testOlderBlock();
+  testSpill();
+  testRandomSequences();
+  testLeaseNext();
+  testDocumentSpill();
+  testPoolExhausted();
+  return testSummary("json_arena");
+}
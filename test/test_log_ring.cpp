@@ -0,0 +1,189 @@
+/*
+ * Log ring - wrap and overwrite, readers falling behind, line starts,
+ * keeping the log across a reattach (warm reset) and 32-bit positions
+ * wrapping. Meant to run under ASan/UBSan (the Makefile default).
+ */
+
+#include <string>
+#include "log_ring.h"
+#include "test_common.h"
+
+static const uint32_t SIZE = 64;
+static LogRingHeader header;
+static char data[SIZE];
+
+static std::string writeLines(LogRing& ring, int count) {
+  std::string all;
+  for (int i = 0; i < count; i++) {
+    char line[32];
+    int n = snprintf(line, sizeof(line), "line %d\r\n", i);
+    ring.write(line, n);
+    all.append(line, n);
+  }
+  return all;
+}
+
+static void testWrapAndRead() {
+  memset(&header, 0x5A, sizeof(header));
+  LogRing ring;
+  CHECK(!ring.attach(&header, data, SIZE));     // Garbage: cleared
+  CHECK(ring.getHead() == 0 && ring.getTail() == 0 && ring.getSize() == SIZE);
+
+  std::string all = writeLines(ring, 40);
+  CHECK(ring.getHead() == all.size());
+  CHECK(ring.getHead() - ring.getTail() == SIZE);
+
+  // The ring holds exactly the newest SIZE bytes
+  char out[128];
+  uint32_t lost = 99;
+  uint32_t pos = ring.getTail();
+  size_t n = ring.read(pos, out, sizeof(out), &lost);
+  CHECK(n == SIZE && lost == 0);
+  CHECK(std::string(out, n) == all.substr(all.size() - SIZE));
+  CHECK(pos == ring.getHead());
+  CHECK(ring.read(pos, out, sizeof(out), &lost) == 0);
+
+  // A reader left behind continues at the tail and is told what it missed
+  uint32_t stale = 0;
+  n = ring.read(stale, out, 10, &lost);
+  CHECK(lost == ring.getTail());
+  CHECK(n == 10 && stale == ring.getTail() + 10);
+
+  // A position past the head is pulled back
+  uint32_t ahead = ring.getHead() + 5;
+  CHECK(ring.read(ahead, out, sizeof(out), &lost) == 0 && ahead == ring.getHead());
+}
+
+static void testLineStart() {
+  LogRing ring;
+  ring.attach(&header, data, SIZE);
+  ring.clear();
+  ring.write("ab\ncd\n", 6);
+  // Before the first overwrite the text starts with a line
+  CHECK(ring.lineStart(0) == 0);
+  CHECK(ring.lineStart(1) == 3);
+  CHECK(ring.lineStart(3) == 3);
+  CHECK(ring.lineStart(100) == 6);
+
+  writeLines(ring, 40);
+  uint32_t pos = ring.lineStart(ring.getHead() - 30);
+  char out[128];
+  size_t n = ring.read(pos, out, sizeof(out));
+  CHECK(n > 0 && n <= 30);
+  CHECK(std::string(out, n).compare(0, 5, "line ") == 0);
+  // Position before the tail: the first full line held (the tail itself
+  // is in the middle of an overwritten line)
+  pos = ring.lineStart(0);
+  CHECK(pos != ring.getTail());
+  CHECK(data[(pos - 1) % SIZE] == '\n');
+}
+
+static void testReattach() {
+  LogRing ring;
+  ring.attach(&header, data, SIZE);
+  ring.clear();
+  writeLines(ring, 10);
+  ring.setDrained(ring.getHead() - 5);
+
+  // Warm reset: same storage, still valid, positions kept
+  LogRing again;
+  CHECK(again.attach(&header, data, SIZE));
+  CHECK(again.getHead() == ring.getHead());
+  CHECK(again.getDrained() == ring.getHead() - 5);
+
+  // Another size, or a corrupted header, clears the log
+  LogRing smaller;
+  CHECK(!smaller.attach(&header, data, SIZE / 2));
+  CHECK(smaller.getHead() == 0);
+  writeLines(smaller, 3);
+  header.head ^= 1;
+  LogRing corrupted;
+  CHECK(!corrupted.attach(&header, data, SIZE));
+  CHECK(corrupted.getHead() == 0);
+}
+
+static void testDrained() {
+  LogRing ring;
+  ring.attach(&header, data, SIZE);
+  ring.clear();
+  ring.write("abc\n", 4);
+  ring.setDrained(2);
+  CHECK(ring.getDrained() == 2);
+  ring.setDrained(100);
+  CHECK(ring.getDrained() == ring.getHead());
+
+  // Overwritten text is no longer waiting for the serial port
+  ring.setDrained(0);
+  for (int i = 0; i < 20; i++) ring.write("0123456789", 10);
+  CHECK(ring.getDrained() == ring.getTail());
+}
+
+static void testDrainLoop() {
+  // Same steps as logDrainTask(): lost bytes are reported once
+  LogRing ring;
+  ring.attach(&header, data, SIZE);
+  ring.clear();
+  for (int i = 0; i < 10; i++) ring.write("0123456789", 10);
+
+  // A reader whose drained position fell behind (as before clamping)
+  header.drained = 0;
+  header.check = header.magic ^ header.size ^ header.head ^ header.tail ^ header.drained ^ 0xA5A5A5A5;
+
+  char chunk[16];
+  uint32_t reportedLost = 0;
+  size_t sent = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (;;) {
+      uint32_t lost;
+      uint32_t pos = ring.getDrained();
+      size_t n = ring.read(pos, chunk, sizeof(chunk), &lost);
+      ring.setDrained(pos);
+      reportedLost += lost;
+      if (n == 0) break;
+      sent += n;
+    }
+  }
+  CHECK(reportedLost == 100 - SIZE);
+  CHECK(sent == SIZE);
+  CHECK(ring.getDrained() == ring.getHead());
+}
+
+static void testOversizeAndPositionWrap() {
+  LogRing ring;
+  ring.attach(&header, data, SIZE);
+  ring.clear();
+
+  // Longer than the ring: only its end is kept
+  std::string big(200, 'x');
+  big += "END";
+  ring.write(big.data(), big.size());
+  char out[128];
+  uint32_t pos = ring.getTail();
+  size_t n = ring.read(pos, out, sizeof(out));
+  CHECK(n == SIZE);
+  CHECK(std::string(out + SIZE - 3, 3) == "END");
+
+  // Positions close to 2^32: differences still hold across the wrap
+  header.head = header.tail = header.drained = 0xFFFFFFF0u;
+  for (int i = 0; i < 10; i++) ring.write("0123456789", 10);
+  CHECK(ring.getHead() == 0xFFFFFFF0u + 100);
+  CHECK(ring.getHead() - ring.getTail() == SIZE);
+  uint32_t lost;
+  pos = ring.getTail();
+  n = ring.read(pos, out, sizeof(out), &lost);
+  CHECK(n == SIZE && lost == 0 && pos == ring.getHead());
+  CHECK(std::string(out, 4) == "6789");
+  uint32_t stale = 0xFFFFFFF0u;
+  ring.read(stale, out, 1, &lost);
+  CHECK(lost == 100 - SIZE);
+}
+
+int main() {
+  testWrapAndRead();
+  testLineStart();
+  testReattach();
+  testDrained();
+  testDrainLoop();
+  testOversizeAndPositionWrap();
+  return testSummary("log_ring");
+}
@@ -0,0 +1,196 @@
+/*
+ * Loop profiler - per-stage min/max/mean, the cycles to microseconds
+ * conversion at the CPU clock, the histogram percentiles /api/perf reports,
+ * the reset request applied by each stage's writer on its next record, and
+ * PerfScope timing one run on the PC clock (1000 "MHz").
+ */
+
+#include "loop_profiler.h"
+#include "test_common.h"
+
+#include <string.h>
+
+static void testStats() {
+  LoopProfiler profiler(240);
+  CHECK(profiler.getCpuMhz() == 240);
+  const PerfStageStats& stage = profiler.getStage(PERF_STAGE_ENERGY_UPDATE);
+  CHECK(stage.count == 0);
+  CHECK(profiler.getMeanUs(PERF_STAGE_ENERGY_UPDATE) == 0);
+
+  profiler.record(PERF_STAGE_ENERGY_UPDATE, 2400);    // 10 us
+  profiler.record(PERF_STAGE_ENERGY_UPDATE, 480);     // 2 us
+  profiler.record(PERF_STAGE_ENERGY_UPDATE, 12000);   // 50 us
+  CHECK(stage.count == 3);
+  CHECK(stage.minCycles == 480);
+  CHECK(stage.maxCycles == 12000);
+  CHECK(stage.totalCycles == 14880);
+  CHECK_NEAR(profiler.toUs(stage.minCycles), 2.0, 1e-6);
+  CHECK_NEAR(profiler.toUs(stage.maxCycles), 50.0, 1e-6);
+  CHECK_NEAR(profiler.getMeanUs(PERF_STAGE_ENERGY_UPDATE), 14880.0 / 240 / 3, 1e-4);
+
+  // A first record of zero is the minimum, not "no minimum yet"
+  profiler.record(PERF_STAGE_LOG_DATA, 0);
+  profiler.record(PERF_STAGE_LOG_DATA, 100);
+  CHECK(profiler.getStage(PERF_STAGE_LOG_DATA).minCycles == 0);
+
+  // Stages are independent
+  CHECK(profiler.getStage(PERF_STAGE_READ_SENSORS).count == 0);
+
+  // Out of range stages are ignored
+  profiler.record(-1, 1000);
+  profiler.record(PERF_STAGE_COUNT, 1000);
+  uint32_t total = 0;
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) total += profiler.getStage(i).count;
+  CHECK(total == 5);
+}
+
+// The full cycle counter range: totals don't overflow, a wrapped delta is
+// the elapsed cycles (PerfScope subtracts unsigned)
+static void testLargeCounts() {
+  LoopProfiler profiler(240);
+  for (int i = 0; i < 4; i++) profiler.record(PERF_STAGE_PUBLISH, 0xFFFFFFFFu);
+  const PerfStageStats& stage = profiler.getStage(PERF_STAGE_PUBLISH);
+  CHECK(stage.totalCycles == 4ull * 0xFFFFFFFFu);
+  CHECK_NEAR(profiler.getMeanUs(PERF_STAGE_PUBLISH), 4294967295.0 / 240, 1.0);
+  CHECK(stage.histogram.getMax() == 0xFFFFFFFFu / 240);
+
+  uint32_t start = 0xFFFFFF00u;
+  uint32_t end = 0x00000100u;
+  CHECK(end - start == 0x200u);
+}
+
+static void testCpuMhz() {
+  LoopProfiler profiler(160);
+  profiler.record(PERF_STAGE_MQTT_LOOP, 1600);
+  CHECK_NEAR(profiler.toUs(1600), 10.0, 1e-6);
+  CHECK(profiler.getStage(PERF_STAGE_MQTT_LOOP).histogram.getMax() == 10);
+
+  // The reported microseconds follow the clock, the recorded cycles stay
+  profiler.setCpuMhz(80);
+  CHECK(profiler.getCpuMhz() == 80);
+  CHECK_NEAR(profiler.getMeanUs(PERF_STAGE_MQTT_LOOP), 20.0, 1e-6);
+
+  // Zero MHz would divide by zero: treated as 1
+  profiler.setCpuMhz(0);
+  CHECK(profiler.getCpuMhz() == 1);
+  CHECK_NEAR(profiler.toUs(1600), 1600.0, 1e-6);
+  LoopProfiler zero(0);
+  CHECK(zero.getCpuMhz() == 1);
+  zero.record(PERF_STAGE_MQTT_LOOP, 77);
+  CHECK(zero.getStage(PERF_STAGE_MQTT_LOOP).histogram.getMax() == 77);
+
+  // Default is the ESP32 at 240 MHz
+  LoopProfiler defaults;
+  CHECK(defaults.getCpuMhz() == 240);
+}
+
+// The histogram holds whole microseconds, as /api/perf reports p50/p90/p99
+static void testPercentiles() {
+  LoopProfiler profiler(240);
+  for (uint32_t us = 1; us <= 1000; us++) {
+    profiler.record(PERF_STAGE_HANDLE_CLIENT, us * 240 + 239);   // Truncated to us
+  }
+  const LatencyHistogram& h = profiler.getStage(PERF_STAGE_HANDLE_CLIENT).histogram;
+  CHECK(h.getSamples() == 1000);
+  CHECK(h.getMax() == 1000);
+  CHECK_NEAR(h.getMean(), 500.5, 0.01);
+  uint32_t p50 = h.percentile(50);
+  uint32_t p90 = h.percentile(90);
+  uint32_t p99 = h.percentile(99);
+  // Upper bucket edges, within ~19% above the exact value
+  CHECK(p50 >= 500 && p50 <= 500 * 1.19 + 1);
+  CHECK(p90 >= 900 && p90 <= 1000);
+  CHECK(p99 >= 990 && p99 <= 1000);                          // Capped at the max
+  CHECK(p50 <= p90 && p90 <= p99);
+
+  // Mean and max from the cycle totals agree with the histogram
+  CHECK_NEAR(profiler.getMeanUs(PERF_STAGE_HANDLE_CLIENT), 500.5 + 239.0 / 240, 0.01);
+  CHECK_NEAR(profiler.toUs(profiler.getStage(PERF_STAGE_HANDLE_CLIENT).maxCycles), 1000.996, 0.01);
+
+  // Runs under a microsecond land in the first bucket
+  LoopProfiler fast(240);
+  for (int i = 0; i < 100; i++) fast.record(PERF_STAGE_HANDLE_CLIENTS, 100);
+  CHECK(fast.getStage(PERF_STAGE_HANDLE_CLIENTS).histogram.percentile(99) == 0);
+  CHECK(fast.getStage(PERF_STAGE_HANDLE_CLIENTS).histogram.getMax() == 0);
+}
+
+// POST /api/perf from the web server task: each stage clears itself on its
+// writer's next record, a stage that doesn't run keeps its numbers until then
+static void testResetRequest() {
+  LoopProfiler profiler(240);
+  for (int i = 0; i < 10; i++) {
+    profiler.record(PERF_STAGE_READ_SENSORS, 24000);
+    profiler.record(PERF_STAGE_LOG_DATA, 4800);
+  }
+  profiler.requestReset();
+  CHECK(profiler.getStage(PERF_STAGE_READ_SENSORS).count == 10);
+  CHECK(profiler.getStage(PERF_STAGE_READ_SENSORS).resetRequested);
+
+  profiler.record(PERF_STAGE_READ_SENSORS, 2400);
+  const PerfStageStats& sensors = profiler.getStage(PERF_STAGE_READ_SENSORS);
+  CHECK(!sensors.resetRequested);
+  CHECK(sensors.count == 1);
+  CHECK(sensors.minCycles == 2400);
+  CHECK(sensors.maxCycles == 2400);
+  CHECK(sensors.totalCycles == 2400);
+  CHECK(sensors.histogram.getSamples() == 1);
+  CHECK(sensors.histogram.getMax() == 10);
+  CHECK_NEAR(profiler.getMeanUs(PERF_STAGE_READ_SENSORS), 10.0, 1e-6);
+
+  const PerfStageStats& log = profiler.getStage(PERF_STAGE_LOG_DATA);
+  CHECK(log.count == 10);
+  CHECK(log.resetRequested);
+  profiler.record(PERF_STAGE_LOG_DATA, 9600);
+  CHECK(log.count == 1);
+  CHECK(log.minCycles == 9600);
+  CHECK(log.histogram.getSamples() == 1);
+
+  // Later records accumulate again
+  profiler.record(PERF_STAGE_READ_SENSORS, 4800);
+  CHECK(sensors.count == 2);
+  CHECK(sensors.minCycles == 2400 && sensors.maxCycles == 4800);
+}
+
+static void testStageNames() {
+  const char* names[PERF_STAGE_COUNT];
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) names[i] = perfStageName(i);
+  CHECK(strcmp(names[PERF_STAGE_READ_SENSORS], "readSensors") == 0);
+  CHECK(strcmp(names[PERF_STAGE_PUBLISH], "publishData") == 0);
+  CHECK(strcmp(names[PERF_STAGE_LOG_DATA], "logData") == 0);
+  bool distinct = true;
+  for (int i = 0; i < PERF_STAGE_COUNT; i++) {
+    for (int j = i + 1; j < PERF_STAGE_COUNT; j++) distinct = distinct && strcmp(names[i], names[j]) != 0;
+    distinct = distinct && strcmp(names[i], "unknown") != 0;
+  }
+  CHECK(distinct);
+  CHECK(strcmp(perfStageName(PERF_STAGE_COUNT), "unknown") == 0);
+  CHECK(strcmp(perfStageName(-1), "unknown") == 0);
+}
+
+static void testScope() {
+  LoopProfiler profiler(1000);                                // PC clock: nanoseconds
+  {
+    PerfScope scope(profiler, PERF_STAGE_ENERGY_UPDATE);
+    volatile uint32_t sum = 0;
+    for (uint32_t i = 0; i < 100000; i++) sum += i;
+  }
+  const PerfStageStats& stage = profiler.getStage(PERF_STAGE_ENERGY_UPDATE);
+  CHECK(stage.count == 1);
+  CHECK(stage.maxCycles > 0);
+  CHECK(stage.maxCycles < 1000000000u);                       // Under a second
+  CHECK(stage.histogram.getSamples() == 1);
+
+  { PerfScope ignored(profiler, PERF_STAGE_COUNT); }
+  CHECK(stage.count == 1);
+}
+
+int main() {
+  testStats();
+  testLargeCounts();
+  testCpuMhz();
+  testPercentiles();
+  testResetRequest();
+  testStageNames();
+  testScope();
+  return testSummary("loop_profiler");
+}
@@ -0,0 +1,145 @@
+/*
+ * Power filter bank - step-response latency and idle noise of the adaptive
+ * filter and median-of-3 against the original fixed-alpha EMA, on the same
+ * trace as HardwareManager::benchmarkPowerFilters(), plus the edge cases.
+ */
+
+#include "config.h"
+#include "power_filter.h"
+#include "test_common.h"
+
+static const int READINGS = 240;
+static const float IDLE_W = 30.0f;
+static const float LOAD_W = 400.0f;
+
+struct FilterResult {
+  int rise;             // Readings after the step to reach 90% of it
+  int fall;             // Readings after the drop to get back within 10%
+  double noise;         // RMS deviation from idle, readings 20..37
+  float spike;          // Peak response to the single 300 W reading at 40
+};
+
+// Idle with +/-8 W noise, a 300 W spike at 40, load step at 60, idle at 150
+static void buildTrace(float* trace) {
+  uint32_t seed = 1;
+  for (int i = 0; i < READINGS; i++) {
+    float noise = 0;
+    for (int k = 0; k < 4; k++) {
+      seed = seed * 1103515245u + 12345u;
+      noise += ((seed >> 16) % 1000) / 1000.0f - 0.5f;
+    }
+    float level = (i >= 60 && i < 150) ? LOAD_W : IDLE_W;
+    trace[i] = level + noise * 8.0f;
+  }
+  trace[40] = IDLE_W + 300.0f;
+}
+
+static FilterResult run(const PowerFilterParams& params, float alpha, const float* trace) {
+  PowerFilter filter;
+  filter.configure(params, alpha);
+  FilterResult r = {-1, -1, 0, 0};
+  double noiseSum = 0;
+  int noiseCount = 0;
+  for (int i = 0; i < READINGS; i++) {
+    float y = filter.update(trace[i]);
+    if (i >= 20 && i < 38) {
+      noiseSum += (y - IDLE_W) * (y - IDLE_W);
+      noiseCount++;
+    }
+    if (i >= 40 && i < 60 && y - IDLE_W > r.spike) r.spike = y - IDLE_W;
+    if (i >= 60 && r.rise < 0 && y >= IDLE_W + 0.9f * (LOAD_W - IDLE_W)) r.rise = i - 60;
+    if (i >= 150 && r.fall < 0 && y <= IDLE_W + 0.1f * (LOAD_W - IDLE_W)) r.fall = i - 150;
+  }
+  r.noise = sqrt(noiseSum / noiseCount);
+  return r;
+}
+
+static void print(const char* name, const FilterResult& r) {
+  printf("  %-22s rise %2d, fall %2d readings, idle noise %.2f W, spike %.0f W\n",
+         name, r.rise, r.fall, r.noise, r.spike);
+}
+
+static void testAgainstEma() {
+  static float trace[READINGS];
+  buildTrace(trace);
+  const float alpha = POWER_FILTER_ALPHA_DEFAULT;
+
+  PowerFilterParams ema = {POWER_FILTER_EMA, false, POWER_FILTER_ALPHA_MAX_DEFAULT, POWER_FILTER_STEP_WATTS_DEFAULT};
+  PowerFilterParams emaMedian = ema;
+  emaMedian.median3 = true;
+  PowerFilterParams adaptive = ema;
+  adaptive.type = POWER_FILTER_ADAPTIVE;
+  PowerFilterParams adaptiveMedian = adaptive;
+  adaptiveMedian.median3 = true;
+
+  FilterResult rEma = run(ema, alpha, trace);
+  FilterResult rEmaMedian = run(emaMedian, alpha, trace);
+  FilterResult rAdaptive = run(adaptive, alpha, trace);
+  FilterResult rAdaptiveMedian = run(adaptiveMedian, alpha, trace);
+  print("EMA", rEma);
+  print("EMA + median-3", rEmaMedian);
+  print("Adaptive", rAdaptive);
+  print("Adaptive + median-3", rAdaptiveMedian);
+
+  // EMA with alpha 0.2 needs ~10 readings for 90%, the adaptive filter ~1
+  CHECK(rEma.rise >= 8);
+  CHECK(rAdaptive.rise >= 0 && rAdaptive.rise <= 2);
+  CHECK(rAdaptive.fall >= 0 && rAdaptive.fall <= 2);
+  CHECK(rAdaptive.rise * 4 < rEma.rise);
+  // ...without more idle jitter than the EMA
+  CHECK(rAdaptive.noise <= rEma.noise * 1.1);
+  // Median-of-3 drops the single spike, for one reading of delay
+  CHECK(rEmaMedian.spike < 0.2f * rEma.spike);
+  CHECK(rAdaptiveMedian.spike < 15.0f);
+  CHECK(rAdaptiveMedian.rise == rAdaptive.rise + 1);
+}
+
+static void testEmaMatchesOriginal() {
+  // The original filterPowerIN: filtered = alpha * raw + (1 - alpha) * filtered
+  PowerFilterParams ema = {POWER_FILTER_EMA, false, 1, 1};
+  PowerFilter filter;
+  filter.configure(ema, 0.3f);
+  double reference = 100;
+  CHECK(filter.update(100) == 100);   // First reading taken as is
+  const float inputs[] = {120, 80, 300, 0, 50, 50, 50};
+  for (float x : inputs) {
+    reference = 0.3 * x + 0.7 * reference;
+    CHECK_NEAR(filter.update(x), reference, 1e-3);
+  }
+}
+
+static void testConfigure() {
+  PowerFilter filter;
+  // Invalid type falls back to EMA, alphaMax never below alpha
+  PowerFilterParams bad = {POWER_FILTER_TYPE_COUNT, false, 0.05f, 0};
+  filter.configure(bad, 0.5f);
+  filter.update(0);
+  CHECK_NEAR(filter.update(100), 50, 1e-4);
+
+  // Adaptive with deviations far below the step stays near the base alpha
+  PowerFilterParams adaptive = {POWER_FILTER_ADAPTIVE, false, 0.9f, 1000};
+  filter.configure(adaptive, 0.2f);
+  filter.reset();
+  CHECK(!filter.isInitialized());
+  filter.update(0);
+  CHECK(filter.isInitialized());
+  CHECK_NEAR(filter.update(10), 2.0, 0.01);
+  // A deviation of a whole step uses alphaMax
+  filter.initialize(0);
+  CHECK_NEAR(filter.update(1000), 900, 1e-2);
+  CHECK_NEAR(filter.get(), 900, 1e-2);
+
+  // Median-of-3 needs two readings to confirm a step
+  PowerFilterParams median = {POWER_FILTER_EMA, true, 1, 1};
+  filter.configure(median, 1.0f);
+  filter.initialize(10);
+  CHECK_NEAR(filter.update(500), 10, 1e-4);
+  CHECK_NEAR(filter.update(500), 500, 1e-4);
+}
+
+int main() {
+  testAgainstEma();
+  testEmaMatchesOriginal();
+  testConfigure();
+  return testSummary("power_filter");
+}
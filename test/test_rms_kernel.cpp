@@ -0,0 +1,105 @@
+/*
+ * RMS kernel - the fixed-point kernel against the reference (EmonLib) one,
+ * within the documented RMS_Q_TOLERANCE on synthetic clamp traces.
+ */
+
+#include "rms_kernel.h"
+#include "test_common.h"
+
+static uint16_t trace[30000];
+
+static void testTolerance() {
+  const double peaks[] = {0, 5, 40, 250, 900, 1900};
+  const double biases[] = {1750, 2048, 2300};
+  const double rates[] = {4000, 10000};
+  int outside = 0;
+
+  for (double rate : rates) {
+    for (double bias : biases) {
+      for (double peak : peaks) {
+        synthesizeCurrentTrace(trace, 1480, bias, peak, 50, rate);
+        // Offset starting away from the bias, as after a restart
+        double ref = referenceTraceRms(trace, 1480, 2048);
+        double q = fixedTraceRms(trace, 1480, 2048);
+        if (!rmsWithinTolerance(q, ref)) {
+          outside++;
+          fprintf(stderr, "rate %.0f bias %.0f peak %.0f: ref %.4f fixed %.4f\n", rate, bias, peak, ref, q);
+        }
+      }
+    }
+  }
+  CHECK(outside == 0);
+}
+
+static void testSettledOffset() {
+  // Both kernels follow the DC bias with the same 1/1024 low-pass
+  RmsAccumulator ref;
+  RmsAccumulatorQ q;
+  ref.reset(2048);
+  q.reset(2048);
+  for (int i = 0; i < 20000; i++) {
+    ref.add(1800);
+    q.add(1800);
+  }
+  CHECK_NEAR(ref.offset, 1800, 0.01);
+  CHECK_NEAR(q.offsetQ / (double)(1 << RMS_Q_OFFSET_BITS), 1800, 0.05);
+}
+
+static void testLongWindow() {
+  // Full-scale square wave for 30000 samples: the 64-bit sum must not wrap
+  RmsAccumulator ref;
+  RmsAccumulatorQ q;
+  ref.reset(2048);
+  q.reset(2048);
+  for (int i = 0; i < 30000; i++) {
+    int sample = (i / 100) % 2 ? 4095 : 0;
+    ref.add(sample);
+    q.add(sample);
+  }
+  double rmsRef = sqrt(ref.meanSquare());
+  CHECK(rmsRef > 1900);
+  CHECK(rmsWithinTolerance(sqrt(q.meanSquare()), rmsRef));
+}
+
+static void testWindowClear() {
+  RmsAccumulatorQ q;
+  q.reset(2048);
+  CHECK(q.meanSquare() == 0);
+  synthesizeCurrentTrace(trace, 2000, 2048, 300, 50, 10000);
+  for (int i = 0; i < 2000; i++) q.add(trace[i]);
+  CHECK(q.count == 2000);
+  q.clearWindow();
+  CHECK(q.count == 0);
+  CHECK(q.meanSquare() == 0);
+  // The offset survives the window (it ripples ~9 counts with a 300-count sine)
+  CHECK_NEAR(q.offsetQ / (double)(1 << RMS_Q_OFFSET_BITS), 2048, 12);
+}
+
+static void testZeroCross() {
+  ZeroCrossDetector zc;
+  zc.reset(20 << RMS_Q_SAMPLE_BITS);
+  RmsAccumulatorQ q;
+  q.reset(2048);
+  synthesizeCurrentTrace(trace, 10000, 2048, 300, 50, 10000);
+  int rising = 0;
+  for (int i = 0; i < 10000; i++) {
+    if (zc.update(q.add(trace[i]))) rising++;
+  }
+  // The first edge only sets the polarity (the trace starts on a crossing)
+  CHECK(rising == 49);
+  CHECK_NEAR(zc.period, 200, 1);
+
+  CHECK(nominalMainsFrequency(49.9) == 50);
+  CHECK(nominalMainsFrequency(60.2) == 60);
+  CHECK(nominalMainsFrequency(30.0) == 0);
+  CHECK(nominalMainsFrequency(100.0) == 0);
+}
+
+int main() {
+  testTolerance();
+  testSettledOffset();
+  testLongWindow();
+  testWindowClear();
+  testZeroCross();
+  return testSummary("rms_kernel");
+}
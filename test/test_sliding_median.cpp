@@ -0,0 +1,102 @@
+/*
+ * Sliding median - median and agreement counts against the original
+ * copy-sort-scan over the same window, on noisy SOC-like traces.
+ */
+
+#include "sliding_median.h"
+#include "test_common.h"
+
+static const int MAX_WINDOW = 400;
+
+static SlidingMedian<MAX_WINDOW> median;
+static float window[MAX_WINDOW];
+static float tmp[MAX_WINDOW];
+
+// Noisy discharge with plateaus and repeated values (SOC is often whole %)
+static float socSample(uint32_t& seed, int i) {
+  seed = seed * 1103515245u + 12345u;
+  float noise = ((seed >> 16) % 700) / 100.0f - 3.5f;
+  float level = 90.0f - i * 0.02f;
+  if ((seed >> 8) % 4 == 0) return (float)(int)level;
+  return level + noise;
+}
+
+static int compareWindow(int size, int samples) {
+  median.reset(size);
+  int filled = 0;
+  int slot = 0;
+  int mismatches = 0;
+  uint32_t seed = 7 + size;
+
+  for (int i = 0; i < samples; i++) {
+    float value = socSample(seed, i);
+    median.push(value);
+    window[slot] = value;
+    slot = (slot + 1) % size;
+    if (filled < size) filled++;
+
+    float expected = slidingMedianReference(window, filled, tmp);
+    if (median.median() != expected || median.size() != filled) mismatches++;
+
+    // Agreement counts as getStableSOC() scanned them
+    double displayed = 80.0 - (i % 7);
+    int above = 0;
+    int below = 0;
+    for (int k = 0; k < filled; k++) {
+      if (window[k] > displayed + 1.0) above++;
+      if (window[k] < displayed - 1.0) below++;
+    }
+    if (median.countAbove(displayed + 1.0) != above || median.countBelow(displayed - 1.0) != below) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+static void testMatchesReference() {
+  const int sizes[] = {1, 2, 3, 10, 15, 64, 301, MAX_WINDOW};
+  for (int size : sizes) {
+    int mismatches = compareWindow(size, 3 * size + 50);
+    if (mismatches > 0) fprintf(stderr, "  window %d: %d mismatches\n", size, mismatches);
+    CHECK(mismatches == 0);
+  }
+}
+
+static void testResetAndClamp() {
+  median.reset(0);
+  CHECK(median.capacity() == 1);
+  median.reset(MAX_WINDOW + 100);
+  CHECK(median.capacity() == MAX_WINDOW);
+
+  median.reset(4);
+  CHECK(median.size() == 0);
+  CHECK(median.median() == 0);
+  median.push(10);
+  median.push(20);
+  CHECK(median.median() == 15);
+  median.push(30);
+  median.push(40);
+  CHECK(median.nextSlot() == 0);
+  median.push(50);                    // 10 leaves
+  CHECK(median.size() == 4);
+  CHECK(median.median() == 35);
+  CHECK(median.countAbove(30) == 2);
+  CHECK(median.countBelow(30) == 1);
+  CHECK(median.countAbove(50) == 0);
+
+  // Equal values: removing one copy leaves the others
+  median.reset(3);
+  median.push(5);
+  median.push(5);
+  median.push(1);
+  median.push(9);                     // First 5 leaves
+  CHECK(median.median() == 5);
+  CHECK(median.countBelow(5) == 1);
+  CHECK(median.countAbove(5) == 1);
+}
+
+int main() {
+  testMatchesReference();
+  testResetAndClamp();
+  return testSummary("sliding_median");
+}
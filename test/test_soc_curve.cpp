@@ -0,0 +1,128 @@
+/*
+ * SOC curve engine - grid and binary-search lookups against the original
+ * linear walk on the built-in curves, plus dense curves, validation and
+ * the named curve set.
+ */
+
+#include "config.h"
+#include "soc_curve.h"
+#include "test_common.h"
+
+static int compareWithReference(const float (*table)[2], int points, double tolerance) {
+  SocCurve curve;
+  if (!curve.load(table, points)) return -1;
+
+  int mismatches = 0;
+  for (int mv = 21000; mv <= 28000; mv++) {
+    float v = mv / 1000.0f;
+    float ref = socCurveLinearReference(table, points, v);
+    float grid = curve.percentAt(v);
+    float binary = curve.percentAtBinary(v);
+    if (fabs(grid - ref) > tolerance || fabs(binary - ref) > tolerance) {
+      if (mismatches++ < 5) {
+        fprintf(stderr, "  %.3f V: reference %.4f, grid %.4f, binary %.4f\n", v, ref, grid, binary);
+      }
+    }
+  }
+  return mismatches;
+}
+
+static void testBuiltInCurves() {
+  CHECK(compareWithReference(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS, 1e-3) == 0);
+  CHECK(compareWithReference(BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS, 1e-3) == 0);
+
+  SocCurve curve;
+  CHECK(curve.load(BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS));
+  CHECK(curve.size() == CURVE_NORMAL_POINTS);
+  // Exact points, clamping, and the repeated 25.95 V point (higher percent wins)
+  CHECK_NEAR(curve.percentAt(26.05f), 80.0, 1e-3);
+  CHECK_NEAR(curve.percentAt(25.95f), 70.0, 1e-3);
+  CHECK_NEAR(curve.percentAt(20.0f), 0.0, 1e-6);
+  CHECK_NEAR(curve.percentAt(30.0f), 100.0, 1e-6);
+
+  float percent, voltage;
+  curve.point(0, percent, voltage);
+  CHECK(percent == 0.0f && voltage == 22.70f);
+}
+
+static void testDenseCurve() {
+  // 40 points, 100% to 0% within 0.2 V: several per 10 mV cell, the binary
+  // search finishes the lookup
+  float table[40][2];
+  for (int i = 0; i < 40; i++) {
+    table[i][0] = 100.0f - i * (100.0f / 39);
+    table[i][1] = 25.20f - i * 0.005f;
+  }
+  CHECK(compareWithReference(table, 40, 1e-2) == 0);
+}
+
+static void testUnsortedInput() {
+  const float shuffled[][2] = {{50.0, 25.0}, {0.0, 23.0}, {100.0, 27.0}, {25.0, 24.0}};
+  const float ordered[][2] = {{100.0, 27.0}, {50.0, 25.0}, {25.0, 24.0}, {0.0, 23.0}};
+  SocCurve curve;
+  CHECK(curve.load(shuffled, 4));
+  for (float v = 22.5f; v < 27.5f; v += 0.01f) {
+    CHECK_NEAR(curve.percentAt(v), socCurveLinearReference(ordered, 4, v), 1e-3);
+  }
+}
+
+static void testValidation() {
+  SocCurve curve;
+  const float good[][2] = {{100.0, 26.0}, {0.0, 23.0}};
+  const float percentHigh[][2] = {{120.0, 26.0}, {0.0, 23.0}};
+  const float flat[][2] = {{100.0, 25.0}, {0.0, 25.0}};
+  const float zeroVolt[][2] = {{100.0, 26.0}, {0.0, 0.0}};
+  CHECK(curve.load(good, 2));
+  CHECK(!curve.load(good, 1));
+  CHECK(!curve.load(percentHigh, 2));
+  CHECK(!curve.load(flat, 2));
+  CHECK(!curve.load(zeroVolt, 2));
+  // Untouched by the failed loads
+  CHECK(curve.size() == 2);
+  CHECK_NEAR(curve.percentAt(24.5f), 50.0, 1e-3);
+
+  SocCurve empty;
+  CHECK(empty.percentAt(25.0f) == 0.0f);
+}
+
+static void testCurveSet() {
+  static SocCurveSet set;
+  set.clear();
+  CHECK(set.percentAt(false, 25.0f) == 0.0f);
+  CHECK(set.add("normal", BATTERY_CURVE_NORMAL, CURVE_NORMAL_POINTS) == 0);
+  CHECK(set.add("charge", BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS) == 1);
+  CHECK(set.select("normal", "charge"));
+  CHECK(!set.select("normal", "missing"));
+  CHECK(set.dischargeIndex == 0 && set.chargeIndex == 1);
+
+  const float cold[][2] = {{100.0, 26.0}, {0.0, 22.0}};
+  CHECK(set.add("cold", cold, 2) == 2);
+  CHECK(set.select("cold", "charge"));
+  CHECK_NEAR(set.percentAt(false, 24.0f), 50.0, 1e-3);
+  CHECK_NEAR(set.percentAt(true, 25.0f), socCurveLinearReference(BATTERY_CURVE_CHARGE, CURVE_CHARGE_POINTS, 25.0f), 1e-3);
+
+  // Replacing keeps the index, a bad curve or name is refused
+  const float colder[][2] = {{100.0, 25.0}, {0.0, 21.0}};
+  CHECK(set.add("cold", colder, 2) == 2);
+  CHECK_NEAR(set.percentAt(false, 23.0f), 50.0, 1e-3);
+  CHECK(set.add("", cold, 2) == -1);
+  CHECK(set.add("a-name-that-is-too-long", cold, 2) == -1);
+  CHECK(set.add("bad", cold, 1) == -1);
+  CHECK(set.count == 3);
+
+  char name[SOC_CURVE_NAME_LEN];
+  for (int i = set.count; i < SOC_CURVE_MAX_CURVES; i++) {
+    snprintf(name, sizeof(name), "c%d", i);
+    CHECK(set.add(name, cold, 2) == i);
+  }
+  CHECK(set.add("onemore", cold, 2) == -1);
+}
+
+int main() {
+  testBuiltInCurves();
+  testDenseCurve();
+  testUnsortedInput();
+  testValidation();
+  testCurveSet();
+  return testSummary("soc_curve");
+}
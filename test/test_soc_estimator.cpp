@@ -0,0 +1,138 @@
+/*
+ * SOC estimator - coulomb counting through an outage, the recharge under
+ * load that detectState() reports as BYPASS, and the float back to full.
+ * Fusion mirrors HardwareManager::updateFusedSOC(), one reading a second.
+ */
+
+#include "config.h"
+#include "soc_estimator.h"
+#include "test_common.h"
+
+static const float VOLTAGE = 25.6f;
+static const float CAPACITY_AH = SOC_CAPACITY_AH_DEFAULT;
+
+struct Fusion {
+  SocEstimator estimator;
+  unsigned long now;
+  unsigned long restStartTime;
+  unsigned long floatStartTime;
+  bool bypassPath;            // false: the estimator as it was, BYPASS counted as zero
+
+  explicit Fusion(bool withBypass) : now(0), restStartTime(0), floatStartTime(0), bypassPath(withBypass) {
+    estimator.setCapacity(CAPACITY_AH);
+    estimator.initialize(100.0f, SOC_INITIAL_VARIANCE);
+  }
+
+  // One reading: state as detectState() reports it, voltage SOC for REST
+  float step(BatteryState state, float powerIn, float powerOut, float voltageSoc) {
+    now += 1000;
+    float amps = socBatteryCurrent(powerIn, powerOut, VOLTAGE, SOC_CHARGE_EFFICIENCY,
+                                   SOC_DISCHARGE_EFFICIENCY, POWER_THRESHOLD_DEFAULT, BATTERY_VMIN);
+    if (state == STATE_BYPASS && (!bypassPath || amps < 0)) amps = 0;
+    estimator.predict(amps, 1.0f, SOC_PROCESS_NOISE);
+
+    if (state != STATE_REST) {
+      restStartTime = now;
+    } else if (now - restStartTime >= SOC_REST_SETTLE_MS) {
+      estimator.correct(voltageSoc, SOC_VOLTAGE_NOISE);
+    }
+
+    if (!bypassPath) return estimator.getSoc();
+    if (state != STATE_BYPASS || amps > 0) floatStartTime = now;
+    if (state == STATE_BYPASS) {
+      estimator.bypass(SOC_BYPASS_FLOOR, now - floatStartTime >= SOC_FLOAT_SETTLE_MS, SOC_VOLTAGE_NOISE);
+    }
+    return estimator.getSoc();
+  }
+
+  float run(int seconds, BatteryState state, float powerIn, float powerOut) {
+    float soc = estimator.getSoc();
+    for (int i = 0; i < seconds; i++) soc = step(state, powerIn, powerOut, 0);
+    return soc;
+  }
+};
+
+// Percent per second of a given AC-side surplus (positive) or deficit
+static float socRate(float netW) {
+  float batteryW = netW > 0 ? netW * SOC_CHARGE_EFFICIENCY : netW / SOC_DISCHARGE_EFFICIENCY;
+  return batteryW / VOLTAGE / 3600.0f / CAPACITY_AH * 100.0f;
+}
+
+// One hour at 150 W from the battery, then mains back with a 300 W load
+// while the charger adds 80 W (within 30%: reported as BYPASS)
+static void testOutageAndBypassRecharge() {
+  Fusion fusion(true);
+  float afterOutage = fusion.run(3600, STATE_DISCHARGING, 0, 150);
+  CHECK_NEAR(afterOutage, 100.0f + socRate(-150) * 3600, 0.1);
+  CHECK(afterOutage < 70.0f);
+
+  // First BYPASS reading: the voltage path's floor applies to the fused SOC too
+  float first = fusion.step(STATE_BYPASS, 380, 300, 0);
+  CHECK_NEAR(first, SOC_BYPASS_FLOOR, 0.01);
+
+  // The IN surplus is counted as charge current from there
+  float recharging = fusion.run(1200, STATE_BYPASS, 380, 300);
+  CHECK_NEAR(recharging, SOC_BYPASS_FLOOR + socRate(80) * 1200, 0.1);
+
+  // Long enough to be full, the clamp holds it at 100
+  float full = fusion.run(3600, STATE_BYPASS, 380, 300);
+  CHECK_NEAR(full, 100.0f, 0.01);
+}
+
+// Charger done early (clamp gain, tail current under the deadband): after
+// SOC_FLOAT_SETTLE_MS without a surplus the estimate is pulled to full
+static void testFloatAnchor() {
+  Fusion fusion(true);
+  fusion.run(3600, STATE_DISCHARGING, 0, 150);
+  float recharged = fusion.run(600, STATE_BYPASS, 380, 300);
+  CHECK(recharged > SOC_BYPASS_FLOOR && recharged < 96.0f);
+
+  // Within the settle time nothing moves
+  float settling = fusion.run(SOC_FLOAT_SETTLE_MS / 1000 - 1, STATE_BYPASS, 305, 300);
+  CHECK_NEAR(settling, recharged, 0.001);
+
+  float floating = fusion.run(600, STATE_BYPASS, 305, 300);
+  CHECK(floating > 99.0f);
+  CHECK(floating <= 100.0f);
+
+  // A deficit in BYPASS is clamp mismatch, it never discharges the estimate
+  float mismatch = fusion.run(600, STATE_BYPASS, 290, 300);
+  CHECK(mismatch >= floating - 0.01f);
+}
+
+// The estimator as it was: BYPASS counted as zero, no floor. The SOC
+// stays at the post-outage value however long the recharge lasts.
+static void testWithoutBypassPath() {
+  Fusion fusion(false);
+  float afterOutage = fusion.run(3600, STATE_DISCHARGING, 0, 150);
+  float later = fusion.run(7200, STATE_BYPASS, 380, 300);
+  CHECK_NEAR(later, afterOutage, 0.001);
+}
+
+// A surplus that leaves BYPASS (> 30% of OUT) is CHARGING and was always counted
+static void testChargingUnchanged() {
+  Fusion with(true);
+  Fusion without(false);
+  with.run(1800, STATE_DISCHARGING, 0, 150);
+  without.run(1800, STATE_DISCHARGING, 0, 150);
+  float a = with.run(600, STATE_CHARGING, 300, 100);
+  float b = without.run(600, STATE_CHARGING, 300, 100);
+  CHECK_NEAR(a, b, 0.001);
+  CHECK(a < SOC_BYPASS_FLOOR);
+}
+
+static void testBypassUninitialized() {
+  SocEstimator estimator;
+  estimator.bypass(SOC_BYPASS_FLOOR, true, SOC_VOLTAGE_NOISE);
+  CHECK(!estimator.isInitialized());
+  CHECK_NEAR(estimator.getSoc(), 0, 0);
+}
+
+int main() {
+  testOutageAndBypassRecharge();
+  testFloatAnchor();
+  testWithoutBypassPath();
+  testChargingUnchanged();
+  testBypassUninitialized();
+  return testSummary("soc_estimator");
+}
@@ -0,0 +1,292 @@
+/*
+ * String buffer and NUT command parsing - addFloat against printf and the
+ * Arduino String(value, n) rounding (dtostrf) over random values, integer
+ * edge cases, truncation, and the upsd command tokenizer every NUT reply
+ * goes through.
+ */
+
+#include "str_buf.h"
+#include "nut_command.h"
+#include "test_common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// dtostrf() of arduino-esp32, behind String(double, decimals): add half a
+// unit of the last digit, then peel the digits off one by one
+static void arduinoDtostrf(double number, int prec, char* out) {
+  if (number != number) {
+    strcpy(out, "nan");
+    return;
+  }
+  bool negative = number < 0.0;
+  if (negative) number = -number;
+  double rounding = 2.0;
+  for (int i = 0; i < prec; i++) rounding *= 10.0;
+  number += 1.0 / rounding;
+  double tenpow = 1.0;
+  int digits = 1;
+  while (number >= 10.0 * tenpow) {
+    tenpow *= 10.0;
+    digits++;
+  }
+  number /= tenpow;
+  if (negative) *out++ = '-';
+  while (digits-- > 0) {
+    int digit = (int)number;
+    number = 10 * (number - digit);
+    *out++ = (char)('0' + digit);
+  }
+  if (prec > 0) {
+    *out++ = '.';
+    while (prec-- > 0) {
+      int digit = (int)number;
+      number = 10 * (number - digit);
+      *out++ = (char)('0' + digit);
+    }
+  }
+  *out = '\0';
+}
+
+static const char* formatFloat(double value, int decimals) {
+  static StackStr<32> out;
+  out.clear();
+  return out.addFloat(value, decimals).c_str();
+}
+
+// Within a hair of x.5 units of the last digit, where the three rounding
+// rules may legitimately differ (printf rounds the exact binary value)
+static bool nearTie(double value, int decimals) {
+  double scaled = fabs(value) * pow(10.0, decimals);
+  double frac = scaled - floor(scaled);
+  return fabs(frac - 0.5) < 1e-12 * (scaled > 1 ? scaled : 1);
+}
+
+static void testFloatCases() {
+  CHECK(strcmp(formatFloat(26.44, 1), "26.4") == 0);
+  CHECK(strcmp(formatFloat(26.45, 1), "26.5") == 0);    // 26.4499... in binary, but 26.45 * 10 is 264.5
+  CHECK(strcmp(formatFloat(0.125, 2), "0.13") == 0);    // Half away from zero (printf: 0.12)
+  CHECK(strcmp(formatFloat(2.5, 0), "3") == 0);
+  CHECK(strcmp(formatFloat(1.999, 2), "2.00") == 0);
+  CHECK(strcmp(formatFloat(99.96, 1), "100.0") == 0);
+  CHECK(strcmp(formatFloat(0, 3), "0.000") == 0);
+  CHECK(strcmp(formatFloat(7, 0), "7") == 0);
+  CHECK(strcmp(formatFloat(1.5, 9), "1.500000") == 0);  // Capped at 6 decimals
+  CHECK(strcmp(formatFloat(1.5, -1), "2") == 0);
+
+  // Negative values near zero keep their sign, as String() and printf do
+  CHECK(strcmp(formatFloat(-0.004, 2), "-0.00") == 0);
+  CHECK(strcmp(formatFloat(-0.005, 2), "-0.01") == 0);
+  CHECK(strcmp(formatFloat(-0.4, 0), "-0") == 0);
+  CHECK(strcmp(formatFloat(-0.6, 0), "-1") == 0);
+  CHECK(strcmp(formatFloat(-12.345, 1), "-12.3") == 0);
+  CHECK(strcmp(formatFloat(-0.0, 1), "0.0") == 0);      // -0.0 < 0 is false, like String()
+
+  char ref[32];
+  const double nearZero[] = {-0.0001, -0.0049, -0.05, -0.449, -0.5, -0.951};
+  for (double v : nearZero) {
+    for (int d = 0; d <= 3; d++) {
+      arduinoDtostrf(v, d, ref);
+      CHECK(strcmp(formatFloat(v, d), ref) == 0);
+    }
+  }
+
+  CHECK(strcmp(formatFloat(NAN, 2), "nan") == 0);
+  CHECK(strcmp(formatFloat(5e9, 1), "ovf") == 0);
+  CHECK(strcmp(formatFloat(-5e9, 1), "-ovf") == 0);
+  CHECK(strcmp(formatFloat(4294967040.0, 0), "4294967040") == 0);
+}
+
+static void testFloatRandom() {
+  uint32_t seed = 12345;
+  int printfMismatch = 0;
+  int stringMismatch = 0;
+  int ties = 0;
+  char ref[48];
+  for (int i = 0; i < 200000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int decimals = (seed >> 8) % 4;
+    seed = seed * 1103515245u + 12345u;
+    // Mostly sensor-sized values, some tiny and some large ones
+    double magnitude = ((seed >> 16) % 3 == 0) ? 1.0 : ((seed >> 16) % 3 == 1) ? 1000.0 : 1e6;
+    seed = seed * 1103515245u + 12345u;
+    double value = ((double)(seed >> 1) / 0x7FFFFFFF * 2.0 - 1.0) * magnitude;
+    if ((i & 7) == 0) value = (float)value;   // Most callers pass a float
+    const char* got = formatFloat(value, decimals);
+
+    if (nearTie(value, decimals)) {
+      ties++;
+      continue;
+    }
+    snprintf(ref, sizeof(ref), "%.*f", decimals, value);
+    if (strcmp(got, ref) != 0) {
+      if (printfMismatch++ < 5) fprintf(stderr, "  printf %.17g/%d: %s vs %s\n", value, decimals, got, ref);
+    }
+    arduinoDtostrf(value, decimals, ref);
+    if (strcmp(got, ref) != 0) {
+      if (stringMismatch++ < 5) fprintf(stderr, "  String %.17g/%d: %s vs %s\n", value, decimals, got, ref);
+    }
+  }
+  printf("  200000 random values: %d near a tie skipped\n", ties);
+  CHECK(printfMismatch == 0);
+  CHECK(stringMismatch == 0);
+}
+
+static void testIntegers() {
+  StackStr<32> out;
+  out.addInt(INT32_MIN);
+  CHECK(strcmp(out.c_str(), "-2147483648") == 0);
+  out.clear();
+  out.addInt(INT32_MAX).add(' ').addInt(0).add(' ').addInt(-1);
+  CHECK(strcmp(out.c_str(), "2147483647 0 -1") == 0);
+  out.clear();
+  out.addUInt(UINT32_MAX).add(' ').addUInt(0);
+  CHECK(strcmp(out.c_str(), "4294967295 0") == 0);
+  CHECK(!out.truncated());
+
+  char ref[16];
+  uint32_t seed = 99;
+  bool same = true;
+  for (int i = 0; i < 100000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    int32_t value = (int32_t)(seed ^ (seed << 13));
+    out.clear();
+    out.addInt(value);
+    snprintf(ref, sizeof(ref), "%ld", (long)value);
+    same = same && strcmp(out.c_str(), ref) == 0;
+  }
+  CHECK(same);
+}
+
+static void testTruncation() {
+  StackStr<8> small;
+  CHECK(small.capacity() == 7);
+  small.add("hello world");
+  CHECK(strcmp(small.c_str(), "hello w") == 0);
+  CHECK(small.length() == 7);
+  CHECK(small.truncated());
+
+  // Further text is dropped, the buffer stays terminated
+  small.add('x').addInt(42).addFloat(1.5, 1);
+  CHECK(strcmp(small.c_str(), "hello w") == 0);
+  CHECK(small.truncated());
+
+  small.clear();
+  CHECK(!small.truncated());
+  CHECK(small.length() == 0 && small.c_str()[0] == '\0');
+
+  // Numbers are cut at the capacity too, never past it
+  small.add("V=").addInt(INT32_MIN);
+  CHECK(strcmp(small.c_str(), "V=-2147") == 0);
+  CHECK(small.truncated());
+  small.clear();
+  small.addFloat(-123.456, 3);
+  CHECK(strcmp(small.c_str(), "-123.45") == 0);
+  CHECK(small.truncated());
+
+  // Exactly full is not truncated
+  small.clear();
+  small.add("1234567");
+  CHECK(!small.truncated());
+  small.add("", 0);
+  CHECK(!small.truncated());
+  small.add(nullptr);
+  CHECK(!small.truncated());
+
+  // A one-byte buffer holds only the terminator
+  char one[1];
+  StrBuf tiny(one, sizeof(one));
+  tiny.add("a");
+  CHECK(one[0] == '\0');
+  CHECK(tiny.truncated());
+}
+
+static NutCommand parse(const char* text, char* storage, size_t size) {
+  size_t length = strlen(text);
+  if (length >= size) length = size - 1;
+  memcpy(storage, text, length);
+  return nutParseCommand(nutTrimLine(storage, length));
+}
+
+static void testNutCommands() {
+  char line[128];
+  NutCommand c;
+
+  c = parse("LIST UPS\r", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_LIST_UPS);
+
+  c = parse("  LIST VAR ups  \r", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_LIST_VAR);
+  CHECK(strcmp(c.upsName, "ups") == 0);
+
+  c = parse("get var  ups   battery.charge", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_GET_VAR);
+  CHECK(strcmp(c.upsName, "ups") == 0);
+  CHECK(strcmp(c.argument, "battery.charge") == 0);
+
+  c = parse("INST CMD ups shutdown.return\t\r", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_INST_CMD);
+  CHECK(strcmp(c.argument, "shutdown.return") == 0);
+
+  c = parse("List Cmd ups", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_LIST_CMD);
+  CHECK(strcmp(c.upsName, "ups") == 0);
+
+  CHECK(parse("VER", line, sizeof(line)).type == NUT_CMD_VER);
+  CHECK(parse("help\r", line, sizeof(line)).type == NUT_CMD_HELP);
+
+  // Missing second word, prefixes of longer words, trailing junk, empty lines
+  CHECK(parse("GET VAR ups", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("GET VAR ups   ", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("INST CMD", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("LIST UPSX", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("LIST VARS ups", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("VER 2", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("LIST", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("\r", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+  CHECK(parse("", line, sizeof(line)).type == NUT_CMD_UNKNOWN);
+
+  // LIST VAR without a name: the handler answers with its own error
+  c = parse("LIST VAR", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_LIST_VAR);
+  CHECK(c.upsName[0] == '\0');
+
+  // Extra words after GET VAR are ignored, the split stays inside the line
+  c = parse("GET VAR ups ups.status extra words", line, sizeof(line));
+  CHECK(c.type == NUT_CMD_GET_VAR);
+  CHECK(strcmp(c.argument, "ups.status") == 0);
+  CHECK(c.argument > line && c.argument < line + sizeof(line));
+
+  // A line cut at the buffer size still parses
+  char shortLine[16];
+  c = parse("GET VAR ups battery.voltage", shortLine, sizeof(shortLine));
+  CHECK(c.type == NUT_CMD_GET_VAR);
+  CHECK(strcmp(c.argument, "bat") == 0);
+
+  // Random bytes never read past the line
+  uint32_t seed = 3;
+  const char alphabet[] = "LISTUPVARGECMDN .\t\r";
+  for (int i = 0; i < 20000; i++) {
+    char text[40];
+    seed = seed * 1103515245u + 12345u;
+    int n = (seed >> 16) % (sizeof(text) - 1);
+    for (int k = 0; k < n; k++) {
+      seed = seed * 1103515245u + 12345u;
+      text[k] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+    text[n] = '\0';
+    char* heapLine = (char*)malloc(n + 1);
+    memcpy(heapLine, text, n);
+    nutParseCommand(nutTrimLine(heapLine, n));
+    free(heapLine);
+  }
+}
+
+int main() {
+  testFloatCases();
+  testFloatRandom();
+  testIntegers();
+  testTruncation();
+  testNutCommands();
+  return testSummary("str_buf");
+}
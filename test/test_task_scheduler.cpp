@@ -0,0 +1,279 @@
+/*
+ * Task scheduler - phase offsets, earliest-deadline order, overrun and
+ * skip accounting, tick budget spreading, getMsUntilNextDue() (the LOW
+ * POWER idle time) and the statistics reset, on a fake microsecond clock.
+ * The clock is also started past the 32-bit microsecond and millis() wraps.
+ */
+
+#include "task_scheduler.h"
+#include "test_common.h"
+
+#include <string.h>
+
+static int64_t fakeNowUs = 0;
+static int64_t fakeClock() {
+  return fakeNowUs;
+}
+
+// Tasks advance the clock by their run time and log their order
+static uint32_t runTimeUs[4];
+static char order[256];
+static int orderLength = 0;
+
+static void record(int id) {
+  if (orderLength < (int)sizeof(order) - 1) {
+    order[orderLength++] = (char)('A' + id);
+    order[orderLength] = '\0';
+  }
+  fakeNowUs += runTimeUs[id];
+}
+static void taskA() { record(0); }
+static void taskB() { record(1); }
+static void taskC() { record(2); }
+static void taskD() { record(3); }
+
+static void resetFake(int64_t startUs) {
+  fakeNowUs = startUs;
+  memset(runTimeUs, 0, sizeof(runTimeUs));
+  orderLength = 0;
+  order[0] = '\0';
+}
+
+// Same period, different phases: never in the same tick
+static void testPhases(int64_t startUs) {
+  resetFake(startUs);
+  TaskScheduler sched(fakeClock, 20000);
+  sched.add("a", taskA, 1000, 0, 5000);
+  sched.add("b", taskB, 1000, 500, 5000);
+  sched.add("c", taskC, 1000, 250, 5000);
+
+  int shared = 0;
+  for (int step = 0; step < 1000; step++) {       // 10 s in 10 ms loop iterations
+    int before = orderLength;
+    sched.tick();
+    if (orderLength - before > 1) shared++;
+    fakeNowUs += 10000;
+  }
+  CHECK(shared == 0);
+  CHECK(sched.getTask(0).runs == 10);
+  CHECK(sched.getTask(1).runs == 10);
+  CHECK(sched.getTask(2).runs == 10);
+  CHECK(strncmp(order, "ACBACB", 6) == 0);
+  CHECK(sched.getTask(0).skipped == 0);
+  CHECK(sched.getDeferredTicks() == 0);
+}
+
+// Several due at once: earliest deadline first, whatever the add order
+static void testEarliestDeadline() {
+  resetFake(0);
+  TaskScheduler sched(fakeClock, 100000);
+  sched.add("a", taskA, 1000, 30, 5000);
+  sched.add("b", taskB, 1000, 10, 5000);
+  sched.add("c", taskC, 1000, 20, 5000);
+  fakeNowUs = 40000;
+  sched.tick();
+  CHECK(strcmp(order, "BCA") == 0);
+  CHECK(sched.getTask(0).maxLateUs == 10000);
+  CHECK(sched.getTask(1).maxLateUs == 30000);
+}
+
+static void testOverruns() {
+  resetFake(0);
+  TaskScheduler sched(fakeClock, 100000);
+  sched.add("a", taskA, 100, 0, 1000);
+  runTimeUs[0] = 800;
+  sched.tick();
+  fakeNowUs = 100000;
+  runTimeUs[0] = 1500;
+  sched.tick();
+  fakeNowUs = 200000;
+  runTimeUs[0] = 1000;                              // At the budget is not over it
+  sched.tick();
+
+  const SchedTask& task = sched.getTask(0);
+  CHECK(task.runs == 3);
+  CHECK(task.overruns == 1);
+  CHECK(task.lastUs == 1000);
+  CHECK(task.maxUs == 1500);
+  CHECK(task.totalUs == 3300);
+}
+
+// The tick budget spreads a burst of due tasks over several iterations
+static void testBudgetSpreading() {
+  resetFake(0);
+  TaskScheduler sched(fakeClock, 2000);
+  sched.add("a", taskA, 1000, 0, 5000);
+  sched.add("b", taskB, 1000, 0, 5000);
+  sched.add("c", taskC, 1000, 0, 5000);
+  sched.add("d", taskD, 1000, 0, 5000);
+  for (int i = 0; i < 4; i++) runTimeUs[i] = 1500;
+
+  sched.tick();
+  CHECK(strcmp(order, "AB") == 0);                  // 0 < 2000, 1500 < 2000, 3000 stops
+  CHECK(sched.getDeferredTicks() == 1);
+  sched.tick();
+  CHECK(strcmp(order, "ABCD") == 0);
+  CHECK(sched.getDeferredTicks() == 1);             // Nothing left over this time
+  sched.tick();
+  CHECK(strcmp(order, "ABCD") == 0);
+
+  // One task longer than the whole budget still runs, one per tick
+  resetFake(0);
+  TaskScheduler tight(fakeClock, 1000);
+  tight.add("a", taskA, 1000, 0, 5000);
+  tight.add("b", taskB, 1000, 0, 5000);
+  runTimeUs[0] = 3000;
+  runTimeUs[1] = 3000;
+  tight.tick();
+  CHECK(strcmp(order, "A") == 0);
+  tight.tick();
+  CHECK(strcmp(order, "AB") == 0);
+
+  // A zero budget still runs one task per tick
+  resetFake(0);
+  TaskScheduler zero(fakeClock, 0);
+  zero.add("a", taskA, 1000, 0, 5000);
+  zero.add("b", taskB, 1000, 0, 5000);
+  zero.tick();
+  CHECK(strcmp(order, "A") == 0);
+  zero.tick();
+  CHECK(strcmp(order, "AB") == 0);
+  CHECK(zero.getDeferredTicks() == 1);
+}
+
+// A stall drops the missed periods and keeps the phase
+static void testStallSkips(int64_t startUs) {
+  resetFake(startUs);
+  TaskScheduler sched(fakeClock, 100000);
+  sched.add("a", taskA, 100, 30, 5000);
+  fakeNowUs = startUs + 30000;
+  sched.tick();
+  fakeNowUs = startUs + 580000;                     // Due at 130, 230 ... 530 missed
+  sched.tick();
+  const SchedTask& task = sched.getTask(0);
+  CHECK(task.runs == 2);
+  CHECK(task.skipped == 4);                         // 230, 330, 430, 530
+  CHECK(task.nextDueUs == startUs + 630000);
+  CHECK(task.maxLateUs == 450000);
+  CHECK(sched.getMsUntilNextDue(1000) == 50);
+}
+
+static void testMsUntilNextDue(int64_t startUs) {
+  resetFake(startUs);
+  TaskScheduler sched(fakeClock, 20000);
+  CHECK(sched.getMsUntilNextDue(200) == 200);       // No task: the cap
+  sched.add("a", taskA, 1000, 300, 5000);
+  sched.add("b", taskB, 500, 120, 5000);
+  CHECK(sched.getMsUntilNextDue(1000) == 120);
+  CHECK(sched.getMsUntilNextDue(50) == 50);
+  fakeNowUs += 119500;
+  CHECK(sched.getMsUntilNextDue(1000) == 0);        // Under 1 ms rounds down
+  fakeNowUs += 500;
+  CHECK(sched.getMsUntilNextDue(1000) == 0);        // Due
+  fakeNowUs += 100000;
+  CHECK(sched.getMsUntilNextDue(1000) == 0);        // Overdue
+  sched.tick();
+  CHECK(strcmp(order, "B") == 0);
+  CHECK(sched.getMsUntilNextDue(1000) == 80);       // a at 300 ms
+  fakeNowUs = startUs + 300000;
+  sched.tick();
+  CHECK(sched.getMsUntilNextDue(1000) == 320);      // b at 620 ms
+
+  // Idle the way the LOW POWER loop does: sleep until due, then tick
+  resetFake(startUs);
+  TaskScheduler idle(fakeClock, 20000);
+  idle.add("a", taskA, 1000, 0, 5000);
+  idle.add("b", taskB, 250, 100, 5000);
+  int wakes = 0;
+  while (fakeNowUs < startUs + 10000000) {
+    idle.tick();
+    uint32_t sleepMs = idle.getMsUntilNextDue(500);
+    fakeNowUs += (int64_t)(sleepMs > 0 ? sleepMs : 1) * 1000;
+    wakes++;
+  }
+  CHECK(idle.getTask(0).runs == 10);
+  CHECK(idle.getTask(1).runs == 40);
+  CHECK(idle.getTask(0).maxLateUs == 0);
+  CHECK(idle.getTask(1).maxLateUs == 0);
+  CHECK(wakes <= 60);
+}
+
+static void testResetRequest() {
+  resetFake(0);
+  TaskScheduler sched(fakeClock, 20000);
+  sched.add("a", taskA, 100, 0, 100);
+  runTimeUs[0] = 200;
+  for (int i = 0; i < 5; i++) {
+    sched.loopStart();
+    sched.tick();
+    fakeNowUs += 100;
+    sched.loopEnd();
+    fakeNowUs += 100000;
+  }
+  CHECK(sched.getTask(0).runs == 5);
+  CHECK(sched.getTask(0).overruns == 5);
+  CHECK(sched.getLoopHistogram().getSamples() == 5);
+
+  // From another task: nothing changes until the owner's next loopStart()
+  sched.requestReset();
+  CHECK(sched.getTask(0).runs == 5);
+  sched.loopStart();
+  CHECK(sched.getTask(0).runs == 0);
+  CHECK(sched.getTask(0).overruns == 0);
+  CHECK(sched.getTask(0).maxUs == 0);
+  CHECK(sched.getTask(0).lastUs == 200);            // Last run is kept
+  CHECK(sched.getLoopHistogram().getSamples() == 0);
+  CHECK(sched.getDeferredTicks() == 0);
+  sched.tick();
+  sched.loopEnd();
+  CHECK(sched.getTask(0).runs == 1);
+  CHECK(sched.getLoopHistogram().getSamples() == 1);
+  CHECK(sched.getLoopHistogram().getMax() == 200);
+}
+
+static void testAddLimits() {
+  resetFake(0);
+  TaskScheduler sched(fakeClock, 20000);
+  CHECK(sched.add("none", nullptr, 100, 0, 100) == -1);
+  CHECK(sched.add("zero", taskA, 0, 0, 100) == -1);
+  for (int i = 0; i < SCHED_MAX_TASKS; i++) {
+    CHECK(sched.add("a", taskA, 100, 0, 100) == i);
+  }
+  CHECK(sched.add("full", taskA, 100, 0, 100) == -1);
+  CHECK(sched.getTaskCount() == SCHED_MAX_TASKS);
+}
+
+static void testHistogram() {
+  LatencyHistogram h;
+  CHECK(h.percentile(50) == 0);
+  for (uint32_t us = 1; us <= 1000; us++) h.add(us);
+  CHECK(h.getSamples() == 1000);
+  CHECK(h.getMax() == 1000);
+  CHECK_NEAR(h.getMean(), 500.5, 0.01);
+  // Upper bucket edge, within ~19% above the exact value
+  uint32_t p50 = h.percentile(50);
+  uint32_t p99 = h.percentile(99);
+  CHECK(p50 >= 500 && p50 <= 500 * 1.19 + 1);
+  CHECK(p99 >= 990 && p99 <= 1000);                 // Capped at the max
+  CHECK(h.percentile(100) == 1000);
+  h.add(0xFFFFFFFF);                                // Last bucket, no overflow
+  CHECK(h.percentile(100) == 0xFFFFFFFF);
+}
+
+int main() {
+  // From boot, past the 32-bit microsecond wrap (71.6 min) and past the
+  // 32-bit millis() wrap (49.7 days) of a 64-bit esp_timer clock
+  const int64_t starts[] = {0, 4294967296LL - 250000, 4294967296000LL - 250000};
+  for (int64_t start : starts) {
+    testPhases(start);
+    testStallSkips(start);
+    testMsUntilNextDue(start);
+  }
+  testEarliestDeadline();
+  testOverruns();
+  testBudgetSpreading();
+  testResetRequest();
+  testAddLimits();
+  testHistogram();
+  return testSummary("task_scheduler");
+}
@@ -0,0 +1,228 @@
+/*
+ * Telemetry fan-out - per-sink rate limit, heartbeat, change filter,
+ * retry of an unavailable sink and the first frame of each sink, with the
+ * intervals the firmware registers (config.h) on a fake clock, one frame
+ * per second as the sensor tick builds them.
+ */
+
+#include "config.h"
+#include "telemetry_fanout.h"
+#include "test_common.h"
+
+#include <string.h>
+
+struct Frame {
+  uint32_t sequence;
+  float power;
+};
+
+static int64_t fakeNowUs = 0;
+static int64_t fakeClock() {
+  return fakeNowUs;
+}
+
+// Per sink: deliveries with their time and sequence, and availability
+struct Log {
+  int count;
+  int64_t firstUs;
+  int64_t lastUs;
+  uint32_t sequences[1024];
+  bool available;
+};
+static Log logs[5];
+
+static bool deliver(Log& log, const Frame& frame) {
+  if (!log.available) return false;
+  if (log.count == 0) log.firstUs = fakeNowUs;
+  log.lastUs = fakeNowUs;
+  if (log.count < 1024) log.sequences[log.count] = frame.sequence;
+  log.count++;
+  return true;
+}
+static bool sinkDataLog(const Frame& f) { return deliver(logs[0], f); }
+static bool sinkNut(const Frame& f) { return deliver(logs[1], f); }
+static bool sinkWebSocket(const Frame& f) { return deliver(logs[2], f); }
+static bool sinkMqtt(const Frame& f) { return deliver(logs[3], f); }
+static bool sinkHttp(const Frame& f) { return deliver(logs[4], f); }
+
+static bool powerChanged(const Frame& last, const Frame& now) {
+  float delta = now.power - last.power;
+  return delta >= TELEMETRY_POWER_DELTA_W || -delta >= TELEMETRY_POWER_DELTA_W;
+}
+
+static void resetLogs() {
+  memset(logs, 0, sizeof(logs));
+  for (Log& log : logs) log.available = true;
+}
+
+// Same registration as registerTelemetrySinks(), one fan-out for brevity
+static void registerSinks(TelemetryFanout<Frame>& sinks) {
+  sinks.add("dataLog",   sinkDataLog,   DATA_LOG_INTERVAL,         DATA_LOG_INTERVAL,      nullptr);
+  sinks.add("nut",       sinkNut,       0,                         0,                      nullptr);
+  sinks.add("websocket", sinkWebSocket, WS_BROADCAST_MIN_INTERVAL, WS_BROADCAST_INTERVAL,  powerChanged);
+  sinks.add("mqtt",      sinkMqtt,      MQTT_PUBLISH_MIN_INTERVAL, MQTT_PUBLISH_INTERVAL,  powerChanged);
+  sinks.add("http",      sinkHttp,      HTTP_PUBLISH_MIN_INTERVAL, HTTP_PUBLISH_INTERVAL,  powerChanged);
+  sinks.deferFirst(0);
+}
+
+// One frame a second, power per second from the callback
+static uint32_t runFrames(TelemetryFanout<Frame>& sinks, uint32_t sequence, int seconds,
+                          float (*power)(int second)) {
+  for (int s = 0; s < seconds; s++) {
+    Frame frame = {++sequence, power(s)};
+    if (sinks.isNew(frame.sequence)) sinks.publish(frame);
+    fakeNowUs += 1000000;
+  }
+  return sequence;
+}
+
+static float steadyPower(int) { return 100.0f; }
+static float stepPower(int s) { return s < 20 ? 100.0f : 400.0f; }
+static float noisyPower(int s) { return 100.0f + (s % 2 ? 1.0f : -1.0f); }
+
+static void testFirstFrame() {
+  resetLogs();
+  fakeNowUs = 3000000;                              // Registered a few seconds after boot
+  TelemetryFanout<Frame> sinks(fakeClock);
+  registerSinks(sinks);
+
+  runFrames(sinks, 0, 1, steadyPower);
+  // Status sinks get the first frame at once, without waiting for a change
+  CHECK(logs[1].count == 1);
+  CHECK(logs[2].count == 1);
+  CHECK(logs[3].count == 1);
+  CHECK(logs[4].count == 1);
+  CHECK(logs[1].sequences[0] == 1 && logs[3].sequences[0] == 1);
+  // The data log waits one interval, as the loop did before the fan-out
+  CHECK(logs[0].count == 0);
+  CHECK(sinks.getSink(0).rateLimited == 1);
+
+  runFrames(sinks, 1, DATA_LOG_INTERVAL / 1000 + 1, steadyPower);
+  CHECK(logs[0].count == 1);
+  CHECK(logs[0].firstUs == 3000000 + (int64_t)DATA_LOG_INTERVAL * 1000);
+}
+
+static void testRatesAndHeartbeat() {
+  resetLogs();
+  fakeNowUs = 0;
+  TelemetryFanout<Frame> sinks(fakeClock);
+  registerSinks(sinks);
+
+  // 10 minutes unchanged: NUT every frame, the others on their heartbeat
+  runFrames(sinks, 0, 600, steadyPower);
+  CHECK(logs[1].count == 600);
+  CHECK(logs[2].count == 1 + 599 / (WS_BROADCAST_INTERVAL / 1000));
+  CHECK(logs[3].count == 1 + 599 / (MQTT_PUBLISH_INTERVAL / 1000));
+  CHECK(logs[4].count == 1 + 599 / (HTTP_PUBLISH_INTERVAL / 1000));
+  CHECK(logs[0].count == 599 / (DATA_LOG_INTERVAL / 1000));    // Deferred: 300 s, not 0 and 300
+  CHECK(sinks.getSink(3).unchanged > 0);
+  CHECK(sinks.getFrames() == 600);
+  CHECK(sinks.getLastSequence() == 600);
+
+  // Noise under the change threshold never speeds them up
+  resetLogs();
+  TelemetryFanout<Frame> quiet(fakeClock);
+  registerSinks(quiet);
+  runFrames(quiet, 0, 120, noisyPower);
+  CHECK(logs[3].count == 1 + 119 / (MQTT_PUBLISH_INTERVAL / 1000));
+}
+
+// A change goes out as soon as the minimum interval allows
+static void testChangeEarly() {
+  resetLogs();
+  fakeNowUs = 0;
+  TelemetryFanout<Frame> sinks(fakeClock);
+  registerSinks(sinks);
+  runFrames(sinks, 0, 40, stepPower);
+
+  // First frame at 0, the step at 20 s: WS at once (past its 1 s minimum),
+  // MQTT at once (past its 5 s), HTTP at once (past its 10 s)
+  CHECK(logs[2].sequences[0] == 1);
+  bool wsStep = false, mqttStep = false, httpStep = false;
+  for (int i = 0; i < logs[2].count; i++) wsStep = wsStep || logs[2].sequences[i] == 21;
+  for (int i = 0; i < logs[3].count; i++) mqttStep = mqttStep || logs[3].sequences[i] == 21;
+  for (int i = 0; i < logs[4].count; i++) httpStep = httpStep || logs[4].sequences[i] == 21;
+  CHECK(wsStep && mqttStep && httpStep);
+
+  // Two changes in a row: the second waits for the minimum interval
+  resetLogs();
+  fakeNowUs = 0;
+  TelemetryFanout<Frame> burst(fakeClock);
+  registerSinks(burst);
+  Frame a = {1, 100};
+  Frame b = {2, 400};
+  Frame c = {3, 100};
+  burst.publish(a);
+  fakeNowUs += 1000000;
+  burst.publish(b);
+  fakeNowUs += 1000000;
+  burst.publish(c);
+  CHECK(logs[3].count == 1);                        // MQTT: 5 s minimum
+  CHECK(burst.getSink(3).rateLimited == 2);
+  CHECK(logs[2].count == 3);                        // WS: 1 s minimum
+}
+
+// An unavailable sink gets the next frame and keeps its rate state
+static void testRetry() {
+  resetLogs();
+  fakeNowUs = 0;
+  TelemetryFanout<Frame> sinks(fakeClock);
+  registerSinks(sinks);
+
+  logs[3].available = false;                        // MQTT not connected at boot
+  runFrames(sinks, 0, 10, steadyPower);
+  CHECK(logs[3].count == 0);
+  CHECK(sinks.getSink(3).unavailable == 10);
+  CHECK(sinks.getSink(3).delivered == 0);
+  CHECK(logs[1].count == 10);                       // Others unaffected
+
+  logs[3].available = true;
+  uint32_t sequence = runFrames(sinks, 10, 1, steadyPower);
+  CHECK(logs[3].count == 1);                        // First delivery right away
+  CHECK(logs[3].sequences[0] == 11);
+  CHECK(sinks.getSink(3).lastSequence == 11);
+
+  // Broker drops after a delivery: the heartbeat is retried every frame,
+  // and the change filter compares against the last delivered frame
+  logs[3].available = false;
+  fakeNowUs += (int64_t)MQTT_PUBLISH_INTERVAL * 1000;
+  sequence = runFrames(sinks, sequence, 3, steadyPower);
+  CHECK(logs[3].count == 1);
+  CHECK(sinks.getSink(3).unavailable == 13);
+  logs[3].available = true;
+  sequence = runFrames(sinks, sequence, 1, steadyPower);
+  CHECK(logs[3].count == 2);
+  CHECK(logs[3].sequences[1] == sequence);
+
+  // A failing sink never blocks the ones after it
+  logs[1].available = false;
+  int before = logs[2].count + logs[4].count;
+  Frame jump = {++sequence, 900};
+  fakeNowUs += (int64_t)HTTP_PUBLISH_MIN_INTERVAL * 1000;
+  sinks.publish(jump);
+  CHECK(logs[2].count + logs[4].count == before + 2);
+}
+
+static void testAddLimits() {
+  fakeNowUs = 0;
+  TelemetryFanout<Frame, 2> sinks(fakeClock);
+  CHECK(sinks.add("none", nullptr, 0, 0, nullptr) == -1);
+  CHECK(sinks.add("a", sinkNut, 0, 0, nullptr) == 0);
+  CHECK(sinks.add("b", sinkNut, 0, 0, nullptr) == 1);
+  CHECK(sinks.add("c", sinkNut, 0, 0, nullptr) == -1);
+  CHECK(sinks.getSinkCount() == 2);
+  sinks.deferFirst(5);                              // Out of range: ignored
+  CHECK(sinks.isNew(1));
+  Frame frame = {1, 0};
+  sinks.publish(frame);
+  CHECK(!sinks.isNew(1));
+}
+
+int main() {
+  testFirstFrame();
+  testRatesAndHeartbeat();
+  testChangeEarly();
+  testRetry();
+  testAddLimits();
+  return testSummary("telemetry_fanout");
+}
@@ -0,0 +1,152 @@
+/*
+ * Voltage compensation - the built-in tables against the original
+ * compensateVoltageDischarge/Charge ladders, at every band edge and
+ * mid-band, plus table validation and interpolation.
+ */
+
+#include "config.h"
+#include "voltage_compensation.h"
+#include "test_common.h"
+
+// The ladders as they were in hardware_manager_sensors.cpp
+static float ladderDischarge(float measuredV) {
+  if(measuredV >= 28.5) return measuredV - 1.00;
+  else if(measuredV >= 26.0) return measuredV - 0;
+  else if(measuredV >= 25.5) return measuredV + 0.10;
+  else if(measuredV >= 25.2) return measuredV + 0.20;
+  else if(measuredV >= 25.0) return measuredV + 0.30;
+  else if(measuredV >= 24.8) return measuredV + 0.40;
+  else if(measuredV >= 24.0) return measuredV + 0.50;
+  else if(measuredV >= 22.0) return measuredV + 0;
+  else if(measuredV >= 21.5) return measuredV + 1.50;
+  else return measuredV;
+}
+
+static float ladderCharge(float measuredV) {
+  if(measuredV >= 28.5) return measuredV - 1.00;
+  else if(measuredV >= 28.4) return measuredV - 0.95;
+  else if(measuredV >= 28.3) return measuredV - 0.90;
+  else if(measuredV >= 28.2) return measuredV - 0.85;
+  else if(measuredV >= 28.1) return measuredV - 0.80;
+  else if(measuredV >= 28.0) return measuredV - 0.75;
+  else if(measuredV >= 27.8) return measuredV - 0.70;
+  else if(measuredV >= 27.6) return measuredV - 0.60;
+  else if(measuredV >= 27.4) return measuredV - 0.50;
+  else if(measuredV >= 27.2) return measuredV - 0.40;
+  else if(measuredV >= 27.0) return measuredV - 0.30;
+  else if(measuredV >= 26.5) return measuredV - 0.25;
+  else if(measuredV >= 26.0) return measuredV + 0;
+  else if(measuredV >= 25.5) return measuredV + 0.40;
+  else if(measuredV >= 25.0) return measuredV + 0.50;
+  else if(measuredV >= 24.5) return measuredV + 0.60;
+  else if(measuredV >= 24.0) return measuredV + 0.70;
+  else if(measuredV >= 23.5) return measuredV + 0.80;
+  else if(measuredV >= 21.0) return measuredV + 1.00;
+  else return measuredV;
+}
+
+static const float DISCHARGE_EDGES[] = {21.5, 22.0, 24.0, 24.8, 25.0, 25.2, 25.5, 26.0, 28.5};
+static const float CHARGE_EDGES[] = {21.0, 23.5, 24.0, 24.5, 25.0, 25.5, 26.0, 26.5, 27.0, 27.2,
+                                     27.4, 27.6, 27.8, 28.0, 28.1, 28.2, 28.3, 28.4, 28.5};
+
+static int countMismatches(const CompensationTable& table, float (*ladder)(float),
+                           const float* edges, int edgeCount) {
+  int mismatches = 0;
+  auto compare = [&](float v) {
+    if (fabs(table.apply(v) - ladder(v)) > 1e-5) {
+      mismatches++;
+      fprintf(stderr, "  %.4f V: table %.4f, ladder %.4f\n", v, table.apply(v), ladder(v));
+    }
+  };
+
+  for (int i = 0; i < edgeCount; i++) {
+    // Either side of the edge (the ladder compares in double, the table in
+    // float, so the float nearest the edge itself may fall either way)
+    compare(edges[i] - 0.001f);
+    compare(edges[i] + 0.001f);
+    if (i + 1 < edgeCount) compare((edges[i] + edges[i + 1]) / 2);
+  }
+  // Whole range, every 5 mV, plus outside the tables
+  for (float v = 18.0f; v < 31.0f; v += 0.005f) {
+    bool nearEdge = false;
+    for (int i = 0; i < edgeCount; i++) {
+      if (fabs(v - edges[i]) < 1e-4) nearEdge = true;
+    }
+    if (!nearEdge) compare(v);
+  }
+  return mismatches;
+}
+
+static void testBuiltInMatchesLadders() {
+  CompensationTable discharge;
+  CompensationTable charge;
+  CHECK(discharge.load(VOLTAGE_COMP_DISCHARGE, VOLTAGE_COMP_DISCHARGE_POINTS));
+  CHECK(charge.load(VOLTAGE_COMP_CHARGE, VOLTAGE_COMP_CHARGE_POINTS));
+
+  CHECK(countMismatches(discharge, ladderDischarge, DISCHARGE_EDGES, 9) == 0);
+  CHECK(countMismatches(charge, ladderCharge, CHARGE_EDGES, 19) == 0);
+
+  // Exactly at an edge the table takes the upper band, like the ladder
+  CHECK_NEAR(discharge.offsetAt(21.5f), 1.50, 1e-6);
+  CHECK_NEAR(discharge.offsetAt(22.0f), 0.00, 1e-6);
+  CHECK_NEAR(discharge.offsetAt(28.5f), -1.00, 1e-6);
+  CHECK_NEAR(charge.offsetAt(21.0f), 1.00, 1e-6);
+  CHECK_NEAR(charge.offsetAt(26.5f), -0.25, 1e-6);
+
+  // Mid-band values quoted in the review of the interpolated tables
+  CHECK_NEAR(discharge.offsetAt(28.0f), 0.00, 1e-6);
+  CHECK_NEAR(discharge.offsetAt(21.75f), 1.50, 1e-6);
+  CHECK_NEAR(charge.offsetAt(22.25f), 1.00, 1e-6);
+}
+
+static void testInterpolation() {
+  const float table[][2] = {{22.0, 0.0}, {24.0, 0.5}, {26.0, 0.0}, {28.5, -1.0}};
+  CompensationTable t;
+  CHECK(t.load(table, 4));
+  CHECK(t.size() == 4);
+  CHECK_NEAR(t.offsetAt(20.0f), 0.0, 1e-6);
+  CHECK_NEAR(t.offsetAt(23.0f), 0.25, 1e-5);
+  CHECK_NEAR(t.offsetAt(24.0f), 0.5, 1e-6);
+  CHECK_NEAR(t.offsetAt(27.25f), -0.5, 1e-5);
+  CHECK_NEAR(t.offsetAt(30.0f), -1.0, 1e-6);
+  CHECK_NEAR(t.apply(25.0f), 25.25, 1e-5);
+
+  const float single[][2] = {{24.0, 0.3}};
+  CompensationTable one;
+  CHECK(one.load(single, 1));
+  CHECK_NEAR(one.offsetAt(10.0f), 0.3, 1e-6);
+  CHECK_NEAR(one.offsetAt(30.0f), 0.3, 1e-6);
+
+  CompensationTable empty;
+  CHECK(empty.offsetAt(25.0f) == 0);
+}
+
+static void testValidation() {
+  CompensationTable t;
+  const float good[][2] = {{22.0, 0.1}, {23.0, 0.2}};
+  CHECK(t.load(good, 2));
+
+  const float descending[][2] = {{23.0, 0.0}, {22.0, 0.0}};
+  const float tripled[][2] = {{22.0, 0.0}, {22.0, 0.5}, {22.0, 1.0}};
+  CHECK(!t.load(descending, 2));
+  CHECK(!t.load(tripled, 3));
+  CHECK(!t.load(good, 0));
+  CHECK(!t.load(good, COMP_TABLE_MAX_POINTS + 1));
+
+  // A failed load keeps the previous table
+  CHECK(t.size() == 2);
+  CHECK_NEAR(t.offsetAt(22.5f), 0.15, 1e-5);
+
+  // A two-point step on its own
+  const float step[][2] = {{25.0, 0.0}, {25.0, 1.0}};
+  CHECK(t.load(step, 2));
+  CHECK_NEAR(t.offsetAt(24.999f), 0.0, 1e-6);
+  CHECK_NEAR(t.offsetAt(25.0f), 1.0, 1e-6);
+}
+
+int main() {
+  testBuiltInMatchesLadders();
+  testInterpolation();
+  testValidation();
+  return testSummary("voltage_compensation");
+}